@@ -64,7 +64,8 @@ class CameraManager: NSObject, ObservableObject {
 
     // MARK: - Filter Rendering
 
-    private let filterRenderer = FilterRenderer()
+    // ★★★ NEW: Bounded async photo pipeline (1 FilterRenderer per in-flight shot) ★★★
+    private lazy var photoPipeline = PhotoProcessingPipeline()
     private var currentPreset: FilterPreset?
     
     // MARK: - Initialization
@@ -229,8 +230,9 @@ class CameraManager: NSObject, ObservableObject {
         // ★★★ FIX: Create video data output but DON'T set delegate ★★★
         // MetalPreviewView will take over and forward frames when recording
         let videoDataOutput = AVCaptureVideoDataOutput()
+        // ★★★ NEW: Sensor-native 420f (Y + CbCr) thay cho BGRA → ít bandwidth hơn, ISP không convert ★★★
         videoDataOutput.videoSettings = [
-            kCVPixelBufferPixelFormatTypeKey as String: kCVPixelFormatType_32BGRA
+            kCVPixelBufferPixelFormatTypeKey as String: CameraFrameTextures.preferredPixelFormat
         ]
         videoDataOutput.alwaysDiscardsLateVideoFrames = true
         // NOTE: Delegate will be set by MetalPreviewView
@@ -427,7 +429,7 @@ class CameraManager: NSObject, ObservableObject {
         // Create processor for this capture
         let processor = PhotoCaptureProcessor(
             preset: preset,
-            filterRenderer: filterRenderer,
+            pipeline: photoPipeline,
             completion: { [weak self] original, filtered in
                 DispatchQueue.main.async {
                     self?.isCapturing = false
@@ -547,6 +549,12 @@ class CameraManager: NSObject, ObservableObject {
         videoRecorder?.stopRecording()
     }
 
+    /// ★★★ NEW: Filtered frame the recorder just wrote (viewfinder reuses it instead of filtering again) ★★★
+    func latestRecordedFrame() -> CVPixelBuffer? {
+        guard isRecording else { return nil }
+        return videoRecorder?.latestFilteredFrame()
+    }
+
     /// Get the last recorded video URL
     var lastRecordedVideoURL: URL? {
         return nil // Will be provided via delegate
@@ -623,12 +631,12 @@ extension CameraManager: VideoRecorderDelegate {
 class PhotoCaptureProcessor: NSObject, AVCapturePhotoCaptureDelegate {
 
     private let preset: FilterPreset
-    private let filterRenderer: FilterRenderer
+    private let pipeline: PhotoProcessingPipeline
     private let completion: (UIImage?, UIImage?) -> Void // (original, filtered)
 
-    init(preset: FilterPreset, filterRenderer: FilterRenderer, completion: @escaping (UIImage?, UIImage?) -> Void) {
+    init(preset: FilterPreset, pipeline: PhotoProcessingPipeline, completion: @escaping (UIImage?, UIImage?) -> Void) {
         self.preset = preset
-        self.filterRenderer = filterRenderer
+        self.pipeline = pipeline
         self.completion = completion
         super.init()
     }
@@ -640,131 +648,16 @@ class PhotoCaptureProcessor: NSObject, AVCapturePhotoCaptureDelegate {
             return
         }
 
-        guard let imageData = photo.fileDataRepresentation(),
-              let originalImage = UIImage(data: imageData) else {
+        guard let imageData = photo.fileDataRepresentation() else {
             print("❌ PhotoCaptureProcessor: Failed to get image data")
             completion(nil, nil)
             return
         }
 
-        print("📸 PhotoCaptureProcessor: Processing \(Int(originalImage.size.width))×\(Int(originalImage.size.height)) image")
-
-        // Apply FULL quality filter pipeline (13 passes)
-        DispatchQueue.global(qos: .userInitiated).async { [weak self] in
-            guard let self = self else { return }
-
-            let startTime = CFAbsoluteTimeGetCurrent()
+        print("📸 PhotoCaptureProcessor: Queued \(imageData.count / 1024) KB photo")
 
-            if let filteredImage = self.applyFullQualityFilters(to: originalImage) {
-                let elapsed = CFAbsoluteTimeGetCurrent() - startTime
-                print("✅ PhotoCaptureProcessor: Full pipeline completed in \(String(format: "%.2f", elapsed))s")
-                self.completion(originalImage, filteredImage)
-            } else {
-                print("⚠️ PhotoCaptureProcessor: Filter failed, returning original")
-                self.completion(originalImage, originalImage)
-            }
-        }
-    }
-    
-    // MARK: - Apply Full Quality Filters (13 passes)
-
-    private func applyFullQualityFilters(to image: UIImage) -> UIImage? {
-        guard let cgImage = image.cgImage else { return nil }
-
-        // ★★★ FIX: Check if RenderEngine is available before using it ★★★
-        guard RenderEngine.isAvailable else {
-            print("⚠️ PhotoCaptureProcessor: RenderEngine not available, returning original image")
-            return image
-        }
-
-        let device = RenderEngine.shared.device
-        let commandQueue = RenderEngine.shared.commandQueue
-        
-        // Create input texture from CGImage
-        // ★ FIX: .SRGB: false để tránh double gamma decode
-        // Metal mặc định auto-decode sRGB→Linear, nhưng shader đã có srgbToLinear3()
-        let textureLoader = MTKTextureLoader(device: device)
-        guard let inputTexture = try? textureLoader.newTexture(cgImage: cgImage, options: [
-            .SRGB: false,  // ★ CRITICAL: Giữ nguyên sRGB values, shader sẽ convert
-            .textureUsage: NSNumber(value: MTLTextureUsage.shaderRead.rawValue),
-            .textureStorageMode: NSNumber(value: MTLStorageMode.shared.rawValue)
-        ]) else {
-            print("❌ PhotoCaptureProcessor: Failed to create input texture")
-            return nil
-        }
-        
-        // Create output texture (same size as input - FULL RESOLUTION)
-        let textureDescriptor = MTLTextureDescriptor.texture2DDescriptor(
-            pixelFormat: .bgra8Unorm,
-            width: cgImage.width,
-            height: cgImage.height,
-            mipmapped: false
-        )
-        textureDescriptor.usage = [.shaderRead, .shaderWrite, .renderTarget]
-        textureDescriptor.storageMode = .shared
-        
-        guard let outputTexture = device.makeTexture(descriptor: textureDescriptor) else {
-            print("❌ PhotoCaptureProcessor: Failed to create output texture")
-            return nil
-        }
-        
-        print("🎨 PhotoCaptureProcessor: Applying FULL 13-pass pipeline at \(cgImage.width)×\(cgImage.height)")
-        
-        // Use SYNCHRONOUS render with FULL quality
-        let success = filterRenderer.renderSync(
-            input: inputTexture,
-            output: outputTexture,
-            preset: preset,
-            commandQueue: commandQueue
-        )
-        
-        guard success else {
-            print("❌ PhotoCaptureProcessor: Render failed")
-            return nil
-        }
-        
-        // Convert output texture back to UIImage
-        return textureToImage(outputTexture, orientation: image.imageOrientation)
-    }
-    
-    private func textureToImage(_ texture: MTLTexture, orientation: UIImage.Orientation) -> UIImage? {
-        let width = texture.width
-        let height = texture.height
-        let bytesPerRow = width * 4
-        
-        var pixelData = [UInt8](repeating: 0, count: width * height * 4)
-        
-        texture.getBytes(
-            &pixelData,
-            bytesPerRow: bytesPerRow,
-            from: MTLRegion(origin: MTLOrigin(x: 0, y: 0, z: 0), size: MTLSize(width: width, height: height, depth: 1)),
-            mipmapLevel: 0
-        )
-        
-        // Convert BGRA to RGBA
-        for i in stride(from: 0, to: pixelData.count, by: 4) {
-            let b = pixelData[i]
-            let r = pixelData[i + 2]
-            pixelData[i] = r
-            pixelData[i + 2] = b
-        }
-        
-        let colorSpace = CGColorSpaceCreateDeviceRGB()
-        let bitmapInfo = CGBitmapInfo(rawValue: CGImageAlphaInfo.premultipliedLast.rawValue)
-        
-        guard let context = CGContext(
-            data: &pixelData,
-            width: width,
-            height: height,
-            bitsPerComponent: 8,
-            bytesPerRow: bytesPerRow,
-            space: colorSpace,
-            bitmapInfo: bitmapInfo.rawValue
-        ),
-        let cgImage = context.makeImage() else {
-            return nil
-        }
-        
-        return UIImage(cgImage: cgImage, scale: 1.0, orientation: orientation)
+        // ★★★ NEW: Decode + FULL quality filter (13 passes) + readback run in PhotoProcessingPipeline ★★★
+        // Không block thread nào khi chờ GPU; burst shots overlap
+        pipeline.submit(photoData: imageData, preset: preset, completion: completion)
     }
 }
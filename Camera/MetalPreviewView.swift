@@ -1,6 +1,8 @@
 // MetalPreviewView.swift
 // Film Camera - Metal-based Camera Preview with Real-time Filtering
 // ★★★ OPTIMIZED: 1080p preview + 4-pass pipeline for 60fps ★★★
+// ★★★ NEW: Native 420f (YUV) camera input, converted in the first GPU pass ★★★
+// ★★★ NEW: Triple-buffered frame pacing, 120 / 60 / 30 Hz (PreviewFramePacer) ★★★
 
 import SwiftUI
 import MetalKit
@@ -38,7 +40,14 @@ struct MetalPreviewView: UIViewRepresentable {
     // MARK: - Coordinator
 
     class Coordinator: NSObject, MTKViewDelegate, AVCaptureVideoDataOutputSampleBufferDelegate {
-        var currentPreset: FilterPreset
+        var currentPreset: FilterPreset {
+            didSet {
+                // ★ Compile specialized pipelines ngay khi đổi preset
+                if oldValue != currentPreset {
+                    filterRenderer.prewarmSpecializedPipelines(for: currentPreset)
+                }
+            }
+        }
         var isFrontCamera: Bool = false {
             didSet {
                 if oldValue != isFrontCamera {
@@ -50,11 +59,13 @@ struct MetalPreviewView: UIViewRepresentable {
         // ★★★ FIX: Keep weak reference to cameraManager for frame forwarding ★★★
         weak var cameraManager: CameraManager?
 
-        private var currentPixelBuffer: CVPixelBuffer?
+        // ★★★ NEW: Camera frame handoff + triple-buffered pacing (thay cho currentPixelBuffer) ★★★
+        private let framePacer = PreviewFramePacer()
         private var currentSampleBuffer: CMSampleBuffer?
         private var textureCache: CVMetalTextureCache?
         private let filterRenderer: FilterRenderer
         private var videoOutputAdded = false
+        private weak var videoOutput: AVCaptureVideoDataOutput?
 
         // Orientation tracking
         private var orientationNeedsUpdate = true
@@ -70,6 +81,8 @@ struct MetalPreviewView: UIViewRepresentable {
             self.filterRenderer = FilterRenderer()
             super.init()
 
+            filterRenderer.prewarmSpecializedPipelines(for: preset)
+
             // ★★★ FIX: Validate texture cache creation ★★★
             var cache: CVMetalTextureCache?
             let status = CVMetalTextureCacheCreate(nil, nil, RenderEngine.shared.device, nil, &cache)
@@ -112,6 +125,7 @@ struct MetalPreviewView: UIViewRepresentable {
                         configureVideoOrientation(connection)
                     }
 
+                    self.videoOutput = existingOutput
                     videoOutputAdded = true
                     print("✅ MetalPreviewView: Using existing video output")
                 }
@@ -122,9 +136,9 @@ struct MetalPreviewView: UIViewRepresentable {
             let videoOutput = AVCaptureVideoDataOutput()
             videoOutput.setSampleBufferDelegate(self, queue: DispatchQueue(label: "video.preview", qos: .userInteractive))
 
-            // Request BGRA format for optimal Metal performance
+            // ★ 420f (sensor-native) khi bật, BGRA nếu tắt
             videoOutput.videoSettings = [
-                kCVPixelBufferPixelFormatTypeKey as String: kCVPixelFormatType_32BGRA
+                kCVPixelBufferPixelFormatTypeKey as String: CameraFrameTextures.preferredPixelFormat
             ]
             videoOutput.alwaysDiscardsLateVideoFrames = true
 
@@ -137,6 +151,7 @@ struct MetalPreviewView: UIViewRepresentable {
                     configureVideoOrientation(connection)
                 }
 
+                self.videoOutput = videoOutput
                 videoOutputAdded = true
                 print("✅ MetalPreviewView: Created new video output")
             }
@@ -164,7 +179,10 @@ struct MetalPreviewView: UIViewRepresentable {
             }
 
             guard let pixelBuffer = CMSampleBufferGetImageBuffer(sampleBuffer) else { return }
-            currentPixelBuffer = pixelBuffer
+            if !framePacer.hasFrame {
+                StartupMetrics.shared.mark(.firstCameraFrame)
+            }
+            framePacer.submit(pixelBuffer)
 
             // ★★★ FIX: Forward frames to CameraManager for video recording ★★★
             if let manager = cameraManager, manager.isRecording {
@@ -189,69 +207,127 @@ struct MetalPreviewView: UIViewRepresentable {
         }
 
         func draw(in view: MTKView) {
-            guard let pixelBuffer = currentPixelBuffer,
-                  let drawable = view.currentDrawable,
-                  let textureCache = textureCache else {
+            updateFrameRate(view)
+
+            // ★ Không có camera frame mới / đã 3 frame in flight → bỏ tick, không tốn GPU
+            guard let textureCache = textureCache,
+                  let pixelBuffer = framePacer.beginFrame() else {
                 return
             }
 
-            // Create texture from pixel buffer (already 1080p from AVCaptureSession)
-            guard let inputTexture = createTexture(from: pixelBuffer, cache: textureCache) else {
+            // Drawable chỉ lấy khi thật sự render
+            guard let drawable = view.currentDrawable else {
+                framePacer.cancelFrame()
                 return
             }
+            let completion: (MTLCommandBuffer) -> Void = { [framePacer] commandBuffer in
+                framePacer.frameCompleted(commandBuffer)
+            }
+
+            // ★★★ NEW: Recording → recorder đã filter frame này; chỉ aspect-fill scale lên drawable ★★★
+            // Halves GPU work per recorded frame (trước đây preview + recorder filter riêng)
+            if let manager = cameraManager,
+               let recordedFrame = manager.latestRecordedFrame(),
+               let recordedTextures = CameraFrameTextures.make(from: recordedFrame, cache: textureCache) {
+                let committed = filterRenderer.presentScaled(
+                    input: recordedTextures.primary,
+                    drawable: drawable,
+                    commandQueue: filterRenderer.stream.commandQueue,
+                    completion: completion
+                )
+                if !committed {
+                    framePacer.cancelFrame()
+                }
+
+                #if DEBUG
+                trackFrameRate()
+                #endif
+                return
+            }
+
+            // Create textures from pixel buffer (already 1080p from AVCaptureSession)
+            // 420f → Y + CbCr planes, YUV→RGB chạy trong fused pass đầu tiên
+            guard let frame = CameraFrameTextures.make(from: pixelBuffer, cache: textureCache) else {
+                framePacer.cancelFrame()
+                return
+            }
+
+            // ★ Time-to-first-frame: đo tới lúc frame đầu thật sự lên màn hình
+            if !StartupMetrics.shared.hasPresentedFirstFrame {
+                drawable.addPresentedHandler { presented in
+                    // presentedTime == 0 → drawable bị drop, chờ frame sau
+                    if presented.presentedTime > 0 {
+                        StartupMetrics.shared.mark(.firstFramePresented)
+                    }
+                }
+            }
 
             // ★★★ Use optimized preview pipeline (Option B: 4 passes) ★★★
             // Skips: Lens Distortion, Halation (4 passes), Instant Frame
             // Uses: ColorGrading, Grain, Bloom (simplified), Vignette
-            filterRenderer.renderPreview(
-                input: inputTexture,
+            let committed = filterRenderer.renderPreview(
+                input: frame.primary,
+                chroma: frame.chroma,
+                yuvMatrix: frame.yuvMatrix,
                 drawable: drawable,
                 preset: currentPreset,
-                commandQueue: RenderEngine.shared.commandQueue
+                commandQueue: filterRenderer.stream.commandQueue,
+                completion: completion
             )
-            
+            if !committed {
+                framePacer.cancelFrame()
+
+                // ★ YUV → RGB lỗi → frame bị bỏ (không hiện ảnh chỉ có luma), camera chuyển sang BGRA
+                if frame.isYUV, filterRenderer.lastDiscardedPass != nil {
+                    fallBackToBGRAInput()
+                }
+            }
+
             #if DEBUG
             trackFrameRate()
             #endif
         }
-        
-        // MARK: - Texture Creation
-        
-        private func createTexture(from pixelBuffer: CVPixelBuffer, cache: CVMetalTextureCache) -> MTLTexture? {
-            var cvTexture: CVMetalTexture?
-            let width = CVPixelBufferGetWidth(pixelBuffer)
-            let height = CVPixelBufferGetHeight(pixelBuffer)
-
-            let status = CVMetalTextureCacheCreateTextureFromImage(
-                nil,
-                cache,
-                pixelBuffer,
-                nil,
-                .bgra8Unorm,
-                width,
-                height,
-                0,
-                &cvTexture
-            )
 
-            guard status == kCVReturnSuccess,
-                  let cvTexture = cvTexture,
-                  let texture = CVMetalTextureGetTexture(cvTexture) else {
-                return nil
+        /// Switch the video output to 32BGRA (CameraFrameTextures.preferYUVInput = false)
+        /// Frames 420f còn trong hàng đợi tiếp tục bị bỏ tới khi frame BGRA đầu tiên tới
+        private func fallBackToBGRAInput() {
+            guard CameraFrameTextures.preferYUVInput else { return }
+            CameraFrameTextures.preferYUVInput = false
+            print("⚠️ MetalPreviewView: YUV conversion failed, switching camera frames to BGRA")
+
+            guard let videoOutput = videoOutput else { return }
+            let settings: [String: Any] = [
+                kCVPixelBufferPixelFormatTypeKey as String: CameraFrameTextures.preferredPixelFormat
+            ]
+            // Đổi videoSettings = session reconfigure → không chặn main thread
+            DispatchQueue.global(qos: .userInitiated).async {
+                videoOutput.videoSettings = settings
             }
-            
-            return texture
         }
         
+        /// ★ 120 Hz khi preset rẻ (GPU time thấp), 60 Hz mặc định, 30 Hz khi thermal serious
+        private func updateFrameRate(_ view: MTKView) {
+            let target = framePacer.targetFramesPerSecond
+            // Governor giữ budget 60 Hz (120 Hz chỉ bật khi đã dư GPU), thermal 30 Hz → budget 33ms
+            filterRenderer.qualityGovernor.frameBudget = 1.0 / Double(min(target, 60))
+            guard view.preferredFramesPerSecond != target else { return }
+
+            view.preferredFramesPerSecond = target
+            print("🎬 MetalPreviewView: Frame rate → \(target) Hz (\(framePacer.targetReason))")
+        }
+
         private func trackFrameRate() {
             frameCount += 1
             let now = CFAbsoluteTimeGetCurrent()
             if now - lastFrameTime >= 2.0 {  // Log every 2 seconds
                 let fps = Double(frameCount) / (now - lastFrameTime)
-                if fps < 55 {
-                    print("⚠️ MetalPreviewView: FPS: \(Int(fps)) (target: 60)")
+                let pacing = framePacer.statistics()
+                let pacingInfo = "\(pacing.repeated) repeated / \(pacing.busy) busy ticks skipped, GPU \(String(format: "%.2f", pacing.gpuMilliseconds))ms"
+                // Camera giao 30/60 fps → FPS render = min(camera, display target)
+                if fps < 25 {
+                    print("⚠️ MetalPreviewView: FPS: \(Int(fps)) (display target: \(framePacer.targetFramesPerSecond)), \(pacingInfo)")
                 } else {
-                    print("✅ MetalPreviewView: FPS: \(Int(fps))")
+                    print("✅ MetalPreviewView: FPS: \(Int(fps)), \(pacingInfo)")
                 }
                 frameCount = 0
                 lastFrameTime = now
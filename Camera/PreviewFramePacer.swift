@@ -0,0 +1,165 @@
+// PreviewFramePacer.swift
+// Film Camera - Frame pacing for the Metal viewfinder
+// ★★★ NEW: ≤ 3 frames in flight, chỉ render khi có camera frame mới, 120 / 60 / 30 Hz theo GPU time + thermal ★★★
+
+import Foundation
+import Metal
+import CoreVideo
+import UIKit
+
+/// Hands camera frames from the capture queue to MTKView ticks
+///
+/// - Capture callback chỉ submit() buffer mới nhất (lock) → draw không còn đọc biến đang bị ghi
+/// - beginFrame() trả nil khi không có frame mới (tick 120 Hz, camera 30/60 fps) hoặc đã có
+///   maxFramesInFlight command buffers chưa xong → không filter lại cùng 1 frame, không dồn burst
+/// - GPU time đo từ command buffer đã xong → preset rẻ cho phép ProMotion 120 Hz (hysteresis);
+///   thermal serious / critical → 30 Hz, Low Power Mode → tối đa 60 Hz
+final class PreviewFramePacer {
+
+    /// Triple buffering: CPU encode frame N+2 trong khi GPU chạy N+1 và display giữ N
+    static let maxFramesInFlight = 3
+
+    private let inFlight = DispatchSemaphore(value: PreviewFramePacer.maxFramesInFlight)
+
+    private var latestBuffer: CVPixelBuffer?
+    private var latestSequence: UInt64 = 0
+    private var renderedSequence: UInt64 = 0
+
+    private var gpuTimeAverage: Double = 0
+    private var allowsHighRefresh = false
+    private var renderedCount = 0
+    private var repeatedCount = 0
+    private var busyCount = 0
+    private let lock = NSLock()
+
+    /// false → render mỗi tick như cũ (vẫn giới hạn in-flight)
+    var skipsRepeatedFrames = true
+
+    /// Display refresh ceiling (120 trên ProMotion, 60 còn lại)
+    let maximumFramesPerSecond = UIScreen.main.maximumFramesPerSecond
+
+    /// GPU time / frame below which 120 Hz is allowed, above which it falls back to 60 Hz
+    /// (phần của budget 8.3ms → còn chỗ cho compositor + jitter)
+    var highRefreshEnterBudget: Double = 0.4 / 120
+    var highRefreshExitBudget: Double = 0.65 / 120
+
+    // MARK: - Capture Queue
+
+    /// Latest camera frame (older unrendered frames are dropped, không xếp hàng)
+    func submit(_ pixelBuffer: CVPixelBuffer) {
+        lock.lock()
+        latestBuffer = pixelBuffer
+        latestSequence += 1
+        lock.unlock()
+    }
+
+    /// A camera frame has arrived since launch / camera switch
+    var hasFrame: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return latestBuffer != nil
+    }
+
+    // MARK: - Draw
+
+    /// Frame to render this tick, nil = skip (no new camera frame or too many frames in flight)
+    /// Non-nil → caller phải gọi frameCompleted(_:) hoặc cancelFrame() đúng 1 lần
+    func beginFrame() -> CVPixelBuffer? {
+        lock.lock()
+        guard let buffer = latestBuffer else {
+            lock.unlock()
+            return nil
+        }
+        if skipsRepeatedFrames && latestSequence == renderedSequence {
+            repeatedCount += 1
+            lock.unlock()
+            return nil
+        }
+        lock.unlock()
+
+        // Không block main thread: GPU còn bận 3 frame → bỏ tick, frame mới vẫn chờ tick sau
+        guard inFlight.wait(timeout: .now()) == .success else {
+            lock.lock()
+            busyCount += 1
+            lock.unlock()
+            return nil
+        }
+
+        lock.lock()
+        renderedSequence = latestSequence
+        renderedCount += 1
+        lock.unlock()
+        return buffer
+    }
+
+    /// Frame began but nothing was committed (no drawable, encode failed)
+    func cancelFrame() {
+        inFlight.signal()
+    }
+
+    /// Command buffer of a begun frame completed (any thread)
+    func frameCompleted(_ commandBuffer: MTLCommandBuffer) {
+        let gpuTime = commandBuffer.gpuEndTime - commandBuffer.gpuStartTime
+        inFlight.signal()
+
+        guard commandBuffer.status == .completed, gpuTime > 0 else { return }
+
+        lock.lock()
+        gpuTimeAverage = gpuTimeAverage == 0 ? gpuTime : gpuTimeAverage * 0.9 + gpuTime * 0.1
+        if allowsHighRefresh {
+            allowsHighRefresh = gpuTimeAverage < highRefreshExitBudget
+        } else {
+            allowsHighRefresh = gpuTimeAverage < highRefreshEnterBudget
+        }
+        lock.unlock()
+    }
+
+    // MARK: - Refresh Rate
+
+    /// preferredFramesPerSecond for the current GPU cost, thermal state and power mode
+    var targetFramesPerSecond: Int {
+        let processInfo = ProcessInfo.processInfo
+        switch processInfo.thermalState {
+        case .serious, .critical:
+            return min(30, maximumFramesPerSecond)
+        default:
+            break
+        }
+
+        lock.lock()
+        let highRefresh = allowsHighRefresh
+        lock.unlock()
+
+        if highRefresh && !processInfo.isLowPowerModeEnabled {
+            return min(120, maximumFramesPerSecond)
+        }
+        return min(60, maximumFramesPerSecond)
+    }
+
+    /// Reason for the current target (logging)
+    var targetReason: String {
+        switch ProcessInfo.processInfo.thermalState {
+        case .serious: return "thermal serious"
+        case .critical: return "thermal critical"
+        default: break
+        }
+        if ProcessInfo.processInfo.isLowPowerModeEnabled { return "low power mode" }
+
+        lock.lock()
+        defer { lock.unlock() }
+        return "GPU \(String(format: "%.2f", gpuTimeAverage * 1000))ms/frame"
+    }
+
+    /// Get pacing statistics for debugging (counts reset mỗi lần gọi)
+    func statistics() -> (rendered: Int, repeated: Int, busy: Int, gpuMilliseconds: Double) {
+        lock.lock()
+        defer {
+            renderedCount = 0
+            repeatedCount = 0
+            busyCount = 0
+            lock.unlock()
+        }
+
+        return (renderedCount, repeatedCount, busyCount, gpuTimeAverage * 1000)
+    }
+}
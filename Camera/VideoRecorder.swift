@@ -3,7 +3,7 @@
 //  Film Camera
 //
 //  Video recording with real-time filter application
-//  Uses optimized 2-pass pipeline for 30fps performance
+//  ★★★ NEW: Viewfinder-quality chain, 2-3 frames in flight, append from GPU completion ★★★
 //
 
 import AVFoundation
@@ -53,6 +53,17 @@ final class VideoRecorder {
     private let filterRenderer: FilterRenderer
     private var metalTextureCache: CVMetalTextureCache?
 
+    // ★★★ NEW: Pipelined GPU encode ★★★
+    // Frames đang chờ GPU; finalize đợi group rỗng trước khi markAsFinished
+    private let framesInFlight = DispatchGroup()
+    private let inFlightLock = NSLock()
+    private var inFlightCount = 0
+    private var framesRendered = 0
+    private var framesDropped = 0
+
+    // ★★★ NEW: Last appended frame, shown by the viewfinder while recording ★★★
+    private var latestFrame: CVPixelBuffer?
+
     // Thread safety
     private let recordingQueue = DispatchQueue(label: "com.filmcamera.video.recording", qos: .userInitiated)
     private let writingQueue = DispatchQueue(label: "com.filmcamera.video.writing", qos: .userInitiated)
@@ -68,6 +79,13 @@ final class VideoRecorder {
         var frameRate: Int = 30
         var bitRate: Int = 10_000_000 // 10 Mbps
         var codec: AVVideoCodecType = .h264
+
+        /// .video = same chain as the viewfinder (grain, bloom, leaks, VHS, date stamp...)
+        /// .capture = full quality separable blur (nặng hơn, dùng cho 1080p30)
+        var filterQuality: RenderQuality = .video
+
+        /// GPU frames queued before new camera frames are dropped
+        var maxFramesInFlight: Int = 3
     }
 
     struct AudioSettings {
@@ -82,15 +100,18 @@ final class VideoRecorder {
     // MARK: - Initialization
 
     init?() {
-        guard let device = MTLCreateSystemDefaultDevice(),
-              let commandQueue = device.makeCommandQueue() else {
-            print("❌ VideoRecorder: Failed to create Metal device")
+        guard RenderEngine.isAvailable else {
+            print("❌ VideoRecorder: RenderEngine not available")
             return nil
         }
 
+        // ★ Stream .recording: queue + TexturePool riêng → frame ghi hình không xếp hàng sau viewfinder / capture
+        // (transient heap textures của pool chỉ alias an toàn trong queue của chính stream đó)
+        let device = RenderEngine.shared.device
+        let stream = RenderEngine.shared.stream(.recording)
         self.device = device
-        self.commandQueue = commandQueue
-        self.filterRenderer = FilterRenderer()
+        self.commandQueue = stream.commandQueue
+        self.filterRenderer = FilterRenderer(stream: stream)
 
         // Create Metal texture cache
         var textureCache: CVMetalTextureCache?
@@ -144,6 +165,14 @@ final class VideoRecorder {
         }
     }
 
+    /// Most recent filtered frame handed to the writer (nil before the first frame lands)
+    /// MetalPreviewView scales this onto the drawable → filter chain chạy 1 lần cho cả preview + file
+    func latestFilteredFrame() -> CVPixelBuffer? {
+        inFlightLock.lock()
+        defer { inFlightLock.unlock() }
+        return latestFrame
+    }
+
     /// Process an audio sample from camera output
     func processAudioSample(_ sampleBuffer: CMSampleBuffer) {
         guard isRecording,
@@ -250,6 +279,10 @@ final class VideoRecorder {
             isRecording = true
             startTime = nil
             recordingDuration = 0
+            inFlightLock.lock()
+            framesRendered = 0
+            framesDropped = 0
+            inFlightLock.unlock()
 
             // Start duration timer on main thread
             DispatchQueue.main.async { [weak self] in
@@ -277,7 +310,8 @@ final class VideoRecorder {
         poolHeight = videoSettings.height
 
         let poolAttributes: [String: Any] = [
-            kCVPixelBufferPoolMinimumBufferCountKey as String: 3
+            // In-flight frames + buffers the encoder is still holding + latestFrame (viewfinder)
+            kCVPixelBufferPoolMinimumBufferCountKey as String: videoSettings.maxFramesInFlight + 3
         ]
 
         let pixelBufferAttributes: [String: Any] = [
@@ -303,7 +337,8 @@ final class VideoRecorder {
     // MARK: - Frame Writing
 
     private func writeVideoFrame(_ sampleBuffer: CMSampleBuffer) {
-        guard let writer = assetWriter,
+        guard isRecording,
+              let writer = assetWriter,
               writer.status == .writing,
               let videoInput = videoInput,
               let adaptor = pixelBufferAdaptor,
@@ -325,16 +360,50 @@ final class VideoRecorder {
             return
         }
 
-        // Apply filter and get output pixel buffer
-        guard let filteredPixelBuffer = applyFilter(to: sourcePixelBuffer, preset: preset) else {
-            // If filter fails, skip frame
+        // ★ GPU quá tải → drop frame thay vì block camera queue
+        guard beginFrame() else {
             return
         }
 
-        // Append to writer
-        if videoInput.isReadyForMoreMediaData {
-            adaptor.append(filteredPixelBuffer, withPresentationTime: presentationTime)
+        // Apply filter asynchronously; append happens in the command buffer completion handler
+        // Command buffers trên 1 queue hoàn thành theo thứ tự → presentation time luôn tăng dần
+        applyFilter(to: sourcePixelBuffer, preset: preset) { [weak self] filteredPixelBuffer in
+            var appended = false
+            if let filteredPixelBuffer = filteredPixelBuffer,
+               writer.status == .writing,
+               videoInput.isReadyForMoreMediaData {
+                appended = adaptor.append(filteredPixelBuffer, withPresentationTime: presentationTime)
+            }
+            self?.endFrame(appended: appended ? filteredPixelBuffer : nil)
+        }
+    }
+
+    /// Reserve an in-flight slot (false → drop this frame)
+    private func beginFrame() -> Bool {
+        inFlightLock.lock()
+        defer { inFlightLock.unlock() }
+
+        guard inFlightCount < videoSettings.maxFramesInFlight else {
+            framesDropped += 1
+            return false
         }
+        inFlightCount += 1
+        framesInFlight.enter()
+        return true
+    }
+
+    private func endFrame(appended frame: CVPixelBuffer?) {
+        inFlightLock.lock()
+        inFlightCount -= 1
+        if let frame = frame {
+            framesRendered += 1
+            latestFrame = frame
+        } else {
+            framesDropped += 1
+        }
+        inFlightLock.unlock()
+
+        framesInFlight.leave()
     }
 
     private func writeAudioSample(_ sampleBuffer: CMSampleBuffer) {
@@ -352,9 +421,11 @@ final class VideoRecorder {
 
     // MARK: - Filter Application
 
-    private func applyFilter(to pixelBuffer: CVPixelBuffer, preset: FilterPreset) -> CVPixelBuffer? {
+    /// Encode the filter chain into a pool buffer; completion fires exactly once (nil on failure)
+    private func applyFilter(to pixelBuffer: CVPixelBuffer, preset: FilterPreset, completion: @escaping (CVPixelBuffer?) -> Void) {
         guard let textureCache = metalTextureCache else {
-            return nil
+            completion(nil)
+            return
         }
 
         let width = CVPixelBufferGetWidth(pixelBuffer)
@@ -369,27 +440,14 @@ final class VideoRecorder {
         }
 
         guard let pool = pixelBufferPool else {
-            return nil
+            completion(nil)
+            return
         }
 
-        // Create input texture from source pixel buffer
-        var inputTextureRef: CVMetalTexture?
-        let inputStatus = CVMetalTextureCacheCreateTextureFromImage(
-            nil,
-            textureCache,
-            pixelBuffer,
-            nil,
-            .bgra8Unorm,
-            width,
-            height,
-            0,
-            &inputTextureRef
-        )
-
-        guard inputStatus == kCVReturnSuccess,
-              let inputTexture = inputTextureRef,
-              let metalInputTexture = CVMetalTextureGetTexture(inputTexture) else {
-            return nil
+        // Create input textures from source pixel buffer (BGRA hoặc 420f Y + CbCr)
+        guard let inputFrame = CameraFrameTextures.make(from: pixelBuffer, cache: textureCache) else {
+            completion(nil)
+            return
         }
 
         // Get output pixel buffer from pool
@@ -398,16 +456,22 @@ final class VideoRecorder {
 
         guard poolStatus == kCVReturnSuccess,
               let outputBuffer = outputPixelBuffer else {
-            return nil
+            completion(nil)
+            return
         }
 
         // ★★★ FIX: Use actual frame dimensions for output texture ★★★
+        // Render target usage → final pass ghi thẳng vào pool buffer (không blit)
+        let outputAttributes = [
+            kCVMetalTextureUsage as String: NSNumber(value: MTLTextureUsage([.shaderRead, .renderTarget]).rawValue)
+        ] as CFDictionary
+
         var outputTextureRef: CVMetalTexture?
         let outputStatus = CVMetalTextureCacheCreateTextureFromImage(
             nil,
             textureCache,
             outputBuffer,
-            nil,
+            outputAttributes,
             .bgra8Unorm,
             width,
             height,
@@ -418,19 +482,25 @@ final class VideoRecorder {
         guard outputStatus == kCVReturnSuccess,
               let outputTexture = outputTextureRef,
               let metalOutputTexture = CVMetalTextureGetTexture(outputTexture) else {
-            return nil
+            completion(nil)
+            return
         }
 
-        // Apply filter using optimized gallery preview pipeline (2 passes: ColorGrading + Vignette)
-        // This is the fastest pipeline suitable for real-time video recording
-        let success = filterRenderer.renderGalleryPreview(
-            input: metalInputTexture,
+        // Viewfinder chain at input resolution (hoặc full quality nếu filterQuality = .capture)
+        filterRenderer.renderAsync(
+            input: inputFrame.primary,
+            chroma: inputFrame.chroma,
+            yuvMatrix: inputFrame.yuvMatrix,
             output: metalOutputTexture,
             preset: preset,
+            quality: videoSettings.filterQuality,
             commandQueue: commandQueue
-        )
-
-        return success ? outputBuffer : nil
+        ) { success in
+            // CVMetalTexture refs phải sống tới khi GPU xong
+            withExtendedLifetime((inputFrame, outputTexture)) {
+                completion(success ? outputBuffer : nil)
+            }
+        }
     }
 
     // MARK: - Finalization
@@ -448,6 +518,22 @@ final class VideoRecorder {
             self?.stopDurationTimer()
         }
 
+        // ★ Frames đã queue trên writingQueue vào group trước; đợi GPU append xong rồi mới finish
+        writingQueue.async { [weak self] in
+            guard let self = self else { return }
+            self.framesInFlight.notify(queue: self.recordingQueue) { [weak self] in
+                self?.finishWriting(writer, outputURL: outputURL)
+            }
+        }
+    }
+
+    private func finishWriting(_ writer: AVAssetWriter, outputURL: URL) {
+        inFlightLock.lock()
+        let rendered = framesRendered
+        let dropped = framesDropped
+        inFlightLock.unlock()
+        print("📊 VideoRecorder: \(rendered) frames written, \(dropped) dropped (\(videoSettings.filterQuality.rawValue) quality)")
+
         // Mark inputs as finished
         videoInput?.markAsFinished()
         audioInput?.markAsFinished()
@@ -482,6 +568,10 @@ final class VideoRecorder {
         pixelBufferAdaptor = nil
         startTime = nil
         currentPreset = nil
+
+        inFlightLock.lock()
+        latestFrame = nil
+        inFlightLock.unlock()
     }
 
     // MARK: - Duration Timer
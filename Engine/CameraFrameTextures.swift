@@ -0,0 +1,119 @@
+// CameraFrameTextures.swift
+// Film Camera - Camera pixel buffer → Metal textures (BGRA or 420f bi-planar)
+// ★★★ NEW: Native YUV input path for preview + recording ★★★
+
+import Foundation
+import Metal
+import CoreVideo
+
+/// Metal views of one camera frame
+///
+/// - 32BGRA: primary = bgra8Unorm, chroma = nil
+/// - 420YpCbCr8BiPlanarFullRange: primary = Y (r8Unorm), chroma = CbCr (rg8Unorm, half res)
+///   → render graph convert YUV→RGB trong pass đầu tiên (fused / yuvToRGBFragment)
+struct CameraFrameTextures {
+
+    let primary: MTLTexture
+    let chroma: MTLTexture?
+    let yuvMatrix: YUVMatrix
+
+    /// CVMetalTexture refs phải sống tới khi GPU đọc xong
+    private let metalTextures: [CVMetalTexture]
+
+    var isYUV: Bool { return chroma != nil }
+
+    /// Pixel format the capture session should deliver
+    /// 420f: ~1.5 byte/pixel thay vì 4 byte/pixel của BGRA, ISP không phải convert
+    static var preferredPixelFormat: OSType {
+        return preferYUVInput ? kCVPixelFormatType_420YpCbCr8BiPlanarFullRange : kCVPixelFormatType_32BGRA
+    }
+
+    /// Toggle native YUV camera input (false → BGRA như trước)
+    /// Đọc trên session queue (CameraManager), ghi từ main khi YUVConvert lỗi (MetalPreviewView) → lock-guarded
+    static var preferYUVInput: Bool {
+        get {
+            preferenceLock.lock()
+            defer { preferenceLock.unlock() }
+            return yuvInputPreferred
+        }
+        set {
+            preferenceLock.lock()
+            defer { preferenceLock.unlock() }
+            yuvInputPreferred = newValue
+        }
+    }
+
+    private static var yuvInputPreferred = true
+    private static let preferenceLock = NSLock()
+
+    /// Wrap a BGRA or 420f pixel buffer; nil for unsupported formats
+    static func make(from pixelBuffer: CVPixelBuffer, cache: CVMetalTextureCache) -> CameraFrameTextures? {
+        switch CVPixelBufferGetPixelFormatType(pixelBuffer) {
+        case kCVPixelFormatType_32BGRA:
+            guard let bgra = makePlaneTexture(pixelBuffer, plane: 0, format: .bgra8Unorm, cache: cache) else { return nil }
+            return CameraFrameTextures(primary: bgra.texture, chroma: nil, yuvMatrix: YUVMatrixBT709, metalTextures: [bgra.ref])
+
+        case kCVPixelFormatType_420YpCbCr8BiPlanarFullRange:
+            guard let luma = makePlaneTexture(pixelBuffer, plane: 0, format: .r8Unorm, cache: cache),
+                  let chroma = makePlaneTexture(pixelBuffer, plane: 1, format: .rg8Unorm, cache: cache) else {
+                return nil
+            }
+            return CameraFrameTextures(
+                primary: luma.texture,
+                chroma: chroma.texture,
+                yuvMatrix: matrix(of: pixelBuffer),
+                metalTextures: [luma.ref, chroma.ref]
+            )
+
+        default:
+            #if DEBUG
+            print("⚠️ CameraFrameTextures: Unsupported pixel format \(CVPixelBufferGetPixelFormatType(pixelBuffer))")
+            #endif
+            return nil
+        }
+    }
+
+    // MARK: - Private
+
+    private static func makePlaneTexture(
+        _ pixelBuffer: CVPixelBuffer,
+        plane: Int,
+        format: MTLPixelFormat,
+        cache: CVMetalTextureCache
+    ) -> (texture: MTLTexture, ref: CVMetalTexture)? {
+        let isPlanar = CVPixelBufferIsPlanar(pixelBuffer)
+        let width = isPlanar ? CVPixelBufferGetWidthOfPlane(pixelBuffer, plane) : CVPixelBufferGetWidth(pixelBuffer)
+        let height = isPlanar ? CVPixelBufferGetHeightOfPlane(pixelBuffer, plane) : CVPixelBufferGetHeight(pixelBuffer)
+
+        var cvTexture: CVMetalTexture?
+        let status = CVMetalTextureCacheCreateTextureFromImage(
+            nil,
+            cache,
+            pixelBuffer,
+            nil,
+            format,
+            width,
+            height,
+            plane,
+            &cvTexture
+        )
+
+        guard status == kCVReturnSuccess,
+              let ref = cvTexture,
+              let texture = CVMetalTextureGetTexture(ref) else {
+            return nil
+        }
+        return (texture, ref)
+    }
+
+    /// Y'CbCr matrix attached by the capture pipeline (HD/4K video = BT.709)
+    private static func matrix(of pixelBuffer: CVPixelBuffer) -> YUVMatrix {
+        guard let attachment = CVBufferCopyAttachment(pixelBuffer, kCVImageBufferYCbCrMatrixKey, nil) else {
+            return YUVMatrixBT709
+        }
+        if CFEqual(attachment, kCVImageBufferYCbCrMatrix_ITU_R_601_4) {
+            return YUVMatrixBT601
+        }
+        return YUVMatrixBT709
+    }
+}
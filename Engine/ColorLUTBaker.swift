@@ -0,0 +1,412 @@
+// ColorLUTBaker.swift
+// Film Camera - Bake position-independent color math into lookup textures
+// ★★★ NEW: Color grading → 3D LUT, B&W tone → 1D (1 fetch per pixel) ★★★
+
+import Foundation
+import Metal
+
+/// Folds the per-pixel color math of a preset into lookup textures on the GPU
+///
+/// - gradingLUT: colorGradingLinear (basic, RGB curves, selective color, .cube LUT × lutIntensity,
+///   fade, split tone) → gridSize³ rgba16Float, index sRGB, giá trị linear
+/// - bwTone: brightness/contrast/gamma + toning → 1D rgba16Float (grain vẫn per-pixel)
+/// - curvesTexture: RGB curves (Catmull-Rom) → 1D rgba16Float, tạo đồng bộ trên CPU
+///   (colorGradingFragment + bake kernel đọc qua TextureIndexCurves, không còn nằm trong ColorGradingParams)
+/// - Rebake chỉ khi params liên quan đổi (key = giá trị từng field, BakeKey); LRU giữ maxEntries
+/// - Bake chạy trên command buffer riêng → texture chỉ được trả về sau khi GPU bake xong,
+///   trước đó caller dùng đường tính trực tiếp (giống PipelineVariantCache)
+final class ColorLUTBaker {
+
+    private enum Kind: UInt8 {
+        case grading = 1
+        case bwTone = 2
+    }
+
+    private struct Entry {
+        let texture: MTLTexture
+        var ready: Bool
+        var lastUsed: UInt64
+    }
+
+    private let device: MTLDevice
+    private let commandQueue: MTLCommandQueue
+
+    private var gradingPipeline: MTLComputePipelineState?
+    private var bwTonePipeline: MTLComputePipelineState?
+
+    private var entries: [Data: Entry] = [:]
+    private var curveTextures: [Data: Entry] = [:]
+    private var useCounter: UInt64 = 0
+    private var bakeCount: Int = 0
+    private let lock = NSLock()
+
+    /// 3D LUT edge (33³ rgba16Float ≈ 288 KB, cùng độ phân giải với .cube của app)
+    var gridSize: Int = 33
+
+    /// 1D tone texture width (luma 0...1)
+    var toneWidth: Int = 1024
+
+    /// 1D curves texture width (input 0...1, linear filtering giữa các sample)
+    var curvesWidth: Int = 1024
+
+    /// Baked textures kept (preview + capture + vài preset gần đây)
+    var maxEntries: Int = 8
+
+    init(device: MTLDevice, library: MTLLibrary, commandQueue: MTLCommandQueue) {
+        self.device = device
+        self.commandQueue = commandQueue
+
+        gradingPipeline = makeComputePipeline(library: library, name: "bakeColorGradingLUTKernel")
+        bwTonePipeline = makeComputePipeline(library: library, name: "bakeBWToneKernel")
+    }
+
+    // MARK: - Access
+
+    /// Baked grading LUT for params (params.flags / lutIntensity đã final), nil while baking
+    /// lutName: identity của .cube texture (residency có thể reload cùng LUT → không rebake)
+    /// curves: control points của COLOR_GRADING_FLAG_CURVE_* (không nằm trong params → thuộc key)
+    func gradingLUT(for params: ColorGradingParams, curves: RGBCurvesParams, lutName: String?, lutTexture: MTLTexture?) -> MTLTexture? {
+        guard let pipeline = gradingPipeline else { return nil }
+
+        var keyParams = params
+        let curvesTexture = keyParams.flags & UInt32(COLOR_GRADING_FLAG_CURVES) != 0 ? self.curvesTexture(for: curves) : nil
+        if curvesTexture == nil {
+            keyParams.flags &= ~UInt32(COLOR_GRADING_FLAG_CURVES)
+        }
+
+        var key = BakeKey(Kind.grading.rawValue)
+        key.add(
+            keyParams.exposure, keyParams.contrast, keyParams.highlights, keyParams.shadows,
+            keyParams.whites, keyParams.blacks, keyParams.saturation, keyParams.vibrance,
+            keyParams.temperature, keyParams.tint, keyParams.fade, keyParams.clarity,
+            keyParams.shadowsHue, keyParams.shadowsSat, keyParams.highlightsHue, keyParams.highlightsSat,
+            keyParams.splitBalance, keyParams.midtoneProtection, keyParams.lutIntensity
+        )
+        // Chỉ các kênh đang dùng → slot thừa (giá trị cũ) không tạo key mới
+        let selectiveCount = max(0, min(Int(keyParams.selectiveColorCount), 8))
+        key.add(Int32(selectiveCount))
+        withUnsafeBytes(of: keyParams.selectiveColors) { buffer in
+            for color in buffer.bindMemory(to: SelectiveColorData.self).prefix(selectiveCount) {
+                key.add(color.hue, color.range, color.satAdj, color.lumAdj, color.hueShift)
+            }
+        }
+        key.add(keyParams.flags)
+        if keyParams.flags & UInt32(COLOR_GRADING_FLAG_LUT) != 0, let lutName = lutName {
+            key.add(lutName)
+        }
+        if curvesTexture != nil {
+            key.add(Self.curvesKey(curves))
+        }
+
+        return lookup(key.data) {
+            let descriptor = MTLTextureDescriptor()
+            descriptor.textureType = .type3D
+            descriptor.pixelFormat = .rgba16Float
+            descriptor.width = gridSize
+            descriptor.height = gridSize
+            descriptor.depth = gridSize
+            descriptor.usage = [.shaderRead, .shaderWrite]
+            descriptor.storageMode = .private
+            return descriptor
+        } encode: { encoder, texture in
+            encoder.setComputePipelineState(pipeline)
+            encoder.setTexture(texture, index: 0)
+            if keyParams.flags & UInt32(COLOR_GRADING_FLAG_LUT) != 0, let lutTexture = lutTexture {
+                encoder.setTexture(lutTexture, index: 1)
+            }
+            if let curvesTexture = curvesTexture {
+                encoder.setTexture(curvesTexture, index: Int(TextureIndexCurves.rawValue))
+            }
+            encoder.setBytes(&keyParams, length: MemoryLayout<ColorGradingParams>.stride, index: 0)
+
+            let width = pipeline.threadExecutionWidth
+            let height = max(pipeline.maxTotalThreadsPerThreadgroup / width, 1)
+            let threadsPerGroup = MTLSize(width: width, height: height, depth: 1)
+            let groups = MTLSize(
+                width: (texture.width + width - 1) / width,
+                height: (texture.height + height - 1) / height,
+                depth: texture.depth
+            )
+            encoder.dispatchThreadgroups(groups, threadsPerThreadgroup: threadsPerGroup)
+        }
+    }
+
+    /// Baked B&W tone curve for params, nil while baking
+    /// Grain fields (seed random mỗi frame) không thuộc key → không rebake mỗi frame
+    func bwTone(for params: BWParams) -> MTLTexture? {
+        guard let pipeline = bwTonePipeline, params.enabled != 0 else { return nil }
+
+        var keyParams = params
+        keyParams.grainIntensity = 0
+        keyParams.grainSize = 0
+        keyParams.grainSeed = 0
+
+        var key = BakeKey(Kind.bwTone.rawValue)
+        key.add(keyParams.redWeight, keyParams.greenWeight, keyParams.blueWeight)
+        key.add(keyParams.contrast, keyParams.brightness, keyParams.gamma)
+        key.add(keyParams.toningMode)
+        key.add(keyParams.toningIntensity, keyParams.customColor.x, keyParams.customColor.y, keyParams.customColor.z)
+        key.add(keyParams.shadowHue, keyParams.shadowSat, keyParams.highlightHue, keyParams.highlightSat, keyParams.splitBalance)
+
+        return lookup(key.data) {
+            let descriptor = MTLTextureDescriptor()
+            descriptor.textureType = .type1D
+            descriptor.pixelFormat = .rgba16Float
+            descriptor.width = toneWidth
+            descriptor.usage = [.shaderRead, .shaderWrite]
+            descriptor.storageMode = .private
+            return descriptor
+        } encode: { encoder, texture in
+            encoder.setComputePipelineState(pipeline)
+            encoder.setTexture(texture, index: 0)
+            encoder.setBytes(&keyParams, length: MemoryLayout<BWParams>.stride, index: 0)
+
+            let width = pipeline.threadExecutionWidth
+            let groups = MTLSize(width: (texture.width + width - 1) / width, height: 1, depth: 1)
+            encoder.dispatchThreadgroups(groups, threadsPerThreadgroup: MTLSize(width: width, height: 1, depth: 1))
+        }
+    }
+
+    /// RGB curves lookup (r/g/b = output của từng kênh), built synchronously → có ngay ở frame đầu
+    /// nil khi không tạo được texture (caller bỏ COLOR_GRADING_FLAG_CURVES)
+    func curvesTexture(for curves: RGBCurvesParams) -> MTLTexture? {
+        let key = Self.curvesKey(curves)
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        useCounter += 1
+        if var entry = curveTextures[key] {
+            entry.lastUsed = useCounter
+            curveTextures[key] = entry
+            return entry.texture
+        }
+
+        let descriptor = MTLTextureDescriptor()
+        descriptor.textureType = .type1D
+        descriptor.pixelFormat = .rgba16Float
+        descriptor.width = curvesWidth
+        descriptor.usage = .shaderRead
+        descriptor.storageMode = .shared
+        guard let texture = device.makeTexture(descriptor: descriptor) else {
+            print("❌ ColorLUTBaker: Failed to create curves texture")
+            return nil
+        }
+
+        var curves = curves
+        let red = Self.curvePoints(&curves.redCurve, count: curves.redPointCount)
+        let green = Self.curvePoints(&curves.greenCurve, count: curves.greenPointCount)
+        let blue = Self.curvePoints(&curves.blueCurve, count: curves.bluePointCount)
+
+        var texels = [Float16](repeating: 1, count: curvesWidth * 4)
+        for i in 0..<curvesWidth {
+            let x = Float(i) / Float(curvesWidth - 1)
+            texels[i * 4 + 0] = Float16(Self.evaluateCurve(x, red))
+            texels[i * 4 + 1] = Float16(Self.evaluateCurve(x, green))
+            texels[i * 4 + 2] = Float16(Self.evaluateCurve(x, blue))
+        }
+        texels.withUnsafeBytes { bytes in
+            texture.replace(region: MTLRegionMake1D(0, curvesWidth), mipmapLevel: 0, withBytes: bytes.baseAddress!, bytesPerRow: curvesWidth * 8)
+        }
+
+        curveTextures[key] = Entry(texture: texture, ready: true, lastUsed: useCounter)
+        while curveTextures.count > maxEntries,
+              let victim = curveTextures.min(by: { $0.value.lastUsed < $1.value.lastUsed }) {
+            curveTextures.removeValue(forKey: victim.key)
+        }
+        return texture
+    }
+
+    // MARK: - Maintenance
+
+    func purge() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        entries.removeAll()
+        curveTextures.removeAll()
+    }
+
+    /// Get cache statistics for debugging
+    func statistics() -> (entries: Int, ready: Int, bakes: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return (entries.count, entries.values.filter { $0.ready }.count, bakeCount)
+    }
+
+    // MARK: - Private
+
+    /// Control points đang dùng của từng kênh (điểm thừa sau pointCount không thuộc key)
+    private static func curvesKey(_ curves: RGBCurvesParams) -> Data {
+        var curves = curves
+        var key = BakeKey(0)
+        key.add(curves.enabled)
+        for points in [
+            curvePoints(&curves.redCurve, count: curves.redPointCount),
+            curvePoints(&curves.greenCurve, count: curves.greenPointCount),
+            curvePoints(&curves.blueCurve, count: curves.bluePointCount)
+        ] {
+            key.add(Int32(points.count))
+            points.forEach { key.add($0.input, $0.output) }
+        }
+        return key.data
+    }
+
+    private static func curvePoints<Points>(_ points: inout Points, count: Int32) -> [CurvePoint] {
+        let count = max(0, min(Int(count), Int(MAX_CURVE_POINTS)))
+        return withUnsafeBytes(of: &points) { Array($0.bindMemory(to: CurvePoint.self).prefix(count)) }
+    }
+
+    /// Catmull-Rom qua các control points — cùng công thức với evaluateCurve cũ trong Shaders.metal
+    /// Không có điểm → identity (kênh đó không set COLOR_GRADING_FLAG_CURVE_*, shader không đọc)
+    private static func evaluateCurve(_ input: Float, _ curve: [CurvePoint]) -> Float {
+        guard !curve.isEmpty else { return input }
+        guard curve.count > 1 else { return curve[0].output }
+
+        let input = min(max(input, 0), 1)
+        var idx = curve.count - 2  // Fallback to last segment
+        for i in 0..<(curve.count - 1) where input >= curve[i].input && input <= curve[i + 1].input {
+            idx = i
+            break
+        }
+
+        let p0 = curve[max(0, idx - 1)]
+        let p1 = curve[idx]
+        let p2 = curve[min(idx + 1, curve.count - 1)]
+        let p3 = curve[min(idx + 2, curve.count - 1)]
+
+        let segmentWidth = p2.input - p1.input
+        let t = min(max(segmentWidth > 0.0001 ? (input - p1.input) / segmentWidth : 0, 0), 1)
+        let t2 = t * t
+        let t3 = t2 * t
+
+        var output = 2 * p1.output
+        output += (-p0.output + p2.output) * t
+        output += (2 * p0.output - 5 * p1.output + 4 * p2.output - p3.output) * t2
+        output += (-p0.output + 3 * p1.output - 3 * p2.output + p3.output) * t3
+        return min(max(0.5 * output, 0), 1)
+    }
+
+    private func makeComputePipeline(library: MTLLibrary, name: String) -> MTLComputePipelineState? {
+        do {
+            // Shader dùng function constants → phải tạo qua constantValues (rỗng = generic)
+            let function = try library.makeFunction(name: name, constantValues: MTLFunctionConstantValues())
+            return try device.makeComputePipelineState(function: function)
+        } catch {
+            print("⚠️ ColorLUTBaker: \(name) unavailable, color math stays per-pixel: \(error.localizedDescription)")
+            return nil
+        }
+    }
+
+    /// Ready texture for key, or start a bake and return nil
+    private func lookup(
+        _ key: Data,
+        descriptor makeDescriptor: () -> MTLTextureDescriptor,
+        encode: (MTLComputeCommandEncoder, MTLTexture) -> Void
+    ) -> MTLTexture? {
+        lock.lock()
+        useCounter += 1
+        if var entry = entries[key] {
+            entry.lastUsed = useCounter
+            entries[key] = entry
+            lock.unlock()
+            return entry.ready ? entry.texture : nil
+        }
+
+        guard let texture = device.makeTexture(descriptor: makeDescriptor()),
+              let commandBuffer = commandQueue.makeCommandBuffer(),
+              let encoder = commandBuffer.makeComputeCommandEncoder() else {
+            lock.unlock()
+            print("❌ ColorLUTBaker: Failed to start bake")
+            return nil
+        }
+        entries[key] = Entry(texture: texture, ready: false, lastUsed: useCounter)
+        bakeCount += 1
+        evictToLimit()
+        lock.unlock()
+
+        let startTime = CFAbsoluteTimeGetCurrent()
+        encode(encoder, texture)
+        encoder.endEncoding()
+
+        commandBuffer.addCompletedHandler { [weak self] buffer in
+            guard let self = self else { return }
+
+            self.lock.lock()
+            if buffer.error == nil, var entry = self.entries[key], entry.texture === texture {
+                entry.ready = true
+                self.entries[key] = entry
+            } else {
+                self.entries.removeValue(forKey: key)
+            }
+            self.lock.unlock()
+
+            if let error = buffer.error {
+                print("❌ ColorLUTBaker: Bake failed - \(error.localizedDescription)")
+            }
+
+            #if DEBUG
+            let elapsed = (CFAbsoluteTimeGetCurrent() - startTime) * 1000
+            print("🎨 ColorLUTBaker: Baked \(texture.textureType == .type3D ? "\(texture.width)³ grading LUT" : "\(texture.width) B&W tone") in \(String(format: "%.1f", elapsed))ms")
+            #endif
+        }
+        commandBuffer.commit()
+
+        return nil
+    }
+
+    /// Drop least-recently-used entries above maxEntries (lock held)
+    private func evictToLimit() {
+        while entries.count > maxEntries,
+              let victim = entries.min(by: { $0.value.lastUsed < $1.value.lastUsed }) {
+            entries.removeValue(forKey: victim.key)
+        }
+    }
+}
+
+// MARK: - Bake Key
+
+/// Cache key built from explicit field values
+/// Không dùng Data(bytes:) của cả struct C: padding / slot mảng thừa có thể mang rác
+/// → cùng params cho ra key khác = bake lại + chiếm thêm 1 entry LRU
+struct BakeKey {
+
+    private(set) var data: Data
+
+    init(_ kind: UInt8) {
+        data = Data([kind])
+    }
+
+    mutating func add(_ values: Float...) {
+        for value in values {
+            append(value.bitPattern)
+        }
+    }
+
+    mutating func add(_ values: Int32...) {
+        for value in values {
+            append(UInt32(bitPattern: value))
+        }
+    }
+
+    mutating func add(_ values: UInt32...) {
+        for value in values {
+            append(value)
+        }
+    }
+
+    mutating func add(_ value: String) {
+        append(UInt32(value.utf8.count))
+        data.append(contentsOf: value.utf8)
+    }
+
+    mutating func add(_ value: Data) {
+        append(UInt32(value.count))
+        data.append(value)
+    }
+
+    private mutating func append(_ value: UInt32) {
+        withUnsafeBytes(of: value.littleEndian) { data.append(contentsOf: $0) }
+    }
+}
@@ -0,0 +1,154 @@
+// ComputeKernelCache.swift
+// Film Camera - Compute variants of the neighbourhood passes (threadgroup tile + apron)
+// ★★★ NEW: CCD bloom, digicam sharpen, VHS bleed, lens CA as compute kernels ★★★
+
+import Foundation
+import Metal
+
+/// Render graph passes with a compute kernel next to their fragment shader
+///
+/// - Threadgroup load tile + apron vào threadgroup memory 1 lần → mọi tap đọc từ đó
+/// - ccdBloom: thêm ccdSmearKernel (vertical smear = cửa sổ trượt theo cột, thay cho 4..30 taps / pixel)
+/// - FilterRenderer.computeKernelPasses chọn pass nào chạy compute; fallback fragment khi output
+///   không ghi được từ compute (drawable, readback surface) hoặc apron vượt threadgroup memory
+enum ComputeKernelPass: String, CaseIterable {
+    case ccdBloom
+    case digicam
+    case vhs
+    case lensDistortion
+
+    /// Kernel functions in Shaders.metal
+    var functionNames: [String] {
+        switch self {
+        case .ccdBloom: return ["ccdSmearKernel", "ccdBloomKernel"]
+        case .digicam: return ["digicamEffectsKernel"]
+        case .vhs: return ["vhsEffectsKernel"]
+        case .lensDistortion: return ["lensDistortionKernel"]
+        }
+    }
+}
+
+/// Compute pipelines per (kernel name, shader I/O mode)
+///
+/// - Kernel đọc/ghi intermediates qua loadSrgb/storeSrgb → cần variant theo ShaderIOMode như PipelineFormatCache
+///   (texture ghi bằng write() → không phụ thuộc pixel format)
+/// - Compile đồng bộ lần đầu dùng; prewarm(mode:) compile nền trước shot đầu tiên
+/// - Qua PipelineArchive → launch sau lấy binary từ archive
+final class ComputeKernelCache {
+
+    private struct Key: Hashable {
+        let name: String
+        let mode: ShaderIOMode
+    }
+
+    private let device: MTLDevice
+    private let library: MTLLibrary
+    private let archive: PipelineArchive
+
+    private var pipelines: [Key: MTLComputePipelineState] = [:]
+    private var failed: Set<Key> = []
+    private let lock = NSLock()
+
+    private let compileQueue = DispatchQueue(label: "com.filmcamera.computeKernels", qos: .utility)
+
+    /// Threadgroup memory per tile kernel (bytes, bội số 16; ≤ 32 KB để nhiều threadgroup cùng chạy / core)
+    let tileMemoryLength: Int
+
+    /// Tile + apron capacity in half4 texels
+    var tileCapacity: Int {
+        return tileMemoryLength / 8
+    }
+
+    init(device: MTLDevice, library: MTLLibrary, archive: PipelineArchive) {
+        self.device = device
+        self.library = library
+        self.archive = archive
+        self.tileMemoryLength = min(device.maxThreadgroupMemoryLength, 32 * 1024) / 16 * 16
+    }
+
+    /// Pipeline for kernel name with the given shader I/O (nil = failed to compile)
+    func pipeline(named name: String, mode: ShaderIOMode) -> MTLComputePipelineState? {
+        let key = Key(name: name, mode: mode)
+
+        lock.lock()
+        if let pipeline = pipelines[key] {
+            lock.unlock()
+            return pipeline
+        }
+        if failed.contains(key) {
+            lock.unlock()
+            return nil
+        }
+        lock.unlock()
+
+        return compile(key)
+    }
+
+    /// Compile every kernel for mode on a background queue
+    func prewarm(mode: ShaderIOMode, completion: (() -> Void)? = nil) {
+        compileQueue.async { [weak self] in
+            for pass in ComputeKernelPass.allCases {
+                for name in pass.functionNames {
+                    _ = self?.pipeline(named: name, mode: mode)
+                }
+            }
+            completion?()
+        }
+    }
+
+    func purge() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        pipelines.removeAll()
+        failed.removeAll()
+    }
+
+    /// Get cache statistics for debugging
+    func statistics() -> (pipelines: Int, failed: Int, tileMemory: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return (pipelines.count, failed.count, tileMemoryLength)
+    }
+
+    // MARK: - Private
+
+    private func compile(_ key: Key) -> MTLComputePipelineState? {
+        let startTime = CFAbsoluteTimeGetCurrent()
+
+        let values = MTLFunctionConstantValues()
+        key.mode.apply(to: values)
+
+        var pipeline: MTLComputePipelineState?
+        do {
+            let descriptor = MTLComputePipelineDescriptor()
+            descriptor.computeFunction = try library.makeFunction(name: key.name, constantValues: values)
+            pipeline = try archive.makeComputePipeline(descriptor: descriptor)
+        } catch {
+            print("⚠️ ComputeKernelCache: \(key.name) unavailable, using fragment path: \(error.localizedDescription)")
+        }
+
+        lock.lock()
+        if let pipeline = pipeline {
+            // Another thread may have compiled it meanwhile → giữ bản đầu tiên
+            if let existing = pipelines[key] {
+                lock.unlock()
+                return existing
+            }
+            pipelines[key] = pipeline
+        } else {
+            failed.insert(key)
+        }
+        lock.unlock()
+
+        #if DEBUG
+        if let pipeline = pipeline {
+            let elapsed = (CFAbsoluteTimeGetCurrent() - startTime) * 1000
+            print("✅ ComputeKernelCache: \(key.name) linear=\(key.mode.linearIntermediates) half=\(key.mode.halfPrecision) (\(pipeline.maxTotalThreadsPerThreadgroup) threads) in \(String(format: "%.1f", elapsed))ms")
+        }
+        #endif
+
+        return pipeline
+    }
+}
@@ -0,0 +1,159 @@
+// DeferredPipelines.swift
+// Film Camera - Pipelines built off the launch path
+// ★★★ NEW: Chỉ pipeline của frame đầu build đồng bộ, phần còn lại build song song ở background ★★★
+
+import Foundation
+import Metal
+
+/// RenderEngine pipelines the first viewfinder frame doesn't need
+///
+/// - RenderEngine.setupPipelines chỉ build fused preview, scale/YUV + core (colorGrading, vignette,
+///   grain, instantFrame, bloom) → phần còn lại build song song ngay sau init
+/// - Truy cập trước khi warm-up xong → build đồng bộ đúng pipeline đó (get-or-build, không bao giờ nil
+///   vì "chưa kịp build")
+/// - needed(by:) → preset đang chọn được build trước (RenderEngine.prewarmPipelines(for:))
+enum DeferredPipeline: String, CaseIterable {
+    case lensDistortion
+    case halation
+    case bloomThreshold
+    case bloomHorizontal
+    case bloomVertical
+    case bloomComposite
+    case halationThreshold
+    case halationHorizontal
+    case halationVertical
+    case halationComposite
+    case bloomPyramidThreshold
+    case halationPyramidThreshold
+    case sharedPyramidThreshold
+    case pyramidDownsample
+    case pyramidUpsample
+    case halationPyramidComposite
+    case toneMapping
+    case flash
+    case lightLeak
+    case lightLeakComposite
+    case dateStamp
+    case ccdBloom
+    case bw
+    case overlays
+    case overlaysComposite
+    case vhsEffects
+    case digicamEffects
+    case filmStrip
+    case skinToneProtection
+    case srgbEncode
+    case srgbDecode
+    case colorGradingBaked
+    case bwBaked
+
+    var fragmentName: String {
+        switch self {
+        case .lensDistortion: return "lensDistortionFragment"
+        case .halation: return "halationFragment"
+        case .bloomThreshold, .bloomPyramidThreshold: return "bloomThresholdFragment"
+        case .bloomHorizontal: return "bloomHorizontalFragment"
+        case .bloomVertical: return "bloomVerticalFragment"
+        case .bloomComposite: return "bloomCompositeFragment"
+        case .halationThreshold, .halationPyramidThreshold: return "halationThresholdFragment"
+        case .halationHorizontal: return "halationHorizontalFragment"
+        case .halationVertical: return "halationVerticalFragment"
+        case .halationComposite: return "halationCompositeFragment"
+        case .sharedPyramidThreshold: return "bloomHalationThresholdFragment"
+        case .pyramidDownsample: return "pyramidDownsampleFragment"
+        case .pyramidUpsample: return "pyramidUpsampleFragment"
+        case .halationPyramidComposite: return "halationPyramidCompositeFragment"
+        case .toneMapping: return "toneMappingFragment"
+        case .flash: return "flashFragment"
+        case .lightLeak: return "lightLeakFragment"
+        case .lightLeakComposite: return "lightLeakCompositeFragment"
+        case .dateStamp: return "dateStampFragment"
+        case .ccdBloom: return "ccdBloomFragment"
+        case .bw: return "bwConvertFragment"
+        case .overlays: return "overlaysFragment"
+        case .overlaysComposite: return "overlaysCompositeFragment"
+        case .vhsEffects: return "vhsEffectsFragment"
+        case .digicamEffects: return "digicamEffectsFragment"
+        case .filmStrip: return "filmStripFragment"
+        case .skinToneProtection: return "skinToneProtectionFragment"
+        case .srgbEncode: return "srgbEncodeFragment"
+        case .srgbDecode: return "srgbDecodeFragment"
+        case .colorGradingBaked: return "colorGradingBakedFragment"
+        case .bwBaked: return "bwConvertBakedFragment"
+        }
+    }
+
+    /// Color attachment format (blur pyramid mips + sRGB decode → rgba16Float)
+    var pixelFormat: MTLPixelFormat {
+        switch self {
+        case .bloomPyramidThreshold, .halationPyramidThreshold, .sharedPyramidThreshold,
+             .pyramidDownsample, .pyramidUpsample:
+            return RenderEngine.pyramidPixelFormat
+        case .srgbDecode:
+            return .rgba16Float
+        default:
+            return .bgra8Unorm
+        }
+    }
+
+    /// Pass ghi thẳng vào target bgra8 (EncodeSRGB) → PipelineFormatCache không đổi format
+    var rendersToTarget: Bool {
+        return self == .srgbEncode
+    }
+
+    /// Pipelines the preset's preview + capture graphs use (separable blur fallbacks excluded)
+    static func needed(by preset: FilterPreset) -> [DeferredPipeline] {
+        // Capture: linear intermediates + baked grading luôn chạy
+        var kinds: [DeferredPipeline] = [.srgbEncode, .srgbDecode, .colorGradingBaked]
+
+        if preset.lensDistortion.enabled { kinds.append(.lensDistortion) }
+        if preset.skinToneProtection.enabled { kinds.append(.skinToneProtection) }
+        if preset.toneMapping.enabled { kinds.append(.toneMapping) }
+        if preset.bw.enabled { kinds += [.bw, .bwBaked] }
+        if preset.flash.enabled { kinds.append(.flash) }
+        if preset.ccdBloom.enabled { kinds.append(.ccdBloom) }
+
+        let bloom = preset.bloom.enabled && preset.bloom.intensity > 0
+        let halation = preset.halation.enabled && preset.halation.intensity > 0
+        if bloom { kinds += [.bloomPyramidThreshold, .bloomComposite] }
+        if bloom && halation { kinds.append(.sharedPyramidThreshold) }
+        if halation { kinds += [.halation, .halationPyramidThreshold, .halationPyramidComposite] }
+        if bloom || halation { kinds += [.pyramidDownsample, .pyramidUpsample] }
+
+        if preset.lightLeak.enabled { kinds += [.lightLeak, .lightLeakComposite] }
+        if preset.dateStamp.enabled { kinds.append(.dateStamp) }
+        if preset.overlays.enabled { kinds += [.overlays, .overlaysComposite] }
+        if preset.vhsEffects.enabled { kinds.append(.vhsEffects) }
+        if preset.digicamEffects.enabled { kinds.append(.digicamEffects) }
+        if preset.filmStripEffects.enabled { kinds.append(.filmStrip) }
+
+        return kinds
+    }
+}
+
+/// Get-or-build storage for one deferred pipeline
+/// Build chạy trong lock → caller đồng thời chờ đúng 1 lần compile thay vì compile 2 lần
+final class DeferredPipelineSlot {
+
+    private var pipeline: MTLRenderPipelineState?
+    private var resolved = false
+    private let lock = NSLock()
+
+    /// Built (or failed) already → truy cập không còn block
+    var isResolved: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return resolved
+    }
+
+    func resolve(_ build: () -> MTLRenderPipelineState?) -> MTLRenderPipelineState? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if !resolved {
+            pipeline = build()
+            resolved = true
+        }
+        return pipeline
+    }
+}
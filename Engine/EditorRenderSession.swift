@@ -0,0 +1,130 @@
+// EditorRenderSession.swift
+// Film Camera - Incremental re-render for PhotoEditorView
+// ★★★ NEW: Slider drag chỉ chạy lại các pass sau effect đang đổi, ở proxy resolution ★★★
+
+import Foundation
+import Metal
+import UIKit
+
+/// One edited image: resident input textures + a RenderGraphCache per resolution
+///
+/// - .proxy while a slider is dragged (long side proxyDimension), .full on release
+/// - Input textures uploaded once per image (không makeTexture mỗi lần render như applyFilterPreview)
+/// - fixedFrameSeed cố định cho cả session → grain / light leaks không nhảy, cache keys ổn định
+/// - Full quality chain (.capture) — gallery preview chỉ có Color Grading + Vignette
+/// - Thread-safe; render() blocks until the GPU finishes (gọi off the main thread)
+final class EditorRenderSession {
+
+    enum Resolution: Int {
+        case proxy
+        case full
+    }
+
+    /// Long side of the proxy render in pixels
+    static let proxyDimension = 800
+
+    private let orientation: UIImage.Orientation
+    private let textures: [Resolution: MTLTexture]
+    private let renderer = FilterRenderer(stream: RenderEngine.shared.stream(.capture))
+    private let cache: RenderGraphCache
+    /// Distinguishes sessions in content keys (textures of a new image reuse old addresses)
+    private let sessionKey = Int.random(in: Int.min...Int.max)
+    private let lock = NSLock()
+
+    init?(image: UIImage) {
+        guard RenderEngine.isAvailable else { return nil }
+        let engine = RenderEngine.shared
+
+        guard let fullCGImage = image.cgImage,
+              let proxyCGImage = Self.downscaled(fullCGImage, maxDimension: Self.proxyDimension),
+              let fullTexture = engine.makeTexture(from: fullCGImage),
+              let proxyTexture = engine.makeTexture(from: proxyCGImage) else {
+            print("❌ EditorRenderSession: Failed to create input textures")
+            return nil
+        }
+
+        self.orientation = image.imageOrientation
+        self.textures = [.full: fullTexture, .proxy: proxyTexture]
+        self.cache = RenderGraphCache(texturePool: renderer.stream.texturePool)
+
+        renderer.fixedFrameSeed = UInt32.random(in: 0..<UInt32.max)
+        renderer.reusesFrameSeed = true
+        renderer.stampDate = Date()
+    }
+
+    deinit {
+        cache.removeAll()
+    }
+
+    // MARK: - Render
+
+    func render(preset: FilterPreset, resolution: Resolution) -> UIImage? {
+        guard let input = textures[resolution] else { return nil }
+        let engine = RenderEngine.shared
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        #if DEBUG
+        let startTime = CFAbsoluteTimeGetCurrent()
+        #endif
+        var hasher = Hasher()
+        hasher.combine(sessionKey)
+        hasher.combine(resolution.rawValue)
+        let inputKey = hasher.finalize()
+
+        guard let cgImage = engine.renderToCGImage(width: input.width, height: input.height, render: { output in
+            renderer.renderEditor(
+                input: input,
+                inputKey: inputKey,
+                output: output,
+                preset: preset,
+                cache: cache,
+                commandQueue: renderer.stream.commandQueue
+            )
+        }) else {
+            return nil
+        }
+
+        #if DEBUG
+        let stats = cache.statistics()
+        print("🎨 EditorRenderSession: \(resolution) \(input.width)×\(input.height) in \(String(format: "%.1f", (CFAbsoluteTimeGetCurrent() - startTime) * 1000))ms - cache \(stats.entries) entries, \(stats.bytes / 1_048_576)MB, \(stats.passesSkipped)/\(stats.passesSkipped + stats.passesExecuted) passes skipped")
+        #endif
+
+        // Textures are unrotated pixels → same orientation at both resolutions
+        return UIImage(cgImage: cgImage, scale: 1, orientation: orientation)
+    }
+
+    /// Drop cached intermediates (memory warning); the next render runs the full chain
+    func purge() {
+        lock.lock()
+        cache.removeAll()
+        lock.unlock()
+    }
+
+    // MARK: - Private
+
+    /// Pixel-exact downscale (UIImage.resizedIfNeeded renders at screen scale)
+    private static func downscaled(_ image: CGImage, maxDimension: Int) -> CGImage? {
+        let longSide = max(image.width, image.height)
+        guard longSide > maxDimension else { return image }
+
+        let scale = CGFloat(maxDimension) / CGFloat(longSide)
+        let width = max(1, Int((CGFloat(image.width) * scale).rounded()))
+        let height = max(1, Int((CGFloat(image.height) * scale).rounded()))
+
+        guard let context = CGContext(
+            data: nil,
+            width: width,
+            height: height,
+            bitsPerComponent: 8,
+            bytesPerRow: 0,
+            space: CGColorSpaceCreateDeviceRGB(),
+            bitmapInfo: CGImageAlphaInfo.noneSkipLast.rawValue
+        ) else { return nil }
+
+        context.interpolationQuality = .high
+        context.draw(image, in: CGRect(x: 0, y: 0, width: width, height: height))
+        return context.makeImage()
+    }
+}
@@ -7,16 +7,123 @@ class FilterRenderer {
     private let device: MTLDevice
     private var renderPassDescriptor: MTLRenderPassDescriptor
 
-    // Ping-pong buffers for proper texture management
-    private var pingPongTextures: [MTLTexture?] = [nil, nil]
-    private var pingPongIndex: Int = 0
-    
     // DEBUG: Frame counter for periodic logging
     private var frameCount: Int = 0
     private var lastLogTime: CFAbsoluteTime = 0
 
-    init() {
+    /// ★★★ NEW: Fused preview mode ★★★
+    /// Gộp các stage per-pixel của renderPreview vào fusedPreviewFragment
+    /// Tắt để so sánh với multi-pass (chênh lệch ≤ 2/255 mỗi kênh)
+    var useFusedPreview: Bool = true
+
+    /// ★★★ NEW: Capture bloom + halation share 1 threshold/pyramid khi cùng số mip ★★★
+    var sharesBloomHalationPyramid: Bool = true
+
+    /// Upsample blend toward the lower mip (0..1) — lớn hơn = glow lan rộng hơn
+    var pyramidScatter: Float = 0.7
+
+    /// ★★★ NEW: Tiled capture — ảnh lớn hơn ngưỡng này (pixels) render theo tile chồng lấn ★★★
+    /// 48MP × bgra8 = 192MB mỗi texture full-size → peak memory giới hạn theo tile thay vì sensor
+    var tiledCaptureThreshold: Int = 24_000_000
+
+    /// Tile edge in pixels, overlap included
+    var captureTileSize: Int = 2048
+
+    /// Tile đang được encode (identity ngoài tiled capture)
+    private var tileRegion = FilterRenderer.fullImageRegion
+
+    /// ★★★ NEW: Intermediate texture format per quality tier ★★★
+    /// Linear formats: sRGB decode ở source (view _srgb), encode ở pass EncodeSRGB cuối → không re-quantize
+    /// 8 bit + decode/encode mỗi pass. Preview/video/gallery giữ bgra8Unorm (bandwidth-bound ở 60fps),
+    /// capture dùng rgba16Float (hết banding ở fade/curves). So sánh: PipelineBenchmark.runIntermediateFormats
+    var previewIntermediateFormat: IntermediateFormat = .bgra8Unorm
+    var captureIntermediateFormat: IntermediateFormat = .rgba16Float
+
+    /// Half-precision shader variants for the per-pixel math (sRGB conversions, vignette, tone mapping)
+    var usesHalfPrecisionMath: Bool = false
+
+    /// ★★★ NEW: Baked color lookups (ColorLUTBaker) ★★★
+    /// Color grading → 1 fetch 3D LUT, B&W tone → 1 fetch 1D; rebake khi params đổi,
+    /// trong lúc bake (1-2 frame) dùng shader tính trực tiếp. Tắt để so sánh với per-pixel math
+    var usesBakedColorLUT: Bool = true
+
+    /// ★★★ NEW: Cached procedural layers (ProceduralLayerCache) ★★★
+    /// Light leak shape + dust/scratches bake 1 lần / seed, mỗi frame chỉ flicker + blend (1 fetch).
+    /// Tắt để so sánh với shader dựng lại toàn bộ mỗi pixel
+    var usesProceduralLayers: Bool = true
+
+    /// ★★★ NEW: Compute neighbourhood kernels (threadgroup tile + apron) ★★★
+    /// Pass trong set chạy compute khi output ghi được từ compute (shaderWrite) và apron vừa threadgroup
+    /// memory, ngược lại fragment như cũ. So sánh từng pass: PipelineBenchmark.runNeighbourhoodKernels
+    var computeKernelPasses: Set<ComputeKernelPass> = Set(ComputeKernelPass.allCases)
+
+    /// Rows per thread of the CCD smear column pass (cửa sổ khởi tạo lại mỗi đoạn)
+    var ccdSmearSegmentRows: Int = 256
+
+    /// ★★★ NEW: Queue + transient pool this renderer encodes on (RenderEngine.stream) ★★★
+    let stream: RenderStream
+
+    /// ★★★ NEW: Adaptive preview quality (GPU time + thermal) - chỉ renderPreview, capture luôn full ★★★
+    let qualityGovernor = PreviewQualityGovernor()
+
+    /// ★★★ NEW: Deterministic output (PipelineBenchmark checksums) ★★★
+    /// non-nil → seed ngẫu nhiên mỗi frame, animation time và date stamp cố định → cùng input = cùng output
+    var fixedFrameSeed: UInt32?
+
+    /// Date printed by the date stamp (nil = now) → re-render / lazy render của ảnh cũ giữ ngày chụp
+    var stampDate: Date?
+
+    /// fixedFrameSeed renders the same image many times (EditorRenderSession) → per-seed layers pay off
+    /// false = one-shot (capture, gallery render): baking a layer for 1 frame only costs an LRU slot
+    var reusesFrameSeed = false
+
+    /// Shader I/O của graph đang encode (legacy = generic pipelines)
+    private var shaderIO = ShaderIOMode.legacy
+
+    /// ★★★ NEW: Per-pass GPU timing của command buffer đang encode (nil = RenderInstrumentation tắt) ★★★
+    private var frameRecorder: FrameRecorder?
+
+    /// ★★★ NEW: Pass params trong 1 uniform ring buffer (bind offset) thay vì setFragmentBytes mỗi pass ★★★
+    /// Tắt để so sánh với setBytes; params được pack lại chỉ khi config tương ứng của preset đổi
+    var usesUniformRing: Bool = true
+
+    private lazy var uniformRing = UniformRingBuffer(device: device)
+
+    /// Required pass of the last discarded frame (YUVConvert / EncodeSRGB) → MetalPreviewView fallback
+    private(set) var lastDiscardedPass: String?
+
+    /// ★ Keep the FrameRecorder of every finished frame until takeFrameRecorders() (PipelineBenchmark)
+    /// → đo đúng command buffer của mình thay vì frame bất kỳ báo về RenderInstrumentation.onFrame
+    var collectsFrameRecorders = false
+    private var collectedRecorders: [FrameRecorder] = []
+    private let recorderLock = NSLock()
+
+    /// Pass param bytes bound by the last finished frame (ShaderTypes.h layout → PipelineBenchmark)
+    private(set) var lastFrameParamBytes = 0
+    private var frameParamBytes = 0
+
+    // Last packed params per stage (PackedParams: so sánh config, không pack lại mỗi frame)
+    private let colorGradingParamsCache = PackedParams<ColorGradingConfig, ColorGradingParams>()
+    private let rgbCurvesParamsCache = PackedParams<RGBCurves, RGBCurvesParams>()
+    private let grainParamsCache = PackedParams<GrainConfig, GrainParams>()
+    private let bloomParamsCache = PackedParams<BloomConfig, BloomParams>()
+    private let vignetteParamsCache = PackedParams<VignetteConfig, VignetteParams>()
+    private let halationParamsCache = PackedParams<HalationConfig, HalationParams>()
+    private let flashParamsCache = PackedParams<FlashConfig, FlashParams>()
+    private let skinToneParamsCache = PackedParams<SkinToneProtection, SkinToneParams>()
+    private let toneMappingParamsCache = PackedParams<ToneMapping, ToneMappingParams>()
+
+    private static let fullImageRegion = TileRegion(
+        origin: SIMD2<Float>(0, 0),
+        extent: SIMD2<Float>(1, 1),
+        imageSize: SIMD2<Float>(0, 0)
+    )
+
+    /// Init with a stream — mọi render call phải dùng stream.commandQueue
+    /// (transients của stream.texturePool chỉ alias an toàn trong queue đó)
+    init(stream: RenderStream = RenderEngine.shared.stream(.preview)) {
         self.device = RenderEngine.shared.device
+        self.stream = stream
         self.renderPassDescriptor = MTLRenderPassDescriptor()
 
         renderPassDescriptor.colorAttachments[0].loadAction = .clear
@@ -28,251 +135,273 @@ class FilterRenderer {
     
     /// Lightweight preview rendering for live viewfinder
     /// Includes: Scale → ColorGrading → Grain → Bloom(simple) → Vignette → InstantFrame
-    func renderPreview(input: MTLTexture, drawable: CAMetalDrawable, preset: FilterPreset, commandQueue: MTLCommandQueue) {
+    /// - chroma: CbCr plane khi input là Y plane của frame 420f (YUV→RGB trong pass đầu)
+    /// - completion: GPU xong command buffer (frame pacing: trả slot in-flight + đo GPU time)
+    /// - Returns: false khi không present được frame (completion không được gọi; lastDiscardedPass = lý do)
+    @discardableResult
+    func renderPreview(
+        input: MTLTexture,
+        chroma: MTLTexture? = nil,
+        yuvMatrix: YUVMatrix = YUVMatrixBT709,
+        drawable: CAMetalDrawable,
+        preset: FilterPreset,
+        commandQueue: MTLCommandQueue,
+        completion: ((MTLCommandBuffer) -> Void)? = nil
+    ) -> Bool {
+        lastDiscardedPass = nil
         guard let commandBuffer = commandQueue.makeCommandBuffer() else {
             print("❌ FilterRenderer: Failed to create command buffer")
-            return
+            return false
         }
 
-        let texturePool = RenderEngine.shared.texturePool
+        let texturePool = stream.texturePool
+
+        // ★ Governor: bậc chất lượng theo GPU time đo được của các frame trước
+        let governed = qualityGovernor.settings(for: preset)
         
         // Use DRAWABLE size for intermediate textures to prevent black borders
-        let outputWidth = drawable.texture.width
-        let outputHeight = drawable.texture.height
-
-        // Allocate ping-pong buffers at OUTPUT resolution (not input!)
-        guard let temp1 = texturePool.renderTargetTexture(width: outputWidth, height: outputHeight, pixelFormat: .bgra8Unorm),
-              let temp2 = texturePool.renderTargetTexture(width: outputWidth, height: outputHeight, pixelFormat: .bgra8Unorm) else {
-            print("❌ FilterRenderer: Failed to allocate intermediate textures")
-            return
-        }
-
-        pingPongTextures[0] = temp1
-        pingPongTextures[1] = temp2
-        pingPongIndex = 0
-
-        var currentInput: MTLTexture = input
-        var passCount = 0
-        var failedPasses: [String] = []
+        // (reducedResolution → graph chạy nhỏ hơn, upscale vào drawable ở cuối)
+        let outputWidth = max(1, Int(Float(drawable.texture.width) * governed.resolutionScale))
+        let outputHeight = max(1, Int(Float(drawable.texture.height) * governed.resolutionScale))
 
         // ═══════════════════════════════════════════════════════════════
-        // PREVIEW PIPELINE: Scale + 5 passes for good quality with decent performance
+        // PREVIEW PIPELINE: render graph at drawable resolution
+        // Last pass renders straight into the drawable (no final blit)
         // ═══════════════════════════════════════════════════════════════
-        
-        // PASS 0: Scale input to drawable size (fixes black border)
-        if input.width != outputWidth || input.height != outputHeight {
-            if let scaled = scaleTexture(input: input, commandBuffer: commandBuffer) {
-                currentInput = scaled
-                passCount += 1
-            } else {
-                failedPasses.append("Scale")
-            }
-        }
+        let graph = buildRenderGraph(
+            source: input,
+            chroma: chroma,
+            yuvMatrix: yuvMatrix,
+            preset: preset,
+            quality: .preview,
+            governed: governed,
+            outputWidth: outputWidth,
+            outputHeight: outputHeight
+        )
+        beginFrame(label: "preview", commandBuffer: commandBuffer)
+        let (result, transients) = graph.execute(commandBuffer: commandBuffer, texturePool: texturePool, target: drawable.texture, instrumentation: frameRecorder)
 
-        // PASS 1: Color Grading (includes LUT, curves, selective color)
-        if let result = applyColorGrading(input: currentInput, preset: preset, commandBuffer: commandBuffer) {
-            currentInput = result
-            passCount += 1
-        } else {
-            failedPasses.append("ColorGrading")
+        // ★ YUVConvert / EncodeSRGB lỗi → không present ảnh sai (chỉ luma / linear trong bgra8)
+        if let failedPass = graph.failedRequiredPass {
+            finishFrame(commandBuffer)
+            discardFrame(failedPass: failedPass, transients: transients, commandBuffer: commandBuffer)
+            return false
         }
 
-        // PASS 1.2: Skin Tone Protection (AFTER color grading to protect skin from harsh edits)
-        if preset.skinToneProtection.enabled {
-            if let result = applySkinToneProtection(input: currentInput, config: preset.skinToneProtection, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("SkinTone")
+        // ═══════════════════════════════════════════════════════════════
+        // DEBUG LOGGING (periodic, not every frame)
+        // ═══════════════════════════════════════════════════════════════
+        frameCount += 1
+        let now = CFAbsoluteTimeGetCurrent()
+        if now - lastLogTime >= 5.0 {  // Log every 5 seconds
+            #if DEBUG
+            print("📊 FilterRenderer Preview: \(frameCount) frames in 5s, preset: \(preset.label)")
+            print("   Input: \(input.width)x\(input.height) → Drawable: \(outputWidth)x\(outputHeight)")
+            print("   Graph: \(graph.declaredPassCount) passes declared, \(graph.culledPassCount) culled, \(graph.mergedPassCount) merged, \(transients.count) textures")
+            let governor = qualityGovernor.statistics()
+            print("   Quality: \(governor.level), GPU \(String(format: "%.2f", governor.gpuMilliseconds))ms, \(governor.steps) steps")
+            if usesUniformRing {
+                let ring = uniformRing.statistics()
+                print("   Uniforms: \(ring.regions) regions, peak \(ring.peakBytes) bytes/frame, \(ring.fallbacks)/\(ring.allocations + ring.fallbacks) setBytes fallbacks")
             }
-        }
-
-        // PASS 1.3: Tone Mapping (AFTER color grading for HDR compression)
-        if preset.toneMapping.enabled {
-            if let result = applyToneMapping(input: currentInput, config: preset.toneMapping, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("ToneMapping")
+            if preset.instantFrame.enabled {
+                print("   InstantFrame: enabled, border=\(preset.instantFrame.borderWidth)")
             }
+            #endif
+            lastLogTime = now
+            frameCount = 0
         }
 
-        // PASS 1.5: Black & White Conversion (AFTER color grading for proper channel mixing)
-        if preset.bw.enabled {
-            if let result = applyBWConvert(input: currentInput, config: preset.bw, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
+        // FINAL: Blit only if the last pass couldn't target the drawable
+        // Reduced resolution → bilinear upscale (result là bgra8 sRGB → generic scale pipeline)
+        if result !== drawable.texture {
+            if result.width != drawable.texture.width || result.height != drawable.texture.height {
+                shaderIO = .legacy
+                frameRecorder?.beginPass("Upscale")
+                if scaleTexture(input: result, output: drawable.texture, commandBuffer: commandBuffer) == nil {
+                    blitToOutput(source: result, destination: drawable.texture, commandBuffer: commandBuffer)
+                }
             } else {
-                failedPasses.append("BWConvert")
+                blitToOutput(source: result, destination: drawable.texture, commandBuffer: commandBuffer)
             }
         }
 
-        // PASS 2: Flash (BEFORE Bloom so flash areas glow)
-        if preset.flash.enabled {
-            if let result = applyFlash(input: currentInput, config: preset.flash, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("Flash")
-            }
+        // Recycle textures after GPU completes
+        commandBuffer.addCompletedHandler { [weak texturePool, qualityGovernor] buffer in
+            transients.forEach { texturePool?.recycle($0) }
+            qualityGovernor.record(buffer)
+            completion?(buffer)
         }
 
-        // PASS 3: CCD Bloom (Digicam vertical smear - alternative to standard bloom)
-        if preset.ccdBloom.enabled {
-            if let result = applyCCDBloom(input: currentInput, config: preset.ccdBloom, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("CCDBloom")
-            }
-        }
+        finishFrame(commandBuffer)
+        commandBuffer.present(drawable)
+        commandBuffer.commit()
+        return true
+    }
+    
+    // MARK: - ★★★ NEW: Present an already-filtered frame ★★★
 
-        // PASS 4: Bloom (single-pass simplified, radius capped at 8)
-        if preset.bloom.enabled {
-            if let result = applyBloomSimplified(input: currentInput, config: preset.bloom, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("Bloom")
-            }
+    /// Aspect-fill scale a filtered frame onto the drawable (1 pass, no filter chain)
+    /// Dùng khi đang quay video: VideoRecorder đã filter frame vào pool buffer → viewfinder chỉ scale
+    @discardableResult
+    func presentScaled(input: MTLTexture, drawable: CAMetalDrawable, commandQueue: MTLCommandQueue, completion: ((MTLCommandBuffer) -> Void)? = nil) -> Bool {
+        guard let commandBuffer = commandQueue.makeCommandBuffer() else {
+            print("❌ FilterRenderer: Failed to create command buffer")
+            return false
         }
 
-        // PASS 4: Vignette
-        if preset.vignette.enabled {
-            if let result = applyVignette(input: currentInput, config: preset.vignette, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("Vignette")
-            }
-        }
+        // Frame của recorder là bgra8 sRGB → generic scale pipeline
+        shaderIO = .legacy
 
-        // PASS 4.5: Halation (Simplified single-pass for preview - important for Tungsten Night 800)
-        if preset.halation.enabled {
-            if let result = applyHalationSimplified(input: currentInput, config: preset.halation, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("Halation")
-            }
+        if scaleTexture(input: input, output: drawable.texture, commandBuffer: commandBuffer) == nil {
+            blitToOutput(source: input, destination: drawable.texture, commandBuffer: commandBuffer)
         }
 
-        // PASS 5: Grain (AFTER lighting effects for natural appearance)
-        if preset.grain.enabled {
-            if let result = applyGrain(input: currentInput, config: preset.grain, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("Grain")
-            }
+        if let completion = completion {
+            commandBuffer.addCompletedHandler { completion($0) }
         }
+        commandBuffer.present(drawable)
+        commandBuffer.commit()
+        return true
+    }
 
-        // PASS 6: Light Leak (Procedural light leak effect)
-        if preset.lightLeak.enabled {
-            if let result = applyLightLeak(input: currentInput, config: preset.lightLeak, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("LightLeak")
-            }
-        }
+    // MARK: - ★★★ Fused Preview Pass (Uber-shader) ★★★
+
+    /// Single fusedPreviewFragment pass for the given stages
+    /// RenderGraph gộp các pass per-pixel liên tiếp (Scale → ColorGrading → ... → Grain) vào đây;
+    /// blur đọc pixel lân cận nên tách chuỗi → thứ tự giống hệt multi-pass.
+    /// Vertex stage là vertexAspectFill → aspect-fill scale miễn phí (identity khi aspect khớp)
+    private func applyFusedPreview(
+        input: MTLTexture,
+        chroma: MTLTexture? = nil,
+        yuvMatrix: YUVMatrix = YUVMatrixBT709,
+        output: MTLTexture,
+        stages: FusedPreviewStages,
+        preset: FilterPreset,
+        commandBuffer: MTLCommandBuffer
+    ) -> MTLTexture? {
+        var bwParams = prepareBWParams(preset.bw)
+        var flashParams = prepareFlashParams(preset.flash)
+
+        // ★ Chỉ specialize stage thực sự chạy trong pass này
+        let signature = PipelineFeatureSignature(
+            flash: stages.contains(.flash) ? flashParams : nil,
+            bw: stages.contains(.bw) ? bwParams : nil
+        )
+        let variant = RenderEngine.shared.pipelineVariants.pipeline(for: .fusedPreview, signature: signature, pixelFormat: output.pixelFormat, mode: shaderIO)
 
-        // PASS 7: Date Stamp (Procedural 7-segment display)
-        if preset.dateStamp.enabled {
-            if let result = applyDateStamp(input: currentInput, config: preset.dateStamp, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("DateStamp")
-            }
+        guard let pipeline = variant ?? RenderEngine.shared.fusedPreviewPipeline else {
+            #if DEBUG
+            print("❌ FilterRenderer: fusedPreviewPipeline is nil!")
+            #endif
+            return nil
         }
 
-        // PASS 8: Overlays (Dust & Scratches - applied to image, not frame)
-        if preset.overlays.enabled {
-            if let result = applyOverlays(input: currentInput, config: preset.overlays, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("Overlays")
-            }
-        }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        // PASS 8.5: VHS Effects (scanlines, color bleed - for VHS presets)
-        if preset.vhsEffects.enabled {
-            if let result = applyVHSEffects(input: currentInput, config: preset.vhsEffects, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("VHS")
-            }
+        renderEncoder.setFragmentTexture(input, index: 0)
+        if let chroma = chroma {
+            renderEncoder.setFragmentTexture(chroma, index: 2)
         }
 
-        // PASS 8.6: Digicam Effects (digital noise, JPEG artifacts - for digicam presets)
-        if preset.digicamEffects.enabled {
-            if let result = applyDigicamEffects(input: currentInput, config: preset.digicamEffects, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("Digicam")
-            }
-        }
+        var aspectParams = AspectScaleParams()
+        aspectParams.inputAspect = Float(input.width) / Float(input.height)
+        aspectParams.outputAspect = Float(output.width) / Float(output.height)
+        renderEncoder.setVertexBytes(&aspectParams, length: MemoryLayout<AspectScaleParams>.stride, index: 0)
 
-        // PASS 8.7: Film Strip Effects (borders, perforations - for film strip preset)
-        if preset.filmStripEffects.enabled {
-            if let result = applyFilmStripEffects(input: currentInput, config: preset.filmStripEffects, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("FilmStrip")
-            }
-        }
+        var fusedParams = FusedPreviewParams()
+        fusedParams.stageMask = stages.rawValue
+        fusedParams.yuvMatrix = Int32(yuvMatrix.rawValue)
+        fusedParams.outputSize = SIMD2<Float>(Float(output.width), Float(output.height))
 
-        // PASS 9: Instant Frame (for Polaroid/Instax look)
-        if preset.instantFrame.enabled {
-            if let result = applyInstantFrame(input: currentInput, config: preset.instantFrame, commandBuffer: commandBuffer) {
-                currentInput = result
-                passCount += 1
-            } else {
-                failedPasses.append("InstantFrame")
-            }
+        // ★ Bind đủ 8 buffer kể cả stage tắt (stageMask quyết định stage nào được đọc)
+        var colorGradingParams = prepareColorGradingParams(preset)
+        var lutTexture: MTLTexture?
+        if stages.contains(.colorGrading), let lutFile = preset.lutFile {
+            lutTexture = RenderEngine.shared.loadLUT(named: lutFile)
         }
-
-        // ═══════════════════════════════════════════════════════════════
-        // DEBUG LOGGING (periodic, not every frame)
-        // ═══════════════════════════════════════════════════════════════
-        frameCount += 1
-        let now = CFAbsoluteTimeGetCurrent()
-        if now - lastLogTime >= 5.0 {  // Log every 5 seconds
-            if !failedPasses.isEmpty {
-                print("⚠️ FilterRenderer: Failed passes in last 5s: \(failedPasses.joined(separator: ", "))")
+        if let lutTexture = lutTexture {
+            renderEncoder.setFragmentTexture(lutTexture, index: 1)
+        } else {
+            colorGradingParams.flags &= ~UInt32(COLOR_GRADING_FLAG_LUT)
+        }
+
+        // ★★★ NEW: Baked lookups thay cho grading/B&W math khi đã bake xong ★★★
+        var gradingBaked = false
+        if usesBakedColorLUT {
+            let baker = RenderEngine.shared.colorLUTBaker
+            if stages.contains(.colorGrading),
+               let baked = baker.gradingLUT(for: colorGradingParams, curves: prepareRGBCurvesParams(preset.rgbCurves), lutName: preset.lutFile, lutTexture: lutTexture) {
+                gradingBaked = true
+                renderEncoder.setFragmentTexture(baked, index: 3)
+                fusedParams.stageMask |= FusedPreviewStages.bakedGrading.rawValue
             }
-            #if DEBUG
-            print("📊 FilterRenderer Preview: \(frameCount) frames in 5s, preset: \(preset.label)")
-            print("   Input: \(input.width)x\(input.height) → Drawable: \(outputWidth)x\(outputHeight)")
-            if preset.instantFrame.enabled {
-                print("   InstantFrame: enabled, border=\(preset.instantFrame.borderWidth)")
+            if stages.contains(.bw), let tone = baker.bwTone(for: bwParams) {
+                renderEncoder.setFragmentTexture(tone, index: 4)
+                fusedParams.stageMask |= FusedPreviewStages.bakedBW.rawValue
             }
-            #endif
-            lastLogTime = now
-            frameCount = 0
+        }
+        if stages.contains(.colorGrading) && !gradingBaked {
+            bindCurvesTexture(renderEncoder, params: &colorGradingParams, curves: preset.rgbCurves)
         }
 
-        // FINAL: Blit to drawable (now sizes match, no black borders!)
-        blitToOutput(source: currentInput, destination: drawable.texture, commandBuffer: commandBuffer)
+        var skinToneParams = prepareSkinToneParams(preset.skinToneProtection)
+        var toneMappingParams = prepareToneMappingParams(preset.toneMapping)
+        var vignetteParams = prepareVignetteParams(preset.vignette)
+        var grainParams = prepareGrainParams(preset.grain)
 
-        // Recycle textures after GPU completes
-        commandBuffer.addCompletedHandler { [weak texturePool] _ in
-            texturePool?.recycle(temp1)
-            texturePool?.recycle(temp2)
-        }
+        setFragmentParams(renderEncoder, &fusedParams, index: 0)
+        setFragmentParams(renderEncoder, &colorGradingParams, index: 1)
+        setFragmentParams(renderEncoder, &skinToneParams, index: 2)
+        setFragmentParams(renderEncoder, &toneMappingParams, index: 3)
+        setFragmentParams(renderEncoder, &bwParams, index: 4)
+        setFragmentParams(renderEncoder, &flashParams, index: 5)
+        setFragmentParams(renderEncoder, &vignetteParams, index: 6)
+        setFragmentParams(renderEncoder, &grainParams, index: 7)
+        bindNoiseTextures(renderEncoder)
 
-        commandBuffer.present(drawable)
-        commandBuffer.commit()
+        renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
+        renderEncoder.endEncoding()
+
+        return output
     }
-    
+
+    // MARK: - ★★★ Specialized Pipeline Prewarm ★★★
+
+    /// Compile function-constant variants cho preset ngay khi chọn → frame đầu không phải chờ
+    func prewarmSpecializedPipelines(for preset: FilterPreset) {
+        // ★ Deferred base pipelines của preset trước background warm-up
+        RenderEngine.shared.prewarmPipelines(for: preset)
+
+        let variants = RenderEngine.shared.pipelineVariants
+
+        // Realtime + capture intermediates (capture linear rgba16Float → variant riêng)
+        let targets = [previewIntermediateFormat, captureIntermediateFormat].map { format in
+            (pixelFormat: format.pixelFormat, mode: ShaderIOMode(linearIntermediates: format.isLinear, halfPrecision: usesHalfPrecisionMath))
+        }
+        for target in targets {
+            if preset.flash.enabled {
+                variants.prewarm(.flash, signature: PipelineFeatureSignature(flash: prepareFlashParams(preset.flash)), pixelFormat: target.pixelFormat, mode: target.mode)
+            }
+            if preset.lightLeak.enabled {
+                variants.prewarm(.lightLeak, signature: PipelineFeatureSignature(lightLeak: prepareLightLeakParams(preset.lightLeak)), pixelFormat: target.pixelFormat, mode: target.mode)
+            }
+            if preset.bw.enabled {
+                variants.prewarm(.bwConvert, signature: PipelineFeatureSignature(bw: prepareBWParams(preset.bw)), pixelFormat: target.pixelFormat, mode: target.mode)
+            }
+        }
+        if useFusedPreview && (preset.flash.enabled || preset.bw.enabled) {
+            let signature = PipelineFeatureSignature(
+                flash: preset.flash.enabled ? prepareFlashParams(preset.flash) : nil,
+                bw: preset.bw.enabled ? prepareBWParams(preset.bw) : nil
+            )
+            variants.prewarm(.fusedPreview, signature: signature, pixelFormat: targets[0].pixelFormat, mode: targets[0].mode)
+        }
+    }
+
     // MARK: - ★★★ FIXED V4: Aspect-Fill Scale with Correct Aspect Ratio ★★★
 
-    /// Scales input texture to match ping-pong buffer size using ASPECT-FILL
+    /// Scales input texture to the render graph working size using ASPECT-FILL
     /// This maintains the correct aspect ratio by cropping (not stretching)
     ///
     /// Uses vertexAspectFill shader to calculate UV correction based on:
@@ -280,17 +409,14 @@ class FilterRenderer {
     ///   outputAspect = output.width / output.height
     ///
     /// Result: Objects (InstantFrame, Vignette, etc.) maintain correct proportions
-    private func scaleTexture(input: MTLTexture, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.aspectFillScalePipeline,
-              let output = getNextOutputTexture() else {
+    private func scaleTexture(input: MTLTexture, output: MTLTexture, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.aspectFillScalePipeline else {
             // Fallback to old pipeline if aspect-fill not available
-            return scaleTextureFallback(input: input, commandBuffer: commandBuffer)
+            return scaleTextureFallback(input: input, output: output, commandBuffer: commandBuffer)
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         // ★★★ NEW: Pass aspect ratio params to vertex shader ★★★
@@ -321,9 +447,9 @@ class FilterRenderer {
         params.midtoneProtection = 0.5
         params.selectiveColorCount = 0
         params.lutIntensity = 0.0
-        params.useLUT = 0
+        params.flags = 0
 
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<ColorGradingParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
 
@@ -331,16 +457,13 @@ class FilterRenderer {
     }
 
     // Fallback for when aspectFillScalePipeline is not available
-    private func scaleTextureFallback(input: MTLTexture, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.colorGradingPipeline,
-              let output = getNextOutputTexture() else {
+    private func scaleTextureFallback(input: MTLTexture, output: MTLTexture, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.colorGradingPipeline else {
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         var params = ColorGradingParams()
@@ -364,9 +487,40 @@ class FilterRenderer {
         params.midtoneProtection = 0.5
         params.selectiveColorCount = 0
         params.lutIntensity = 0.0
-        params.useLUT = 0
+        params.flags = 0
+
+        setFragmentParams(renderEncoder, &params, index: 0)
+        renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
+        renderEncoder.endEncoding()
+
+        return output
+    }
+
+    // MARK: - ★★★ NEW: YUV → RGB (420f camera input) ★★★
+
+    /// Y + CbCr planes → BGRA at output size (aspect-fill, thay cho Scale)
+    private func applyYUVConvert(luma: MTLTexture, chroma: MTLTexture, matrix: YUVMatrix, output: MTLTexture, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.yuvConvertPipeline else {
+            #if DEBUG
+            print("❌ FilterRenderer: yuvConvertPipeline is nil!")
+            #endif
+            return nil
+        }
+
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
+
+        renderEncoder.setFragmentTexture(luma, index: 0)
+        renderEncoder.setFragmentTexture(chroma, index: 1)
+
+        var aspectParams = AspectScaleParams()
+        aspectParams.inputAspect = Float(luma.width) / Float(luma.height)
+        aspectParams.outputAspect = Float(output.width) / Float(output.height)
+        renderEncoder.setVertexBytes(&aspectParams, length: MemoryLayout<AspectScaleParams>.stride, index: 0)
+
+        var params = YUVConvertParams()
+        params.matrix = Int32(matrix.rawValue)
+        setFragmentParams(renderEncoder, &params, index: 0)
 
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<ColorGradingParams>.stride, index: 0)
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
 
@@ -375,33 +529,28 @@ class FilterRenderer {
 
     // MARK: - Simplified Bloom (Single Pass, Radius 8)
     
-    private func applyBloomSimplified(input: MTLTexture, config: BloomConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.bloomPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyBloomSimplified(input: MTLTexture, output: MTLTexture, config: BloomConfig, radiusCap: Float = 8, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.bloomPipeline else {
             #if DEBUG
-            if RenderEngine.shared.bloomPipeline == nil {
-                print("❌ FilterRenderer: bloomPipeline is nil!")
-            }
+            print("❌ FilterRenderer: bloomPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         // OPTIMIZED: Cap radius at 8 for preview
         var params = BloomParams()
         params.intensity = config.intensity
         params.threshold = config.threshold
-        params.radius = min(config.radius, 8.0)  // MAX 8 for preview
+        params.radius = min(config.radius, radiusCap)  // MAX 8 for preview (governor: 4)
         params.softness = config.softness
-        params.colorTint = SIMD3<Float>(config.colorTint.r, config.colorTint.g, config.colorTint.b)
+        params.colorTint = PackedFloat3(x: config.colorTint.r, y: config.colorTint.g, z: config.colorTint.b)
         params.enabled = 1
 
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<BloomParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
 
@@ -410,33 +559,28 @@ class FilterRenderer {
 
     /// Simplified halation for preview (single-pass, radius capped at 8)
     /// Uses legacy halationPipeline for performance
-    private func applyHalationSimplified(input: MTLTexture, config: HalationConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.halationPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyHalationSimplified(input: MTLTexture, output: MTLTexture, config: HalationConfig, radiusCap: Float = 8, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.halationPipeline else {
             #if DEBUG
-            if RenderEngine.shared.halationPipeline == nil {
-                print("❌ FilterRenderer: halationPipeline is nil!")
-            }
+            print("❌ FilterRenderer: halationPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         // OPTIMIZED: Cap radius at 8 for preview (legacy shader uses step=3 for performance)
         var params = HalationParams()
         params.enabled = 1
-        params.color = SIMD3<Float>(config.color.r, config.color.g, config.color.b)
+        params.color = PackedFloat3(x: config.color.r, y: config.color.g, z: config.color.b)
         params.intensity = config.intensity
         params.threshold = config.threshold
-        params.radius = min(config.radius, 8.0)  // MAX 8 for preview
+        params.radius = min(config.radius, radiusCap)  // MAX 8 for preview (governor: 4)
         params.softness = config.softness
 
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<HalationParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
 
@@ -452,40 +596,29 @@ class FilterRenderer {
             return
         }
 
-        let texturePool = RenderEngine.shared.texturePool
-        
-        // Use DRAWABLE size for intermediate textures
-        let outputWidth = drawable.texture.width
-        let outputHeight = drawable.texture.height
+        let texturePool = stream.texturePool
+
+        // Execute FULL filter pipeline at DRAWABLE size (graph scales input first)
+        let graph = buildRenderGraph(
+            source: input,
+            preset: preset,
+            quality: .capture,
+            outputWidth: drawable.texture.width,
+            outputHeight: drawable.texture.height
+        )
+        let (result, transients) = graph.execute(commandBuffer: commandBuffer, texturePool: texturePool, target: drawable.texture)
 
-        guard let temp1 = texturePool.renderTargetTexture(width: outputWidth, height: outputHeight, pixelFormat: .bgra8Unorm),
-              let temp2 = texturePool.renderTargetTexture(width: outputWidth, height: outputHeight, pixelFormat: .bgra8Unorm) else {
-            print("FilterRenderer: Failed to allocate intermediate textures")
+        if let failedPass = graph.failedRequiredPass {
+            discardFrame(failedPass: failedPass, transients: transients, commandBuffer: commandBuffer)
             return
         }
 
-        pingPongTextures[0] = temp1
-        pingPongTextures[1] = temp2
-        pingPongIndex = 0
-
-        var currentInput: MTLTexture = input
-        
-        // Scale input to drawable size first
-        if input.width != outputWidth || input.height != outputHeight {
-            if let scaled = scaleTexture(input: input, commandBuffer: commandBuffer) {
-                currentInput = scaled
-            }
+        if result !== drawable.texture {
+            blitToOutput(source: result, destination: drawable.texture, commandBuffer: commandBuffer)
         }
 
-        // Execute FULL filter pipeline (13 passes)
-        currentInput = executeFullPipeline(input: currentInput, preset: preset, commandBuffer: commandBuffer)
-
-        // FINAL PASS: Blit to drawable (sizes now match)
-        blitToOutput(source: currentInput, destination: drawable.texture, commandBuffer: commandBuffer)
-
         commandBuffer.addCompletedHandler { [weak texturePool] _ in
-            texturePool?.recycle(temp1)
-            texturePool?.recycle(temp2)
+            transients.forEach { texturePool?.recycle($0) }
         }
 
         commandBuffer.present(drawable)
@@ -502,102 +635,172 @@ class FilterRenderer {
             return false
         }
 
-        let texturePool = RenderEngine.shared.texturePool
+        let texturePool = stream.texturePool
 
-        guard let temp1 = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm),
-              let temp2 = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm) else {
-            print("❌ FilterRenderer: Failed to allocate preview textures")
+        // GALLERY PREVIEW: Color Grading + Vignette (fused into 1 pass when available)
+        let graph = buildRenderGraph(
+            source: input,
+            preset: preset,
+            quality: .gallery,
+            outputWidth: input.width,
+            outputHeight: input.height
+        )
+        beginFrame(label: "gallery", commandBuffer: commandBuffer)
+        let (result, transients) = graph.execute(commandBuffer: commandBuffer, texturePool: texturePool, target: output, instrumentation: frameRecorder)
+
+        if let failedPass = graph.failedRequiredPass {
+            finishFrame(commandBuffer)
+            discardFrame(failedPass: failedPass, transients: transients, commandBuffer: commandBuffer)
             return false
         }
 
-        pingPongTextures[0] = temp1
-        pingPongTextures[1] = temp2
-        pingPongIndex = 0
+        if result !== output {
+            blitToOutput(source: result, destination: output, commandBuffer: commandBuffer)
+        }
 
-        var currentInput = input
+        finishFrame(commandBuffer)
+        commandBuffer.commit()
+        commandBuffer.waitUntilCompleted()
 
-        // ═══════════════════════════════════════════════════════════════
-        // GALLERY PREVIEW: Only 2 passes for maximum speed
-        // ═══════════════════════════════════════════════════════════════
+        transients.forEach { texturePool.recycle($0) }
 
-        // PASS 1: Color Grading (includes LUT - the most important!)
-        if let result = applyColorGrading(input: currentInput, preset: preset, commandBuffer: commandBuffer) {
-            currentInput = result
+        if let error = commandBuffer.error {
+            print("❌ FilterRenderer: Gallery preview GPU error - \(error.localizedDescription)")
+            return false
         }
 
-        // PASS 2: Vignette (lightweight, adds depth)
-        if preset.vignette.enabled {
-            if let result = applyVignette(input: currentInput, config: preset.vignette, commandBuffer: commandBuffer) {
-                currentInput = result
-            }
+        return true
+    }
+
+    // MARK: - ★★★ NEW: Incremental Editor Render ★★★
+
+    /// Full capture chain for PhotoEditorView, reusing pass outputs from earlier renders
+    /// - inputKey: identity of `input` pixels (same key ⇔ same texture contents)
+    /// - cache: passes upstream of the first changed effect are skipped (RenderGraphCache)
+    /// Caller pins fixedFrameSeed → grain / light leaks stay put while a slider moves
+    func renderEditor(
+        input: MTLTexture,
+        inputKey: Int,
+        output: MTLTexture,
+        preset: FilterPreset,
+        cache: RenderGraphCache,
+        commandQueue: MTLCommandQueue
+    ) -> Bool {
+        guard let commandBuffer = commandQueue.makeCommandBuffer() else {
+            print("❌ FilterRenderer: Failed to create command buffer")
+            return false
         }
 
-        // Final blit to output
-        blitToOutput(source: currentInput, destination: output, commandBuffer: commandBuffer)
+        let texturePool = stream.texturePool
 
+        let graph = buildRenderGraph(
+            source: input,
+            preset: preset,
+            quality: .capture,
+            outputWidth: input.width,
+            outputHeight: input.height,
+            sourceKey: inputKey
+        )
+        beginFrame(label: "editor", commandBuffer: commandBuffer)
+        let (result, transients) = graph.execute(commandBuffer: commandBuffer, texturePool: texturePool, target: output, instrumentation: frameRecorder, cache: cache)
+
+        if let failedPass = graph.failedRequiredPass {
+            finishFrame(commandBuffer)
+            discardFrame(failedPass: failedPass, transients: transients, commandBuffer: commandBuffer)
+            return false
+        }
+
+        if result !== output {
+            blitToOutput(source: result, destination: output, commandBuffer: commandBuffer)
+        }
+
+        finishFrame(commandBuffer)
         commandBuffer.commit()
         commandBuffer.waitUntilCompleted()
 
+        transients.forEach { texturePool.recycle($0) }
+
         if let error = commandBuffer.error {
-            print("❌ FilterRenderer: Gallery preview GPU error - \(error.localizedDescription)")
-            texturePool.recycle(temp1)
-            texturePool.recycle(temp2)
+            print("❌ FilterRenderer: Editor render GPU error - \(error.localizedDescription)")
             return false
         }
 
-        texturePool.recycle(temp1)
-        texturePool.recycle(temp2)
-
         return true
     }
 
+    /// Stable bytes of a pass's parameters for content keys (sorted keys → same config = same bytes)
+    private static let parameterEncoder: JSONEncoder = {
+        let encoder = JSONEncoder()
+        encoder.outputFormatting = .sortedKeys
+        return encoder
+    }()
+
+    private static func encodedParameters<T: Encodable>(_ value: T) -> Data {
+        return (try? parameterEncoder.encode(value)) ?? Data()
+    }
+
     // MARK: - Synchronous Render (for photo capture) with Debug
 
     /// Render to texture SYNCHRONOUSLY with FULL quality pipeline
     func renderSync(input: MTLTexture, output: MTLTexture, preset: FilterPreset, commandQueue: MTLCommandQueue) -> Bool {
         print("🔄 FilterRenderer.renderSync: Starting for preset '\(preset.label)'")
         print("   Input: \(input.width)x\(input.height), Output: \(output.width)x\(output.height)")
-        
-        guard let commandBuffer = commandQueue.makeCommandBuffer() else {
-            print("❌ FilterRenderer: Failed to create command buffer")
-            return false
-        }
 
-        let texturePool = RenderEngine.shared.texturePool
+        // ★ 48MP-class input → tiles, mỗi tile 1 command buffer (chờ tile cuối)
+        if let tiles = captureTiles(input: input, output: output, preset: preset) {
+            let done = DispatchSemaphore(value: 0)
+            var success = false
+            renderTiles(tiles, index: 0, input: input, output: output, preset: preset, commandQueue: commandQueue) { ok in
+                success = ok
+                done.signal()
+            }
+            done.wait()
+            return success
+        }
 
-        guard let temp1 = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm),
-              let temp2 = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm) else {
-            print("❌ FilterRenderer: Failed to allocate intermediate textures")
+        guard let commandBuffer = commandQueue.makeCommandBuffer() else {
+            print("❌ FilterRenderer: Failed to create command buffer")
             return false
         }
 
-        pingPongTextures[0] = temp1
-        pingPongTextures[1] = temp2
-        pingPongIndex = 0
-
-        var currentInput = input
+        let texturePool = stream.texturePool
 
         // Execute FULL pipeline for capture (all 13 passes)
         let startTime = CFAbsoluteTimeGetCurrent()
-        currentInput = executeFullPipeline(input: currentInput, preset: preset, commandBuffer: commandBuffer)
+        let graph = buildRenderGraph(
+            source: input,
+            preset: preset,
+            quality: .capture,
+            outputWidth: input.width,
+            outputHeight: input.height
+        )
+        beginFrame(label: "capture", commandBuffer: commandBuffer)
+        let (result, transients) = graph.execute(commandBuffer: commandBuffer, texturePool: texturePool, target: output, instrumentation: frameRecorder)
         print("   Pipeline setup time: \(String(format: "%.3f", CFAbsoluteTimeGetCurrent() - startTime))s")
+        print("   Graph: \(graph.declaredPassCount) passes declared, \(graph.culledPassCount) culled, \(transients.count) textures")
 
-        // Final blit to output
-        blitToOutput(source: currentInput, destination: output, commandBuffer: commandBuffer)
+        if let failedPass = graph.failedRequiredPass {
+            finishFrame(commandBuffer)
+            discardFrame(failedPass: failedPass, transients: transients, commandBuffer: commandBuffer)
+            return false
+        }
+
+        // Final blit to output (skipped when the last pass rendered into output)
+        if result !== output {
+            blitToOutput(source: result, destination: output, commandBuffer: commandBuffer)
+        }
 
         // CRITICAL: Commit and WAIT for GPU to complete
+        finishFrame(commandBuffer)
         commandBuffer.commit()
         commandBuffer.waitUntilCompleted()
+
+        transients.forEach { texturePool.recycle($0) }
         
         if let error = commandBuffer.error {
             print("❌ FilterRenderer: GPU error - \(error.localizedDescription)")
-            texturePool.recycle(temp1)
-            texturePool.recycle(temp2)
             return false
         }
-
-        texturePool.recycle(temp1)
-        texturePool.recycle(temp2)
         
         let totalTime = CFAbsoluteTimeGetCurrent() - startTime
         print("✅ FilterRenderer.renderSync: Completed in \(String(format: "%.3f", totalTime))s")
@@ -605,256 +808,631 @@ class FilterRenderer {
         return true
     }
     
-    // MARK: - Async Render (legacy)
-    
-    func render(input: MTLTexture, output: MTLTexture, preset: FilterPreset, commandQueue: MTLCommandQueue) {
+    // MARK: - ★★★ NEW: Non-blocking Capture Render ★★★
+
+    /// Render that returns right after commit (không waitUntilCompleted)
+    /// - quality: .capture (full 13-pass, photo) or .video (viewfinder chain at input resolution)
+    /// - thumbnails: square targets aspect-fill scaled from output in the same command buffer (gallery pyramid)
+    /// - completion: called on Metal's completion thread with GPU success; output is readable from there
+    func renderAsync(
+        input: MTLTexture,
+        chroma: MTLTexture? = nil,
+        yuvMatrix: YUVMatrix = YUVMatrixBT709,
+        output: MTLTexture,
+        preset: FilterPreset,
+        quality: RenderQuality = .capture,
+        thumbnails: [MTLTexture] = [],
+        commandQueue: MTLCommandQueue,
+        completion: @escaping (Bool) -> Void
+    ) {
+        // ★ 48MP-class capture → tiles chained through completion handlers (thumbnails sau tile cuối)
+        if quality == .capture, chroma == nil, let tiles = captureTiles(input: input, output: output, preset: preset) {
+            renderTiles(tiles, index: 0, input: input, output: output, preset: preset, commandQueue: commandQueue) { [weak self] success in
+                guard success, !thumbnails.isEmpty, let self = self, let commandBuffer = commandQueue.makeCommandBuffer() else {
+                    completion(success)
+                    return
+                }
+                self.encodeThumbnails(from: output, into: thumbnails, commandBuffer: commandBuffer)
+                commandBuffer.addCompletedHandler { completion($0.error == nil) }
+                commandBuffer.commit()
+            }
+            return
+        }
+
         guard let commandBuffer = commandQueue.makeCommandBuffer() else {
+            print("❌ FilterRenderer: Failed to create command buffer")
+            completion(false)
             return
         }
 
-        let texturePool = RenderEngine.shared.texturePool
+        let texturePool = stream.texturePool
+
+        let graph = buildRenderGraph(
+            source: input,
+            chroma: chroma,
+            yuvMatrix: yuvMatrix,
+            preset: preset,
+            quality: quality,
+            outputWidth: input.width,
+            outputHeight: input.height
+        )
+        beginFrame(label: quality == .video ? "video" : "capture", commandBuffer: commandBuffer)
+        let (result, transients) = graph.execute(commandBuffer: commandBuffer, texturePool: texturePool, target: output, instrumentation: frameRecorder)
 
-        guard let temp1 = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm),
-              let temp2 = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm) else {
+        if let failedPass = graph.failedRequiredPass {
+            finishFrame(commandBuffer)
+            discardFrame(failedPass: failedPass, transients: transients, commandBuffer: commandBuffer)
+            completion(false)
             return
         }
 
-        pingPongTextures[0] = temp1
-        pingPongTextures[1] = temp2
-        pingPongIndex = 0
+        if result !== output {
+            blitToOutput(source: result, destination: output, commandBuffer: commandBuffer)
+        }
 
-        var currentInput = input
-        currentInput = executeFullPipeline(input: currentInput, preset: preset, commandBuffer: commandBuffer)
-        blitToOutput(source: currentInput, destination: output, commandBuffer: commandBuffer)
+        encodeThumbnails(from: output, into: thumbnails, commandBuffer: commandBuffer)
 
-        commandBuffer.addCompletedHandler { [weak texturePool] _ in
-            texturePool?.recycle(temp1)
-            texturePool?.recycle(temp2)
+        commandBuffer.addCompletedHandler { [weak texturePool] buffer in
+            transients.forEach { texturePool?.recycle($0) }
+
+            if let error = buffer.error {
+                print("❌ FilterRenderer: Async render GPU error - \(error.localizedDescription)")
+                completion(false)
+            } else {
+                completion(true)
+            }
         }
 
+        finishFrame(commandBuffer)
         commandBuffer.commit()
     }
 
-    // MARK: - Full Pipeline Execution (13 passes for capture) with Debug
-    
-    private func executeFullPipeline(input: MTLTexture, preset: FilterPreset, commandBuffer: MTLCommandBuffer) -> MTLTexture {
-        var currentInput = input
-        var passResults: [String] = []
+    // MARK: - ★★★ NEW: Thumbnail Pyramid (capture by-product) ★★★
+
+    /// Aspect-fill downscales of source into targets, largest first
+    /// Mỗi level scale từ level lớn hơn → minification ≤ ~3× mỗi bước, bilinear không aliasing nặng
+    private func encodeThumbnails(from source: MTLTexture, into targets: [MTLTexture], commandBuffer: MTLCommandBuffer) {
+        guard !targets.isEmpty else { return }
+
+        // Output đã là bgra8 sRGB-encoded → generic scale pipeline
+        shaderIO = .legacy
+        frameRecorder?.beginPass("Thumbnails")
 
-        // PASS 1: Lens Distortion
+        var previous = source
+        for target in targets.sorted(by: { $0.width * $0.height > $1.width * $1.height }) {
+            guard scaleTexture(input: previous, output: target, commandBuffer: commandBuffer) != nil else { return }
+            previous = target
+        }
+    }
+
+    // MARK: - ★★★ NEW: Tiled Full-Resolution Capture (48MP) ★★★
+
+    /// One tile: `padded` is rendered, only `core` is written to the output (cores cover the image exactly once)
+    private struct CaptureTile {
+        let core: MTLRegion
+        let padded: MTLRegion
+    }
+
+    /// Tile layout for a capture, nil → render the whole image in one command buffer
+    /// - Overlap = tổng footprint của các pass lân cận (lens distortion, bloom/halation, CCD smear)
+    /// - Tile origins aligned to the deepest pyramid mip so mip grids match across tiles
+    private func captureTiles(input: MTLTexture, output: MTLTexture, preset: FilterPreset) -> [CaptureTile]? {
+        let width = input.width
+        let height = input.height
+
+        guard width * height > tiledCaptureThreshold,
+              output.width == width, output.height == height,
+              output.pixelFormat == .bgra8Unorm else {
+            return nil
+        }
+
+        guard let footprint = tileFootprint(for: preset, width: width, height: height) else {
+            print("⚠️ FilterRenderer: Preset '\(preset.label)' has a whole-image pass, tiled capture skipped")
+            return nil
+        }
+
+        let alignment = footprint.alignment
+        let overlap = (footprint.overlap + alignment - 1) / alignment * alignment
+        let stride = (captureTileSize - 2 * overlap) / alignment * alignment
+
+        // Overlap ăn gần hết tile → tiling không còn lợi
+        guard stride >= captureTileSize / 2 else {
+            print("⚠️ FilterRenderer: Tile overlap \(overlap)px too large for \(captureTileSize)px tiles, rendering full frame")
+            return nil
+        }
+
+        var tiles: [CaptureTile] = []
+        for y in Swift.stride(from: 0, to: height, by: stride) {
+            for x in Swift.stride(from: 0, to: width, by: stride) {
+                let coreWidth = min(stride, width - x)
+                let coreHeight = min(stride, height - y)
+                let paddedX = max(0, x - overlap)
+                let paddedY = max(0, y - overlap)
+                let paddedWidth = min(width, x + coreWidth + overlap) - paddedX
+                let paddedHeight = min(height, y + coreHeight + overlap) - paddedY
+
+                tiles.append(CaptureTile(
+                    core: MTLRegionMake2D(x, y, coreWidth, coreHeight),
+                    padded: MTLRegionMake2D(paddedX, paddedY, paddedWidth, paddedHeight)
+                ))
+            }
+        }
+
+        print("🧩 FilterRenderer: Tiled capture \(width)x\(height) → \(tiles.count) tiles (\(captureTileSize)px, overlap \(overlap)px)")
+        return tiles
+    }
+
+    /// Kernel reach (full-res pixels) accumulated over the capture chain + mip alignment
+    /// nil → preset dùng pass remap toàn ảnh / chưa tile-aware (InstantFrame, FilmStrip, VHS, Digicam)
+    private func tileFootprint(for preset: FilterPreset, width: Int, height: Int) -> (overlap: Int, alignment: Int)? {
+        if preset.instantFrame.enabled || preset.filmStripEffects.enabled ||
+            preset.vhsEffects.enabled || preset.digicamEffects.enabled {
+            return nil
+        }
+
+        let longEdge = Float(max(width, height))
+        var overlap = 2  // Bilinear taps ở mép tile
+        var alignment = 1
+
+        // Lens distortion: max |dc| × |distortion × scale − 1| over the image (UV → pixels)
         if preset.lensDistortion.enabled {
-            if let result = applyLensDistortion(input: currentInput, params: preset.lensDistortion, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("LensDistortion✓")
+            let lens = preset.lensDistortion
+            var maxShift: Float = 0
+            for step in 1...8 {
+                let radius = 0.7072 * Float(step) / 8
+                let r2 = radius * radius
+                let distortion = 1 + lens.k1 * r2 + lens.k2 * r2 * r2
+                for channel in [1 - lens.caStrength, 1, 1 + lens.caStrength] {
+                    maxShift = max(maxShift, radius * abs(distortion * channel * lens.scale - 1))
+                }
+            }
+            overlap += Int((maxShift * longEdge).rounded(.up)) + 1
+        }
+
+        // CCD: vertical smear ≤ 30 × 3px, horizontal ≤ 15 × 3px, fringe 5 × fringeWidth px
+        if preset.ccdBloom.enabled {
+            let ccd = preset.ccdBloom
+            let vertical = min(max(Int(ccd.smearLength * 40), 4), 30) * 3
+            let horizontal = min(max(Int(ccd.horizontalRadius * 30), 2), 15) * 3
+            let fringe = Int((ccd.fringeWidth * 5).rounded(.up))
+            overlap += max(vertical, horizontal, fringe) + 1
+        }
+
+        // Bloom / halation: pyramid reach ≈ 3 × 2^(levels+1) px, separable fallback = capped radius
+        let pyramidAvailable = RenderEngine.shared.pyramidDownsamplePipeline != nil &&
+            RenderEngine.shared.pyramidUpsamplePipeline != nil
+        let blurs: [(enabled: Bool, radius: Float, cap: Float)] = [
+            (preset.bloom.enabled && preset.bloom.intensity > 0, preset.bloom.radius, 20),
+            (preset.halation.enabled && preset.halation.intensity > 0, preset.halation.radius, 25)
+        ]
+        for blur in blurs where blur.enabled {
+            if pyramidAvailable {
+                let levels = pyramidLevels(radius: blur.radius, width: width, height: height)
+                overlap += 3 << (levels + 1)
+                alignment = max(alignment, 1 << levels)
             } else {
-                passResults.append("LensDistortion✗")
+                overlap += Int(min(blur.radius, blur.cap).rounded(.up)) + 2
             }
         }
 
-        // PASS 2: Color Grading
-        if let result = applyColorGrading(input: currentInput, preset: preset, commandBuffer: commandBuffer) {
-            currentInput = result
-            passResults.append("ColorGrading✓")
-        } else {
-            passResults.append("ColorGrading✗")
+        return (overlap, alignment)
+    }
+
+    /// Encode tile `index`, then chain the next one from its completion handler
+    /// (1 tile in flight → transients của tile trước đã recycle trước khi tile sau cấp phát)
+    private func renderTiles(
+        _ tiles: [CaptureTile],
+        index: Int,
+        input: MTLTexture,
+        output: MTLTexture,
+        preset: FilterPreset,
+        commandQueue: MTLCommandQueue,
+        startTime: CFAbsoluteTime = CFAbsoluteTimeGetCurrent(),
+        completion: @escaping (Bool) -> Void
+    ) {
+        let tile = tiles[index]
+        let texturePool = stream.texturePool
+
+        guard let commandBuffer = commandQueue.makeCommandBuffer(),
+              let tileInput = texturePool.transientTexture(
+                  width: tile.padded.size.width,
+                  height: tile.padded.size.height,
+                  pixelFormat: input.pixelFormat
+              ) else {
+            print("❌ FilterRenderer: Failed to set up tile \(index + 1)/\(tiles.count)")
+            completion(false)
+            return
+        }
+        commandBuffer.label = "CaptureTile\(index)"
+        beginFrame(label: "capture.tile", commandBuffer: commandBuffer)
+
+        // 1. Crop padded region of the source
+        if let blit = commandBuffer.makeBlitCommandEncoder() {
+            blit.copy(
+                from: input, sourceSlice: 0, sourceLevel: 0,
+                sourceOrigin: tile.padded.origin, sourceSize: tile.padded.size,
+                to: tileInput, destinationSlice: 0, destinationLevel: 0,
+                destinationOrigin: MTLOrigin(x: 0, y: 0, z: 0)
+            )
+            blit.endEncoding()
+        }
+
+        // 2. Full capture chain on the tile, position-dependent passes see full-image coordinates
+        tileRegion = TileRegion(
+            origin: SIMD2<Float>(Float(tile.padded.origin.x) / Float(input.width), Float(tile.padded.origin.y) / Float(input.height)),
+            extent: SIMD2<Float>(Float(tile.padded.size.width) / Float(input.width), Float(tile.padded.size.height) / Float(input.height)),
+            imageSize: SIMD2<Float>(Float(input.width), Float(input.height))
+        )
+        let graph = buildRenderGraph(
+            source: tileInput,
+            preset: preset,
+            quality: .capture,
+            outputWidth: tile.padded.size.width,
+            outputHeight: tile.padded.size.height
+        )
+        let (result, transients) = graph.execute(commandBuffer: commandBuffer, texturePool: texturePool, instrumentation: frameRecorder)
+        tileRegion = Self.fullImageRegion
+
+        if let failedPass = graph.failedRequiredPass {
+            finishFrame(commandBuffer)
+            discardFrame(failedPass: failedPass, transients: transients + [tileInput], commandBuffer: commandBuffer)
+            completion(false)
+            return
         }
 
-        // PASS 2.2: Skin Tone Protection (AFTER color grading to protect skin from harsh edits)
-        if preset.skinToneProtection.enabled {
-            if let result = applySkinToneProtection(input: currentInput, config: preset.skinToneProtection, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("SkinTone✓")
-            } else {
-                passResults.append("SkinTone✗")
+        // 3. Stitch: chỉ phần core (bỏ overlap) vào output
+        if let blit = commandBuffer.makeBlitCommandEncoder() {
+            blit.copy(
+                from: result, sourceSlice: 0, sourceLevel: 0,
+                sourceOrigin: MTLOrigin(
+                    x: tile.core.origin.x - tile.padded.origin.x,
+                    y: tile.core.origin.y - tile.padded.origin.y,
+                    z: 0
+                ),
+                sourceSize: tile.core.size,
+                to: output, destinationSlice: 0, destinationLevel: 0,
+                destinationOrigin: tile.core.origin
+            )
+            blit.endEncoding()
+        }
+
+        commandBuffer.addCompletedHandler { [weak self, weak texturePool] buffer in
+            texturePool?.recycle(tileInput)
+            transients.forEach { texturePool?.recycle($0) }
+
+            if let error = buffer.error {
+                print("❌ FilterRenderer: Tile \(index + 1)/\(tiles.count) GPU error - \(error.localizedDescription)")
+                completion(false)
+                return
             }
+
+            guard index + 1 < tiles.count else {
+                print("✅ FilterRenderer: \(tiles.count) tiles in \(String(format: "%.3f", CFAbsoluteTimeGetCurrent() - startTime))s")
+                completion(true)
+                return
+            }
+
+            guard let self = self else {
+                completion(false)
+                return
+            }
+            self.renderTiles(tiles, index: index + 1, input: input, output: output, preset: preset,
+                             commandQueue: commandQueue, startTime: startTime, completion: completion)
         }
 
-        // PASS 2.3: Tone Mapping (AFTER color grading for HDR compression)
-        if preset.toneMapping.enabled {
-            if let result = applyToneMapping(input: currentInput, config: preset.toneMapping, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("ToneMapping✓")
-            } else {
-                passResults.append("ToneMapping✗")
+        finishFrame(commandBuffer)
+        commandBuffer.commit()
+    }
+
+    // MARK: - ★★★ NEW: Single Neighbourhood Pass (PipelineBenchmark) ★★★
+
+    /// One neighbourhood pass on input, fragment or compute theo computeKernelPasses
+    /// Blocking; frame label "kernel" (RenderInstrumentation) → PipelineBenchmark đọc GPU time qua recorder
+    func renderNeighbourhoodPass(_ pass: ComputeKernelPass, input: MTLTexture, output: MTLTexture, commandQueue: MTLCommandQueue) -> Bool {
+        guard let commandBuffer = commandQueue.makeCommandBuffer() else {
+            print("❌ FilterRenderer: Failed to create command buffer")
+            return false
+        }
+
+        shaderIO = .legacy
+        beginFrame(label: "kernel", commandBuffer: commandBuffer)
+        frameRecorder?.beginPass(pass.rawValue)
+        let encoded = encodeNeighbourhoodPass(pass, input: input, output: output, commandBuffer: commandBuffer) != nil
+
+        finishFrame(commandBuffer)
+        commandBuffer.commit()
+        commandBuffer.waitUntilCompleted()
+
+        return encoded && commandBuffer.error == nil
+    }
+
+    /// One neighbourhood pass with a representative preset config
+    private func encodeNeighbourhoodPass(_ pass: ComputeKernelPass, input: MTLTexture, output: MTLTexture, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        switch pass {
+        case .ccdBloom:
+            return applyCCDBloom(input: input, output: output, config: .ccdHeavy, commandBuffer: commandBuffer)
+        case .digicam:
+            return applyDigicamEffects(input: input, output: output, config: .ccdPointShoot, commandBuffer: commandBuffer)
+        case .vhs:
+            return applyVHSEffects(input: input, output: output, config: .wornTape, commandBuffer: commandBuffer)
+        case .lensDistortion:
+            let lens = LensDistortionConfig(enabled: true, k1: 0.08, k2: 0.02, caStrength: 0.006, scale: 0.96)
+            return applyLensDistortion(input: input, output: output, params: lens, commandBuffer: commandBuffer)
+        }
+    }
+
+    /// Per-frame random seed in 0..<bound (fixedFrameSeed khi deterministic)
+    private func frameSeed(below bound: UInt32) -> UInt32 {
+        if let seed = fixedFrameSeed {
+            return seed % bound
+        }
+        return UInt32.random(in: 0..<bound)
+    }
+
+    /// Coarse GPU class for benchmark reports
+    var deviceClass: String {
+        if device.supportsFamily(.apple8) { return "apple8+" }
+        if device.supportsFamily(.apple7) { return "apple7" }
+        if device.supportsFamily(.apple6) { return "apple6" }
+        if device.supportsFamily(.apple5) { return "apple5" }
+        return "apple4-"
+    }
+
+    // MARK: - Async Render (legacy)
+    
+    func render(input: MTLTexture, output: MTLTexture, preset: FilterPreset, commandQueue: MTLCommandQueue) {
+        renderAsync(input: input, output: output, preset: preset, commandQueue: commandQueue) { _ in }
+    }
+
+    // MARK: - ★★★ Render Graph Description (shared by all quality tiers) ★★★
+
+    /// Declares the filter chain once; RenderQuality decides blur quality, fusion and which effects run
+    ///
+    /// Order: Scale → LensDistortion → ColorGrading → SkinTone → ToneMapping → B&W → Flash → CCDBloom
+    ///        → Bloom → Vignette → Halation → Grain → LightLeak → DateStamp → Overlays → VHS → Digicam
+    ///        → FilmStrip → InstantFrame
+    /// chroma != nil → source là Y plane; pass đầu (YUVConvert, fusable) convert + aspect-fill thay cho Scale
+    /// Linear intermediate format → source đọc qua view _srgb (hoặc DecodeSRGB), thêm EncodeSRGB cuối
+    /// governed: bậc của PreviewQualityGovernor (chỉ preview; .full = không đổi gì)
+    /// sourceKey: identity of the source pixels → every pass gets a content key (RenderGraphCache)
+    private func buildRenderGraph(
+        source: MTLTexture,
+        chroma: MTLTexture? = nil,
+        yuvMatrix: YUVMatrix = YUVMatrixBT709,
+        preset: FilterPreset,
+        quality: RenderQuality,
+        governed: PreviewQualitySettings = .full,
+        outputWidth: Int,
+        outputHeight: Int,
+        sourceKey: Int? = nil
+    ) -> RenderGraph {
+        let format = intermediateFormat(for: quality)
+        let linear = format.isLinear && RenderEngine.shared.srgbEncodePipeline != nil
+        shaderIO = ShaderIOMode(linearIntermediates: linear, halfPrecision: usesHalfPrecisionMath)
+
+        // Content key của source = pixels + mọi state của renderer mà pass closures đọc
+        let graphKey: Int? = sourceKey.map { sourceKey in
+            var hasher = Hasher()
+            hasher.combine(sourceKey)
+            hasher.combine(quality.rawValue)
+            hasher.combine(format.pixelFormat.rawValue)
+            hasher.combine(linear)
+            hasher.combine(usesHalfPrecisionMath)
+            hasher.combine(outputWidth)
+            hasher.combine(outputHeight)
+            hasher.combine(fixedFrameSeed)
+            hasher.combine(stampDate)
+            return hasher.finalize()
+        }
+
+        // ★ Hardware sRGB decode khi sample source → pass đầu đọc giá trị linear, không tốn ALU
+        let sourceView = linear && chroma == nil ? srgbView(of: source) : nil
+        let graph = RenderGraph(source: sourceView ?? source, sourceKey: graphKey)
+        let target = RenderGraphTextureDescriptor(width: outputWidth, height: outputHeight, pixelFormat: .bgra8Unorm)
+        let working = RenderGraphTextureDescriptor(width: outputWidth, height: outputHeight, pixelFormat: linear ? format.pixelFormat : .bgra8Unorm)
+        var current = graph.source
+
+        /// Content key of a stage's parameters (nil when the graph is not cached)
+        func key(_ values: any Encodable...) -> Int? {
+            guard graphKey != nil else { return nil }
+            var hasher = Hasher()
+            values.forEach { hasher.combine(Self.encodedParameters($0)) }
+            return hasher.finalize()
+        }
+
+        /// Single-input fullscreen pass at working resolution
+        func add(
+            _ name: String,
+            isIdentity: Bool = false,
+            fused: FusedPreviewStages? = nil,
+            parameters: Int?,
+            _ encode: @escaping (_ input: MTLTexture, _ output: MTLTexture, _ commandBuffer: MTLCommandBuffer) -> MTLTexture?
+        ) {
+            graph.parameterKey = parameters
+            current = graph.addPass(name, inputs: [current], output: working, isIdentity: isIdentity, fusedStages: fused) { context in
+                encode(context.inputs[0], context.output, context.commandBuffer) != nil
             }
         }
 
-        // PASS 2.5: Black & White Conversion (AFTER color grading for proper channel mixing)
-        if preset.bw.enabled {
-            if let result = applyBWConvert(input: currentInput, config: preset.bw, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("BWConvert✓")
-            } else {
-                passResults.append("BWConvert✗")
+        /// Linear intermediates → encode sRGB vào target ở pass cuối
+        /// Required: passthrough sẽ đưa rgba16Float linear thẳng vào bgra8 (tối + lệch màu) → bỏ frame
+        func finish() -> RenderGraph {
+            graph.parameterKey = key()
+            if linear, let encodePipeline = RenderEngine.shared.srgbEncodePipeline {
+                current = graph.addPass("EncodeSRGB", inputs: [current], output: target, isRequired: true) { context in
+                    self.encodeFullscreenPass(pipeline: encodePipeline, context: context) { _ in }
+                }
             }
+            return graph
         }
 
-        // PASS 3: Flash (BEFORE Bloom/Halation so bright flash areas bloom)
-        if preset.flash.enabled {
-            if let result = applyFlash(input: currentInput, config: preset.flash, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("Flash✓")
-            } else {
-                passResults.append("Flash✗")
+        if quality.mergesPerPixelPasses && useFusedPreview && RenderEngine.shared.fusedPreviewPipeline != nil {
+            graph.enableFusion { stages, context in
+                let chroma = stages.contains(.yuvInput) ? context.inputs[1] : nil
+                return self.applyFusedPreview(input: context.inputs[0], chroma: chroma, yuvMatrix: yuvMatrix, output: context.output, stages: stages, preset: preset, commandBuffer: context.commandBuffer) != nil
             }
         }
 
-        // PASS 4: CCD Bloom (Digicam vertical smear - alternative to standard bloom)
-        if preset.ccdBloom.enabled {
-            if let result = applyCCDBloom(input: currentInput, config: preset.ccdBloom, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("CCDBloom✓")
-            } else {
-                passResults.append("CCDBloom✗")
+        if let chroma = chroma {
+            // YUV → RGB + aspect-fill in one pass; fused → biến mất vào fusedPreviewFragment
+            let chromaResource = graph.importTexture(chroma)
+            current = graph.addPass("YUVConvert", inputs: [graph.source, chromaResource], output: working, fusedStages: .yuvInput, isRequired: true) { context in
+                self.applyYUVConvert(luma: context.inputs[0], chroma: context.inputs[1], matrix: yuvMatrix, output: context.output, commandBuffer: context.commandBuffer) != nil
             }
+        } else if linear && sourceView == nil, let decodePipeline = RenderEngine.shared.srgbDecodePipeline {
+            // Source không có view _srgb → decode 1 lần ở source resolution
+            let decoded = RenderGraphTextureDescriptor(width: source.width, height: source.height, pixelFormat: format.pixelFormat)
+            graph.parameterKey = key()
+            current = graph.addPass("DecodeSRGB", inputs: [current], output: decoded) { context in
+                self.encodeFullscreenPass(pipeline: decodePipeline, context: context) { _ in }
+            }
+        }
+
+        if chroma == nil && (source.width != outputWidth || source.height != outputHeight) {
+            // Scale input to working size (aspect-fill). Empty stage set → gộp vào fused pass kế tiếp
+            add("Scale", fused: [], parameters: key()) { self.scaleTexture(input: $0, output: $1, commandBuffer: $2) }
+        }
+
+        if quality.includesLensDistortion && preset.lensDistortion.enabled {
+            add("LensDistortion", parameters: key(preset.lensDistortion)) { self.applyLensDistortion(input: $0, output: $1, params: preset.lensDistortion, commandBuffer: $2) }
+        }
+
+        // Color Grading (includes LUT, curves, selective color) - always runs
+        let gradingKey = key(preset.lutFile, preset.lutIntensity, preset.colorAdjustments, preset.splitTone, preset.selectiveColor, preset.rgbCurves)
+        add("ColorGrading", fused: .colorGrading, parameters: gradingKey) { self.applyColorGrading(input: $0, output: $1, preset: preset, commandBuffer: $2) }
+
+        guard quality.includesSecondaryEffects else {
+            // Gallery: Color Grading + Vignette only
+            if preset.vignette.enabled {
+                add("Vignette", isIdentity: preset.vignette.intensity <= 0, fused: .vignette, parameters: key(preset.vignette)) {
+                    self.applyVignette(input: $0, output: $1, config: preset.vignette, commandBuffer: $2)
+                }
+            }
+            return finish()
         }
 
-        // PASS 5-8: Bloom (Separable - 4 passes) - FULL QUALITY
-        // ★ FIX: Fallback to legacy bloom if separable pipeline unavailable
-        if preset.bloom.enabled {
-            if let result = applyBloomSeparable(input: currentInput, config: preset.bloom, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("Bloom✓")
-            } else if let result = applyBloomSimplified(input: currentInput, config: preset.bloom, commandBuffer: commandBuffer) {
-                // Fallback to legacy single-pass bloom
-                currentInput = result
-                passResults.append("Bloom(legacy)✓")
+        // Skin Tone Protection (AFTER color grading to protect skin from harsh edits)
+        if preset.skinToneProtection.enabled {
+            add("SkinTone", fused: .skinTone, parameters: key(preset.skinToneProtection)) { self.applySkinToneProtection(input: $0, output: $1, config: preset.skinToneProtection, commandBuffer: $2) }
+        }
+
+        // Tone Mapping (AFTER color grading for HDR compression)
+        if preset.toneMapping.enabled {
+            add("ToneMapping", fused: .toneMapping, parameters: key(preset.toneMapping)) { self.applyToneMapping(input: $0, output: $1, config: preset.toneMapping, commandBuffer: $2) }
+        }
+
+        // Black & White Conversion (AFTER color grading for proper channel mixing)
+        if preset.bw.enabled {
+            add("BWConvert", fused: .bw, parameters: key(preset.bw)) { self.applyBWConvert(input: $0, output: $1, config: preset.bw, commandBuffer: $2) }
+        }
+
+        // Flash (BEFORE Bloom/Halation so bright flash areas bloom)
+        if preset.flash.enabled {
+            add("Flash", fused: .flash, parameters: key(preset.flash)) { self.applyFlash(input: $0, output: $1, config: preset.flash, commandBuffer: $2) }
+        }
+
+        // CCD Bloom (Digicam vertical smear - alternative to standard bloom)
+        if preset.ccdBloom.enabled {
+            add("CCDBloom", parameters: key(preset.ccdBloom)) { self.applyCCDBloom(input: $0, output: $1, config: preset.ccdBloom, commandBuffer: $2) }
+        }
+
+        // Bloom: blur pyramid for capture (fallback: separable 4 passes), single-pass (radius ≤ 8) otherwise
+        // ★ Fallback to legacy bloom if pyramid/separable pipelines unavailable
+        var sharedPyramid: RenderGraph.Resource?
+        // ★ Governed halfResolutionBlur → preview cũng dùng pyramid (threshold + mips ở half-res)
+        let usesPyramid = quality.usesSeparableBlur || governed.halfResolutionBlur
+        // Bloom pyramid đọc cả halation config (shared threshold)
+        let bloomKey = key(preset.bloom, preset.halation)
+        let halationKey = key(preset.halation)
+        if preset.bloom.enabled && preset.bloom.intensity > 0 {
+            graph.parameterKey = bloomKey
+            if usesPyramid,
+               let bloom = addBloomPyramid(to: graph, input: current, preset: preset, sharedPyramid: &sharedPyramid)
+                ?? (quality.usesSeparableBlur ? addBloomSeparable(to: graph, input: current, config: preset.bloom) : nil) {
+                current = bloom
             } else {
-                passResults.append("Bloom✗")
+                add("Bloom", parameters: bloomKey) { self.applyBloomSimplified(input: $0, output: $1, config: preset.bloom, radiusCap: governed.blurRadiusCap, commandBuffer: $2) }
             }
         }
 
-        // PASS 8: Vignette
         if preset.vignette.enabled {
-            if let result = applyVignette(input: currentInput, config: preset.vignette, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("Vignette✓")
-            } else {
-                passResults.append("Vignette✗")
+            add("Vignette", isIdentity: preset.vignette.intensity <= 0, fused: .vignette, parameters: key(preset.vignette)) {
+                self.applyVignette(input: $0, output: $1, config: preset.vignette, commandBuffer: $2)
             }
         }
 
-        // PASS 9-12: Halation (Separable - 4 passes) - FULL QUALITY
-        // ★ FIX: Fallback to legacy halation if separable pipeline unavailable
-        if preset.halation.enabled {
-            if let result = applyHalationSeparable(input: currentInput, config: preset.halation, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("Halation✓")
-            } else if let result = applyHalationSimplified(input: currentInput, config: preset.halation, commandBuffer: commandBuffer) {
-                // Fallback to legacy single-pass halation
-                currentInput = result
-                passResults.append("Halation(legacy)✓")
+        // Halation: blur pyramid for capture (reuses bloom's when shared), single-pass otherwise (important for Tungsten Night 800)
+        if preset.halation.enabled && preset.halation.intensity > 0 {
+            graph.parameterKey = halationKey
+            if usesPyramid,
+               let halation = addHalationPyramid(to: graph, input: current, config: preset.halation, sharedPyramid: sharedPyramid)
+                ?? (quality.usesSeparableBlur ? addHalationSeparable(to: graph, input: current, config: preset.halation) : nil) {
+                current = halation
             } else {
-                passResults.append("Halation✗")
+                add("Halation", parameters: halationKey) { self.applyHalationSimplified(input: $0, output: $1, config: preset.halation, radiusCap: governed.blurRadiusCap, commandBuffer: $2) }
             }
         }
 
-        // PASS 13: Grain (AFTER lighting effects for natural appearance)
-        if preset.grain.enabled {
-            if let result = applyGrain(input: currentInput, config: preset.grain, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("Grain✓")
-            } else {
-                passResults.append("Grain✗")
+        // Grain (AFTER lighting effects for natural appearance)
+        if preset.grain.enabled && governed.includesGrainAndOverlays {
+            add("Grain", isIdentity: preset.grain.globalIntensity <= 0, fused: .grain, parameters: key(preset.grain)) {
+                self.applyGrain(input: $0, output: $1, config: preset.grain, commandBuffer: $2)
             }
         }
 
-        // PASS 14: Light Leak (Procedural light leak effect)
         if preset.lightLeak.enabled {
-            if let result = applyLightLeak(input: currentInput, config: preset.lightLeak, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("LightLeak✓")
-            } else {
-                passResults.append("LightLeak✗")
-            }
+            add("LightLeak", parameters: key(preset.lightLeak)) { self.applyLightLeak(input: $0, output: $1, config: preset.lightLeak, commandBuffer: $2) }
         }
 
-        // PASS 15: Date Stamp (Procedural 7-segment display)
         if preset.dateStamp.enabled {
-            if let result = applyDateStamp(input: currentInput, config: preset.dateStamp, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("DateStamp✓")
-            } else {
-                passResults.append("DateStamp✗")
-            }
+            add("DateStamp", parameters: key(preset.dateStamp)) { self.applyDateStamp(input: $0, output: $1, config: preset.dateStamp, commandBuffer: $2) }
         }
 
-        // PASS 16: Overlays (Dust & Scratches - applied to image, not frame)
-        if preset.overlays.enabled {
-            if let result = applyOverlays(input: currentInput, config: preset.overlays, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("Overlays✓")
-            } else {
-                passResults.append("Overlays✗")
-            }
+        // Overlays (Dust & Scratches - applied to image, not frame)
+        if preset.overlays.enabled && governed.includesGrainAndOverlays {
+            add("Overlays", parameters: key(preset.overlays)) { self.applyOverlays(input: $0, output: $1, config: preset.overlays, commandBuffer: $2) }
         }
 
-        // PASS 17: VHS Effects (scanlines, color bleed, tracking)
         if preset.vhsEffects.enabled {
-            if let result = applyVHSEffects(input: currentInput, config: preset.vhsEffects, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("VHS✓")
-            } else {
-                passResults.append("VHS✗")
-            }
+            add("VHS", parameters: key(preset.vhsEffects)) { self.applyVHSEffects(input: $0, output: $1, config: preset.vhsEffects, commandBuffer: $2) }
         }
 
-        // PASS 18: Digicam Effects (digital noise, JPEG artifacts, sharpening)
         if preset.digicamEffects.enabled {
-            if let result = applyDigicamEffects(input: currentInput, config: preset.digicamEffects, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("Digicam✓")
-            } else {
-                passResults.append("Digicam✗")
-            }
+            add("Digicam", parameters: key(preset.digicamEffects)) { self.applyDigicamEffects(input: $0, output: $1, config: preset.digicamEffects, commandBuffer: $2) }
         }
 
-        // PASS 19: Film Strip Effects (borders, perforations)
         if preset.filmStripEffects.enabled {
-            if let result = applyFilmStripEffects(input: currentInput, config: preset.filmStripEffects, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("FilmStrip✓")
-            } else {
-                passResults.append("FilmStrip✗")
-            }
+            add("FilmStrip", parameters: key(preset.filmStripEffects)) { self.applyFilmStripEffects(input: $0, output: $1, config: preset.filmStripEffects, commandBuffer: $2) }
         }
 
-        // PASS 20: Instant Frame
+        // Instant Frame (for Polaroid/Instax look) - always last
         if preset.instantFrame.enabled {
-            if let result = applyInstantFrame(input: currentInput, config: preset.instantFrame, commandBuffer: commandBuffer) {
-                currentInput = result
-                passResults.append("InstantFrame✓")
-            } else {
-                passResults.append("InstantFrame✗")
-            }
+            add("InstantFrame", parameters: key(preset.instantFrame)) { self.applyInstantFrame(input: $0, output: $1, config: preset.instantFrame, commandBuffer: $2) }
         }
 
-        #if DEBUG
-        print("   Pipeline passes: \(passResults.joined(separator: " → "))")
-        #endif
+        return finish()
+    }
 
-        return currentInput
+    /// Intermediate format for a quality tier (capture vs. realtime)
+    private func intermediateFormat(for quality: RenderQuality) -> IntermediateFormat {
+        return quality == .capture ? captureIntermediateFormat : previewIntermediateFormat
     }
 
-    // MARK: - Ping-Pong Buffer Helper
-    
-    private func getNextOutputTexture() -> MTLTexture? {
-        let output = pingPongTextures[pingPongIndex]
-        pingPongIndex = 1 - pingPongIndex
-        return output
+    /// sRGB view of an 8-bit source → sampler decode sRGB → linear (nil: format không có biến thể _srgb)
+    private func srgbView(of texture: MTLTexture) -> MTLTexture? {
+        let srgbFormat: MTLPixelFormat
+        switch texture.pixelFormat {
+        case .bgra8Unorm: srgbFormat = .bgra8Unorm_srgb
+        case .rgba8Unorm: srgbFormat = .rgba8Unorm_srgb
+        default: return nil
+        }
+        return texture.makeTextureView(pixelFormat: srgbFormat)
     }
 
     // MARK: - Individual Filter Passes
 
-    private func applyLensDistortion(input: MTLTexture, params: LensDistortionConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.lensDistortionPipeline,
-              let output = getNextOutputTexture() else { return nil }
-
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
-
-        renderEncoder.setRenderPipelineState(pipeline)
-        renderEncoder.setFragmentTexture(input, index: 0)
+    private func applyLensDistortion(input: MTLTexture, output: MTLTexture, params: LensDistortionConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.lensDistortionPipeline else { return nil }
 
         var metalParams = LensDistortionParams(
             enabled: params.enabled ? 1 : 0,
@@ -863,7 +1441,25 @@ class FilterRenderer {
             caStrength: params.caStrength,
             scale: params.scale
         )
-        renderEncoder.setFragmentBytes(&metalParams, length: MemoryLayout<LensDistortionParams>.stride, index: 0)
+
+        // ★ Compute: footprint R/G/B tính trong kernel → dùng hết tile memory
+        if let kernel = computeKernel("lensDistortionKernel", pass: .lensDistortion, input: input, output: output),
+           let encoder = makeComputeEncoder(commandBuffer: commandBuffer) {
+            encoder.setTexture(input, index: 0)
+            encoder.setTexture(output, index: 1)
+            setComputeParams(encoder, &metalParams, index: 0)
+            var region = tileRegion
+            encoder.setBytes(&region, length: MemoryLayout<TileRegion>.stride, index: Int(BufferIndexTileRegion.rawValue))
+            dispatchTileKernel(encoder, pipeline: kernel, output: output, usesFullTileMemory: true)
+            encoder.endEncoding()
+            return output
+        }
+
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
+
+        renderEncoder.setFragmentTexture(input, index: 0)
+        setFragmentParams(renderEncoder, &metalParams, index: 0)
+        bindTileRegion(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -871,52 +1467,61 @@ class FilterRenderer {
         return output
     }
 
-    private func applyColorGrading(input: MTLTexture, preset: FilterPreset, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.colorGradingPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyColorGrading(input: MTLTexture, output: MTLTexture, preset: FilterPreset, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        var params = prepareColorGradingParams(preset)
+
+        let lutTexture = preset.lutFile.flatMap { RenderEngine.shared.loadLUT(named: $0) }
+        if lutTexture == nil {
+            params.flags &= ~UInt32(COLOR_GRADING_FLAG_LUT)
+        }
+
+        // ★★★ NEW: Baked 3D LUT (curves + selective color + .cube + split tone) → 1 fetch ★★★
+        if usesBakedColorLUT,
+           let bakedPipeline = RenderEngine.shared.colorGradingBakedPipeline,
+           let baked = RenderEngine.shared.colorLUTBaker.gradingLUT(for: params, curves: prepareRGBCurvesParams(preset.rgbCurves), lutName: preset.lutFile, lutTexture: lutTexture) {
+            guard let renderEncoder = makeRenderEncoder(pipeline: bakedPipeline, output: output, commandBuffer: commandBuffer) else { return nil }
+
+            renderEncoder.setFragmentTexture(input, index: 0)
+            renderEncoder.setFragmentTexture(baked, index: 1)
+            renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
+            renderEncoder.endEncoding()
+
+            return output
+        }
+
+        guard let pipeline = RenderEngine.shared.colorGradingPipeline else {
             #if DEBUG
-            if RenderEngine.shared.colorGradingPipeline == nil {
-                print("❌ FilterRenderer: colorGradingPipeline is nil! Check shader compilation.")
-            }
+            print("❌ FilterRenderer: colorGradingPipeline is nil! Check shader compilation.")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
-
-        var params = prepareColorGradingParams(preset)
-        
-        var lutLoaded = false
-        if let lutFile = preset.lutFile, let lutTexture = RenderEngine.shared.loadLUT(named: lutFile) {
+        if let lutTexture = lutTexture {
             renderEncoder.setFragmentTexture(lutTexture, index: 1)
-            lutLoaded = true
         }
-        
-        params.useLUT = lutLoaded ? 1 : 0
-        
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<ColorGradingParams>.stride, index: 0)
+        bindCurvesTexture(renderEncoder, params: &params, curves: preset.rgbCurves)
+
+        setFragmentParams(renderEncoder, &params, index: 0)
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
 
         return output
     }
     
-    private func applyGrain(input: MTLTexture, config: GrainConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.grainPipeline,
-              let output = getNextOutputTexture() else { return nil }
+    private func applyGrain(input: MTLTexture, output: MTLTexture, config: GrainConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.grainPipeline else { return nil }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         var params = prepareGrainParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<GrainParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
+        bindTileRegion(renderEncoder)
+        bindNoiseTextures(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -925,10 +1530,12 @@ class FilterRenderer {
     }
 
     // MARK: - Separable Bloom Pipeline (4 passes) - CAPTURE ONLY
-    
-    private func applyBloomSeparable(input: MTLTexture, config: BloomConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+
+    /// Declares threshold → horizontal → vertical → composite as graph passes
+    /// Threshold/blur textures chỉ sống trong 4 pass này → RenderGraph tái sử dụng cho pass sau
+    /// Returns nil if any pipeline is missing (caller falls back to legacy bloom)
+    private func addBloomSeparable(to graph: RenderGraph, input: RenderGraph.Resource, config: BloomConfig) -> RenderGraph.Resource? {
         // ★ FIX: Validate ALL separable bloom pipelines exist before proceeding
-        // If any pipeline is missing, return nil to trigger fallback to legacy bloom
         guard let thresholdPipeline = RenderEngine.shared.bloomThresholdPipeline,
               let horizontalPipeline = RenderEngine.shared.bloomHorizontalPipeline,
               let verticalPipeline = RenderEngine.shared.bloomVerticalPipeline,
@@ -939,143 +1546,448 @@ class FilterRenderer {
             return nil
         }
 
-        let texturePool = RenderEngine.shared.texturePool
+        return addSeparableBlur(
+            to: graph,
+            input: input,
+            name: "Bloom",
+            pipelines: (thresholdPipeline, horizontalPipeline, verticalPipeline, compositePipeline),
+            params: prepareBloomParams(config)
+        )
+    }
 
-        guard let thresholdTex = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm),
-              let horizontalTex = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm),
-              let verticalTex = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm),
-              let output = getNextOutputTexture() else { return nil }
+    // MARK: - Separable Halation Pipeline (4 passes) - CAPTURE ONLY
 
-        var params = prepareBloomParams(config)
+    private func addHalationSeparable(to graph: RenderGraph, input: RenderGraph.Resource, config: HalationConfig) -> RenderGraph.Resource? {
+        // ★ FIX: Validate ALL separable halation pipelines exist before proceeding
+        guard let thresholdPipeline = RenderEngine.shared.halationThresholdPipeline,
+              let horizontalPipeline = RenderEngine.shared.halationHorizontalPipeline,
+              let verticalPipeline = RenderEngine.shared.halationVerticalPipeline,
+              let compositePipeline = RenderEngine.shared.halationCompositePipeline else {
+            #if DEBUG
+            print("⚠️ FilterRenderer: Separable halation pipelines not available, will fallback to legacy")
+            #endif
+            return nil
+        }
 
-        // Pass 1: Threshold extraction
-        renderPassDescriptor.colorAttachments[0].texture = thresholdTex
-        guard let encoder1 = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
-        encoder1.setRenderPipelineState(thresholdPipeline)
-        encoder1.setFragmentTexture(input, index: 0)
-        encoder1.setFragmentBytes(&params, length: MemoryLayout<BloomParams>.stride, index: 0)
-        encoder1.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
-        encoder1.endEncoding()
+        return addSeparableBlur(
+            to: graph,
+            input: input,
+            name: "Halation",
+            pipelines: (thresholdPipeline, horizontalPipeline, verticalPipeline, compositePipeline),
+            params: prepareHalationParams(config)
+        )
+    }
 
-        // Pass 2: Horizontal blur
-        renderPassDescriptor.colorAttachments[0].texture = horizontalTex
-        guard let encoder2 = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
-        encoder2.setRenderPipelineState(horizontalPipeline)
-        encoder2.setFragmentTexture(thresholdTex, index: 0)
-        encoder2.setFragmentBytes(&params, length: MemoryLayout<BloomParams>.stride, index: 0)
-        encoder2.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
-        encoder2.endEncoding()
+    // MARK: - ★★★ NEW: Dual-filter Blur Pyramid (bloom + halation) - CAPTURE ONLY ★★★
+
+    /// Bloom via pyramid; nếu halation cần cùng số mip → threshold chung (.rgb bloom, .a halation),
+    /// pyramid đó được trả qua sharedPyramid cho addHalationPyramid
+    private func addBloomPyramid(
+        to graph: RenderGraph,
+        input: RenderGraph.Resource,
+        preset: FilterPreset,
+        sharedPyramid: inout RenderGraph.Resource?
+    ) -> RenderGraph.Resource? {
+        guard let compositePipeline = RenderEngine.shared.bloomCompositePipeline else { return nil }
+
+        let descriptor = graph.descriptor(of: input)
+        let bloomParams = prepareBloomParams(preset.bloom)
+        let levels = pyramidLevels(radius: preset.bloom.radius, descriptor: descriptor)
+
+        let halation = preset.halation
+        let shareWithHalation = sharesBloomHalationPyramid &&
+            halation.enabled && halation.intensity > 0 &&
+            pyramidLevels(radius: halation.radius, descriptor: descriptor) == levels
+
+        let pyramid: RenderGraph.Resource?
+        if shareWithHalation, let sharedThreshold = RenderEngine.shared.sharedPyramidThresholdPipeline {
+            let halationParams = prepareHalationParams(halation)
+            pyramid = addBlurPyramid(to: graph, input: input, name: "BloomHalation", levels: levels) { context in
+                self.encodeFullscreenPass(pipeline: sharedThreshold, context: context) { encoder in
+                    var bloom = bloomParams
+                    var halo = halationParams
+                    self.setFragmentParams(encoder, &bloom, index: 0)
+                    self.setFragmentParams(encoder, &halo, index: 1)
+                }
+            }
+            sharedPyramid = pyramid
+        } else if let threshold = RenderEngine.shared.bloomPyramidThresholdPipeline {
+            pyramid = addBlurPyramid(to: graph, input: input, name: "Bloom", levels: levels) { context in
+                self.encodeFullscreenPass(pipeline: threshold, context: context, params: bloomParams)
+            }
+        } else {
+            pyramid = nil
+        }
 
-        // Pass 3: Vertical blur
-        renderPassDescriptor.colorAttachments[0].texture = verticalTex
-        guard let encoder3 = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
-        encoder3.setRenderPipelineState(verticalPipeline)
-        encoder3.setFragmentTexture(horizontalTex, index: 0)
-        encoder3.setFragmentBytes(&params, length: MemoryLayout<BloomParams>.stride, index: 0)
-        encoder3.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
-        encoder3.endEncoding()
-
-        // Pass 4: Composite
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let encoder4 = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
-        encoder4.setRenderPipelineState(compositePipeline)
-        encoder4.setFragmentTexture(input, index: 0)
-        encoder4.setFragmentTexture(verticalTex, index: 1)
-        encoder4.setFragmentBytes(&params, length: MemoryLayout<BloomParams>.stride, index: 0)
-        encoder4.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
-        encoder4.endEncoding()
+        guard let blurred = pyramid else { return nil }
 
-        commandBuffer.addCompletedHandler { [weak texturePool] _ in
-            texturePool?.recycle(thresholdTex)
-            texturePool?.recycle(horizontalTex)
-            texturePool?.recycle(verticalTex)
+        // Composite (original at texture 0, half-res pyramid at texture 1 — bilinear upscale khi sample)
+        return graph.addPass("BloomComposite", inputs: [input, blurred], output: descriptor) { context in
+            self.encodeFullscreenPass(pipeline: compositePipeline, context: context, params: bloomParams)
         }
+    }
 
-        return output
+    /// Halation via pyramid; sharedPyramid != nil → chỉ còn composite (đọc kênh .a)
+    private func addHalationPyramid(
+        to graph: RenderGraph,
+        input: RenderGraph.Resource,
+        config: HalationConfig,
+        sharedPyramid: RenderGraph.Resource?
+    ) -> RenderGraph.Resource? {
+        guard let compositePipeline = RenderEngine.shared.halationPyramidCompositePipeline else { return nil }
+
+        let descriptor = graph.descriptor(of: input)
+        let halationParams = prepareHalationParams(config)
+        var pyramidParams = PyramidParams()
+        pyramidParams.scatter = pyramidScatter
+
+        let blurred: RenderGraph.Resource
+        if let shared = sharedPyramid {
+            pyramidParams.channelMode = PYRAMID_CHANNEL_ALPHA
+            blurred = shared
+        } else if let threshold = RenderEngine.shared.halationPyramidThresholdPipeline,
+                  let pyramid = addBlurPyramid(
+                      to: graph,
+                      input: input,
+                      name: "Halation",
+                      levels: pyramidLevels(radius: config.radius, descriptor: descriptor),
+                      threshold: { context in
+                          self.encodeFullscreenPass(pipeline: threshold, context: context, params: halationParams)
+                      }
+                  ) {
+            pyramidParams.channelMode = PYRAMID_CHANNEL_RGB
+            blurred = pyramid
+        } else {
+            return nil
+        }
+
+        let compositeParams = pyramidParams
+        return graph.addPass("HalationComposite", inputs: [input, blurred], output: descriptor) { context in
+            self.encodeFullscreenPass(pipeline: compositePipeline, context: context) { encoder in
+                var halo = halationParams
+                var pyramid = compositeParams
+                self.setFragmentParams(encoder, &halo, index: 0)
+                self.setFragmentParams(encoder, &pyramid, index: 1)
+            }
+        }
     }
 
-    // MARK: - Separable Halation Pipeline (4 passes) - CAPTURE ONLY
-    
-    private func applyHalationSeparable(input: MTLTexture, config: HalationConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        // ★ FIX: Validate ALL separable halation pipelines exist before proceeding
-        // If any pipeline is missing, return nil to trigger fallback to legacy halation
-        guard let thresholdPipeline = RenderEngine.shared.halationThresholdPipeline,
-              let horizontalPipeline = RenderEngine.shared.halationHorizontalPipeline,
-              let verticalPipeline = RenderEngine.shared.halationVerticalPipeline,
-              let compositePipeline = RenderEngine.shared.halationCompositePipeline else {
+    /// Threshold (→ mip 1, 1/2 res) → 13-tap downsample tới mip `levels` → tent upsample về mip 1
+    /// - Returns: blurred mip 1 (rgba16Float), nil if pyramid pipelines are missing
+    private func addBlurPyramid(
+        to graph: RenderGraph,
+        input: RenderGraph.Resource,
+        name: String,
+        levels: Int,
+        threshold: @escaping (RenderGraphPassContext) -> Bool
+    ) -> RenderGraph.Resource? {
+        guard let downsamplePipeline = RenderEngine.shared.pyramidDownsamplePipeline,
+              let upsamplePipeline = RenderEngine.shared.pyramidUpsamplePipeline else {
             #if DEBUG
-            print("⚠️ FilterRenderer: Separable halation pipelines not available, will fallback to legacy")
+            print("⚠️ FilterRenderer: Blur pyramid pipelines not available, will fallback to separable")
             #endif
             return nil
         }
 
-        let texturePool = RenderEngine.shared.texturePool
+        let base = graph.descriptor(of: input)
+        func mip(_ level: Int) -> RenderGraphTextureDescriptor {
+            return RenderGraphTextureDescriptor(
+                width: max(1, base.width >> level),
+                height: max(1, base.height >> level),
+                pixelFormat: RenderEngine.pyramidPixelFormat
+            )
+        }
+
+        var params = PyramidParams()
+        params.scatter = pyramidScatter
+        let upsampleParams = params
+
+        // Mip chain: mips[i] = level i + 1
+        var mips = [graph.addPass("\(name)Threshold", inputs: [input], output: mip(1), encode: threshold)]
+        if levels >= 2 {
+            for level in 2...levels {
+                let down = graph.addPass("\(name)Down\(level)", inputs: [mips[level - 2]], output: mip(level)) { context in
+                    self.encodeFullscreenPass(pipeline: downsamplePipeline, context: context) { _ in }
+                }
+                mips.append(down)
+            }
+        }
+
+        // Upsample: up(k) = mix(down(k), tent(up(k + 1)), scatter)
+        var accumulated = mips[levels - 1]
+        for level in stride(from: levels - 1, through: 1, by: -1) {
+            accumulated = graph.addPass("\(name)Up\(level)", inputs: [mips[level - 1], accumulated], output: mip(level)) { context in
+                self.encodeFullscreenPass(pipeline: upsamplePipeline, context: context, params: upsampleParams)
+            }
+        }
+
+        return accumulated
+    }
+
+    /// Mip count for a Gaussian-equivalent radius in working-res texels (mip k ≈ 2^k texels)
+    /// Tiled capture: giới hạn theo ảnh đầy đủ, không theo tile → mọi tile cùng số mip
+    private func pyramidLevels(radius: Float, descriptor: RenderGraphTextureDescriptor) -> Int {
+        let size = imageSize(width: descriptor.width, height: descriptor.height)
+        return pyramidLevels(radius: radius, width: size.width, height: size.height)
+    }
 
-        guard let thresholdTex = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm),
-              let horizontalTex = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm),
-              let verticalTex = texturePool.renderTargetTexture(width: input.width, height: input.height, pixelFormat: .bgra8Unorm),
-              let output = getNextOutputTexture() else { return nil }
+    /// Không cap radius — chỉ giới hạn bởi kích thước ảnh (mip nhỏ nhất ≥ 8 px)
+    private func pyramidLevels(radius: Float, width: Int, height: Int) -> Int {
+        let wanted = max(1, Int(log2(max(radius, 2)).rounded()))
+        var maxLevels = 1
+        while min(width, height) >> (maxLevels + 1) >= 8 {
+            maxLevels += 1
+        }
+        return min(wanted, maxLevels)
+    }
 
-        var params = prepareHalationParams(config)
+    /// Threshold → horizontal blur → vertical blur → composite(input, blurred)
+    private func addSeparableBlur<Params>(
+        to graph: RenderGraph,
+        input: RenderGraph.Resource,
+        name: String,
+        pipelines: (threshold: MTLRenderPipelineState, horizontal: MTLRenderPipelineState, vertical: MTLRenderPipelineState, composite: MTLRenderPipelineState),
+        params: Params
+    ) -> RenderGraph.Resource {
+        let descriptor = graph.descriptor(of: input)
 
-        // Pass 1: Threshold + red tint
-        renderPassDescriptor.colorAttachments[0].texture = thresholdTex
-        guard let encoder1 = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
-        encoder1.setRenderPipelineState(thresholdPipeline)
-        encoder1.setFragmentTexture(input, index: 0)
-        encoder1.setFragmentBytes(&params, length: MemoryLayout<HalationParams>.stride, index: 0)
-        encoder1.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
-        encoder1.endEncoding()
+        // Pass 1: Threshold extraction
+        let threshold = graph.addPass("\(name)Threshold", inputs: [input], output: descriptor) { context in
+            self.encodeFullscreenPass(pipeline: pipelines.threshold, context: context, params: params)
+        }
 
         // Pass 2: Horizontal blur
-        renderPassDescriptor.colorAttachments[0].texture = horizontalTex
-        guard let encoder2 = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
-        encoder2.setRenderPipelineState(horizontalPipeline)
-        encoder2.setFragmentTexture(thresholdTex, index: 0)
-        encoder2.setFragmentBytes(&params, length: MemoryLayout<HalationParams>.stride, index: 0)
-        encoder2.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
-        encoder2.endEncoding()
+        let horizontal = graph.addPass("\(name)Horizontal", inputs: [threshold], output: descriptor) { context in
+            self.encodeFullscreenPass(pipeline: pipelines.horizontal, context: context, params: params)
+        }
 
         // Pass 3: Vertical blur
-        renderPassDescriptor.colorAttachments[0].texture = verticalTex
-        guard let encoder3 = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
-        encoder3.setRenderPipelineState(verticalPipeline)
-        encoder3.setFragmentTexture(horizontalTex, index: 0)
-        encoder3.setFragmentBytes(&params, length: MemoryLayout<HalationParams>.stride, index: 0)
-        encoder3.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
-        encoder3.endEncoding()
-
-        // Pass 4: Composite
+        let vertical = graph.addPass("\(name)Vertical", inputs: [horizontal], output: descriptor) { context in
+            self.encodeFullscreenPass(pipeline: pipelines.vertical, context: context, params: params)
+        }
+
+        // Pass 4: Composite (original at texture 0, blurred at texture 1)
+        return graph.addPass("\(name)Composite", inputs: [input, vertical], output: descriptor) { context in
+            self.encodeFullscreenPass(pipeline: pipelines.composite, context: context, params: params)
+        }
+    }
+
+    /// TileRegion at BufferIndexTileRegion cho pass phụ thuộc vị trí (identity ngoài tiled capture)
+    private func bindTileRegion(_ encoder: MTLRenderCommandEncoder) {
+        var region = tileRegion
+        encoder.setFragmentBytes(&region, length: MemoryLayout<TileRegion>.stride, index: Int(BufferIndexTileRegion.rawValue))
+    }
+
+    /// ★★★ NEW: Shared noise textures (TextureIndexNoise / TextureIndexBlueNoise) ★★★
+    /// Grain, B&W grain, dust/scratches, digicam + VHS noise fetch thay vì hash per-pixel
+    private func bindNoiseTextures(_ encoder: MTLRenderCommandEncoder) {
+        let noise = RenderEngine.shared.noiseTextures
+        encoder.setFragmentTexture(noise.grain, index: Int(TextureIndexNoise.rawValue))
+        encoder.setFragmentTexture(noise.blueNoise, index: Int(TextureIndexBlueNoise.rawValue))
+    }
+
+    /// White noise at TextureIndexNoise (overlays: 4 random độc lập / texel cho dust cell + scratch)
+    private func bindWhiteNoiseTexture(_ encoder: MTLRenderCommandEncoder) {
+        encoder.setFragmentTexture(RenderEngine.shared.noiseTextures.white, index: Int(TextureIndexNoise.rawValue))
+    }
+
+    // MARK: - ★★★ NEW: Compute Neighbourhood Kernels ★★★
+
+    /// Kernel that may replace the fragment pass input → output, nil → fragment path
+    /// (pass bị tắt, output không có shaderWrite như drawable / readback surface, hoặc đổi kích thước)
+    private func computeKernel(_ name: String, pass: ComputeKernelPass, input: MTLTexture, output: MTLTexture) -> MTLComputePipelineState? {
+        guard computeKernelPasses.contains(pass),
+              output.usage.contains(.shaderWrite),
+              output.width == input.width, output.height == input.height else {
+            return nil
+        }
+        return RenderEngine.shared.computeKernels.pipeline(named: name, mode: shaderIO)
+    }
+
+    /// KERNEL_TILE_SIZE wide, fewer rows when the pipeline can't run 256 threads
+    private func tileThreadgroupSize(_ pipeline: MTLComputePipelineState) -> MTLSize {
+        let side = Int(KERNEL_TILE_SIZE)
+        return MTLSize(width: side, height: max(1, min(side, pipeline.maxTotalThreadsPerThreadgroup / side)), depth: 1)
+    }
+
+    /// Tile + apron fits in threadgroup memory (không vừa → fragment, tránh mỗi tap đọc texture)
+    private func tileFits(_ pipeline: MTLComputePipelineState, apron: SIMD2<Int32>) -> Bool {
+        let size = tileThreadgroupSize(pipeline)
+        let texels = (size.width + 2 * Int(apron.x)) * (size.height + 2 * Int(apron.y))
+        return texels <= RenderEngine.shared.computeKernels.tileCapacity
+    }
+
+    /// Dispatch a tile kernel over output with KernelTileParams + threadgroup memory bound
+    /// Threadgroup memory = đúng footprint (tile + apron + reach) để nhiều threadgroup cùng chạy / core;
+    /// usesFullTileMemory: footprint tính trong kernel (lens)
+    private func dispatchTileKernel(
+        _ encoder: MTLComputeCommandEncoder,
+        pipeline: MTLComputePipelineState,
+        output: MTLTexture,
+        apron: SIMD2<Int32> = .zero,
+        reach: SIMD2<Int32> = .zero,
+        usesFullTileMemory: Bool = false
+    ) {
+        let kernels = RenderEngine.shared.computeKernels
+        let threads = tileThreadgroupSize(pipeline)
+
+        let extent = apron &+ reach
+        let needed = (threads.width + 2 * Int(extent.x)) * (threads.height + 2 * Int(extent.y)) * 8
+        let length = usesFullTileMemory ? kernels.tileMemoryLength : min((needed + 15) / 16 * 16, kernels.tileMemoryLength)
+
+        var tileParams = KernelTileParams(apron: apron, reach: reach, capacity: Int32(length / 8))
+        encoder.setComputePipelineState(pipeline)
+        encoder.setBytes(&tileParams, length: MemoryLayout<KernelTileParams>.stride, index: Int(BufferIndexKernelTile.rawValue))
+        encoder.setThreadgroupMemoryLength(length, index: 0)
+
+        let groups = MTLSize(
+            width: (output.width + threads.width - 1) / threads.width,
+            height: (output.height + threads.height - 1) / threads.height,
+            depth: 1
+        )
+        encoder.dispatchThreadgroups(groups, threadsPerThreadgroup: threads)
+    }
+
+    /// Full-image size while tiling, otherwise the given working size
+    private func imageSize(width: Int, height: Int) -> (width: Int, height: Int) {
+        guard tileRegion.imageSize.x > 0 else { return (width, height) }
+        return (Int(tileRegion.imageSize.x), Int(tileRegion.imageSize.y))
+    }
+
+    private func imageSize(of texture: MTLTexture) -> (width: Int, height: Int) {
+        return imageSize(width: texture.width, height: texture.height)
+    }
+
+    /// Binds context.inputs at fragment textures 0..n and params at fragment buffer 0
+    private func encodeFullscreenPass<Params>(pipeline: MTLRenderPipelineState, context: RenderGraphPassContext, params: Params) -> Bool {
+        return encodeFullscreenPass(pipeline: pipeline, context: context) { encoder in
+            var params = params
+            setFragmentParams(encoder, &params, index: 0)
+        }
+    }
+
+    /// Render encoder into output with the pipeline variant matching output's format + shaderIO
+    private func makeRenderEncoder(pipeline: MTLRenderPipelineState, output: MTLTexture, commandBuffer: MTLCommandBuffer) -> MTLRenderCommandEncoder? {
+        guard let resolved = RenderEngine.shared.pipelineFormats.pipeline(pipeline, pixelFormat: output.pixelFormat, mode: shaderIO) else {
+            #if DEBUG
+            print("❌ FilterRenderer: No pipeline variant for format \(output.pixelFormat.rawValue)")
+            #endif
+            return nil
+        }
+
         renderPassDescriptor.colorAttachments[0].texture = output
-        guard let encoder4 = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
-        encoder4.setRenderPipelineState(compositePipeline)
-        encoder4.setFragmentTexture(input, index: 0)
-        encoder4.setFragmentTexture(verticalTex, index: 1)
-        encoder4.setFragmentBytes(&params, length: MemoryLayout<HalationParams>.stride, index: 0)
-        encoder4.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
-        encoder4.endEncoding()
+        frameRecorder?.attach(to: renderPassDescriptor)
+        let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor)
+        // Descriptor dùng lại cho mọi pass → bỏ sample buffer (pass sau / frame không đo không ghi nhầm index)
+        renderPassDescriptor.sampleBufferAttachments[0].sampleBuffer = nil
+        guard let renderEncoder = renderEncoder else { return nil }
+
+        renderEncoder.setRenderPipelineState(resolved)
+        return renderEncoder
+    }
+
+    /// Compute encoder, sampled at its boundaries while a frame is instrumented
+    private func makeComputeEncoder(commandBuffer: MTLCommandBuffer) -> MTLComputeCommandEncoder? {
+        if let descriptor = frameRecorder?.computePassDescriptor() {
+            return commandBuffer.makeComputeCommandEncoder(descriptor: descriptor)
+        }
+        return commandBuffer.makeComputeCommandEncoder()
+    }
+
+    /// Required pass failed (RenderGraph.failedRequiredPass) → không present / output không hợp lệ
+    /// Commit phần đã encode để transients recycle sau khi GPU xong; caller báo thất bại
+    private func discardFrame(failedPass: String, transients: [MTLTexture], commandBuffer: MTLCommandBuffer) {
+        lastDiscardedPass = failedPass
+        print("❌ FilterRenderer: Required pass \(failedPass) failed, frame discarded")
 
+        let texturePool = stream.texturePool
         commandBuffer.addCompletedHandler { [weak texturePool] _ in
-            texturePool?.recycle(thresholdTex)
-            texturePool?.recycle(horizontalTex)
-            texturePool?.recycle(verticalTex)
+            transients.forEach { texturePool?.recycle($0) }
+        }
+        commandBuffer.commit()
+    }
+
+    /// Start encoding commandBuffer: uniform ring region + per-pass timing (khi instrumentation bật)
+    private func beginFrame(label: String, commandBuffer: MTLCommandBuffer) {
+        if usesUniformRing {
+            uniformRing.beginFrame()
         }
+        frameParamBytes = 0
+        frameRecorder = RenderInstrumentation.shared.beginFrame(label: label, commandBuffer: commandBuffer, texturePool: stream.texturePool)
+    }
 
-        return output
+    /// Release the ring region + resolve per-pass timings when commandBuffer completes (gọi ngay trước commit)
+    private func finishFrame(_ commandBuffer: MTLCommandBuffer) {
+        if usesUniformRing {
+            uniformRing.endFrame(commandBuffer)
+        }
+        lastFrameParamBytes = frameParamBytes
+        if let recorder = frameRecorder {
+            recorder.finish(commandBuffer)
+            if collectsFrameRecorders {
+                recorderLock.lock()
+                collectedRecorders.append(recorder)
+                recorderLock.unlock()
+            }
+        }
+        frameRecorder = nil
     }
 
-    private func applyVignette(input: MTLTexture, config: VignetteConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.vignettePipeline,
-              let output = getNextOutputTexture() else { return nil }
+    /// Recorders finished since the last call (collectsFrameRecorders), oldest first
+    /// Tiled capture = 1 recorder mỗi tile (tile sau finish trên completion thread của tile trước)
+    func takeFrameRecorders() -> [FrameRecorder] {
+        recorderLock.lock()
+        defer { recorderLock.unlock() }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        let recorders = collectedRecorders
+        collectedRecorders.removeAll()
+        return recorders
+    }
+
+    /// Params → ring region của frame đang encode; ngoài frame (benchmarks, present) hoặc ring đầy → setBytes
+    private func setFragmentParams<T>(_ encoder: MTLRenderCommandEncoder, _ value: inout T, index: Int) {
+        frameParamBytes += MemoryLayout<T>.stride
+        if usesUniformRing, let allocation = uniformRing.allocate(&value) {
+            encoder.setFragmentBuffer(allocation.buffer, offset: allocation.offset, index: index)
+        } else {
+            encoder.setFragmentBytes(&value, length: MemoryLayout<T>.stride, index: index)
+        }
+    }
+
+    private func setComputeParams<T>(_ encoder: MTLComputeCommandEncoder, _ value: inout T, index: Int) {
+        frameParamBytes += MemoryLayout<T>.stride
+        if usesUniformRing, let allocation = uniformRing.allocate(&value) {
+            encoder.setBuffer(allocation.buffer, offset: allocation.offset, index: index)
+        } else {
+            encoder.setBytes(&value, length: MemoryLayout<T>.stride, index: index)
+        }
+    }
+
+    /// Binds context.inputs at fragment textures 0..n; bind sets fragment buffers
+    private func encodeFullscreenPass(pipeline: MTLRenderPipelineState, context: RenderGraphPassContext, bind: (MTLRenderCommandEncoder) -> Void) -> Bool {
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: context.output, commandBuffer: context.commandBuffer) else { return false }
+
+        for (index, texture) in context.inputs.enumerated() {
+            renderEncoder.setFragmentTexture(texture, index: index)
+        }
+
+        bind(renderEncoder)
+        renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
+        renderEncoder.endEncoding()
+
+        return true
+    }
+
+    private func applyVignette(input: MTLTexture, output: MTLTexture, config: VignetteConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.vignettePipeline else { return nil }
+
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         var params = prepareVignetteParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<VignetteParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
+        bindTileRegion(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1083,25 +1995,20 @@ class FilterRenderer {
         return output
     }
 
-    private func applyInstantFrame(input: MTLTexture, config: InstantFrameConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.instantFramePipeline,
-              let output = getNextOutputTexture() else {
+    private func applyInstantFrame(input: MTLTexture, output: MTLTexture, config: InstantFrameConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.instantFramePipeline else {
             #if DEBUG
-            if RenderEngine.shared.instantFramePipeline == nil {
-                print("❌ FilterRenderer: instantFramePipeline is nil!")
-            }
+            print("❌ FilterRenderer: instantFramePipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         var params = prepareInstantFrameParams(config, inputTexture: input)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<InstantFrameParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1111,25 +2018,25 @@ class FilterRenderer {
 
     // MARK: - Flash Effect (Disposable Camera)
 
-    private func applyFlash(input: MTLTexture, config: FlashConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.flashPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyFlash(input: MTLTexture, output: MTLTexture, config: FlashConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        var params = prepareFlashParams(config)
+
+        // ★ Specialized variant nếu đã compile xong, fallback generic pipeline
+        let variant = RenderEngine.shared.pipelineVariants.pipeline(for: .flash, signature: PipelineFeatureSignature(flash: params), pixelFormat: output.pixelFormat, mode: shaderIO)
+
+        guard let pipeline = variant ?? RenderEngine.shared.flashPipeline else {
             #if DEBUG
-            if RenderEngine.shared.flashPipeline == nil {
-                print("❌ FilterRenderer: flashPipeline is nil!")
-            }
+            print("❌ FilterRenderer: flashPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
-        var params = prepareFlashParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<FlashParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
+        bindTileRegion(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1147,9 +2054,32 @@ class FilterRenderer {
 
     // MARK: - Parameter Preparation
 
+    /// Fields of FilterPreset read by ColorGradingParams (kéo slider vignette không pack lại curves / selective color)
+    private struct ColorGradingConfig: Equatable {
+        let colorAdjustments: ColorAdjustments
+        let splitTone: SplitToneConfig
+        let selectiveColor: [SelectiveColorAdjustment]
+        let rgbCurves: RGBCurves
+        let lutIntensity: Float
+        let usesLUT: Bool
+
+        init(_ preset: FilterPreset) {
+            colorAdjustments = preset.colorAdjustments
+            splitTone = preset.splitTone
+            selectiveColor = preset.selectiveColor
+            rgbCurves = preset.rgbCurves
+            lutIntensity = preset.lutIntensity
+            usesLUT = preset.lutFile != nil
+        }
+    }
+
     private func prepareColorGradingParams(_ preset: FilterPreset) -> ColorGradingParams {
+        return colorGradingParamsCache.params(for: ColorGradingConfig(preset), pack: packColorGradingParams)
+    }
+
+    private func packColorGradingParams(_ config: ColorGradingConfig) -> ColorGradingParams {
         var params = ColorGradingParams()
-        let adj = preset.colorAdjustments
+        let adj = config.colorAdjustments
         params.exposure = adj.exposure
         params.contrast = adj.contrast
         params.highlights = adj.highlights
@@ -1163,7 +2093,7 @@ class FilterRenderer {
         params.fade = adj.fade
         params.clarity = adj.clarity
 
-        let split = preset.splitTone
+        let split = config.splitTone
         params.shadowsHue = split.shadowsHue
         params.shadowsSat = split.shadowsSat
         params.highlightsHue = split.highlightsHue
@@ -1171,23 +2101,42 @@ class FilterRenderer {
         params.splitBalance = split.balance
         params.midtoneProtection = split.midtoneProtection
 
-        params.selectiveColorCount = Int32(min(preset.selectiveColor.count, 8))
-        for (i, selColor) in preset.selectiveColor.prefix(8).enumerated() {
+        params.selectiveColorCount = Int32(min(config.selectiveColor.count, 8))
+        for (i, selColor) in config.selectiveColor.prefix(8).enumerated() {
             let colorData = SelectiveColorData(hue: selColor.hue, range: selColor.range, satAdj: selColor.sat, lumAdj: selColor.lum, hueShift: selColor.hueShift)
             params.setSelectiveColor(at: i, value: colorData)
         }
 
-        params.lutIntensity = preset.lutIntensity
-        params.useLUT = preset.lutFile != nil ? 1 : 0
+        params.lutIntensity = config.lutIntensity
 
-        // ★★★ FIX: Initialize RGB Curves ★★★
-        params.rgbCurves = prepareRGBCurvesParams(preset.rgbCurves)
+        // ★★★ RGB Curves: baked 1D texture (bindCurvesTexture), flag cho từng kênh có control points ★★★
+        var flags: UInt32 = config.usesLUT ? UInt32(COLOR_GRADING_FLAG_LUT) : 0
+        if !config.rgbCurves.red.isEmpty { flags |= UInt32(COLOR_GRADING_FLAG_CURVE_R) }
+        if !config.rgbCurves.green.isEmpty { flags |= UInt32(COLOR_GRADING_FLAG_CURVE_G) }
+        if !config.rgbCurves.blue.isEmpty { flags |= UInt32(COLOR_GRADING_FLAG_CURVE_B) }
+        params.flags = flags
 
         return params
     }
 
+    /// Curves texture at TextureIndexCurves khi params có COLOR_GRADING_FLAG_CURVE_* (không tạo được → bỏ curves)
+    private func bindCurvesTexture(_ encoder: MTLRenderCommandEncoder, params: inout ColorGradingParams, curves: RGBCurves) {
+        guard params.flags & UInt32(COLOR_GRADING_FLAG_CURVES) != 0 else { return }
+
+        if let texture = RenderEngine.shared.colorLUTBaker.curvesTexture(for: prepareRGBCurvesParams(curves)) {
+            encoder.setFragmentTexture(texture, index: Int(TextureIndexCurves.rawValue))
+        } else {
+            params.flags &= ~UInt32(COLOR_GRADING_FLAG_CURVES)
+        }
+    }
+
     // ★★★ NEW: Prepare RGB Curves Params ★★★
+    // Control points cho ColorLUTBaker.curvesTexture (key + Catmull-Rom trên CPU), không bind lên GPU
     private func prepareRGBCurvesParams(_ curves: RGBCurves) -> RGBCurvesParams {
+        return rgbCurvesParamsCache.params(for: curves, pack: packRGBCurvesParams)
+    }
+
+    private func packRGBCurvesParams(_ curves: RGBCurves) -> RGBCurvesParams {
         var params = RGBCurvesParams()
 
         // Check if curves are effectively enabled (have control points)
@@ -1230,12 +2179,16 @@ class FilterRenderer {
     }
 
     private func prepareGrainParams(_ config: GrainConfig) -> GrainParams {
+        return grainParamsCache.params(for: config, pack: packGrainParams)
+    }
+
+    private func packGrainParams(_ config: GrainConfig) -> GrainParams {
         var params = GrainParams()
         params.globalIntensity = config.globalIntensity
         params.size = config.channels.red.size
         params.softness = config.channels.red.softness
         params.enabled = config.enabled ? 1 : 0
-        params.channelIntensity = SIMD3<Float>(config.channels.red.intensity, config.channels.green.intensity, config.channels.blue.intensity)
+        params.channelIntensity = PackedFloat3(x: config.channels.red.intensity, y: config.channels.green.intensity, z: config.channels.blue.intensity)
         if config.clumping.enabled {
             params.size *= (1.0 + config.clumping.clusterSize * 0.3)
             params.globalIntensity *= (1.0 - config.clumping.strength * 0.2)
@@ -1244,17 +2197,25 @@ class FilterRenderer {
     }
 
     private func prepareBloomParams(_ config: BloomConfig) -> BloomParams {
+        return bloomParamsCache.params(for: config, pack: packBloomParams)
+    }
+
+    private func packBloomParams(_ config: BloomConfig) -> BloomParams {
         var params = BloomParams()
         params.intensity = config.intensity
         params.threshold = config.threshold
         params.radius = min(config.radius, 20.0)  // Full quality for capture
         params.softness = config.softness
-        params.colorTint = SIMD3<Float>(config.colorTint.r, config.colorTint.g, config.colorTint.b)
+        params.colorTint = PackedFloat3(x: config.colorTint.r, y: config.colorTint.g, z: config.colorTint.b)
         params.enabled = config.enabled ? 1 : 0
         return params
     }
 
     private func prepareVignetteParams(_ config: VignetteConfig) -> VignetteParams {
+        return vignetteParamsCache.params(for: config, pack: packVignetteParams)
+    }
+
+    private func packVignetteParams(_ config: VignetteConfig) -> VignetteParams {
         var params = VignetteParams()
         params.intensity = config.intensity
         params.roundness = config.roundness
@@ -1265,12 +2226,16 @@ class FilterRenderer {
     }
 
     private func prepareHalationParams(_ config: HalationConfig) -> HalationParams {
+        return halationParamsCache.params(for: config, pack: packHalationParams)
+    }
+
+    private func packHalationParams(_ config: HalationConfig) -> HalationParams {
         var params = HalationParams()
         params.intensity = config.intensity
         params.threshold = config.threshold
         params.radius = min(config.radius, 25.0)  // Full quality for capture
         params.softness = config.softness
-        params.color = SIMD3<Float>(config.color.r, config.color.g, config.color.b)
+        params.color = PackedFloat3(x: config.color.r, y: config.color.g, z: config.color.b)
         params.enabled = config.enabled ? 1 : 0
         return params
     }
@@ -1278,7 +2243,7 @@ class FilterRenderer {
     private func prepareInstantFrameParams(_ config: InstantFrameConfig, inputTexture: MTLTexture) -> InstantFrameParams {
         var params = InstantFrameParams()
         params.borderWidths = SIMD4<Float>(config.borderWidth.top, config.borderWidth.left, config.borderWidth.right, config.borderWidth.bottom)
-        params.borderColor = SIMD3<Float>(config.borderColor.r, config.borderColor.g, config.borderColor.b)
+        params.borderColor = PackedFloat3(x: config.borderColor.r, y: config.borderColor.g, z: config.borderColor.b)
         params.edgeFade = 0.05
         params.cornerDarkening = 0.08
 
@@ -1297,6 +2262,10 @@ class FilterRenderer {
     }
 
     private func prepareFlashParams(_ config: FlashConfig) -> FlashParams {
+        return flashParamsCache.params(for: config, pack: packFlashParams)
+    }
+
+    private func packFlashParams(_ config: FlashConfig) -> FlashParams {
         var params = FlashParams()
         params.enabled = config.enabled ? 1 : 0
         params.intensity = config.intensity
@@ -1311,19 +2280,23 @@ class FilterRenderer {
         params.falloffType = Int32(config.falloffType.rawValue)
         params.distanceScale = config.distanceScale
 
+        // Hot spot, Fresnel rings, specular → FLASH_FEATURE_* bits
+        var features: UInt32 = 0
+        if config.hotSpotEnabled { features |= UInt32(FLASH_FEATURE_HOT_SPOT) }
+        if config.fresnelEnabled { features |= UInt32(FLASH_FEATURE_FRESNEL) }
+        if config.specularEnabled { features |= UInt32(FLASH_FEATURE_SPECULAR) }
+        params.features = features
+
         // Hot spot simulation
-        params.hotSpotEnabled = config.hotSpotEnabled ? 1 : 0
         params.hotSpotSize = config.hotSpotSize
         params.hotSpotIntensity = config.hotSpotIntensity
 
         // Fresnel ring effects
-        params.fresnelEnabled = config.fresnelEnabled ? 1 : 0
         params.fresnelRings = Int32(config.fresnelRings)
         params.fresnelIntensity = config.fresnelIntensity
         params.fresnelSpacing = config.fresnelSpacing
 
         // Specular highlights
-        params.specularEnabled = config.specularEnabled ? 1 : 0
         params.specularThreshold = config.specularThreshold
         params.specularBoost = config.specularBoost
 
@@ -1332,25 +2305,20 @@ class FilterRenderer {
 
     // MARK: - Skin Tone Protection
 
-    private func applySkinToneProtection(input: MTLTexture, config: SkinToneProtection, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.skinToneProtectionPipeline,
-              let output = getNextOutputTexture() else {
+    private func applySkinToneProtection(input: MTLTexture, output: MTLTexture, config: SkinToneProtection, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.skinToneProtectionPipeline else {
             #if DEBUG
-            if RenderEngine.shared.skinToneProtectionPipeline == nil {
-                print("❌ FilterRenderer: skinToneProtectionPipeline is nil!")
-            }
+            print("❌ FilterRenderer: skinToneProtectionPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         var params = prepareSkinToneParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<SkinToneParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1359,6 +2327,10 @@ class FilterRenderer {
     }
 
     private func prepareSkinToneParams(_ config: SkinToneProtection) -> SkinToneParams {
+        return skinToneParamsCache.params(for: config, pack: packSkinToneParams)
+    }
+
+    private func packSkinToneParams(_ config: SkinToneProtection) -> SkinToneParams {
         var params = SkinToneParams()
         params.enabled = config.enabled ? 1 : 0
         params.hueCenter = config.hueCenter
@@ -1370,25 +2342,20 @@ class FilterRenderer {
 
     // MARK: - Tone Mapping
 
-    private func applyToneMapping(input: MTLTexture, config: ToneMapping, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.toneMappingPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyToneMapping(input: MTLTexture, output: MTLTexture, config: ToneMapping, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.toneMappingPipeline else {
             #if DEBUG
-            if RenderEngine.shared.toneMappingPipeline == nil {
-                print("❌ FilterRenderer: toneMappingPipeline is nil!")
-            }
+            print("❌ FilterRenderer: toneMappingPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         var params = prepareToneMappingParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<ToneMappingParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1397,6 +2364,10 @@ class FilterRenderer {
     }
 
     private func prepareToneMappingParams(_ config: ToneMapping) -> ToneMappingParams {
+        return toneMappingParamsCache.params(for: config, pack: packToneMappingParams)
+    }
+
+    private func packToneMappingParams(_ config: ToneMapping) -> ToneMappingParams {
         var params = ToneMappingParams()
         params.enabled = config.enabled ? 1 : 0
         params.whitePoint = config.whitePoint
@@ -1408,25 +2379,43 @@ class FilterRenderer {
 
     // MARK: - Light Leak Effect (Procedural)
 
-    private func applyLightLeak(input: MTLTexture, config: LightLeakConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.lightLeakPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyLightLeak(input: MTLTexture, output: MTLTexture, config: LightLeakConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        var params = prepareLightLeakParams(config)
+
+        // ★★★ NEW: Static leak layer baked per seed → chỉ flicker + blend mỗi frame ★★★
+        let size = imageSize(of: input)
+        if usesProceduralLayers,
+           let compositePipeline = RenderEngine.shared.lightLeakCompositePipeline,
+           let layer = RenderEngine.shared.proceduralLayers.lightLeakLayer(for: params, imageWidth: size.width, imageHeight: size.height, commandBuffer: commandBuffer) {
+            guard let renderEncoder = makeRenderEncoder(pipeline: compositePipeline, output: output, commandBuffer: commandBuffer) else { return nil }
+
+            renderEncoder.setFragmentTexture(input, index: 0)
+            renderEncoder.setFragmentTexture(layer, index: 1)
+            setFragmentParams(renderEncoder, &params, index: 0)
+            bindTileRegion(renderEncoder)
+
+            renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
+            renderEncoder.endEncoding()
+
+            return output
+        }
+
+        // ★ Specialized variant nếu đã compile xong, fallback generic pipeline
+        let variant = RenderEngine.shared.pipelineVariants.pipeline(for: .lightLeak, signature: PipelineFeatureSignature(lightLeak: params), pixelFormat: output.pixelFormat, mode: shaderIO)
+
+        guard let pipeline = variant ?? RenderEngine.shared.lightLeakPipeline else {
             #if DEBUG
-            if RenderEngine.shared.lightLeakPipeline == nil {
-                print("❌ FilterRenderer: lightLeakPipeline is nil!")
-            }
+            print("❌ FilterRenderer: lightLeakPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
-        var params = prepareLightLeakParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<LightLeakParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
+        bindTileRegion(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1455,7 +2444,7 @@ class FilterRenderer {
         params.temporalEnabled = config.temporalEnabled ? 1 : 0
         params.flickerSpeed = config.flickerSpeed
         params.flickerIntensity = config.flickerIntensity
-        params.time = Float(CACurrentMediaTime())
+        params.time = Float(fixedFrameSeed == nil ? CACurrentMediaTime() : 0)
 
         // Multi-layer depth
         params.depthLayers = Int32(config.depthLayers)
@@ -1481,25 +2470,21 @@ class FilterRenderer {
 
     // MARK: - Date Stamp Effect (Procedural 7-Segment Display)
 
-    private func applyDateStamp(input: MTLTexture, config: DateStampConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.dateStampPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyDateStamp(input: MTLTexture, output: MTLTexture, config: DateStampConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.dateStampPipeline else {
             #if DEBUG
-            if RenderEngine.shared.dateStampPipeline == nil {
-                print("❌ FilterRenderer: dateStampPipeline is nil!")
-            }
+            print("❌ FilterRenderer: dateStampPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         var params = prepareDateStampParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<DateStampParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
+        bindTileRegion(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1514,7 +2499,7 @@ class FilterRenderer {
         // Convert date string to digit array for 7-segment display
         // Format: "12 25 '24" → digits: [1,2,-1,2,5,-1,10,2,4]
         // -1 = space, 10 = quote, 11 = slash, 12 = dot
-        let dateString = config.format.format(Date())
+        let dateString = config.format.format(stampDate ?? (fixedFrameSeed == nil ? Date() : Date(timeIntervalSince1970: 0)))
         var digits: [Int32] = []
         for char in dateString {
             switch char {
@@ -1545,7 +2530,7 @@ class FilterRenderer {
 
         // Color
         let rgb = config.color.rgb
-        params.color = SIMD3<Float>(rgb.r, rgb.g, rgb.b)
+        params.color = PackedFloat3(x: rgb.r, y: rgb.g, z: rgb.b)
         params.opacity = config.opacity
         params.scale = config.scale
         params.marginX = config.marginX
@@ -1585,25 +2570,24 @@ class FilterRenderer {
 
     // MARK: - CCD Bloom Effect (Digicam Vertical Smear)
 
-    private func applyCCDBloom(input: MTLTexture, config: CCDBloomConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.ccdBloomPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyCCDBloom(input: MTLTexture, output: MTLTexture, config: CCDBloomConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.ccdBloomPipeline else {
             #if DEBUG
-            if RenderEngine.shared.ccdBloomPipeline == nil {
-                print("❌ FilterRenderer: ccdBloomPipeline is nil!")
-            }
+            print("❌ FilterRenderer: ccdBloomPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        var params = prepareCCDBloomParams(config, textureWidth: input.width, textureHeight: input.height)
 
-        renderEncoder.setRenderPipelineState(pipeline)
-        renderEncoder.setFragmentTexture(input, index: 0)
+        if encodeCCDBloomKernels(input: input, output: output, params: params, commandBuffer: commandBuffer) {
+            return output
+        }
 
-        var params = prepareCCDBloomParams(config, textureWidth: input.width, textureHeight: input.height)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<CCDBloomParams>.stride, index: 0)
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
+
+        renderEncoder.setFragmentTexture(input, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1611,6 +2595,83 @@ class FilterRenderer {
         return output
     }
 
+    /// ★ Compute path: ccdSmearKernel (vertical smear theo cột → rgba16Float transient) + ccdBloomKernel
+    /// - Returns: false → caller dùng fragment (kernel off, output không ghi được, apron quá lớn)
+    private func encodeCCDBloomKernels(input: MTLTexture, output: MTLTexture, params: CCDBloomParams, commandBuffer: MTLCommandBuffer) -> Bool {
+        guard let bloomKernel = computeKernel("ccdBloomKernel", pass: .ccdBloom, input: input, output: output) else { return false }
+
+        // Horizontal bloom ±hSamples × 3 px, fringe CA ±fringeWidth × 5 px (+1 bilinear), edge ±1 px
+        let hSamples = min(max(Int(params.horizontalRadius * 30), 2), 15)
+        let caOffset = Int(ceil(params.fringeWidth * 5)) + 1
+        let apron = SIMD2<Int32>(Int32(max(hSamples * 3, caOffset, 1)), 1)
+        guard tileFits(bloomKernel, apron: apron) else { return false }
+
+        let texturePool = stream.texturePool
+        var smearTexture: MTLTexture?
+        var smearKernel: MTLComputePipelineState?
+        if params.enabled != 0 && params.verticalSmear > 0 {
+            guard let kernel = computeKernel("ccdSmearKernel", pass: .ccdBloom, input: input, output: output),
+                  let texture = texturePool.transientTexture(width: input.width, height: input.height, pixelFormat: .rgba16Float) else {
+                return false
+            }
+            smearKernel = kernel
+            smearTexture = texture
+        }
+
+        guard let encoder = makeComputeEncoder(commandBuffer: commandBuffer) else {
+            if let smear = smearTexture {
+                texturePool.recycle(smear)
+            }
+            return false
+        }
+
+        var params = params
+        if let kernel = smearKernel, let smear = smearTexture {
+            var smearParams = prepareCCDSmearParams(params)
+            encoder.setComputePipelineState(kernel)
+            encoder.setTexture(input, index: 0)
+            encoder.setTexture(smear, index: 1)
+            setComputeParams(encoder, &params, index: 0)
+            setComputeParams(encoder, &smearParams, index: 1)
+
+            // 1 thread / (cột, đoạn ccdSmearSegmentRows rows)
+            let width = kernel.threadExecutionWidth
+            let groups = MTLSize(
+                width: (input.width + width - 1) / width,
+                height: (input.height + Int(smearParams.segmentRows) - 1) / Int(smearParams.segmentRows),
+                depth: 1
+            )
+            encoder.dispatchThreadgroups(groups, threadsPerThreadgroup: MTLSize(width: width, height: 1, depth: 1))
+
+            commandBuffer.addCompletedHandler { [weak texturePool] _ in
+                texturePool?.recycle(smear)
+            }
+        }
+
+        // Serial compute encoder → dispatch sau thấy kết quả smear
+        encoder.setTexture(input, index: 0)
+        encoder.setTexture(smearTexture ?? input, index: 1)
+        encoder.setTexture(output, index: 2)
+        setComputeParams(encoder, &params, index: 0)
+        dispatchTileKernel(encoder, pipeline: bloomKernel, output: output, apron: apron)
+        encoder.endEncoding()
+
+        return true
+    }
+
+    /// Smear window from CCDBloomParams (cùng số taps như ccdBloomFragment)
+    /// Cửa sổ tam giác thay cho pow(1 - dist, smearFalloff): độ dài rút lại để khoảng cách trung bình
+    /// theo trọng số bằng nhau (triangle: n/3, pow falloff f: samples/(f + 2)) → falloff 1 giống hệt
+    private func prepareCCDSmearParams(_ params: CCDBloomParams) -> CCDSmearParams {
+        let samples = min(max(Int(params.smearLength * 40), 4), 30)
+        let length = max(2, Int((3 * Float(samples) / (max(params.smearFalloff, 0) + 2)).rounded()))
+        return CCDSmearParams(
+            length: Int32(length),
+            above: Int32(min(samples / 4, length)),
+            segmentRows: Int32(max(ccdSmearSegmentRows, 3))
+        )
+    }
+
     private func prepareCCDBloomParams(_ config: CCDBloomConfig, textureWidth: Int, textureHeight: Int) -> CCDBloomParams {
         var params = CCDBloomParams()
         params.enabled = config.enabled ? 1 : 0
@@ -1630,25 +2691,44 @@ class FilterRenderer {
 
     // MARK: - Black & White Pipeline
 
-    private func applyBWConvert(input: MTLTexture, config: BWConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.bwPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyBWConvert(input: MTLTexture, output: MTLTexture, config: BWConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        var params = prepareBWParams(config)
+
+        // ★★★ NEW: Baked tone curve + toning → 1 fetch (grain vẫn per-pixel) ★★★
+        if usesBakedColorLUT,
+           let bakedPipeline = RenderEngine.shared.bwBakedPipeline,
+           let tone = RenderEngine.shared.colorLUTBaker.bwTone(for: params) {
+            guard let renderEncoder = makeRenderEncoder(pipeline: bakedPipeline, output: output, commandBuffer: commandBuffer) else { return nil }
+
+            renderEncoder.setFragmentTexture(input, index: 0)
+            renderEncoder.setFragmentTexture(tone, index: 1)
+            setFragmentParams(renderEncoder, &params, index: 0)
+            bindTileRegion(renderEncoder)
+            bindNoiseTextures(renderEncoder)
+
+            renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
+            renderEncoder.endEncoding()
+
+            return output
+        }
+
+        // ★ Specialized variant nếu đã compile xong, fallback generic pipeline
+        let variant = RenderEngine.shared.pipelineVariants.pipeline(for: .bwConvert, signature: PipelineFeatureSignature(bw: params), pixelFormat: output.pixelFormat, mode: shaderIO)
+
+        guard let pipeline = variant ?? RenderEngine.shared.bwPipeline else {
             #if DEBUG
-            if RenderEngine.shared.bwPipeline == nil {
-                print("❌ FilterRenderer: bwPipeline is nil!")
-            }
+            print("❌ FilterRenderer: bwPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
-        var params = prepareBWParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<BWParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
+        bindTileRegion(renderEncoder)
+        bindNoiseTextures(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1680,7 +2760,7 @@ class FilterRenderer {
         case .custom:    params.toningMode = 5
         }
         params.toningIntensity = config.toningIntensity
-        params.customColor = SIMD3<Float>(config.customColor.r, config.customColor.g, config.customColor.b)
+        params.customColor = PackedFloat3(x: config.customColor.r, y: config.customColor.g, z: config.customColor.b)
 
         // Split Tone
         params.shadowHue = config.splitTone.shadowHue
@@ -1692,32 +2772,58 @@ class FilterRenderer {
         // Grain
         params.grainIntensity = config.grainIntensity
         params.grainSize = config.grainSize
-        params.grainSeed = UInt32.random(in: 0..<10000) // Random seed for each frame
+        params.grainSeed = frameSeed(below: 10000) // Random seed for each frame
 
         return params
     }
 
     // MARK: - Overlays (Dust & Scratches)
 
-    private func applyOverlays(input: MTLTexture, config: OverlaysConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.overlaysPipeline,
-              let output = getNextOutputTexture() else {
+    /// Layer only when its seed comes back and it fits at real size:
+    /// - seed: config.seed (!animate) or a reused fixedFrameSeed (editor) — capture seeds are one-shot
+    /// - size: ≤ overlaysMaxDimension, not tiled → không bake bản thu nhỏ (mờ dust / scratch 1px trên 12/48MP)
+    /// Otherwise overlaysFragment computes the masks at full resolution
+    private func reusesOverlaysLayer(_ config: OverlaysConfig, imageWidth: Int, imageHeight: Int) -> Bool {
+        guard !config.animate || (fixedFrameSeed != nil && reusesFrameSeed) else { return false }
+        guard tileRegion.imageSize.x == 0 else { return false }
+        return max(imageWidth, imageHeight) <= RenderEngine.shared.proceduralLayers.overlaysMaxDimension
+    }
+
+    private func applyOverlays(input: MTLTexture, output: MTLTexture, config: OverlaysConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        let size = imageSize(of: input)
+        var params = prepareOverlaysParams(config, textureWidth: size.width, textureHeight: size.height)
+
+        // ★★★ NEW: Dust & scratch masks baked per seed (animate + live seed → seed mới mỗi frame, không cache) ★★★
+        if usesProceduralLayers, reusesOverlaysLayer(config, imageWidth: size.width, imageHeight: size.height),
+           let compositePipeline = RenderEngine.shared.overlaysCompositePipeline,
+           let layer = RenderEngine.shared.proceduralLayers.overlaysLayer(for: params, imageWidth: size.width, imageHeight: size.height, whiteNoise: RenderEngine.shared.noiseTextures.white, commandBuffer: commandBuffer) {
+            guard let renderEncoder = makeRenderEncoder(pipeline: compositePipeline, output: output, commandBuffer: commandBuffer) else { return nil }
+
+            renderEncoder.setFragmentTexture(input, index: 0)
+            renderEncoder.setFragmentTexture(layer, index: 1)
+            setFragmentParams(renderEncoder, &params, index: 0)
+            bindTileRegion(renderEncoder)
+
+            renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
+            renderEncoder.endEncoding()
+
+            return output
+        }
+
+        guard let pipeline = RenderEngine.shared.overlaysPipeline else {
             #if DEBUG
-            if RenderEngine.shared.overlaysPipeline == nil {
-                print("❌ FilterRenderer: overlaysPipeline is nil!")
-            }
+            print("❌ FilterRenderer: overlaysPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
-        var params = prepareOverlaysParams(config, textureWidth: input.width, textureHeight: input.height)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<OverlaysParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
+        bindTileRegion(renderEncoder)
+        bindWhiteNoiseTexture(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1749,7 +2855,7 @@ class FilterRenderer {
         params.scratchBlendMode = Int32(config.scratches.blendMode.rawValue)
 
         // Global
-        params.seed = config.animate ? UInt32.random(in: 0..<100000) : config.seed
+        params.seed = config.animate ? frameSeed(below: 100000) : config.seed
         params.aspectRatio = Float(textureWidth) / Float(textureHeight)
 
         return params
@@ -1757,25 +2863,44 @@ class FilterRenderer {
 
     // MARK: - ★★★ VHS Effects ★★★
 
-    private func applyVHSEffects(input: MTLTexture, config: VHSEffectsConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.vhsEffectsPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyVHSEffects(input: MTLTexture, output: MTLTexture, config: VHSEffectsConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.vhsEffectsPipeline else {
             #if DEBUG
-            if RenderEngine.shared.vhsEffectsPipeline == nil {
-                print("❌ FilterRenderer: vhsEffectsPipeline is nil!")
-            }
+            print("❌ FilterRenderer: vhsEffectsPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        var params = prepareVHSEffectsParams(config)
 
-        renderEncoder.setRenderPipelineState(pipeline)
-        renderEncoder.setFragmentTexture(input, index: 0)
+        // ★ Compute: apron = bleed ngang + blur, reach = vertical bleed (load khi còn chỗ)
+        if let kernel = computeKernel("vhsEffectsKernel", pass: .vhs, input: input, output: output),
+           let encoder = makeComputeEncoder(commandBuffer: commandBuffer) {
+            let bleedEnabled = params.features & UInt32(VHS_FEATURE_COLOR_BLEED) != 0 && params.colorBleedIntensity > 0
+            let bleed = bleedEnabled ? max(abs(params.colorBleedRedShift), abs(params.colorBleedBlueShift)) * params.colorBleedIntensity * 10 : 0
+            let blur = params.sharpnessLoss * 2
+            let verticalBleed = bleedEnabled ? Int(ceil(abs(params.colorBleedVertical) * params.colorBleedIntensity * 0.01 * Float(input.height))) : 0
+
+            encoder.setTexture(input, index: 0)
+            encoder.setTexture(output, index: 1)
+            encoder.setTexture(RenderEngine.shared.noiseTextures.blueNoise, index: Int(TextureIndexBlueNoise.rawValue))
+            setComputeParams(encoder, &params, index: 0)
+            dispatchTileKernel(
+                encoder,
+                pipeline: kernel,
+                output: output,
+                apron: SIMD2<Int32>(Int32(ceil(bleed + blur)) + 2, Int32(ceil(blur)) + 2),
+                reach: SIMD2<Int32>(0, Int32(verticalBleed))
+            )
+            encoder.endEncoding()
+            return output
+        }
+
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        var params = prepareVHSEffectsParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<VHSEffectsParams>.stride, index: 0)
+        renderEncoder.setFragmentTexture(input, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
+        bindNoiseTextures(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1787,22 +2912,25 @@ class FilterRenderer {
         var params = VHSEffectsParams()
         params.enabled = config.enabled ? 1 : 0
 
+        var features: UInt32 = 0
+        if config.scanlines.enabled { features |= UInt32(VHS_FEATURE_SCANLINES) }
+        if config.colorBleed.enabled { features |= UInt32(VHS_FEATURE_COLOR_BLEED) }
+        if config.tracking.enabled { features |= UInt32(VHS_FEATURE_TRACKING) }
+        params.features = features
+
         // Scanlines
-        params.scanlinesEnabled = config.scanlines.enabled ? 1 : 0
         params.scanlinesIntensity = config.scanlines.intensity
         params.scanlinesDensity = config.scanlines.density
         params.scanlinesFlickerSpeed = config.scanlines.flickerSpeed
         params.scanlinesFlickerIntensity = config.scanlines.flickerIntensity
 
         // Color Bleed
-        params.colorBleedEnabled = config.colorBleed.enabled ? 1 : 0
         params.colorBleedIntensity = config.colorBleed.intensity
         params.colorBleedRedShift = config.colorBleed.redShift
         params.colorBleedBlueShift = config.colorBleed.blueShift
         params.colorBleedVertical = config.colorBleed.verticalBleed
 
         // Tracking
-        params.trackingEnabled = config.tracking.enabled ? 1 : 0
         params.trackingIntensity = config.tracking.intensity
         params.trackingSpeed = config.tracking.speed
         params.trackingNoise = config.tracking.noise
@@ -1814,32 +2942,40 @@ class FilterRenderer {
         params.sharpnessLoss = config.sharpnessLoss
 
         // Animation time (current time for flicker/tracking animation)
-        params.time = Float(CFAbsoluteTimeGetCurrent().truncatingRemainder(dividingBy: 100.0))
+        params.time = Float(fixedFrameSeed == nil ? CFAbsoluteTimeGetCurrent().truncatingRemainder(dividingBy: 100.0) : 0)
 
         return params
     }
 
     // MARK: - ★★★ Digicam Effects ★★★
 
-    private func applyDigicamEffects(input: MTLTexture, config: DigicamEffectsConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.digicamEffectsPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyDigicamEffects(input: MTLTexture, output: MTLTexture, config: DigicamEffectsConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.digicamEffectsPipeline else {
             #if DEBUG
-            if RenderEngine.shared.digicamEffectsPipeline == nil {
-                print("❌ FilterRenderer: digicamEffectsPipeline is nil!")
-            }
+            print("❌ FilterRenderer: digicamEffectsPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        var params = prepareDigicamEffectsParams(config)
 
-        renderEncoder.setRenderPipelineState(pipeline)
-        renderEncoder.setFragmentTexture(input, index: 0)
+        // ★ Compute: unsharp mask ±1.5 px → apron 3
+        if let kernel = computeKernel("digicamEffectsKernel", pass: .digicam, input: input, output: output),
+           let encoder = makeComputeEncoder(commandBuffer: commandBuffer) {
+            encoder.setTexture(input, index: 0)
+            encoder.setTexture(output, index: 1)
+            encoder.setTexture(RenderEngine.shared.noiseTextures.blueNoise, index: Int(TextureIndexBlueNoise.rawValue))
+            setComputeParams(encoder, &params, index: 0)
+            dispatchTileKernel(encoder, pipeline: kernel, output: output, apron: SIMD2<Int32>(3, 3))
+            encoder.endEncoding()
+            return output
+        }
 
-        var params = prepareDigicamEffectsParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<DigicamEffectsParams>.stride, index: 0)
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
+
+        renderEncoder.setFragmentTexture(input, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
+        bindNoiseTextures(renderEncoder)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1868,32 +3004,27 @@ class FilterRenderer {
         params.sharpening = config.sharpening
 
         // Random seed
-        params.seed = UInt32.random(in: 0..<10000)
+        params.seed = frameSeed(below: 10000)
 
         return params
     }
 
     // MARK: - ★★★ Film Strip Effects ★★★
 
-    private func applyFilmStripEffects(input: MTLTexture, config: FilmStripEffectsConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
-        guard let pipeline = RenderEngine.shared.filmStripPipeline,
-              let output = getNextOutputTexture() else {
+    private func applyFilmStripEffects(input: MTLTexture, output: MTLTexture, config: FilmStripEffectsConfig, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = RenderEngine.shared.filmStripPipeline else {
             #if DEBUG
-            if RenderEngine.shared.filmStripPipeline == nil {
-                print("❌ FilterRenderer: filmStripPipeline is nil!")
-            }
+            print("❌ FilterRenderer: filmStripPipeline is nil!")
             #endif
             return nil
         }
 
-        renderPassDescriptor.colorAttachments[0].texture = output
-        guard let renderEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: renderPassDescriptor) else { return nil }
+        guard let renderEncoder = makeRenderEncoder(pipeline: pipeline, output: output, commandBuffer: commandBuffer) else { return nil }
 
-        renderEncoder.setRenderPipelineState(pipeline)
         renderEncoder.setFragmentTexture(input, index: 0)
 
         var params = prepareFilmStripParams(config)
-        renderEncoder.setFragmentBytes(&params, length: MemoryLayout<FilmStripParams>.stride, index: 0)
+        setFragmentParams(renderEncoder, &params, index: 0)
 
         renderEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         renderEncoder.endEncoding()
@@ -1914,7 +3045,7 @@ class FilterRenderer {
         }
 
         // Border
-        params.borderColor = SIMD3<Float>(config.borderColor.r, config.borderColor.g, config.borderColor.b)
+        params.borderColor = PackedFloat3(x: config.borderColor.r, y: config.borderColor.g, z: config.borderColor.b)
         params.borderOpacity = config.borderOpacity
 
         // Frame lines
@@ -1945,3 +3076,21 @@ extension ColorGradingParams {
         }
     }
 }
+
+// MARK: - ★★★ Fused Preview Stages ★★★
+
+/// Stage bits cho fusedPreviewFragment - phải khớp với FUSED_STAGE_* trong ShaderTypes.h
+struct FusedPreviewStages: OptionSet {
+    let rawValue: Int32
+
+    static let colorGrading = FusedPreviewStages(rawValue: 1 << 0)
+    static let skinTone     = FusedPreviewStages(rawValue: 1 << 1)
+    static let toneMapping  = FusedPreviewStages(rawValue: 1 << 2)
+    static let bw           = FusedPreviewStages(rawValue: 1 << 3)
+    static let flash        = FusedPreviewStages(rawValue: 1 << 4)
+    static let vignette     = FusedPreviewStages(rawValue: 1 << 5)
+    static let grain        = FusedPreviewStages(rawValue: 1 << 6)
+    static let yuvInput     = FusedPreviewStages(rawValue: 1 << 7)   // inputs = [Y, CbCr]
+    static let bakedGrading = FusedPreviewStages(rawValue: 1 << 8)   // set lúc encode: texture(3) = ColorLUTBaker LUT
+    static let bakedBW      = FusedPreviewStages(rawValue: 1 << 9)   // set lúc encode: texture(4) = B&W tone
+}
@@ -0,0 +1,213 @@
+// IntermediateFormat.swift
+// Film Camera - Render graph intermediate encoding + per-format pipeline variants
+// ★★★ NEW: Linear half-float intermediates (sRGB round trip only at the pipeline boundaries) ★★★
+
+import Foundation
+import Metal
+
+/// Pixel format + encoding of the render graph's transient textures
+///
+/// - bgra8Unorm: sRGB-encoded 8-bit như cũ → mỗi pass linear decode + encode lại, re-quantize 8 bit
+/// - rgba16Float: giá trị LINEAR, 8 B/px → không banding ở fade/curves, gấp đôi bandwidth
+/// - rg11b10Float: giá trị LINEAR, 4 B/px, không có alpha (alpha luôn = 1 trong chain) → bandwidth như bgra8
+enum IntermediateFormat: String, CaseIterable {
+    case bgra8Unorm
+    case rgba16Float
+    case rg11b10Float
+
+    var pixelFormat: MTLPixelFormat {
+        switch self {
+        case .bgra8Unorm: return .bgra8Unorm
+        case .rgba16Float: return .rgba16Float
+        case .rg11b10Float: return .rg11b10Float
+        }
+    }
+
+    /// Intermediates hold linear values (shader I/O variant FunctionConstantLinearIntermediates)
+    var isLinear: Bool {
+        return self != .bgra8Unorm
+    }
+
+    var bytesPerPixel: Int {
+        return self == .rgba16Float ? 8 : 4
+    }
+}
+
+/// Shader I/O specialization (FunctionConstantLinearIntermediates / FunctionConstantHalfPrecision)
+struct ShaderIOMode: Hashable {
+    var linearIntermediates: Bool = false
+    var halfPrecision: Bool = false
+
+    /// Không set constant nào → generic pipeline (bgra8 sRGB, float math)
+    static let legacy = ShaderIOMode()
+
+    var isLegacy: Bool {
+        return self == .legacy
+    }
+
+    /// Adds the I/O constants to values (no-op for legacy → pipeline giống hệt generic)
+    func apply(to values: MTLFunctionConstantValues) {
+        guard !isLegacy else { return }
+
+        var linear = linearIntermediates
+        var half = halfPrecision
+        values.setConstantValue(&linear, type: .bool, index: Int(FunctionConstantLinearIntermediates.rawValue))
+        values.setConstantValue(&half, type: .bool, index: Int(FunctionConstantHalfPrecision.rawValue))
+    }
+}
+
+/// Variants of RenderEngine's generic pipelines per (color attachment format, shader I/O mode)
+///
+/// - RenderEngine registers each generic pipeline with its descriptor + fragment name
+/// - pipeline(_:pixelFormat:mode:) returns the base when it already matches, otherwise a variant
+///   (compiled synchronously on first use; prewarm(mode:pixelFormat:) compiles them ahead of time)
+/// - Pipelines not registered here (vd. PipelineVariantCache variants) are returned unchanged
+final class PipelineFormatCache {
+
+    private struct Source {
+        let descriptor: MTLRenderPipelineDescriptor
+        let fragmentName: String
+        let rendersToTarget: Bool
+    }
+
+    private struct Key: Hashable {
+        let base: ObjectIdentifier
+        let pixelFormat: MTLPixelFormat
+        let mode: ShaderIOMode
+    }
+
+    private let device: MTLDevice
+    private let library: MTLLibrary
+    private let archive: PipelineArchive
+
+    private var sources: [ObjectIdentifier: Source] = [:]
+    private var variants: [Key: MTLRenderPipelineState] = [:]
+    private var failed: Set<Key> = []
+    private let lock = NSLock()
+
+    private let compileQueue = DispatchQueue(label: "com.filmcamera.pipelineFormats", qos: .utility)
+
+    init(device: MTLDevice, library: MTLLibrary, archive: PipelineArchive) {
+        self.device = device
+        self.library = library
+        self.archive = archive
+    }
+
+    /// Remember how a generic pipeline was built so variants can be derived from it
+    /// rendersToTarget: pipeline luôn ghi vào target bgra8Unorm (vd. EncodeSRGB) → prewarm giữ format
+    func register(_ pipeline: MTLRenderPipelineState, descriptor: MTLRenderPipelineDescriptor, fragmentName: String, rendersToTarget: Bool = false) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        sources[ObjectIdentifier(pipeline)] = Source(descriptor: descriptor, fragmentName: fragmentName, rendersToTarget: rendersToTarget)
+    }
+
+    /// Variant of base rendering into pixelFormat with the given shader I/O (nil = variant failed to compile)
+    func pipeline(_ base: MTLRenderPipelineState, pixelFormat: MTLPixelFormat, mode: ShaderIOMode) -> MTLRenderPipelineState? {
+        let id = ObjectIdentifier(base)
+
+        lock.lock()
+        guard let source = sources[id] else {
+            lock.unlock()
+            return base
+        }
+        let baseFormat = source.descriptor.colorAttachments[0].pixelFormat
+        if baseFormat == pixelFormat && mode.isLegacy {
+            lock.unlock()
+            return base
+        }
+        let key = Key(base: id, pixelFormat: pixelFormat, mode: mode)
+        if let variant = variants[key] {
+            lock.unlock()
+            return variant
+        }
+        if failed.contains(key) {
+            lock.unlock()
+            return nil
+        }
+        lock.unlock()
+
+        return compile(source, key: key)
+    }
+
+    /// Compile variants for every registered pipeline on a background queue
+    /// Pipelines rendering bgra8Unorm → pixelFormat; fixed-format (blur pyramid) + target pipelines keep theirs
+    func prewarm(mode: ShaderIOMode, pixelFormat: MTLPixelFormat, completion: ((_ compiled: Int, _ elapsed: CFAbsoluteTime) -> Void)? = nil) {
+        compileQueue.async { [weak self] in
+            guard let self = self else { return }
+            let startTime = CFAbsoluteTimeGetCurrent()
+
+            self.lock.lock()
+            let pending = self.sources.compactMap { id, source -> (Source, Key)? in
+                let baseFormat = source.descriptor.colorAttachments[0].pixelFormat
+                let format = baseFormat == .bgra8Unorm && !source.rendersToTarget ? pixelFormat : baseFormat
+                let key = Key(base: id, pixelFormat: format, mode: mode)
+                if format == baseFormat && mode.isLegacy { return nil }
+                if self.variants[key] != nil || self.failed.contains(key) { return nil }
+                return (source, key)
+            }
+            self.lock.unlock()
+
+            let compiled = pending.filter { self.compile($0.0, key: $0.1) != nil }.count
+            completion?(compiled, CFAbsoluteTimeGetCurrent() - startTime)
+        }
+    }
+
+    /// Drop all compiled variants (registered bases stay)
+    func purge() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        variants.removeAll()
+        failed.removeAll()
+    }
+
+    /// Get cache statistics for debugging
+    func statistics() -> (registered: Int, variants: Int, failed: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return (sources.count, variants.count, failed.count)
+    }
+
+    // MARK: - Private
+
+    private func compile(_ source: Source, key: Key) -> MTLRenderPipelineState? {
+        let startTime = CFAbsoluteTimeGetCurrent()
+
+        let values = MTLFunctionConstantValues()
+        key.mode.apply(to: values)
+
+        var pipeline: MTLRenderPipelineState?
+        do {
+            let descriptor = source.descriptor.copy() as! MTLRenderPipelineDescriptor
+            descriptor.fragmentFunction = try library.makeFunction(name: source.fragmentName, constantValues: values)
+            descriptor.colorAttachments[0].pixelFormat = key.pixelFormat
+            pipeline = try archive.makeRenderPipeline(descriptor: descriptor)
+        } catch {
+            print("❌ PipelineFormatCache: Failed to build \(source.fragmentName) variant: \(error.localizedDescription)")
+        }
+
+        lock.lock()
+        if let pipeline = pipeline {
+            // Another thread may have compiled it meanwhile → giữ bản đầu tiên
+            if let existing = variants[key] {
+                lock.unlock()
+                return existing
+            }
+            variants[key] = pipeline
+        } else {
+            failed.insert(key)
+        }
+        lock.unlock()
+
+        #if DEBUG
+        if pipeline != nil {
+            let elapsed = (CFAbsoluteTimeGetCurrent() - startTime) * 1000
+            print("✅ PipelineFormatCache: \(source.fragmentName) → \(key.pixelFormat.rawValue) linear=\(key.mode.linearIntermediates) half=\(key.mode.halfPrecision) in \(String(format: "%.1f", elapsed))ms")
+        }
+        #endif
+
+        return pipeline
+    }
+}
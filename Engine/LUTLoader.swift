@@ -1,18 +1,49 @@
 // LUTLoader.swift
 // Film Camera - .cube LUT File Loader
 // ★ FIX: Better path handling + Debug logging
+// ★★★ NEW: Binary .flut cache (memory-mapped rgba16Float payload) ★★★
 
 import Foundation
 import Metal
 
+/// Where a LUT texture came from (for preload timing reports)
+enum LUTLoadSource {
+    case binaryBundle   // Pre-baked .flut shipped in the bundle (build time)
+    case binaryCache    // .flut generated on an earlier launch (Caches/LUTCache)
+    case cubeParse      // .cube text parse (first launch / import path)
+}
+
 /// Loads .cube LUT files and creates 3D Metal textures
+///
+/// Binary .flut layout (little-endian):
+///   BinaryHeader (32 bytes) → size³ × RGBA16Float (8 bytes/texel), ready for MTLTexture.replace
+/// .cube chỉ còn là đường fallback/import: parse 1 lần rồi ghi .flut vào Caches
 class LUTLoader {
-    
-    /// Load a .cube file and create a 3D texture
+
+    /// Load a LUT by name, preferring the binary cache
     static func load(filename: String, device: MTLDevice) -> MTLTexture? {
+        return loadWithSource(filename: filename, device: device)?.texture
+    }
+
+    /// Load a LUT and report which path produced it
+    static func loadWithSource(filename: String, device: MTLDevice) -> (texture: MTLTexture, source: LUTLoadSource)? {
         // ★ FIX: Handle "luts/xxx.cube" path format
         let cleanFilename = extractFilename(from: filename)
-        
+        let cubeURL = findLUTFile(named: cleanFilename)
+
+        // ★ Fast path 1: pre-baked .flut in bundle (không cần .cube)
+        if let bundleURL = findBinaryLUTFile(named: cleanFilename),
+           let texture = loadBinary(url: bundleURL, validatingAgainst: nil, device: device) {
+            return (texture, .binaryBundle)
+        }
+
+        // ★ Fast path 2: .flut generated on a previous launch (invalidated if the .cube changed)
+        if let cubeURL = cubeURL,
+           let cacheURL = binaryCacheURL(for: cleanFilename),
+           let texture = loadBinary(url: cacheURL, validatingAgainst: cubeURL, device: device) {
+            return (texture, .binaryCache)
+        }
+
         // ★ DEBUG: List all .cube files in bundle
         print("🔍 Looking for LUT: \(filename) (cleaned: \(cleanFilename))")
         
@@ -20,16 +51,30 @@ class LUTLoader {
         listBundleCubeFiles()
         #endif
         
-        // Try multiple locations
-        let url = findLUTFile(named: cleanFilename)
-        
-        guard let fileURL = url else {
+        guard let fileURL = cubeURL else {
             print("❌ LUT file NOT FOUND: \(filename) (cleaned: \(cleanFilename))")
             return nil
         }
         
         print("✅ LUT file FOUND: \(fileURL.lastPathComponent)")
-        return load(url: fileURL, device: device)
+
+        guard let content = try? String(contentsOf: fileURL, encoding: .utf8),
+              let parsed = parse(content: content) else {
+            print("❌ Could not read LUT file: \(fileURL)")
+            return nil
+        }
+
+        let payload = makeRGBA16Payload(data: parsed.data, size: parsed.size)
+        guard let texture = createTexture(payload: payload, size: parsed.size, device: device) else {
+            return nil
+        }
+
+        // Bake for next launch
+        if let cacheURL = binaryCacheURL(for: cleanFilename) {
+            writeBinary(payload: payload, size: parsed.size, to: cacheURL, source: fileURL)
+        }
+
+        return (texture, .cubeParse)
     }
     
     /// Debug: List all .cube files in bundle
@@ -95,18 +140,19 @@ class LUTLoader {
         return nil
     }
     
-    /// Load a .cube file from URL
+    /// Load a .cube file from URL (import path, no binary cache)
     static func load(url: URL, device: MTLDevice) -> MTLTexture? {
         guard let content = try? String(contentsOf: url, encoding: .utf8) else {
             print("❌ Could not read LUT file: \(url)")
             return nil
         }
         
-        return parse(content: content, device: device)
+        guard let parsed = parse(content: content) else { return nil }
+        return createTexture(payload: makeRGBA16Payload(data: parsed.data, size: parsed.size), size: parsed.size, device: device)
     }
     
-    /// Parse .cube file content
-    private static func parse(content: String, device: MTLDevice) -> MTLTexture? {
+    /// Parse .cube file content into RGB floats
+    private static func parse(content: String) -> (data: [Float], size: Int)? {
         var size: Int = 0
         var data: [Float] = []
         
@@ -148,15 +194,38 @@ class LUTLoader {
             return nil
         }
         
-        return createTexture(data: data, size: size, device: device)
+        return (data, size)
+    }
+
+    /// Convert RGB Float32 to RGBA Float16
+    private static func makeRGBA16Payload(data: [Float], size: Int) -> [UInt16] {
+        let totalPixels = size * size * size
+        var rgba16Data = [UInt16](repeating: 0, count: totalPixels * 4)
+
+        for i in 0..<totalPixels {
+            let srcIdx = i * 3
+            let dstIdx = i * 4
+            rgba16Data[dstIdx + 0] = floatToHalf(data[srcIdx + 0])  // R
+            rgba16Data[dstIdx + 1] = floatToHalf(data[srcIdx + 1])  // G
+            rgba16Data[dstIdx + 2] = floatToHalf(data[srcIdx + 2])  // B
+            rgba16Data[dstIdx + 3] = floatToHalf(1.0)               // A
+        }
+
+        return rgba16Data
+    }
+
+    private static func createTexture(payload: [UInt16], size: Int, device: MTLDevice) -> MTLTexture? {
+        return payload.withUnsafeBytes { ptr in
+            createTexture(bytes: ptr.baseAddress!, size: size, device: device)
+        }
     }
     
-    /// Create 3D texture from LUT data
+    /// Create 3D texture from RGBA16Float texels
     /// ★ OPTIMIZED: Use rgba16Float instead of rgba32Float
     /// - rgba32Float: 16 bytes/pixel → 575 KB for 33³ LUT
     /// - rgba16Float: 8 bytes/pixel → 288 KB for 33³ LUT (50% reduction)
     /// Visual quality is identical for color grading purposes
-    private static func createTexture(data: [Float], size: Int, device: MTLDevice) -> MTLTexture? {
+    private static func createTexture(bytes: UnsafeRawPointer, size: Int, device: MTLDevice) -> MTLTexture? {
         let descriptor = MTLTextureDescriptor()
         descriptor.textureType = .type3D
         descriptor.pixelFormat = .rgba16Float  // ★ CHANGED from .rgba32Float
@@ -170,19 +239,6 @@ class LUTLoader {
             return nil
         }
 
-        // Convert RGB Float32 to RGBA Float16
-        let totalPixels = size * size * size
-        var rgba16Data = [UInt16](repeating: 0, count: totalPixels * 4)
-
-        for i in 0..<totalPixels {
-            let srcIdx = i * 3
-            let dstIdx = i * 4
-            rgba16Data[dstIdx + 0] = floatToHalf(data[srcIdx + 0])  // R
-            rgba16Data[dstIdx + 1] = floatToHalf(data[srcIdx + 1])  // G
-            rgba16Data[dstIdx + 2] = floatToHalf(data[srcIdx + 2])  // B
-            rgba16Data[dstIdx + 3] = floatToHalf(1.0)               // A
-        }
-
         let region = MTLRegion(
             origin: MTLOrigin(x: 0, y: 0, z: 0),
             size: MTLSize(width: size, height: size, depth: size)
@@ -191,21 +247,138 @@ class LUTLoader {
         let bytesPerRow = size * 4 * MemoryLayout<UInt16>.size  // 8 bytes per pixel
         let bytesPerImage = bytesPerRow * size
 
-        rgba16Data.withUnsafeBytes { ptr in
-            texture.replace(
-                region: region,
-                mipmapLevel: 0,
-                slice: 0,
-                withBytes: ptr.baseAddress!,
-                bytesPerRow: bytesPerRow,
-                bytesPerImage: bytesPerImage
-            )
-        }
+        texture.replace(
+            region: region,
+            mipmapLevel: 0,
+            slice: 0,
+            withBytes: bytes,
+            bytesPerRow: bytesPerRow,
+            bytesPerImage: bytesPerImage
+        )
 
         print("✅ LUT texture created: \(size)x\(size)x\(size) (rgba16Float)")
         return texture
     }
 
+    // MARK: - ★★★ Binary LUT Cache (.flut) ★★★
+
+    private struct BinaryHeader {
+        var magic: UInt32           // "FLUT"
+        var version: UInt32
+        var size: UInt32            // Cube edge length
+        var pixelFormat: UInt32     // MTLPixelFormat.rawValue (rgba16Float)
+        var sourceSize: UInt64      // .cube file size (0 = pre-baked, not validated)
+        var sourceModified: Double  // .cube modification date (timeIntervalSince1970)
+    }
+
+    private static let binaryMagic: UInt32 = 0x54554C46  // "FLUT" little-endian
+    private static let binaryVersion: UInt32 = 1
+    private static let binaryExtension = "flut"
+
+    /// Thư mục Caches/LUTCache (tạo nếu chưa có)
+    private static let binaryCacheDirectory: URL? = {
+        guard let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first else {
+            return nil
+        }
+        let directory = caches.appendingPathComponent("LUTCache", isDirectory: true)
+        try? FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        return directory
+    }()
+
+    private static func binaryCacheURL(for filename: String) -> URL? {
+        let baseName = (filename as NSString).deletingPathExtension
+        return binaryCacheDirectory?.appendingPathComponent(baseName).appendingPathExtension(binaryExtension)
+    }
+
+    /// Pre-baked .flut added to the bundle by a build step (optional)
+    private static func findBinaryLUTFile(named filename: String) -> URL? {
+        let baseName = (filename as NSString).deletingPathExtension
+        return Bundle.main.url(forResource: baseName, withExtension: binaryExtension)
+            ?? Bundle.main.url(forResource: "LUTs/\(baseName)", withExtension: binaryExtension)
+    }
+
+    /// Source fingerprint: .cube size + modification date (app update → regenerate)
+    private static func sourceFingerprint(of url: URL) -> (size: UInt64, modified: Double)? {
+        guard let attributes = try? FileManager.default.attributesOfItem(atPath: url.path),
+              let size = attributes[.size] as? NSNumber,
+              let modified = attributes[.modificationDate] as? Date else {
+            return nil
+        }
+        return (size.uint64Value, modified.timeIntervalSince1970)
+    }
+
+    /// Memory-map a .flut and upload it straight into a 3D texture (không copy, không parse)
+    private static func loadBinary(url: URL, validatingAgainst source: URL?, device: MTLDevice) -> MTLTexture? {
+        guard let data = try? Data(contentsOf: url, options: .alwaysMapped) else { return nil }
+
+        let headerSize = MemoryLayout<BinaryHeader>.size
+        guard data.count >= headerSize else { return nil }
+
+        return data.withUnsafeBytes { (raw: UnsafeRawBufferPointer) -> MTLTexture? in
+            let header = raw.loadUnaligned(as: BinaryHeader.self)
+
+            guard header.magic == binaryMagic,
+                  header.version == binaryVersion,
+                  header.pixelFormat == UInt32(MTLPixelFormat.rgba16Float.rawValue) else {
+                print("⚠️ LUTLoader: Ignoring incompatible binary LUT \(url.lastPathComponent)")
+                return nil
+            }
+
+            if let source = source {
+                guard let fingerprint = sourceFingerprint(of: source),
+                      fingerprint.size == header.sourceSize,
+                      fingerprint.modified == header.sourceModified else {
+                    #if DEBUG
+                    print("🔄 LUTLoader: Binary LUT stale, re-parsing \(source.lastPathComponent)")
+                    #endif
+                    return nil
+                }
+            }
+
+            let size = Int(header.size)
+            let payloadSize = size * size * size * 4 * MemoryLayout<UInt16>.size
+            guard size > 0, data.count >= headerSize + payloadSize else {
+                print("⚠️ LUTLoader: Truncated binary LUT \(url.lastPathComponent)")
+                return nil
+            }
+
+            return createTexture(bytes: raw.baseAddress! + headerSize, size: size, device: device)
+        }
+    }
+
+    /// Write header + payload atomically so a crash never leaves a half-written cache
+    private static func writeBinary(payload: [UInt16], size: Int, to url: URL, source: URL) {
+        guard let fingerprint = sourceFingerprint(of: source) else { return }
+
+        var header = BinaryHeader(
+            magic: binaryMagic,
+            version: binaryVersion,
+            size: UInt32(size),
+            pixelFormat: UInt32(MTLPixelFormat.rgba16Float.rawValue),
+            sourceSize: fingerprint.size,
+            sourceModified: fingerprint.modified
+        )
+
+        var data = Data(bytes: &header, count: MemoryLayout<BinaryHeader>.size)
+        payload.withUnsafeBytes { data.append(contentsOf: $0) }
+
+        do {
+            try data.write(to: url, options: .atomic)
+            #if DEBUG
+            print("💾 LUTLoader: Baked \(url.lastPathComponent) (\(data.count / 1024) KB)")
+            #endif
+        } catch {
+            print("⚠️ LUTLoader: Failed to write binary LUT: \(error.localizedDescription)")
+        }
+    }
+
+    /// Remove all generated .flut files
+    static func clearBinaryCache() {
+        guard let directory = binaryCacheDirectory else { return }
+        try? FileManager.default.removeItem(at: directory)
+        try? FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+    }
+
     /// Convert Float32 to Float16 (IEEE 754 half-precision)
     private static func floatToHalf(_ value: Float) -> UInt16 {
         let bits = value.bitPattern
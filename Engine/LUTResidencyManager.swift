@@ -0,0 +1,250 @@
+// LUTResidencyManager.swift
+// Film Camera - Lazy, prioritized LUT texture residency
+// ★★★ NEW: Replaces load-everything lutCache ★★★
+
+import Foundation
+import Metal
+import UIKit
+
+/// Load order for LUT prefetching
+enum LUTPriority: Int, Comparable {
+    case active = 0       // Preset đang hiển thị
+    case neighbour = 1    // Preset kế bên trong carousel
+    case background = 2   // Catalog warm-up (chỉ khi còn budget)
+
+    static func < (lhs: LUTPriority, rhs: LUTPriority) -> Bool {
+        return lhs.rawValue < rhs.rawValue
+    }
+}
+
+/// Keeps LUT 3D textures resident under a byte budget
+///
+/// - texture(named:) loads synchronously on a miss (same as the old lutCache)
+/// - prioritize(active:neighbours:) prefetches on a background queue, active first
+/// - LRU eviction above byteBudget; active + neighbours are pinned
+/// - Memory warning → drop everything except the active LUT
+final class LUTResidencyManager {
+
+    private struct Entry {
+        let texture: MTLTexture
+        let bytes: Int
+        let source: LUTLoadSource
+        var lastUsed: UInt64
+    }
+
+    private let device: MTLDevice
+    private var resident: [String: Entry] = [:]
+    private var pinned: Set<String> = []
+    private var activeLUT: String?
+    private var pending: [(name: String, priority: LUTPriority)] = []
+    private var useCounter: UInt64 = 0
+    private var residentBytes: Int = 0
+    private let lock = NSLock()
+
+    private let loadQueue = DispatchQueue(label: "com.filmcamera.lutResidency", qos: .utility)
+    private var memoryWarningObserver: NSObjectProtocol?
+
+    /// Max bytes of LUT textures kept resident (33³ rgba16Float ≈ 288 KB, 64³ ≈ 2 MB)
+    var byteBudget: Int = 16 * 1024 * 1024 {
+        didSet {
+            lock.lock()
+            evictToBudget()
+            lock.unlock()
+        }
+    }
+
+    init(device: MTLDevice) {
+        self.device = device
+
+        memoryWarningObserver = NotificationCenter.default.addObserver(
+            forName: UIApplication.didReceiveMemoryWarningNotification,
+            object: nil,
+            queue: nil
+        ) { [weak self] _ in
+            self?.handleMemoryWarning()
+        }
+    }
+
+    deinit {
+        if let observer = memoryWarningObserver {
+            NotificationCenter.default.removeObserver(observer)
+        }
+    }
+
+    // MARK: - Access
+
+    /// Resident texture, loading synchronously on a miss
+    func texture(named filename: String) -> MTLTexture? {
+        lock.lock()
+        if var entry = resident[filename] {
+            useCounter += 1
+            entry.lastUsed = useCounter
+            resident[filename] = entry
+            lock.unlock()
+            return entry.texture
+        }
+        lock.unlock()
+
+        // Load outside the lock so render thread không chờ prefetch của LUT khác
+        return load(filename)
+    }
+
+    /// Resident without loading (nil if cold)
+    func residentTexture(named filename: String) -> MTLTexture? {
+        lock.lock()
+        defer { lock.unlock() }
+        return resident[filename]?.texture
+    }
+
+    // MARK: - Prioritization
+
+    /// Active preset LUT first, then carousel neighbours; replaces any earlier pending prefetch
+    func prioritize(active: String?, neighbours: [String]) {
+        lock.lock()
+        activeLUT = active
+        pinned = Set(neighbours + [active].compactMap { $0 })
+
+        // Background warm-up không bị huỷ, chỉ bị đẩy ra sau
+        let background = pending.filter { $0.priority == .background }
+        var queue: [(name: String, priority: LUTPriority)] = []
+        if let active = active {
+            queue.append((active, .active))
+        }
+        queue += neighbours.map { ($0, .neighbour) }
+        pending = queue + background
+        lock.unlock()
+
+        drain(completion: nil)
+    }
+
+    /// Queue LUTs at a given priority; completion fires when the queue drains
+    func prefetch(_ filenames: [String], priority: LUTPriority, completion: ((_ elapsed: CFAbsoluteTime) -> Void)? = nil) {
+        lock.lock()
+        pending += filenames.map { ($0, priority) }
+        pending.sort { $0.priority < $1.priority }
+        lock.unlock()
+
+        drain(completion: completion)
+    }
+
+    // MARK: - Eviction
+
+    /// Drop every LUT except the active one
+    func handleMemoryWarning() {
+        lock.lock()
+        let before = resident.count
+        for (name, entry) in resident where name != activeLUT {
+            residentBytes -= entry.bytes
+            resident.removeValue(forKey: name)
+        }
+        pending.removeAll { $0.priority == .background }
+        let evicted = before - resident.count
+        lock.unlock()
+
+        print("⚠️ LUTResidency: Memory warning - evicted \(evicted) LUTs")
+    }
+
+    func removeAll() {
+        lock.lock()
+        resident.removeAll()
+        pending.removeAll()
+        residentBytes = 0
+        lock.unlock()
+    }
+
+    // MARK: - Statistics
+
+    func loadSource(of filename: String) -> LUTLoadSource? {
+        lock.lock()
+        defer { lock.unlock() }
+        return resident[filename]?.source
+    }
+
+    func statistics() -> (resident: Int, bytes: Int, pending: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+        return (resident.count, residentBytes, pending.count)
+    }
+
+    #if DEBUG
+    func printStatus() {
+        lock.lock()
+        print("📊 LUT Residency: \(resident.count) resident, \(residentBytes / 1024) KB / \(byteBudget / 1024) KB, \(pending.count) pending")
+        for (name, entry) in resident.sorted(by: { $0.value.lastUsed > $1.value.lastUsed }) {
+            let tag = name == activeLUT ? " [active]" : (pinned.contains(name) ? " [pinned]" : "")
+            print("   - \(name): \(entry.texture.width)³, \(entry.bytes / 1024) KB\(tag)")
+        }
+        lock.unlock()
+    }
+    #endif
+
+    // MARK: - Private
+
+    @discardableResult
+    private func load(_ filename: String) -> MTLTexture? {
+        guard let loaded = LUTLoader.loadWithSource(filename: filename, device: device) else {
+            print("⚠️ LUTResidency: Failed to load LUT: \(filename)")
+            return nil
+        }
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        // Another thread may have loaded it meanwhile
+        if let existing = resident[filename] {
+            return existing.texture
+        }
+
+        useCounter += 1
+        let bytes = loaded.texture.allocatedSize
+        resident[filename] = Entry(texture: loaded.texture, bytes: bytes, source: loaded.source, lastUsed: useCounter)
+        residentBytes += bytes
+        evictToBudget()
+
+        print("✅ LUTResidency: LUT loaded: \(filename) (\(bytes / 1024) KB)")
+        return loaded.texture
+    }
+
+    /// Process pending loads in priority order on loadQueue
+    private func drain(completion: ((CFAbsoluteTime) -> Void)?) {
+        loadQueue.async { [weak self] in
+            guard let self = self else { return }
+            let startTime = CFAbsoluteTimeGetCurrent()
+
+            while let next = self.popNext() {
+                self.load(next)
+            }
+
+            completion?(CFAbsoluteTimeGetCurrent() - startTime)
+        }
+    }
+
+    /// Next pending LUT that is not resident (background items only while under budget)
+    private func popNext() -> String? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        while !pending.isEmpty {
+            let item = pending.removeFirst()
+            if resident[item.name] != nil { continue }
+            if item.priority == .background && residentBytes >= byteBudget { continue }
+            return item.name
+        }
+        return nil
+    }
+
+    /// Evict least-recently-used, non-pinned LUTs (lock held)
+    private func evictToBudget() {
+        while residentBytes > byteBudget,
+              let victim = resident
+                .filter({ !pinned.contains($0.key) && $0.key != activeLUT })
+                .min(by: { $0.value.lastUsed < $1.value.lastUsed }) {
+            residentBytes -= victim.value.bytes
+            resident.removeValue(forKey: victim.key)
+
+            #if DEBUG
+            print("♻️ LUTResidency: Evicted \(victim.key)")
+            #endif
+        }
+    }
+}
@@ -0,0 +1,250 @@
+// NoiseTextureAtlas.swift
+// Film Camera - Pre-generated tileable noise for grain, dust, digicam + VHS noise
+// ★★★ NEW: Replaces per-pixel procedural hashing with texture fetches ★★★
+
+import Foundation
+import Metal
+
+/// Tileable noise textures generated once at startup
+///
+/// - grain (TextureIndexNoise): 256² rgba8, 4 kênh độc lập, white noise lọc [1 2 1] → phổ hạt film
+///   (không còn từng pixel độc lập như hash); a = B&W grain
+/// - white (cũng dùng TextureIndexNoise ở overlays): 256² rgba8 white noise, 4 giá trị random / texel
+/// - blueNoise (TextureIndexBlueNoise): 64² r8 void-and-cluster → digicam/VHS noise không vón cục
+///   Sinh trên background queue; trước khi xong trả về white noise (cùng phân bố đều)
+/// - Seed → texel offset trong shader (noiseSeedOffset) → cùng seed = cùng pattern (FilmConditionConfig)
+final class NoiseTextureAtlas {
+
+    let grain: MTLTexture?
+    let white: MTLTexture?
+
+    private var blue: MTLTexture?
+    private let lock = NSLock()
+
+    private let device: MTLDevice
+
+    static let grainSize = 256
+    static let blueNoiseSize = 64
+
+    /// Blue noise when ready, white noise meanwhile
+    var blueNoise: MTLTexture? {
+        lock.lock()
+        defer { lock.unlock() }
+        return blue ?? white
+    }
+
+    init(device: MTLDevice) {
+        self.device = device
+
+        let size = NoiseTextureAtlas.grainSize
+        var rng = SplitMix64(seed: 0x46494C4D)  // Cố định → pattern giống nhau mỗi lần mở app
+
+        let white = (0..<(size * size * 4)).map { _ in rng.nextByte() }
+        self.white = NoiseTextureAtlas.makeTexture(device: device, pixelFormat: .rgba8Unorm, size: size, bytes: white, bytesPerPixel: 4)
+        self.grain = NoiseTextureAtlas.makeTexture(
+            device: device,
+            pixelFormat: .rgba8Unorm,
+            size: size,
+            bytes: NoiseTextureAtlas.filmGrain(from: white, size: size),
+            bytesPerPixel: 4
+        )
+
+        if grain == nil || white == nil {
+            print("❌ NoiseTextureAtlas: Failed to create noise textures")
+        }
+
+        DispatchQueue.global(qos: .utility).async { [weak self] in
+            self?.generateBlueNoise()
+        }
+    }
+
+    // MARK: - Private
+
+    private func generateBlueNoise() {
+        let startTime = CFAbsoluteTimeGetCurrent()
+        let size = NoiseTextureAtlas.blueNoiseSize
+        let ranks = NoiseTextureAtlas.voidAndCluster(size: size)
+        let count = size * size
+        let bytes = ranks.map { UInt8(min(255, ($0 * 256) / count)) }
+
+        guard let texture = NoiseTextureAtlas.makeTexture(device: device, pixelFormat: .r8Unorm, size: size, bytes: bytes, bytesPerPixel: 1) else {
+            print("⚠️ NoiseTextureAtlas: Blue noise unavailable, using white noise")
+            return
+        }
+
+        lock.lock()
+        blue = texture
+        lock.unlock()
+
+        #if DEBUG
+        print("✅ NoiseTextureAtlas: \(size)² blue noise in \(String(format: "%.0f", (CFAbsoluteTimeGetCurrent() - startTime) * 1000))ms")
+        #endif
+    }
+
+    private static func makeTexture(device: MTLDevice, pixelFormat: MTLPixelFormat, size: Int, bytes: [UInt8], bytesPerPixel: Int) -> MTLTexture? {
+        let descriptor = MTLTextureDescriptor.texture2DDescriptor(pixelFormat: pixelFormat, width: size, height: size, mipmapped: false)
+        descriptor.usage = .shaderRead
+        guard let texture = device.makeTexture(descriptor: descriptor) else { return nil }
+
+        bytes.withUnsafeBytes { buffer in
+            texture.replace(
+                region: MTLRegionMake2D(0, 0, size, size),
+                mipmapLevel: 0,
+                withBytes: buffer.baseAddress!,
+                bytesPerRow: size * bytesPerPixel
+            )
+        }
+        return texture
+    }
+
+    /// White noise → [1 2 1]² low-pass (wrap) + stretch về full range
+    /// Phổ hạt film: năng lượng giảm dần ở tần số cao, hạt hơi vón như emulsion thật
+    private static func filmGrain(from white: [UInt8], size: Int) -> [UInt8] {
+        var filtered = [Float](repeating: 0, count: white.count)
+        let weights: [Float] = [1, 2, 1]
+
+        for y in 0..<size {
+            for x in 0..<size {
+                for c in 0..<4 {
+                    var sum: Float = 0
+                    for dy in -1...1 {
+                        for dx in -1...1 {
+                            let sx = (x + dx + size) % size
+                            let sy = (y + dy + size) % size
+                            sum += Float(white[(sy * size + sx) * 4 + c]) * weights[dx + 1] * weights[dy + 1]
+                        }
+                    }
+                    filtered[(y * size + x) * 4 + c] = sum / 16
+                }
+            }
+        }
+
+        // Lọc làm hẹp biên độ (σ giảm ~2.7×) → chuẩn hoá lại quanh 128 để intensity giữ như cũ
+        let mean = filtered.reduce(0, +) / Float(filtered.count)
+        let variance = filtered.reduce(0) { $0 + ($1 - mean) * ($1 - mean) } / Float(filtered.count)
+        let gain = 73.6 / max(variance.squareRoot(), 1)   // σ của uniform [0, 255] = 255/√12
+        return filtered.map { UInt8(max(0, min(255, 128 + ($0 - mean) * gain))) }
+    }
+
+    /// Void-and-cluster (Ulichney 1993) on a torus → rank của từng pixel (0 ..< size²)
+    private static func voidAndCluster(size: Int) -> [Int] {
+        let count = size * size
+        let sigma: Float = 1.5
+
+        // Gaussian energy per toroidal offset
+        var kernel = [Float](repeating: 0, count: count)
+        for dy in 0..<size {
+            for dx in 0..<size {
+                let x = Float(min(dx, size - dx))
+                let y = Float(min(dy, size - dy))
+                kernel[dy * size + dx] = exp(-(x * x + y * y) / (2 * sigma * sigma))
+            }
+        }
+
+        var energy = [Float](repeating: 0, count: count)
+        var isSet = [Bool](repeating: false, count: count)
+        var ranks = [Int](repeating: 0, count: count)
+
+        func update(_ index: Int, _ sign: Float) {
+            let px = index % size
+            let py = index / size
+            kernel.withUnsafeBufferPointer { k in
+                energy.withUnsafeMutableBufferPointer { e in
+                    for y in 0..<size {
+                        let ky = ((y - py + size) % size) * size
+                        let row = y * size
+                        for x in 0..<size {
+                            e[row + x] += sign * k[ky + (x - px + size) % size]
+                        }
+                    }
+                }
+            }
+        }
+
+        /// Tightest cluster (max energy among set) or largest void (min energy among unset)
+        func extreme(set: Bool) -> Int {
+            var best = -1
+            var bestEnergy: Float = set ? -.infinity : .infinity
+            for i in 0..<count where isSet[i] == set {
+                if set ? energy[i] > bestEnergy : energy[i] < bestEnergy {
+                    bestEnergy = energy[i]
+                    best = i
+                }
+            }
+            return best
+        }
+
+        // 1. Initial pattern: ~10% random points, relaxed until stable
+        var rng = SplitMix64(seed: 0x424C5545)
+        let initialCount = count / 10
+        var placed = 0
+        while placed < initialCount {
+            let index = Int(rng.next() % UInt64(count))
+            if !isSet[index] {
+                isSet[index] = true
+                update(index, 1)
+                placed += 1
+            }
+        }
+        while true {
+            let cluster = extreme(set: true)
+            isSet[cluster] = false
+            update(cluster, -1)
+            let void = extreme(set: false)
+            if void == cluster {
+                isSet[cluster] = true
+                update(cluster, 1)
+                break
+            }
+            isSet[void] = true
+            update(void, 1)
+        }
+
+        // 2. Rank initial points: remove tightest clusters first
+        let prototype = isSet
+        let prototypeEnergy = energy
+        var rank = initialCount - 1
+        while rank >= 0 {
+            let cluster = extreme(set: true)
+            isSet[cluster] = false
+            update(cluster, -1)
+            ranks[cluster] = rank
+            rank -= 1
+        }
+
+        // 3. Fill remaining pixels: largest void first
+        isSet = prototype
+        energy = prototypeEnergy
+        rank = initialCount
+        while rank < count {
+            let void = extreme(set: false)
+            isSet[void] = true
+            update(void, 1)
+            ranks[void] = rank
+            rank += 1
+        }
+
+        return ranks
+    }
+}
+
+/// Deterministic PRNG cho noise generation (SplitMix64)
+private struct SplitMix64 {
+    private var state: UInt64
+
+    init(seed: UInt64) {
+        state = seed
+    }
+
+    mutating func next() -> UInt64 {
+        state &+= 0x9E3779B97F4A7C15
+        var z = state
+        z = (z ^ (z >> 30)) &* 0xBF58476D1CE4E5B9
+        z = (z ^ (z >> 27)) &* 0x94D049BB133111EB
+        return z ^ (z >> 31)
+    }
+
+    mutating func nextByte() -> UInt8 {
+        return UInt8(truncatingIfNeeded: next() >> 56)
+    }
+}
@@ -0,0 +1,264 @@
+// PhotoProcessingPipeline.swift
+// Film Camera - Bounded, non-blocking photo capture processing
+// ★★★ NEW: Replaces renderSync + shared FilterRenderer per capture ★★★
+
+import Foundation
+import Metal
+import UIKit
+import os
+
+/// Decode → GPU filter → readback for captured photos, overlapping consecutive shots
+///
+/// - At most maxInFlight jobs hold full-resolution textures; extra shots wait as compressed Data
+/// - Mỗi job in-flight có FilterRenderer riêng (không còn lock quanh 1 renderer chung)
+/// - GPU work completes in a Metal completion handler → không thread nào bị block khi chờ GPU
+/// - JPEG/HEIC encode happens downstream (GalleryManager.fileQueue), overlapping the next shot's GPU work
+/// - Camera bytes + render seed gắn vào original UIImage (CaptureSource) → lưu file camera nguyên bản,
+///   filtered có thể render lại y hệt (original-only storage)
+/// - Gallery thumbnail pyramid render trong cùng command buffer, gắn vào filtered UIImage (ThumbnailPyramid)
+/// - Signposts: "Capture" (submit → completion) chứa "Decode" + "Filter" → Instruments thấy từng shot
+final class PhotoProcessingPipeline {
+
+    private struct Job {
+        let id: Int
+        let photoData: Data
+        let preset: FilterPreset
+        let submittedAt: CFAbsoluteTime
+        let signpostID: OSSignpostID
+        let captureInterval: OSSignpostIntervalState
+        let completion: (UIImage?, UIImage?) -> Void  // (original, filtered)
+    }
+
+    private var queued: [Job] = []
+    private var inFlight: Int = 0
+    private var nextJobID: Int = 0
+    private var idleRenderers: [FilterRenderer] = []
+    private let lock = NSLock()
+
+    private let decodeQueue = DispatchQueue(
+        label: "com.filmcamera.photoPipeline.decode",
+        qos: .userInitiated,
+        attributes: .concurrent
+    )
+
+    // Latency tracking (shot-to-shot = interval between consecutive completions)
+    private var completedCount: Int = 0
+    private var lastCompletionTime: CFAbsoluteTime?
+    private var latencies: [CFAbsoluteTime] = []
+    private var shotIntervals: [CFAbsoluteTime] = []
+
+    /// Max jobs decoding/rendering at once (mỗi job 12MP ≈ 48MB input + 48MB output)
+    var maxInFlight: Int = 2
+
+    /// Print a latency report every N completed shots (10-frame burst)
+    var burstReportSize: Int = 10
+
+    /// Thumbnail levels rendered on the GPU with each capture (rỗng = GalleryManager tự tạo bằng ImageIO)
+    var thumbnailLevels: [ThumbnailLevel] = ThumbnailLevel.allCases
+
+    /// Stream of the capture renders (nil without Metal)
+    private var captureStream: RenderStream? {
+        RenderEngine.isAvailable ? RenderEngine.shared.stream(.capture) : nil
+    }
+
+    // MARK: - Submit
+
+    /// Queue a captured photo; completion fires on a background thread with (original, filtered)
+    /// Filter failure → filtered = original (giống PhotoCaptureProcessor cũ)
+    func submit(photoData: Data, preset: FilterPreset, completion: @escaping (UIImage?, UIImage?) -> Void) {
+        let signposter = RenderInstrumentation.signposter
+        let signpostID = signposter.makeSignpostID()
+        let captureInterval = signposter.beginInterval("Capture", id: signpostID, "\(preset.label)")
+
+        lock.lock()
+        nextJobID += 1
+        queued.append(Job(
+            id: nextJobID,
+            photoData: photoData,
+            preset: preset,
+            submittedAt: CFAbsoluteTimeGetCurrent(),
+            signpostID: signpostID,
+            captureInterval: captureInterval,
+            completion: completion
+        ))
+        lock.unlock()
+
+        pump()
+    }
+
+    // MARK: - Statistics
+
+    func statistics() -> (queued: Int, inFlight: Int, completed: Int, averageLatency: CFAbsoluteTime, averageShotToShot: CFAbsoluteTime) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return (queued.count, inFlight, completedCount, Self.average(latencies), Self.average(shotIntervals))
+    }
+
+    // MARK: - Private
+
+    /// Start queued jobs while under maxInFlight
+    private func pump() {
+        lock.lock()
+        var started: [(Job, FilterRenderer?)] = []
+        while inFlight < maxInFlight, !queued.isEmpty {
+            inFlight += 1
+            started.append((queued.removeFirst(), idleRenderers.popLast()))
+        }
+        lock.unlock()
+
+        for (job, renderer) in started {
+            // Capture pool được purge khi pipeline rảnh (RenderStream.endWork trong finish)
+            captureStream?.beginWork()
+            decodeQueue.async { [weak self] in
+                self?.process(job, renderer: renderer)
+            }
+        }
+    }
+
+    private func process(_ job: Job, renderer reusedRenderer: FilterRenderer?) {
+        let signposter = RenderInstrumentation.signposter
+        let decodeInterval = signposter.beginInterval("Decode", id: job.signpostID)
+        let decodedImage = UIImage(data: job.photoData)
+        signposter.endInterval("Decode", decodeInterval)
+
+        guard let originalImage = decodedImage else {
+            print("❌ PhotoPipeline: Failed to decode photo #\(job.id)")
+            finish(job, renderer: reusedRenderer, original: nil, filtered: nil)
+            return
+        }
+
+        // ★★★ FIX: Check if RenderEngine is available before using it ★★★
+        guard RenderEngine.isAvailable, let cgImage = originalImage.cgImage else {
+            print("⚠️ PhotoPipeline: RenderEngine not available, returning original image")
+            finish(job, renderer: reusedRenderer, original: originalImage, filtered: originalImage)
+            return
+        }
+
+        let engine = RenderEngine.shared
+        let renderer = reusedRenderer ?? FilterRenderer(stream: engine.stream(.capture))
+        let texturePool = renderer.stream.texturePool
+
+        // Seed + date pinned per shot → lazy render from the original reproduces this exact output
+        let source = CaptureSource(data: job.photoData, renderSeed: UInt32.random(in: 0..<UInt32.max), capturedAt: Date())
+        source.attach(to: originalImage)
+        renderer.fixedFrameSeed = source.renderSeed
+        renderer.stampDate = source.capturedAt
+
+        guard let inputTexture = engine.makeTexture(from: cgImage) else {
+            print("❌ PhotoPipeline: Failed to create input texture")
+            finish(job, renderer: renderer, original: originalImage, filtered: originalImage)
+            return
+        }
+
+        // Readback target: IOSurface (zero-copy) → fallback shared texture + getBytes
+        let outputTexture: MTLTexture
+        let readback: () -> CGImage?
+        if let surface = engine.readbackSurfaces.makeSurface(width: cgImage.width, height: cgImage.height) {
+            outputTexture = surface.texture
+            readback = { surface.makeCGImage() }
+        } else if let texture = texturePool.readableTexture(width: cgImage.width, height: cgImage.height) {
+            outputTexture = texture
+            readback = {
+                defer { texturePool.recycle(texture) }
+                return engine.textureToCGImage(texture: texture)
+            }
+        } else {
+            print("❌ PhotoPipeline: Failed to create output texture")
+            finish(job, renderer: renderer, original: originalImage, filtered: originalImage)
+            return
+        }
+
+        print("🎨 PhotoPipeline: #\(job.id) FULL pipeline at \(cgImage.width)×\(cgImage.height)")
+
+        // Square thumbnails (center crop) → không lớn hơn cạnh ngắn của ảnh
+        let shortSide = min(cgImage.width, cgImage.height)
+        let thumbnailTargets: [(level: ThumbnailLevel, texture: MTLTexture)] = thumbnailLevels
+            .filter { $0.pixelSize <= shortSide }
+            .compactMap { level in
+                texturePool.readableTexture(width: level.pixelSize, height: level.pixelSize).map { (level, $0) }
+            }
+
+        let filterInterval = signposter.beginInterval("Filter", id: job.signpostID, "\(cgImage.width)x\(cgImage.height)")
+        renderer.renderAsync(
+            input: inputTexture,
+            output: outputTexture,
+            preset: job.preset,
+            thumbnails: thumbnailTargets.map { $0.texture },
+            commandQueue: renderer.stream.commandQueue
+        ) { [weak self] success in
+            let filteredCGImage = readback()
+            signposter.endInterval("Filter", filterInterval)
+            var filteredImage = originalImage
+
+            var thumbnails: [ThumbnailLevel: CGImage] = [:]
+            for target in thumbnailTargets {
+                if success, let image = engine.textureToCGImage(texture: target.texture) {
+                    thumbnails[target.level] = image
+                }
+                texturePool.recycle(target.texture)
+            }
+
+            if success, let filteredCGImage = filteredCGImage {
+                filteredImage = UIImage(cgImage: filteredCGImage, scale: 1.0, orientation: originalImage.imageOrientation)
+                if !thumbnails.isEmpty {
+                    ThumbnailPyramid(images: thumbnails, orientation: originalImage.imageOrientation).attach(to: filteredImage)
+                }
+            } else {
+                print("⚠️ PhotoPipeline: Filter failed for #\(job.id), returning original")
+            }
+
+            self?.finish(job, renderer: renderer, original: originalImage, filtered: filteredImage)
+        }
+    }
+
+    private func finish(_ job: Job, renderer: FilterRenderer?, original: UIImage?, filtered: UIImage?) {
+        let now = CFAbsoluteTimeGetCurrent()
+        let latency = now - job.submittedAt
+
+        lock.lock()
+        inFlight -= 1
+        if let renderer = renderer {
+            idleRenderers.append(renderer)
+        }
+        // Giữ tối đa maxInFlight renderers
+        if idleRenderers.count > maxInFlight {
+            idleRenderers.removeFirst(idleRenderers.count - maxInFlight)
+        }
+
+        completedCount += 1
+        latencies.append(latency)
+        if let last = lastCompletionTime {
+            shotIntervals.append(now - last)
+        }
+        lastCompletionTime = now
+        if latencies.count > burstReportSize { latencies.removeFirst() }
+        if shotIntervals.count > burstReportSize - 1 { shotIntervals.removeFirst() }
+
+        let reportDue = completedCount % burstReportSize == 0
+        let report = (latencies, shotIntervals)
+        let queuedCount = queued.count
+        lock.unlock()
+
+        print("✅ PhotoPipeline: #\(job.id) done in \(String(format: "%.2f", latency))s (\(queuedCount) queued)")
+        RenderInstrumentation.signposter.endInterval("Capture", job.captureInterval)
+
+        if reportDue {
+            printBurstReport(latencies: report.0, intervals: report.1)
+        }
+
+        job.completion(original, filtered)
+        pump()
+        captureStream?.endWork()
+    }
+
+    private func printBurstReport(latencies: [CFAbsoluteTime], intervals: [CFAbsoluteTime]) {
+        print("📊 PhotoPipeline: Last \(latencies.count) shots (maxInFlight \(maxInFlight))")
+        print("   latency: avg \(String(format: "%.0f", Self.average(latencies) * 1000))ms, max \(String(format: "%.0f", (latencies.max() ?? 0) * 1000))ms")
+        print("   shot-to-shot: avg \(String(format: "%.0f", Self.average(intervals) * 1000))ms, max \(String(format: "%.0f", (intervals.max() ?? 0) * 1000))ms")
+    }
+
+    private static func average(_ values: [CFAbsoluteTime]) -> CFAbsoluteTime {
+        return values.isEmpty ? 0 : values.reduce(0, +) / Double(values.count)
+    }
+}
@@ -0,0 +1,244 @@
+// PipelineArchive.swift
+// Film Camera - Persistent MTLBinaryArchive of every pipeline the engine builds
+// ★★★ NEW: Launch 2+ lấy GPU binary từ archive thay vì compile lại ★★★
+
+import Foundation
+import Metal
+import UIKit
+
+/// Harvests compiled pipelines into an MTLBinaryArchive and serves them back on later launches
+///
+/// - Launch đầu (hoặc sau update app / iOS / driver): archive rỗng → pipeline compile như cũ,
+///   functions của descriptor được add vào archive, serialize() ghi ra Caches
+/// - Launch sau: descriptor.binaryArchives = [archive] + .failOnBinaryArchiveMiss → hit = không compile,
+///   miss (pipeline mới, variant mới) → compile bình thường rồi harvest
+/// - File key = app version + build + OS build + GPU + param layout → binary cũ không bao giờ bị dùng nhầm
+/// - Archive hỏng / không load được → xoá file, tạo archive rỗng (chỉ mất cache, không mất pipeline)
+/// - Mọi truy cập archive (add + serialize) chạy trên serializeQueue → build pipeline song song lúc
+///   cold launch không xếp hàng sau nhau; lock chỉ giữ counters
+final class PipelineArchive {
+
+    private let device: MTLDevice
+    private let archive: MTLBinaryArchive?
+    private let url: URL
+
+    private var hits: Int = 0
+    private var misses: Int = 0
+    private var pendingHarvest: Int = 0
+    private var serializedBytes: Int = 0
+    private let lock = NSLock()
+
+    private let serializeQueue = DispatchQueue(label: "com.filmcamera.pipelineArchive", qos: .utility)
+
+    /// Loaded a previously serialized archive (false → lần đầu / archive vừa bị invalidate)
+    let loadedFromDisk: Bool
+
+    /// Toggle archive lookups + harvesting at runtime (false → compile như chưa có archive)
+    var isEnabled: Bool = true
+
+    init(device: MTLDevice) {
+        self.device = device
+        self.url = PipelineArchive.archiveURL(device: device)
+
+        let fileManager = FileManager.default
+        try? fileManager.createDirectory(at: url.deletingLastPathComponent(), withIntermediateDirectories: true)
+        PipelineArchive.removeStaleArchives(keeping: url)
+
+        var archive: MTLBinaryArchive?
+        var loaded = false
+        if fileManager.fileExists(atPath: url.path) {
+            let descriptor = MTLBinaryArchiveDescriptor()
+            descriptor.url = url
+            do {
+                archive = try device.makeBinaryArchive(descriptor: descriptor)
+                loaded = true
+            } catch {
+                print("⚠️ PipelineArchive: Discarding unreadable archive: \(error.localizedDescription)")
+                try? fileManager.removeItem(at: url)
+            }
+        }
+        if archive == nil {
+            do {
+                archive = try device.makeBinaryArchive(descriptor: MTLBinaryArchiveDescriptor())
+            } catch {
+                print("⚠️ PipelineArchive: Binary archives unavailable, pipelines compile every launch: \(error.localizedDescription)")
+            }
+        }
+        self.archive = archive
+        self.loadedFromDisk = loaded
+
+        #if DEBUG
+        print("✅ PipelineArchive: \(loaded ? "Loaded" : "Created empty") archive \(url.lastPathComponent)")
+        #endif
+
+        // ★ Ghi phần harvest còn lại trước khi app có thể bị kill
+        NotificationCenter.default.addObserver(
+            self,
+            selector: #selector(applicationDidEnterBackground),
+            name: UIApplication.didEnterBackgroundNotification,
+            object: nil
+        )
+    }
+
+    deinit {
+        NotificationCenter.default.removeObserver(self)
+    }
+
+    // MARK: - Pipeline Creation
+
+    /// Render pipeline from the archive when present, otherwise compiled + harvested
+    func makeRenderPipeline(descriptor: MTLRenderPipelineDescriptor) throws -> MTLRenderPipelineState {
+        guard isEnabled, let archive = archive else {
+            return try device.makeRenderPipelineState(descriptor: descriptor)
+        }
+
+        descriptor.binaryArchives = [archive]
+        if loadedFromDisk,
+           let pipeline = try? device.makeRenderPipelineState(descriptor: descriptor, options: [.failOnBinaryArchiveMiss], reflection: nil) {
+            recordHit()
+            return pipeline
+        }
+
+        let pipeline = try device.makeRenderPipelineState(descriptor: descriptor)
+        // Copy → caller có thể sửa / tái dùng descriptor trong lúc add còn chờ trên queue
+        let harvested = descriptor.copy() as! MTLRenderPipelineDescriptor
+        harvest {
+            try archive.addRenderPipelineFunctions(descriptor: harvested)
+        }
+        return pipeline
+    }
+
+    /// Compute pipeline from the archive when present, otherwise compiled + harvested
+    func makeComputePipeline(descriptor: MTLComputePipelineDescriptor) throws -> MTLComputePipelineState {
+        guard isEnabled, let archive = archive else {
+            return try device.makeComputePipelineState(descriptor: descriptor, options: [], reflection: nil)
+        }
+
+        descriptor.binaryArchives = [archive]
+        if loadedFromDisk,
+           let pipeline = try? device.makeComputePipelineState(descriptor: descriptor, options: [.failOnBinaryArchiveMiss], reflection: nil) {
+            recordHit()
+            return pipeline
+        }
+
+        let pipeline = try device.makeComputePipelineState(descriptor: descriptor, options: [], reflection: nil)
+        let harvested = descriptor.copy() as! MTLComputePipelineDescriptor
+        harvest {
+            try archive.addComputePipelineFunctions(descriptor: harvested)
+        }
+        return pipeline
+    }
+
+    // MARK: - Persistence
+
+    /// Write newly harvested pipelines to disk on a background queue (no-op khi không có gì mới)
+    func serialize() {
+        serializeQueue.async { [weak self] in
+            self?.serializeNow()
+        }
+    }
+
+    /// Get archive statistics for debugging
+    func statistics() -> (loaded: Bool, hits: Int, misses: Int, pending: Int, bytes: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return (loadedFromDisk, hits, misses, pendingHarvest, serializedBytes)
+    }
+
+    // MARK: - Private
+
+    @objc private func applicationDidEnterBackground() {
+        serialize()
+    }
+
+    private func recordHit() {
+        lock.lock()
+        hits += 1
+        lock.unlock()
+    }
+
+    /// Queue the add on serializeQueue (MTLBinaryArchive không thread-safe khi add + serialize song song)
+    /// Caller (pipeline build) không chờ: add tự compile lại functions cho archive → tốn ngang 1 lần build
+    private func harvest(_ add: @escaping () throws -> Void) {
+        lock.lock()
+        misses += 1
+        lock.unlock()
+
+        serializeQueue.async { [weak self] in
+            do {
+                try add()
+                guard let self = self else { return }
+                self.lock.lock()
+                self.pendingHarvest += 1
+                self.lock.unlock()
+            } catch {
+                #if DEBUG
+                print("⚠️ PipelineArchive: Harvest failed: \(error.localizedDescription)")
+                #endif
+            }
+        }
+    }
+
+    /// serializeQueue only — adds chạy cùng queue nên không bao giờ song song với serialize
+    private func serializeNow() {
+        lock.lock()
+        let harvested = pendingHarvest
+        lock.unlock()
+
+        guard let archive = archive, harvested > 0 else { return }
+
+        let startTime = CFAbsoluteTimeGetCurrent()
+        // Ghi ra file tạm rồi thay thế → app bị kill giữa chừng không để lại archive hỏng
+        let temporaryURL = url.appendingPathExtension("tmp")
+        do {
+            try? FileManager.default.removeItem(at: temporaryURL)
+            try archive.serialize(to: temporaryURL)
+            _ = try FileManager.default.replaceItemAt(url, withItemAt: temporaryURL)
+            let bytes = try? FileManager.default.attributesOfItem(atPath: url.path)[.size] as? Int
+
+            lock.lock()
+            pendingHarvest -= harvested
+            if let bytes = bytes {
+                serializedBytes = bytes
+            }
+            lock.unlock()
+
+            #if DEBUG
+            let elapsed = (CFAbsoluteTimeGetCurrent() - startTime) * 1000
+            print("✅ PipelineArchive: Serialized \(harvested) new pipelines (\((bytes ?? 0) / 1024) KB) in \(String(format: "%.1f", elapsed))ms")
+            #endif
+        } catch {
+            print("⚠️ PipelineArchive: Failed to serialize archive: \(error.localizedDescription)")
+        }
+    }
+
+    /// Caches/PipelineArchive/<version>-<build>-<os build>-<gpu>-p<param layout>.metallib
+    /// Param layout (SHADER_PARAMS_LAYOUT_VERSION) → dev build cùng build number không load binary của layout cũ
+    private static func archiveURL(device: MTLDevice) -> URL {
+        let info = Bundle.main.infoDictionary
+        let version = info?["CFBundleShortVersionString"] as? String ?? "0"
+        let build = info?["CFBundleVersion"] as? String ?? "0"
+        let os = ProcessInfo.processInfo.operatingSystemVersionString
+        let name = [version, build, os, device.name, "p\(SHADER_PARAMS_LAYOUT_VERSION)"]
+            .joined(separator: "-")
+            .map { $0.isLetter || $0.isNumber || $0 == "." || $0 == "-" ? $0 : "_" }
+
+        let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask)[0]
+        return caches
+            .appendingPathComponent("PipelineArchive", isDirectory: true)
+            .appendingPathComponent(String(name))
+            .appendingPathExtension("metallib")
+    }
+
+    /// Archives of older app / OS builds can never hit again → xoá
+    private static func removeStaleArchives(keeping current: URL) {
+        let fileManager = FileManager.default
+        let directory = current.deletingLastPathComponent()
+        guard let files = try? fileManager.contentsOfDirectory(at: directory, includingPropertiesForKeys: nil) else { return }
+
+        for file in files where file.lastPathComponent != current.lastPathComponent {
+            try? fileManager.removeItem(at: file)
+        }
+    }
+}
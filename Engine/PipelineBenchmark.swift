@@ -0,0 +1,575 @@
+// PipelineBenchmark.swift
+// Film Camera - Reproducible whole-pipeline benchmark across presets
+// ★★★ NEW: Mọi preset × renderPreview / renderGalleryPreview / renderSync × 1080p / 4K / 12MP → JSON ★★★
+
+import Foundation
+import Metal
+import QuartzCore
+import UIKit
+
+/// Renders every preset through the three public entry points on fixed test images
+///
+/// - Test image: pattern tính toán (hue ramp + gradient + skin patch + highlight blocks) → giống nhau mọi lần chạy
+/// - FilterRenderer riêng: fixedFrameSeed (grain/overlay/VHS seeds, animation time, date stamp cố định),
+///   governor tắt → output deterministic, checksum chỉ đổi khi output thật sự đổi
+/// - GPU time / passes / bytes: FrameRecorder của chính command buffer đã submit (FilterRenderer.takeFrameRecorders)
+///   → frame viewfinder / capture khác đang chạy không bị tính nhầm
+/// - Peak memory: TexturePool peakBytes, reset trước mỗi run
+/// - JSON (sorted keys) trong Documents/Benchmarks → diff giữa các commit, hoặc compare(_:with:)
+/// - Cùng harness: runIntermediateFormats (bgra8 / rgba16Float / rg11b10Float × half math),
+///   runNeighbourhoodKernels (fragment vs compute mỗi pass lân cận)
+/// Blocking, mất vài phút → background thread; launch argument `-runPipelineBenchmark YES` (runFromLaunchArguments)
+/// GPU time chính xác nhất khi camera dừng (viewfinder vẫn chia GPU dù không bị tính vào kết quả)
+final class PipelineBenchmark {
+
+    enum EntryPoint: String, Codable, CaseIterable {
+        case preview = "renderPreview"
+        case gallery = "renderGalleryPreview"
+        case capture = "renderSync"
+    }
+
+    struct Size: Codable, Hashable {
+        let name: String
+        let width: Int
+        let height: Int
+
+        static let hd1080 = Size(name: "1080p", width: 1920, height: 1080)
+        static let uhd4K = Size(name: "4K", width: 3840, height: 2160)
+        static let capture12MP = Size(name: "12MP", width: 4032, height: 3024)
+
+        static let standard: [Size] = [.hd1080, .uhd4K, .capture12MP]
+    }
+
+    struct Result: Codable {
+        let preset: String
+        let entryPoint: EntryPoint
+        let size: String
+        /// Median over the measured iterations
+        let gpuMilliseconds: Double
+        let peakBytes: Int
+        let passesExecuted: Int
+        /// Pass param bytes bound per frame (ShaderTypes.h layout; nil in reports before layout v2)
+        let paramBytes: Int?
+        /// Per-pass median (rỗng khi GPU không hỗ trợ stage-boundary counters)
+        let passMilliseconds: [String: Double]
+        /// FNV-1a 64 of the output pixels (hex)
+        let checksum: String
+    }
+
+    /// One intermediate format × shader precision (capture chain, renderSync)
+    struct FormatResult: Codable {
+        let format: String
+        let halfPrecision: Bool
+        let gpuMilliseconds: Double
+        /// 1 read + 1 write mỗi pass (bỏ qua multi-tap / texture cache)
+        let estimatedBytes: Int
+        let checksum: String
+    }
+
+    /// One neighbourhood pass, fragment vs compute kernel
+    struct KernelResult: Codable {
+        let pass: String
+        let size: String
+        let fragmentMilliseconds: Double
+        let computeMilliseconds: Double
+    }
+
+    struct Report: Codable {
+        let device: String
+        let deviceClass: String
+        let appVersion: String
+        let build: String
+        let date: Date
+        let iterations: Int
+        let results: [Result]
+    }
+
+    /// Measured iterations per run (cộng 1 lần warm-up không tính)
+    var iterations: Int = 3
+
+    /// Seed used for every frame (thay đổi → checksum thay đổi)
+    var frameSeed: UInt32 = 1234
+
+    private let engine = RenderEngine.shared
+    private let renderer = FilterRenderer()
+    private var savedInstrumentation: (enabled: Bool, reportInterval: Int)?
+
+    init() {
+        renderer.fixedFrameSeed = frameSeed
+        renderer.qualityGovernor.isEnabled = false
+    }
+
+    // MARK: - Run
+
+    /// Benchmark presets × entryPoints × sizes; nil when the test textures can't be created
+    func run(
+        presets: [FilterPreset] = FilmPresets.allPresets,
+        entryPoints: [EntryPoint] = EntryPoint.allCases,
+        sizes: [Size] = Size.standard
+    ) -> Report? {
+        beginInstrumentation()
+        defer { endInstrumentation() }
+
+        let startTime = CFAbsoluteTimeGetCurrent()
+        var results: [Result] = []
+
+        for size in sizes {
+            guard let input = Self.makeTestImage(width: size.width, height: size.height, texturePool: engine.texturePool) else {
+                print("❌ PipelineBenchmark: Test image unavailable at \(size.width)×\(size.height)")
+                return nil
+            }
+            defer { engine.texturePool.recycle(input) }
+
+            for preset in presets {
+                for entryPoint in entryPoints {
+                    if let result = measure(entryPoint, preset: preset, input: input, size: size) {
+                        results.append(result)
+                    } else {
+                        print("⚠️ PipelineBenchmark: \(entryPoint.rawValue) failed for '\(preset.label)' at \(size.name)")
+                    }
+                }
+            }
+        }
+
+        let info = Bundle.main.infoDictionary
+        let report = Report(
+            device: engine.device.name,
+            deviceClass: renderer.deviceClass,
+            appVersion: info?["CFBundleShortVersionString"] as? String ?? "?",
+            build: info?["CFBundleVersion"] as? String ?? "?",
+            date: Date(),
+            iterations: iterations,
+            results: results
+        )
+
+        print("📊 PipelineBenchmark: \(results.count) runs in \(String(format: "%.1f", CFAbsoluteTimeGetCurrent() - startTime))s - \(report.device) (\(report.deviceClass))")
+        for entryPoint in entryPoints {
+            for size in sizes {
+                let runs = results.filter { $0.entryPoint == entryPoint && $0.size == size.name }
+                guard let slowest = runs.max(by: { $0.gpuMilliseconds < $1.gpuMilliseconds }) else { continue }
+                let total = runs.reduce(0) { $0 + $1.gpuMilliseconds }
+                let paramBytes = runs.reduce(0) { $0 + ($1.paramBytes ?? 0) } / runs.count
+                print("   \(entryPoint.rawValue) \(size.name): avg \(String(format: "%.2f", total / Double(runs.count)))ms, slowest '\(slowest.preset)' \(String(format: "%.2f", slowest.gpuMilliseconds))ms, params \(paramBytes) B/frame")
+            }
+        }
+
+        return report
+    }
+
+    /// Run and write the JSON report to Documents/Benchmarks
+    @discardableResult
+    func runAndSave(presets: [FilterPreset] = FilmPresets.allPresets) -> URL? {
+        guard let report = run(presets: presets) else { return nil }
+
+        let directory = FileManager.default.urls(for: .documentDirectory, in: .userDomainMask)[0]
+            .appendingPathComponent("Benchmarks", isDirectory: true)
+        let formatter = DateFormatter()
+        formatter.dateFormat = "yyyyMMdd-HHmmss"
+        let url = directory.appendingPathComponent("benchmark-\(report.appVersion)-\(report.build)-\(formatter.string(from: report.date)).json")
+
+        do {
+            try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+            try Self.encode(report).write(to: url, options: .atomic)
+            print("✅ PipelineBenchmark: Saved \(url.lastPathComponent)")
+            return url
+        } catch {
+            print("❌ PipelineBenchmark: Failed to save report: \(error.localizedDescription)")
+            return nil
+        }
+    }
+
+    // MARK: - Intermediate Formats
+
+    /// Capture chain per intermediate format × float/half shader math on this device
+    /// bgra8 = ít bandwidth + nhiều ALU (decode/encode sRGB mỗi pass); rgba16Float = ngược lại;
+    /// rg11b10Float = bandwidth như bgra8, không ALU sRGB. Kết quả khác nhau theo GPU family → in kèm device class
+    @discardableResult
+    func runIntermediateFormats(preset: FilterPreset, size: Size = .capture12MP) -> [FormatResult] {
+        beginInstrumentation()
+        defer { endInstrumentation() }
+
+        let texturePool = engine.texturePool
+        guard let input = Self.makeTestImage(width: size.width, height: size.height, texturePool: texturePool),
+              let output = texturePool.readableTexture(width: size.width, height: size.height) else {
+            print("❌ PipelineBenchmark: Test textures unavailable at \(size.width)×\(size.height)")
+            return []
+        }
+        defer {
+            texturePool.recycle(input)
+            texturePool.recycle(output)
+        }
+
+        let savedFormat = renderer.captureIntermediateFormat
+        let savedHalf = renderer.usesHalfPrecisionMath
+        defer {
+            renderer.captureIntermediateFormat = savedFormat
+            renderer.usesHalfPrecisionMath = savedHalf
+        }
+
+        var results: [FormatResult] = []
+        for format in IntermediateFormat.allCases {
+            for halfPrecision in [false, true] {
+                renderer.captureIntermediateFormat = format
+                renderer.usesHalfPrecisionMath = halfPrecision
+
+                guard let frames = measureFrames({ _ in
+                    renderer.renderSync(input: input, output: output, preset: preset, commandQueue: engine.commandQueue)
+                }) else {
+                    print("⚠️ PipelineBenchmark: \(format.rawValue)\(halfPrecision ? " +half" : "") failed for '\(preset.label)'")
+                    continue
+                }
+
+                let passCount = frames.last?.passCount ?? 0
+                results.append(FormatResult(
+                    format: format.rawValue,
+                    halfPrecision: halfPrecision,
+                    gpuMilliseconds: frames.map { $0.gpuMilliseconds }.median,
+                    estimatedBytes: passCount * size.width * size.height * format.bytesPerPixel * 2,
+                    checksum: checksum(of: output)
+                ))
+            }
+        }
+
+        print("📊 PipelineBenchmark: Intermediate formats - \(engine.device.name) (\(renderer.deviceClass)) '\(preset.label)' \(size.name)")
+        for result in results {
+            print("   \(result.format)\(result.halfPrecision ? " +half" : ""): \(String(format: "%.2f", result.gpuMilliseconds))ms GPU, ~\(result.estimatedBytes / 1_048_576)MB traffic")
+        }
+
+        return results
+    }
+
+    // MARK: - Neighbourhood Kernels
+
+    /// GPU time of each neighbourhood pass as fragment vs compute kernel per size (1080p video, 12MP capture)
+    /// Test image có highlight blocks (CCD smear/bloom chỉ chạy trên pixel sáng hơn threshold)
+    @discardableResult
+    func runNeighbourhoodKernels(sizes: [Size] = [.hd1080, .capture12MP]) -> [KernelResult] {
+        beginInstrumentation()
+        defer { endInstrumentation() }
+
+        let texturePool = engine.texturePool
+        let savedPasses = renderer.computeKernelPasses
+        defer { renderer.computeKernelPasses = savedPasses }
+
+        var results: [KernelResult] = []
+        for size in sizes {
+            guard let input = Self.makeTestImage(width: size.width, height: size.height, texturePool: texturePool),
+                  let output = texturePool.renderTargetTexture(width: size.width, height: size.height) else {
+                print("❌ PipelineBenchmark: Test textures unavailable at \(size.width)×\(size.height)")
+                continue
+            }
+            defer {
+                texturePool.recycle(input)
+                texturePool.recycle(output)
+            }
+
+            for pass in ComputeKernelPass.allCases {
+                var times: [Double] = []
+                for usesCompute in [false, true] {
+                    renderer.computeKernelPasses = usesCompute ? [pass] : []
+                    let frames = measureFrames { _ in
+                        renderer.renderNeighbourhoodPass(pass, input: input, output: output, commandQueue: engine.commandQueue)
+                    }
+                    times.append(frames?.map { $0.gpuMilliseconds }.median ?? 0)
+                }
+                results.append(KernelResult(pass: pass.rawValue, size: size.name, fragmentMilliseconds: times[0], computeMilliseconds: times[1]))
+            }
+        }
+
+        print("📊 PipelineBenchmark: Neighbourhood kernels - \(engine.device.name) (\(renderer.deviceClass)), \(engine.computeKernels.tileMemoryLength / 1024)KB tile memory")
+        for result in results {
+            let speedup = result.computeMilliseconds > 0 ? result.fragmentMilliseconds / result.computeMilliseconds : 0
+            print("   \(result.pass) \(result.size): fragment \(String(format: "%.2f", result.fragmentMilliseconds))ms, compute \(String(format: "%.2f", result.computeMilliseconds))ms (×\(String(format: "%.2f", speedup)))")
+        }
+
+        return results
+    }
+
+    // MARK: - Launch Argument
+
+    /// `-runPipelineBenchmark YES` → full run + JSON, rồi format / kernel sweeps (preset đầu tiên)
+    /// trên background thread, vài giây sau launch (shader warm-up của app không bị tính)
+    static func runFromLaunchArguments() {
+        guard UserDefaults.standard.bool(forKey: "runPipelineBenchmark") else { return }
+
+        print("📊 PipelineBenchmark: Launch argument set, starting in 3s")
+        DispatchQueue.global(qos: .userInitiated).asyncAfter(deadline: .now() + 3) {
+            let benchmark = PipelineBenchmark()
+            benchmark.runAndSave()
+            if let preset = FilmPresets.allPresets.first {
+                benchmark.runIntermediateFormats(preset: preset)
+            }
+            benchmark.runNeighbourhoodKernels()
+        }
+    }
+
+    // MARK: - Compare
+
+    /// Print GPU regressions over threshold and output changes between two reports
+    /// - Returns: runs whose checksum changed (optimization đổi output)
+    @discardableResult
+    static func compare(_ baseline: Report, with current: Report, threshold: Double = 0.1) -> [Result] {
+        let key: (Result) -> String = { "\($0.preset)|\($0.entryPoint.rawValue)|\($0.size)" }
+        let previous = Dictionary(baseline.results.map { (key($0), $0) }, uniquingKeysWith: { first, _ in first })
+
+        var changedOutput: [Result] = []
+        var regressions: [String] = []
+        var improvements = 0
+
+        for result in current.results {
+            guard let old = previous[key(result)] else { continue }
+            if old.checksum != result.checksum {
+                changedOutput.append(result)
+            }
+            guard old.gpuMilliseconds > 0 else { continue }
+            let change = (result.gpuMilliseconds - old.gpuMilliseconds) / old.gpuMilliseconds
+            if change > threshold {
+                regressions.append("\(result.preset) \(result.entryPoint.rawValue) \(result.size): \(String(format: "%.2f", old.gpuMilliseconds)) → \(String(format: "%.2f", result.gpuMilliseconds))ms (+\(String(format: "%.0f", change * 100))%)")
+            } else if change < -threshold {
+                improvements += 1
+            }
+        }
+
+        if baseline.device != current.device {
+            print("⚠️ PipelineBenchmark: Comparing different devices (\(baseline.device) vs \(current.device))")
+        }
+        print("📊 PipelineBenchmark: v\(baseline.appVersion) (\(baseline.build)) → v\(current.appVersion) (\(current.build)): \(regressions.count) regressions, \(improvements) improvements > \(String(format: "%.0f", threshold * 100))%")
+        regressions.forEach { print("   ⚠️ \($0)") }
+
+        // Constant payload (ShaderTypes.h layout) — chỉ run có paramBytes ở cả 2 report
+        let paramBytes = current.results.compactMap { result -> (old: Int, new: Int)? in
+            guard let old = previous[key(result)]?.paramBytes, let new = result.paramBytes else { return nil }
+            return (old, new)
+        }
+        if !paramBytes.isEmpty {
+            let old = paramBytes.reduce(0) { $0 + $1.old } / paramBytes.count
+            let new = paramBytes.reduce(0) { $0 + $1.new } / paramBytes.count
+            print("   Params: \(old) → \(new) B/frame avg over \(paramBytes.count) runs")
+        }
+
+        for result in changedOutput {
+            print("   ❌ Output changed: \(result.preset) \(result.entryPoint.rawValue) \(result.size)")
+        }
+
+        return changedOutput
+    }
+
+    static func load(_ url: URL) -> Report? {
+        guard let data = try? Data(contentsOf: url) else { return nil }
+        let decoder = JSONDecoder()
+        decoder.dateDecodingStrategy = .iso8601
+        return try? decoder.decode(Report.self, from: data)
+    }
+
+    static func encode(_ report: Report) throws -> Data {
+        let encoder = JSONEncoder()
+        encoder.outputFormatting = [.prettyPrinted, .sortedKeys]
+        encoder.dateEncodingStrategy = .iso8601
+        return try encoder.encode(report)
+    }
+
+    // MARK: - Private
+
+    private func measure(_ entryPoint: EntryPoint, preset: FilterPreset, input: MTLTexture, size: Size) -> Result? {
+        let texturePool = engine.texturePool
+
+        // Preview → CAMetalLayer off-screen (drawable thật như MTKView), đọc lại được (framebufferOnly = false)
+        let layer = CAMetalLayer()
+        layer.device = engine.device
+        layer.pixelFormat = .bgra8Unorm
+        layer.framebufferOnly = false
+        layer.drawableSize = CGSize(width: size.width, height: size.height)
+
+        guard let output = texturePool.readableTexture(width: size.width, height: size.height) else { return nil }
+        defer { texturePool.recycle(output) }
+
+        texturePool.resetPeakBytes()
+
+        let measured = measureFrames { isLast in
+            switch entryPoint {
+            case .preview:
+                guard let drawable = layer.nextDrawable(),
+                      renderer.renderPreview(input: input, drawable: drawable, preset: preset, commandQueue: engine.commandQueue) else {
+                    return false
+                }
+                if isLast {
+                    copy(drawable.texture, to: output)
+                }
+                return true
+            case .gallery:
+                return renderer.renderGalleryPreview(input: input, output: output, preset: preset, commandQueue: engine.commandQueue)
+            case .capture:
+                return renderer.renderSync(input: input, output: output, preset: preset, commandQueue: engine.commandQueue)
+            }
+        }
+        guard let frames = measured else { return nil }
+
+        var passTimes: [String: [Double]] = [:]
+        for frame in frames {
+            for pass in frame.passes {
+                passTimes[pass.name, default: []].append(pass.gpuMilliseconds)
+            }
+        }
+
+        return Result(
+            preset: preset.id,
+            entryPoint: entryPoint,
+            size: size.name,
+            gpuMilliseconds: frames.map { $0.gpuMilliseconds }.median,
+            peakBytes: texturePool.statistics().peakBytes,
+            passesExecuted: frames.last?.passCount ?? 0,
+            paramBytes: renderer.lastFrameParamBytes,
+            passMilliseconds: passTimes.mapValues { $0.median },
+            checksum: checksum(of: output)
+        )
+    }
+
+    /// Warm-up + `iterations` measured renders; nil when a render or its GPU work fails
+    /// Iteration 0 = warm-up (variants, heaps, LUT / layer bake) → không tính
+    /// Mỗi render đọc recorder của chính command buffer nó submit (tiled capture: mọi tile cộng lại)
+    private func measureFrames(_ render: (_ isLast: Bool) -> Bool) -> [FrameInstrumentation]? {
+        var frames: [FrameInstrumentation] = []
+
+        for iteration in 0...iterations {
+            _ = renderer.takeFrameRecorders()
+            guard render(iteration == iterations) else { return nil }
+
+            var parts: [FrameInstrumentation] = []
+            for recorder in renderer.takeFrameRecorders() {
+                guard let frame = recorder.wait(timeout: .now() + 10) else { return nil }
+                parts.append(frame)
+            }
+            guard let frame = Self.combine(parts) else { return nil }
+
+            if iteration > 0 {
+                frames.append(frame)
+            }
+        }
+        return frames
+    }
+
+    /// Command buffers of one render (capture tiles) → 1 frame: GPU time + bytes cộng, pass cùng tên gộp
+    private static func combine(_ parts: [FrameInstrumentation]) -> FrameInstrumentation? {
+        guard let first = parts.first else { return nil }
+        guard parts.count > 1 else { return first }
+
+        var passes: [PassTiming] = []
+        for pass in parts.flatMap({ $0.passes }) {
+            if let index = passes.firstIndex(where: { $0.name == pass.name }) {
+                passes[index].gpuMilliseconds += pass.gpuMilliseconds
+                passes[index].encoders += pass.encoders
+            } else {
+                passes.append(pass)
+            }
+        }
+
+        return FrameInstrumentation(
+            label: first.label,
+            passes: passes,
+            passCount: parts.reduce(0) { $0 + $1.passCount },
+            gpuMilliseconds: parts.reduce(0) { $0 + $1.gpuMilliseconds },
+            bytesRequested: parts.reduce(0) { $0 + $1.bytesRequested },
+            bytesAllocated: parts.reduce(0) { $0 + $1.bytesAllocated },
+            unsampledEncoders: parts.reduce(0) { $0 + $1.unsampledEncoders }
+        )
+    }
+
+    /// Instrumentation on + renderer keeps its recorders for the duration of a run
+    private func beginInstrumentation() {
+        let instrumentation = RenderInstrumentation.shared
+        savedInstrumentation = (instrumentation.isEnabled, instrumentation.reportInterval)
+        instrumentation.isEnabled = true
+        instrumentation.reportInterval = 0
+
+        renderer.fixedFrameSeed = frameSeed
+        renderer.collectsFrameRecorders = true
+    }
+
+    private func endInstrumentation() {
+        renderer.collectsFrameRecorders = false
+        _ = renderer.takeFrameRecorders()
+
+        guard let saved = savedInstrumentation else { return }
+        RenderInstrumentation.shared.isEnabled = saved.enabled
+        RenderInstrumentation.shared.reportInterval = saved.reportInterval
+        savedInstrumentation = nil
+    }
+
+    /// Drawable → shared texture (preview checksum)
+    private func copy(_ source: MTLTexture, to destination: MTLTexture) {
+        guard let commandBuffer = engine.commandQueue.makeCommandBuffer(),
+              let blit = commandBuffer.makeBlitCommandEncoder() else { return }
+        blit.copy(
+            from: source, sourceSlice: 0, sourceLevel: 0,
+            sourceOrigin: MTLOrigin(x: 0, y: 0, z: 0),
+            sourceSize: MTLSize(width: min(source.width, destination.width), height: min(source.height, destination.height), depth: 1),
+            to: destination, destinationSlice: 0, destinationLevel: 0,
+            destinationOrigin: MTLOrigin(x: 0, y: 0, z: 0)
+        )
+        blit.endEncoding()
+        commandBuffer.commit()
+        commandBuffer.waitUntilCompleted()
+    }
+
+    /// FNV-1a 64 over bgra8 rows
+    private func checksum(of texture: MTLTexture) -> String {
+        let bytesPerRow = texture.width * 4
+        var row = [UInt8](repeating: 0, count: bytesPerRow)
+        var hash: UInt64 = 0xcbf29ce484222325
+
+        for y in 0..<texture.height {
+            row.withUnsafeMutableBytes { buffer in
+                texture.getBytes(buffer.baseAddress!, bytesPerRow: bytesPerRow, from: MTLRegionMake2D(0, y, texture.width, 1), mipmapLevel: 0)
+            }
+            for byte in row {
+                hash = (hash ^ UInt64(byte)) &* 0x100000001b3
+            }
+        }
+        return String(format: "%016llx", hash)
+    }
+
+    /// Fixed bgra8 test image: hue ramp theo x, độ sáng theo y, skin-tone patch giữa ảnh,
+    /// highlight blocks mỗi 96 px (bloom / halation / CCD smear có việc để làm)
+    private static func makeTestImage(width: Int, height: Int, texturePool: TexturePool) -> MTLTexture? {
+        guard let texture = texturePool.readableTexture(width: width, height: height) else { return nil }
+
+        var row = [UInt8](repeating: 255, count: width * 4)
+        for y in 0..<height {
+            let luminance = 0.15 + 0.75 * Float(y) / Float(max(height - 1, 1))
+            for x in 0..<width {
+                var color = hueRamp(Float(x) / Float(max(width - 1, 1))) * luminance
+
+                let dx = Float(x - width / 2) / Float(width)
+                let dy = Float(y - height / 2) / Float(height)
+                if dx * dx + dy * dy < 0.01 {
+                    color = SIMD3<Float>(0.87, 0.67, 0.55)  // Skin tone
+                }
+                if (x / 96 + y / 96) % 7 == 0 && (x % 96) < 24 && (y % 96) < 24 {
+                    color = SIMD3<Float>(1, 0.98, 0.95)     // Highlight
+                }
+
+                // BGRA
+                row[x * 4] = UInt8(min(max(color.z, 0), 1) * 255)
+                row[x * 4 + 1] = UInt8(min(max(color.y, 0), 1) * 255)
+                row[x * 4 + 2] = UInt8(min(max(color.x, 0), 1) * 255)
+            }
+            row.withUnsafeBytes { buffer in
+                texture.replace(
+                    region: MTLRegionMake2D(0, y, width, 1),
+                    mipmapLevel: 0,
+                    withBytes: buffer.baseAddress!,
+                    bytesPerRow: width * 4
+                )
+            }
+        }
+        return texture
+    }
+
+    private static func hueRamp(_ t: Float) -> SIMD3<Float> {
+        let h = t * 6
+        let r = min(max(abs(h - 3) - 1, 0), 1)
+        let g = min(max(2 - abs(h - 2), 0), 1)
+        let b = min(max(2 - abs(h - 4), 0), 1)
+        return SIMD3<Float>(r, g, b)
+    }
+}
@@ -0,0 +1,225 @@
+// PipelineVariantCache.swift
+// Film Camera - Function-constant specialized pipeline variants
+// ★★★ NEW: Specialize heavy fragments per preset feature signature ★★★
+
+import Foundation
+import Metal
+
+/// Preset fields that select branches in Shaders.metal (see FunctionConstantIndex in ShaderTypes.h)
+/// nil = không specialize → shader đọc giá trị runtime từ param struct
+struct PipelineFeatureSignature: Hashable {
+    var flashFalloffType: Int32?
+    var flashHotSpot: Bool?
+    var flashFresnel: Bool?
+    var flashFresnelRings: Int32?
+    var flashSpecular: Bool?
+
+    var leakType: Int32?
+    var leakFalloffType: Int32?
+    var leakBlendMode: Int32?
+    var leakTemporal: Bool?
+    var leakDepthLayers: Int32?
+
+    var bwToningMode: Int32?
+
+    init(flash: FlashParams? = nil, lightLeak: LightLeakParams? = nil, bw: BWParams? = nil) {
+        if let flash = flash, flash.enabled != 0 {
+            flashFalloffType = flash.falloffType
+            flashHotSpot = flash.features & UInt32(FLASH_FEATURE_HOT_SPOT) != 0
+            flashFresnel = flash.features & UInt32(FLASH_FEATURE_FRESNEL) != 0
+            // Ring count chỉ có nghĩa khi fresnel bật → tránh tạo variant thừa
+            flashFresnelRings = flashFresnel == true ? flash.fresnelRings : 0
+            flashSpecular = flash.features & UInt32(FLASH_FEATURE_SPECULAR) != 0
+        }
+
+        if let leak = lightLeak, leak.enabled != 0 {
+            leakType = leak.leakType
+            leakFalloffType = leak.falloffType
+            leakBlendMode = leak.blendMode
+            leakTemporal = leak.temporalEnabled != 0
+            leakDepthLayers = max(1, min(leak.depthLayers, 4))
+        }
+
+        if let bw = bw, bw.enabled != 0 {
+            bwToningMode = bw.toningMode
+        }
+    }
+
+    /// True when nothing is specialized (generic pipeline is equivalent)
+    var isEmpty: Bool {
+        return self == PipelineFeatureSignature()
+    }
+
+    func makeConstantValues() -> MTLFunctionConstantValues {
+        let values = MTLFunctionConstantValues()
+
+        func setInt(_ value: Int32?, _ index: FunctionConstantIndex) {
+            guard var v = value else { return }
+            values.setConstantValue(&v, type: .int, index: Int(index.rawValue))
+        }
+
+        func setBool(_ value: Bool?, _ index: FunctionConstantIndex) {
+            guard var v = value else { return }
+            values.setConstantValue(&v, type: .bool, index: Int(index.rawValue))
+        }
+
+        setInt(flashFalloffType, FunctionConstantFlashFalloffType)
+        setBool(flashHotSpot, FunctionConstantFlashHotSpot)
+        setBool(flashFresnel, FunctionConstantFlashFresnel)
+        setInt(flashFresnelRings, FunctionConstantFlashFresnelRings)
+        setBool(flashSpecular, FunctionConstantFlashSpecular)
+
+        setInt(leakType, FunctionConstantLeakType)
+        setInt(leakFalloffType, FunctionConstantLeakFalloffType)
+        setInt(leakBlendMode, FunctionConstantLeakBlendMode)
+        setBool(leakTemporal, FunctionConstantLeakTemporal)
+        setInt(leakDepthLayers, FunctionConstantLeakDepthLayers)
+
+        setInt(bwToningMode, FunctionConstantBWToningMode)
+
+        return values
+    }
+}
+
+/// Caches specialized MTLRenderPipelineState variants, compiled asynchronously on first request
+/// Trong lúc compile, caller dùng generic pipeline → chọn preset không bị stall
+final class PipelineVariantCache {
+
+    /// Fragments that read function constants
+    enum Pass: String {
+        case flash = "flashFragment"
+        case lightLeak = "lightLeakFragment"
+        case bwConvert = "bwConvertFragment"
+        case fusedPreview = "fusedPreviewFragment"
+
+        var vertexFunctionName: String {
+            return self == .fusedPreview ? "vertexAspectFill" : "vertexPassthrough"
+        }
+    }
+
+    private struct Key: Hashable {
+        let pass: Pass
+        let signature: PipelineFeatureSignature
+        let pixelFormat: MTLPixelFormat
+        let mode: ShaderIOMode
+    }
+
+    private let device: MTLDevice
+    private let library: MTLLibrary
+    private let archive: PipelineArchive
+
+    private var variants: [Key: MTLRenderPipelineState] = [:]
+    private var pending: Set<Key> = []
+    private var failed: Set<Key> = []
+    private let lock = NSLock()
+
+    /// Toggle specialization at runtime (false → always generic pipelines)
+    var isEnabled: Bool = true
+
+    init(device: MTLDevice, library: MTLLibrary, archive: PipelineArchive) {
+        self.device = device
+        self.library = library
+        self.archive = archive
+    }
+
+    /// Returns the specialized variant if ready; otherwise schedules compilation and returns nil
+    /// pixelFormat/mode: render target + shader I/O của graph hiện tại (linear intermediates → variant riêng)
+    func pipeline(
+        for pass: Pass,
+        signature: PipelineFeatureSignature,
+        pixelFormat: MTLPixelFormat = .bgra8Unorm,
+        mode: ShaderIOMode = .legacy
+    ) -> MTLRenderPipelineState? {
+        guard isEnabled, !signature.isEmpty else { return nil }
+
+        let key = Key(pass: pass, signature: signature, pixelFormat: pixelFormat, mode: mode)
+
+        lock.lock()
+        if let variant = variants[key] {
+            lock.unlock()
+            return variant
+        }
+        let shouldCompile = !pending.contains(key) && !failed.contains(key)
+        if shouldCompile {
+            pending.insert(key)
+        }
+        lock.unlock()
+
+        if shouldCompile {
+            compileAsync(key)
+        }
+        return nil
+    }
+
+    /// Kick off compilation ahead of the first frame (e.g. on preset selection)
+    func prewarm(_ pass: Pass, signature: PipelineFeatureSignature, pixelFormat: MTLPixelFormat = .bgra8Unorm, mode: ShaderIOMode = .legacy) {
+        _ = pipeline(for: pass, signature: signature, pixelFormat: pixelFormat, mode: mode)
+    }
+
+    /// Drop all compiled variants
+    func purge() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        variants.removeAll()
+        failed.removeAll()
+    }
+
+    /// Get cache statistics for debugging
+    func statistics() -> (compiled: Int, pending: Int, failed: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return (variants.count, pending.count, failed.count)
+    }
+
+    // MARK: - Private
+
+    private func compileAsync(_ key: Key) {
+        let startTime = CFAbsoluteTimeGetCurrent()
+
+        let constantValues = key.signature.makeConstantValues()
+        key.mode.apply(to: constantValues)
+
+        library.makeFunction(name: key.pass.rawValue, constantValues: constantValues) { [weak self] function, error in
+            guard let self = self else { return }
+
+            guard let fragmentFunction = function,
+                  let vertexFunction = self.library.makeFunction(name: key.pass.vertexFunctionName) else {
+                print("❌ PipelineVariantCache: Failed to specialize \(key.pass.rawValue): \(error?.localizedDescription ?? "unknown")")
+                self.finish(key, pipeline: nil)
+                return
+            }
+
+            let descriptor = MTLRenderPipelineDescriptor()
+            descriptor.vertexFunction = vertexFunction
+            descriptor.fragmentFunction = fragmentFunction
+            descriptor.colorAttachments[0].pixelFormat = key.pixelFormat
+
+            // Đang ở completion thread của Metal → build đồng bộ qua archive (hit = không compile)
+            var pipeline: MTLRenderPipelineState?
+            do {
+                pipeline = try self.archive.makeRenderPipeline(descriptor: descriptor)
+                #if DEBUG
+                let elapsed = (CFAbsoluteTimeGetCurrent() - startTime) * 1000
+                print("✅ PipelineVariantCache: \(key.pass.rawValue) variant compiled in \(String(format: "%.1f", elapsed))ms")
+                #endif
+            } catch {
+                print("❌ PipelineVariantCache: Failed to create \(key.pass.rawValue) variant: \(error.localizedDescription)")
+            }
+            self.finish(key, pipeline: pipeline)
+        }
+    }
+
+    private func finish(_ key: Key, pipeline: MTLRenderPipelineState?) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        pending.remove(key)
+        if let pipeline = pipeline {
+            variants[key] = pipeline
+        } else {
+            failed.insert(key)
+        }
+    }
+}
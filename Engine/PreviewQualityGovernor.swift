@@ -0,0 +1,165 @@
+// PreviewQualityGovernor.swift
+// Film Camera - Adaptive viewfinder quality from measured GPU time + thermal state
+// ★★★ NEW: Hạ / nâng chất lượng preview theo từng bậc, capture luôn full quality ★★★
+
+import Foundation
+import Metal
+
+/// Cumulative preview degradation steps (mỗi bậc giữ mọi cắt giảm của bậc trước)
+enum PreviewQualityLevel: Int, CaseIterable, Comparable {
+    case full
+    case reducedResolution      // Render graph ở 75% drawable, upscale ở pass cuối
+    case reducedBlurTaps        // Bloom/halation single-pass radius cap 8 → 4 (~81 → 25 taps)
+    case noGrainOverlays        // Grain + dust/scratches tắt
+    case halfResolutionBlur     // Bloom/halation qua blur pyramid half-res thay vì single-pass full-res
+
+    static func < (lhs: PreviewQualityLevel, rhs: PreviewQualityLevel) -> Bool {
+        return lhs.rawValue < rhs.rawValue
+    }
+
+    var settings: PreviewQualitySettings {
+        return PreviewQualitySettings(
+            resolutionScale: self >= .reducedResolution ? 0.75 : 1,
+            blurRadiusCap: self >= .reducedBlurTaps ? 4 : 8,
+            includesGrainAndOverlays: self < .noGrainOverlays,
+            halfResolutionBlur: self >= .halfResolutionBlur
+        )
+    }
+}
+
+/// What buildRenderGraph changes for a governed preview frame
+struct PreviewQualitySettings: Equatable {
+    var resolutionScale: Float
+    var blurRadiusCap: Float
+    var includesGrainAndOverlays: Bool
+    var halfResolutionBlur: Bool
+
+    /// Ungoverned (capture, video, gallery)
+    static let full = PreviewQualityLevel.full.settings
+}
+
+/// Steps preview quality down when the GPU can't hold the frame budget, back up when it has headroom
+///
+/// - GPU time = gpuEndTime - gpuStartTime của command buffer preview (EMA)
+/// - Hạ 1 bậc: EMA > downThreshold × budget liên tục downFrames frames
+/// - Nâng 1 bậc: EMA < upThreshold × budget liên tục upFrames frames (chậm hơn nhiều → không dao động)
+/// - Thermal serious / critical ép bậc tối thiểu; preset .heavy (EffectSystem PerformanceLevel) bắt đầu
+///   ở reducedResolution rồi tự nâng nếu GPU còn dư
+/// - Chỉ renderPreview dùng; capture / video / gallery luôn PreviewQualitySettings.full
+final class PreviewQualityGovernor {
+
+    private var level: PreviewQualityLevel = .full
+    private var gpuTimeAverage: Double = 0
+    private var overBudgetFrames = 0
+    private var underBudgetFrames = 0
+    private var cooldownFrames = 0
+    private var presetID: String?
+    private var performanceLevel: PerformanceLevel = .normal
+    private var stepCount = 0
+    private let lock = NSLock()
+
+    /// false → luôn full quality (A/B so sánh)
+    var isEnabled: Bool = true
+
+    /// Frame budget in seconds (viewfinder target 60 Hz; 30 Hz khi pacer hạ vì thermal)
+    var frameBudget: Double = 1.0 / 60
+
+    var downThreshold: Double = 0.85
+    var upThreshold: Double = 0.5
+    var downFrames: Int = 30
+    var upFrames: Int = 120
+
+    /// Frames ignored after a step (EMA cần thời gian phản ánh bậc mới)
+    var cooldownAfterStep: Int = 45
+
+    // MARK: - Render Thread
+
+    /// Settings for the next preview frame of preset
+    func settings(for preset: FilterPreset) -> PreviewQualitySettings {
+        guard isEnabled else { return .full }
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        if preset.id != presetID {
+            presetID = preset.id
+            performanceLevel = PerformanceLevel.from(score: EffectDefinition.from(preset: preset).performanceScore)
+            level = performanceLevel == .heavy ? .reducedResolution : .full
+            resetCounters()
+            #if DEBUG
+            print("📊 PreviewQualityGovernor: '\(preset.label)' (\(performanceLevel.displayName)) → \(level)")
+            #endif
+        }
+
+        return max(level, thermalFloor).settings
+    }
+
+    /// Completed preview command buffer (any thread)
+    func record(_ commandBuffer: MTLCommandBuffer) {
+        guard isEnabled, commandBuffer.status == .completed else { return }
+        let gpuTime = commandBuffer.gpuEndTime - commandBuffer.gpuStartTime
+        guard gpuTime > 0 else { return }
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        gpuTimeAverage = gpuTimeAverage == 0 ? gpuTime : gpuTimeAverage * 0.9 + gpuTime * 0.1
+
+        if cooldownFrames > 0 {
+            cooldownFrames -= 1
+            return
+        }
+
+        if gpuTimeAverage > frameBudget * downThreshold {
+            overBudgetFrames += 1
+            underBudgetFrames = 0
+        } else if gpuTimeAverage < frameBudget * upThreshold {
+            underBudgetFrames += 1
+            overBudgetFrames = 0
+        } else {
+            overBudgetFrames = 0
+            underBudgetFrames = 0
+        }
+
+        if overBudgetFrames >= downFrames, let lower = PreviewQualityLevel(rawValue: level.rawValue + 1) {
+            step(to: lower)
+        } else if underBudgetFrames >= upFrames, let higher = PreviewQualityLevel(rawValue: level.rawValue - 1) {
+            step(to: higher)
+        }
+    }
+
+    /// Get governor statistics for debugging
+    func statistics() -> (level: PreviewQualityLevel, gpuMilliseconds: Double, steps: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return (max(level, thermalFloor), gpuTimeAverage * 1000, stepCount)
+    }
+
+    // MARK: - Private
+
+    /// Minimum degradation for the current thermal state
+    private var thermalFloor: PreviewQualityLevel {
+        switch ProcessInfo.processInfo.thermalState {
+        case .critical: return .halfResolutionBlur
+        case .serious: return .reducedBlurTaps
+        default: return .full
+        }
+    }
+
+    /// Lock held
+    private func step(to newLevel: PreviewQualityLevel) {
+        #if DEBUG
+        print("📊 PreviewQualityGovernor: \(level) → \(newLevel) (GPU \(String(format: "%.2f", gpuTimeAverage * 1000))ms, budget \(String(format: "%.1f", frameBudget * 1000))ms)")
+        #endif
+        level = newLevel
+        stepCount += 1
+        resetCounters()
+        cooldownFrames = cooldownAfterStep
+    }
+
+    private func resetCounters() {
+        overBudgetFrames = 0
+        underBudgetFrames = 0
+    }
+}
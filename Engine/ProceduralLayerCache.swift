@@ -0,0 +1,245 @@
+// ProceduralLayerCache.swift
+// Film Camera - Static procedural layers baked once per seed
+// ★★★ NEW: Light leak + dust/scratches không còn dựng lại cấu trúc procedural mỗi pixel mỗi frame ★★★
+
+import Foundation
+import Metal
+
+/// Position-only part of the light leak and overlays shaders, cached per seed
+///
+/// - Light leak: shape, falloff, depth layers, organic noise → rgba16Float (rgb = màu, a = intensity × opacity),
+///   long side leakDimension (field mượt, bilinear đủ); composite pass chỉ còn flicker (time) + blend
+/// - Overlays: dust cells + scratch lines → rg16Float (r = dust, g = scratch), long side ≤ overlaysMaxDimension
+///   (scratch rộng ~1px → giữ gần full res); composite chỉ còn blend
+/// - Key = các field bake dùng (BakeKey), không gồm field composite (time, flicker, blend, dust/scratch opacity)
+///   → FilmConditionConfig đổi seed (config.seed) / slider đổi shape = key mới = bake lại
+/// - Bake trên command buffer riêng của queue caller, commit ngay → render cùng queue (commit sau)
+///   dùng layer luôn từ frame đầu; queue khác nhận nil (đường tính trực tiếp) tới khi bake xong
+final class ProceduralLayerCache {
+
+    private enum Kind: UInt8 {
+        case lightLeak = 1
+        case overlays = 2
+    }
+
+    private struct Entry {
+        let texture: MTLTexture
+        let queue: MTLCommandQueue
+        var ready: Bool
+        var lastUsed: UInt64
+    }
+
+    private let device: MTLDevice
+
+    private var lightLeakPipeline: MTLComputePipelineState?
+    private var overlaysPipeline: MTLComputePipelineState?
+
+    private var entries: [Data: Entry] = [:]
+    private var useCounter: UInt64 = 0
+    private var bakeCount: Int = 0
+    private let lock = NSLock()
+
+    /// Long side of the light leak layer (256 × 192 rgba16Float ≈ 384 KB)
+    var leakDimension: Int = 256
+
+    /// Long side cap of the dust & scratch layer (2048 × 1536 rg16Float ≈ 12 MB)
+    var overlaysMaxDimension: Int = 2048
+
+    /// Layers kept (preview + capture size của vài preset / seed gần đây)
+    var maxEntries: Int = 6
+
+    init(device: MTLDevice, library: MTLLibrary) {
+        self.device = device
+
+        lightLeakPipeline = makeComputePipeline(library: library, name: "bakeLightLeakLayerKernel")
+        overlaysPipeline = makeComputePipeline(library: library, name: "bakeOverlaysLayerKernel")
+    }
+
+    // MARK: - Access
+
+    /// Leak layer for an image of imageWidth × imageHeight, nil → lightLeakFragment tính trực tiếp
+    func lightLeakLayer(for params: LightLeakParams, imageWidth: Int, imageHeight: Int, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = lightLeakPipeline, params.enabled != 0 else { return nil }
+
+        // Composite-only fields không thuộc key → flicker / đổi blend mode không bake lại
+        var keyParams = params
+        keyParams.time = 0
+        keyParams.temporalEnabled = 0
+        keyParams.flickerSpeed = 0
+        keyParams.flickerIntensity = 0
+        keyParams.blendMode = 0
+
+        let size = Self.layerSize(width: imageWidth, height: imageHeight, maxDimension: leakDimension)
+        var key = BakeKey(Kind.lightLeak.rawValue)
+        key.add(keyParams.leakType, keyParams.falloffType, keyParams.depthLayers)
+        key.add(keyParams.opacity, keyParams.size, keyParams.softness, keyParams.warmth, keyParams.saturation,
+                keyParams.hueShift, keyParams.falloffDecay, keyParams.depthFalloff)
+        key.add(keyParams.seed)
+        key.add(UInt32(size.width), UInt32(size.height))
+
+        return lookup(key.data, size: size, pixelFormat: .rgba16Float, commandBuffer: commandBuffer) { encoder, texture in
+            encoder.setComputePipelineState(pipeline)
+            encoder.setTexture(texture, index: 0)
+            encoder.setBytes(&keyParams, length: MemoryLayout<LightLeakParams>.stride, index: 0)
+            Self.dispatch(encoder, pipeline: pipeline, texture: texture)
+        }
+    }
+
+    /// Dust & scratch layer, nil → overlaysFragment tính trực tiếp
+    /// Caller không gọi khi seed chỉ dùng 1 lần (config.animate, capture seed) — mỗi frame sẽ là 1 bake mới —
+    /// hay khi ảnh lớn hơn overlaysMaxDimension (layer thu nhỏ làm mờ dust / scratch)
+    func overlaysLayer(for params: OverlaysParams, imageWidth: Int, imageHeight: Int, whiteNoise: MTLTexture?, commandBuffer: MTLCommandBuffer) -> MTLTexture? {
+        guard let pipeline = overlaysPipeline, let whiteNoise = whiteNoise, params.enabled != 0 else { return nil }
+
+        var keyParams = params
+        keyParams.dustOpacity = 0
+        keyParams.dustBlendMode = 0
+        keyParams.scratchOpacity = 0
+        keyParams.scratchBlendMode = 0
+
+        let size = Self.layerSize(width: imageWidth, height: imageHeight, maxDimension: overlaysMaxDimension)
+        var key = BakeKey(Kind.overlays.rawValue)
+        key.add(keyParams.dustEnabled, keyParams.scratchEnabled, keyParams.scratchVertical)
+        key.add(keyParams.dustDensity, keyParams.dustSize, keyParams.dustVariation, keyParams.dustClumping,
+                keyParams.scratchDensity, keyParams.scratchLength, keyParams.scratchWidth, keyParams.scratchAngle,
+                keyParams.aspectRatio)
+        key.add(keyParams.seed)
+        key.add(UInt32(size.width), UInt32(size.height))
+
+        return lookup(key.data, size: size, pixelFormat: .rg16Float, commandBuffer: commandBuffer) { encoder, texture in
+            encoder.setComputePipelineState(pipeline)
+            encoder.setTexture(texture, index: 0)
+            encoder.setTexture(whiteNoise, index: Int(TextureIndexNoise.rawValue))
+            encoder.setBytes(&keyParams, length: MemoryLayout<OverlaysParams>.stride, index: 0)
+            Self.dispatch(encoder, pipeline: pipeline, texture: texture)
+        }
+    }
+
+    // MARK: - Maintenance
+
+    func purge() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        entries.removeAll()
+    }
+
+    /// Get cache statistics for debugging
+    func statistics() -> (entries: Int, ready: Int, bakes: Int, bytes: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        return (entries.count, entries.values.filter { $0.ready }.count, bakeCount, entries.values.reduce(0) { $0 + $1.texture.allocatedSize })
+    }
+
+    // MARK: - Private
+
+    /// Layer size giữ aspect của ảnh, long side = min(ảnh, maxDimension)
+    private static func layerSize(width: Int, height: Int, maxDimension: Int) -> (width: Int, height: Int) {
+        let longSide = max(width, height, 1)
+        guard longSide > maxDimension else { return (max(width, 1), max(height, 1)) }
+
+        let scale = Double(maxDimension) / Double(longSide)
+        return (max(1, Int((Double(width) * scale).rounded())), max(1, Int((Double(height) * scale).rounded())))
+    }
+
+    private static func dispatch(_ encoder: MTLComputeCommandEncoder, pipeline: MTLComputePipelineState, texture: MTLTexture) {
+        let width = pipeline.threadExecutionWidth
+        let height = max(pipeline.maxTotalThreadsPerThreadgroup / width, 1)
+        let groups = MTLSize(
+            width: (texture.width + width - 1) / width,
+            height: (texture.height + height - 1) / height,
+            depth: 1
+        )
+        encoder.dispatchThreadgroups(groups, threadsPerThreadgroup: MTLSize(width: width, height: height, depth: 1))
+    }
+
+    private func makeComputePipeline(library: MTLLibrary, name: String) -> MTLComputePipelineState? {
+        do {
+            // Shader dùng function constants → phải tạo qua constantValues (rỗng = generic)
+            let function = try library.makeFunction(name: name, constantValues: MTLFunctionConstantValues())
+            return try device.makeComputePipelineState(function: function)
+        } catch {
+            print("⚠️ ProceduralLayerCache: \(name) unavailable, layer stays per-pixel: \(error.localizedDescription)")
+            return nil
+        }
+    }
+
+    /// Layer for key (đang bake trên cùng queue cũng dùng được), or start a bake on commandBuffer's queue
+    private func lookup(
+        _ key: Data,
+        size: (width: Int, height: Int),
+        pixelFormat: MTLPixelFormat,
+        commandBuffer: MTLCommandBuffer,
+        encode: (MTLComputeCommandEncoder, MTLTexture) -> Void
+    ) -> MTLTexture? {
+        let queue = commandBuffer.commandQueue
+
+        lock.lock()
+        useCounter += 1
+        if var entry = entries[key] {
+            entry.lastUsed = useCounter
+            entries[key] = entry
+            lock.unlock()
+            // Bake đã commit trước command buffer này trên cùng queue → GPU chạy bake trước
+            return entry.ready || entry.queue === queue ? entry.texture : nil
+        }
+
+        let descriptor = MTLTextureDescriptor.texture2DDescriptor(pixelFormat: pixelFormat, width: size.width, height: size.height, mipmapped: false)
+        descriptor.usage = [.shaderRead, .shaderWrite]
+        descriptor.storageMode = .private
+
+        guard let texture = device.makeTexture(descriptor: descriptor),
+              let bakeBuffer = queue.makeCommandBuffer(),
+              let encoder = bakeBuffer.makeComputeCommandEncoder() else {
+            lock.unlock()
+            print("❌ ProceduralLayerCache: Failed to start bake")
+            return nil
+        }
+        texture.label = pixelFormat == .rg16Float ? "OverlaysLayer" : "LightLeakLayer"
+        bakeBuffer.label = "ProceduralLayerBake"
+        entries[key] = Entry(texture: texture, queue: queue, ready: false, lastUsed: useCounter)
+        bakeCount += 1
+        evictToLimit()
+        lock.unlock()
+
+        #if DEBUG
+        let startTime = CFAbsoluteTimeGetCurrent()
+        #endif
+        encode(encoder, texture)
+        encoder.endEncoding()
+
+        bakeBuffer.addCompletedHandler { [weak self] buffer in
+            guard let self = self else { return }
+
+            self.lock.lock()
+            if buffer.error == nil, var entry = self.entries[key], entry.texture === texture {
+                entry.ready = true
+                self.entries[key] = entry
+            } else {
+                self.entries.removeValue(forKey: key)
+            }
+            self.lock.unlock()
+
+            if let error = buffer.error {
+                print("❌ ProceduralLayerCache: Bake failed - \(error.localizedDescription)")
+            }
+
+            #if DEBUG
+            let elapsed = (CFAbsoluteTimeGetCurrent() - startTime) * 1000
+            print("🎨 ProceduralLayerCache: Baked \(texture.label ?? "layer") \(texture.width)×\(texture.height) in \(String(format: "%.1f", elapsed))ms")
+            #endif
+        }
+        bakeBuffer.commit()
+
+        return texture
+    }
+
+    /// Drop least-recently-used entries above maxEntries (lock held)
+    private func evictToLimit() {
+        while entries.count > maxEntries,
+              let victim = entries.min(by: { $0.value.lastUsed < $1.value.lastUsed }) {
+            entries.removeValue(forKey: victim.key)
+        }
+    }
+}
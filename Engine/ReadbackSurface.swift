@@ -0,0 +1,210 @@
+// ReadbackSurface.swift
+// Film Camera - Zero-copy GPU → CGImage readback
+// ★★★ NEW: Replaces getBytes + CPU BGRA→RGBA swap in textureToCGImage ★★★
+
+import Foundation
+import Metal
+import CoreVideo
+import CoreGraphics
+
+/// IOSurface-backed BGRA pixel buffer + Metal texture view of the same memory
+///
+/// - Render graph's final pass renders straight into `texture`
+/// - makeCGImage() wraps the pixel buffer bytes (BGRA little-endian, không cần swap)
+/// - CGImage giữ pixel buffer alive; buffer trả về pool khi CGImage được release
+final class ReadbackSurface {
+
+    let pixelBuffer: CVPixelBuffer
+    let texture: MTLTexture
+
+    /// Keeps the Metal view valid while the GPU writes into it
+    private let metalTexture: CVMetalTexture
+
+    fileprivate init(pixelBuffer: CVPixelBuffer, metalTexture: CVMetalTexture, texture: MTLTexture) {
+        self.pixelBuffer = pixelBuffer
+        self.metalTexture = metalTexture
+        self.texture = texture
+    }
+
+    var width: Int { return CVPixelBufferGetWidth(pixelBuffer) }
+    var height: Int { return CVPixelBufferGetHeight(pixelBuffer) }
+
+    /// Wrap the rendered pixels as a CGImage without copying
+    /// Call only after the command buffer writing `texture` has completed
+    func makeCGImage() -> CGImage? {
+        guard CVPixelBufferLockBaseAddress(pixelBuffer, .readOnly) == kCVReturnSuccess else {
+            print("❌ ReadbackSurface: Failed to lock pixel buffer")
+            return nil
+        }
+
+        guard let baseAddress = CVPixelBufferGetBaseAddress(pixelBuffer) else {
+            CVPixelBufferUnlockBaseAddress(pixelBuffer, .readOnly)
+            return nil
+        }
+
+        let bytesPerRow = CVPixelBufferGetBytesPerRow(pixelBuffer)  // Có thể có padding → dùng đúng stride
+        let height = CVPixelBufferGetHeight(pixelBuffer)
+
+        // Provider owns one retain + the read lock; released when the CGImage dies
+        let retained = Unmanaged.passRetained(pixelBuffer)
+        guard let provider = CGDataProvider(
+            dataInfo: retained.toOpaque(),
+            data: baseAddress,
+            size: bytesPerRow * height,
+            releaseData: { info, _, _ in
+                guard let info = info else { return }
+                let buffer = Unmanaged<CVPixelBuffer>.fromOpaque(info).takeRetainedValue()
+                CVPixelBufferUnlockBaseAddress(buffer, .readOnly)
+            }
+        ) else {
+            CVPixelBufferUnlockBaseAddress(pixelBuffer, .readOnly)
+            retained.release()
+            print("❌ ReadbackSurface: Failed to create CGDataProvider")
+            return nil
+        }
+
+        // ★ BGRA in memory = 32-bit little-endian ARGB → CoreGraphics/ImageIO đọc trực tiếp
+        // Alpha luôn = 1 sau pipeline → noneSkipFirst (encoder không cần ghi alpha plane)
+        let bitmapInfo = CGBitmapInfo(rawValue: CGImageAlphaInfo.noneSkipFirst.rawValue)
+            .union(.byteOrder32Little)
+
+        return CGImage(
+            width: width,
+            height: height,
+            bitsPerComponent: 8,
+            bitsPerPixel: 32,
+            bytesPerRow: bytesPerRow,
+            space: CGColorSpaceCreateDeviceRGB(),
+            bitmapInfo: bitmapInfo,
+            provider: provider,
+            decode: nil,
+            shouldInterpolate: false,
+            intent: .defaultIntent
+        )
+    }
+}
+
+/// Recycles IOSurface-backed BGRA pixel buffers for readback targets
+/// One CVPixelBufferPool per output size (capture size gần như cố định → 1-2 pool)
+final class ReadbackSurfacePool {
+
+    private struct SizeKey: Hashable {
+        let width: Int
+        let height: Int
+    }
+
+    private let device: MTLDevice
+    private var textureCache: CVMetalTextureCache?
+    private var pools: [SizeKey: CVPixelBufferPool] = [:]
+    private var poolOrder: [SizeKey] = []
+    private let lock = NSLock()
+
+    /// Distinct output sizes kept pooled (oldest pool dropped above this)
+    var maxPoolCount: Int = 2
+
+    init(device: MTLDevice) {
+        self.device = device
+
+        var cache: CVMetalTextureCache?
+        if CVMetalTextureCacheCreate(kCFAllocatorDefault, nil, device, nil, &cache) == kCVReturnSuccess {
+            textureCache = cache
+        } else {
+            print("⚠️ ReadbackSurfacePool: Failed to create CVMetalTextureCache, readback falls back to getBytes")
+        }
+    }
+
+    /// Get a render-target surface of the given size (nil → caller falls back to a plain texture)
+    func makeSurface(width: Int, height: Int) -> ReadbackSurface? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard let textureCache = textureCache,
+              let pool = pool(for: SizeKey(width: width, height: height)) else {
+            return nil
+        }
+
+        var pixelBuffer: CVPixelBuffer?
+        guard CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, pool, &pixelBuffer) == kCVReturnSuccess,
+              let buffer = pixelBuffer else {
+            print("❌ ReadbackSurfacePool: Failed to create \(width)x\(height) pixel buffer")
+            return nil
+        }
+
+        // ★ Render target usage: final pass của render graph ghi thẳng vào IOSurface
+        let textureAttributes = [
+            kCVMetalTextureUsage as String: NSNumber(value: MTLTextureUsage([.shaderRead, .renderTarget]).rawValue)
+        ] as CFDictionary
+
+        var metalTexture: CVMetalTexture?
+        guard CVMetalTextureCacheCreateTextureFromImage(
+            kCFAllocatorDefault,
+            textureCache,
+            buffer,
+            textureAttributes,
+            .bgra8Unorm,
+            width,
+            height,
+            0,
+            &metalTexture
+        ) == kCVReturnSuccess,
+              let cvTexture = metalTexture,
+              let texture = CVMetalTextureGetTexture(cvTexture) else {
+            print("❌ ReadbackSurfacePool: Failed to wrap pixel buffer as Metal texture")
+            return nil
+        }
+
+        return ReadbackSurface(pixelBuffer: buffer, metalTexture: cvTexture, texture: texture)
+    }
+
+    /// Drop pooled buffers (buffers still held by CGImages stay alive until released)
+    func purge() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        pools.removeAll()
+        poolOrder.removeAll()
+        if let textureCache = textureCache {
+            CVMetalTextureCacheFlush(textureCache, 0)
+        }
+    }
+
+    // MARK: - Private
+
+    /// Must be called with lock held
+    private func pool(for key: SizeKey) -> CVPixelBufferPool? {
+        if let existing = pools[key] {
+            poolOrder.removeAll { $0 == key }
+            poolOrder.append(key)
+            return existing
+        }
+
+        let pixelBufferAttributes: [String: Any] = [
+            kCVPixelBufferPixelFormatTypeKey as String: kCVPixelFormatType_32BGRA,
+            kCVPixelBufferWidthKey as String: key.width,
+            kCVPixelBufferHeightKey as String: key.height,
+            kCVPixelBufferIOSurfacePropertiesKey as String: [String: Any](),
+            kCVPixelBufferMetalCompatibilityKey as String: true,
+            kCVPixelBufferCGImageCompatibilityKey as String: true,
+            kCVPixelBufferCGBitmapContextCompatibilityKey as String: true
+        ]
+
+        var pool: CVPixelBufferPool?
+        guard CVPixelBufferPoolCreate(kCFAllocatorDefault, nil, pixelBufferAttributes as CFDictionary, &pool) == kCVReturnSuccess,
+              let created = pool else {
+            print("❌ ReadbackSurfacePool: Failed to create pixel buffer pool \(key.width)x\(key.height)")
+            return nil
+        }
+
+        pools[key] = created
+        poolOrder.append(key)
+        while poolOrder.count > maxPoolCount {
+            pools.removeValue(forKey: poolOrder.removeFirst())
+        }
+
+        #if DEBUG
+        print("✅ ReadbackSurfacePool: Created \(key.width)x\(key.height) BGRA pool")
+        #endif
+
+        return created
+    }
+}
@@ -5,6 +5,7 @@
 import Foundation
 import Metal
 import MetalKit
+import UIKit
 
 /// Singleton Metal rendering engine
 class RenderEngine {
@@ -55,72 +56,130 @@ class RenderEngine {
     let commandQueue: MTLCommandQueue
     let library: MTLLibrary
     let texturePool: TexturePool
+
+    // ★★★ NEW: Specialized pipeline variants (function constants) ★★★
+    let pipelineVariants: PipelineVariantCache
+
+    // ★★★ NEW: Per-format / shader I/O pipeline variants (linear half-float intermediates) ★★★
+    let pipelineFormats: PipelineFormatCache
+
+    // ★★★ NEW: Persistent binary archive (launch 2+ không compile lại pipeline) ★★★
+    let pipelineArchive: PipelineArchive
+
+    // ★★★ NEW: Pipelines ngoài critical path - build song song ở background, get-or-build khi truy cập ★★★
+    private let deferredSlots: [DeferredPipeline: DeferredPipelineSlot]
+    private var passthroughVertex: MTLFunction?
     
-    // Core Pipeline States
+    // Core Pipeline States (built synchronously - first viewfinder frame)
     private(set) var colorGradingPipeline: MTLRenderPipelineState?
     private(set) var vignettePipeline: MTLRenderPipelineState?
     private(set) var grainPipeline: MTLRenderPipelineState?
     private(set) var instantFramePipeline: MTLRenderPipelineState?
-    private(set) var lensDistortionPipeline: MTLRenderPipelineState?
+    var lensDistortionPipeline: MTLRenderPipelineState? { return deferredPipeline(.lensDistortion) }
     
     // Legacy single-pass (for fallback)
     private(set) var bloomPipeline: MTLRenderPipelineState?
-    private(set) var halationPipeline: MTLRenderPipelineState?
+    var halationPipeline: MTLRenderPipelineState? { return deferredPipeline(.halation) }
     
     // Separable Bloom Pipeline (4 passes)
-    private(set) var bloomThresholdPipeline: MTLRenderPipelineState?
-    private(set) var bloomHorizontalPipeline: MTLRenderPipelineState?
-    private(set) var bloomVerticalPipeline: MTLRenderPipelineState?
-    private(set) var bloomCompositePipeline: MTLRenderPipelineState?
+    var bloomThresholdPipeline: MTLRenderPipelineState? { return deferredPipeline(.bloomThreshold) }
+    var bloomHorizontalPipeline: MTLRenderPipelineState? { return deferredPipeline(.bloomHorizontal) }
+    var bloomVerticalPipeline: MTLRenderPipelineState? { return deferredPipeline(.bloomVertical) }
+    var bloomCompositePipeline: MTLRenderPipelineState? { return deferredPipeline(.bloomComposite) }
     
     // Separable Halation Pipeline (4 passes)
-    private(set) var halationThresholdPipeline: MTLRenderPipelineState?
-    private(set) var halationHorizontalPipeline: MTLRenderPipelineState?
-    private(set) var halationVerticalPipeline: MTLRenderPipelineState?
-    private(set) var halationCompositePipeline: MTLRenderPipelineState?
+    var halationThresholdPipeline: MTLRenderPipelineState? { return deferredPipeline(.halationThreshold) }
+    var halationHorizontalPipeline: MTLRenderPipelineState? { return deferredPipeline(.halationHorizontal) }
+    var halationVerticalPipeline: MTLRenderPipelineState? { return deferredPipeline(.halationVertical) }
+    var halationCompositePipeline: MTLRenderPipelineState? { return deferredPipeline(.halationComposite) }
+    
+    // ★★★ NEW: Dual-filter Blur Pyramid (rgba16Float mips, capture bloom/halation) ★★★
+    var bloomPyramidThresholdPipeline: MTLRenderPipelineState? { return deferredPipeline(.bloomPyramidThreshold) }
+    var halationPyramidThresholdPipeline: MTLRenderPipelineState? { return deferredPipeline(.halationPyramidThreshold) }
+    var sharedPyramidThresholdPipeline: MTLRenderPipelineState? { return deferredPipeline(.sharedPyramidThreshold) }
+    var pyramidDownsamplePipeline: MTLRenderPipelineState? { return deferredPipeline(.pyramidDownsample) }
+    var pyramidUpsamplePipeline: MTLRenderPipelineState? { return deferredPipeline(.pyramidUpsample) }
+    var halationPyramidCompositePipeline: MTLRenderPipelineState? { return deferredPipeline(.halationPyramidComposite) }
+
+    /// Pixel format of blur pyramid mips (linear light → cần > 8 bit để không banding)
+    static let pyramidPixelFormat: MTLPixelFormat = .rgba16Float
     
     // Tone Mapping
-    private(set) var toneMappingPipeline: MTLRenderPipelineState?
+    var toneMappingPipeline: MTLRenderPipelineState? { return deferredPipeline(.toneMapping) }
 
     // ★★★ NEW: Aspect-Fill Scaling Pipeline ★★★
     private(set) var aspectFillScalePipeline: MTLRenderPipelineState?
 
+    // ★★★ NEW: YUV (420f) camera input → RGB, aspect-fill ★★★
+    private(set) var yuvConvertPipeline: MTLRenderPipelineState?
+
     // ★★★ NEW: Flash Effect Pipeline ★★★
-    private(set) var flashPipeline: MTLRenderPipelineState?
+    var flashPipeline: MTLRenderPipelineState? { return deferredPipeline(.flash) }
 
     // ★★★ NEW: Light Leak Effect Pipeline ★★★
-    private(set) var lightLeakPipeline: MTLRenderPipelineState?
+    var lightLeakPipeline: MTLRenderPipelineState? { return deferredPipeline(.lightLeak) }
+    var lightLeakCompositePipeline: MTLRenderPipelineState? { return deferredPipeline(.lightLeakComposite) }
 
     // ★★★ NEW: Date Stamp Effect Pipeline ★★★
-    private(set) var dateStampPipeline: MTLRenderPipelineState?
+    var dateStampPipeline: MTLRenderPipelineState? { return deferredPipeline(.dateStamp) }
 
     // ★★★ NEW: CCD Bloom Effect Pipeline ★★★
-    private(set) var ccdBloomPipeline: MTLRenderPipelineState?
+    var ccdBloomPipeline: MTLRenderPipelineState? { return deferredPipeline(.ccdBloom) }
 
     // ★★★ NEW: Black & White Pipeline ★★★
-    private(set) var bwPipeline: MTLRenderPipelineState?
+    var bwPipeline: MTLRenderPipelineState? { return deferredPipeline(.bw) }
 
     // ★★★ NEW: Overlays Pipeline (Dust & Scratches) ★★★
-    private(set) var overlaysPipeline: MTLRenderPipelineState?
+    var overlaysPipeline: MTLRenderPipelineState? { return deferredPipeline(.overlays) }
+    var overlaysCompositePipeline: MTLRenderPipelineState? { return deferredPipeline(.overlaysComposite) }
 
     // ★★★ NEW: VHS Effects Pipeline ★★★
-    private(set) var vhsEffectsPipeline: MTLRenderPipelineState?
+    var vhsEffectsPipeline: MTLRenderPipelineState? { return deferredPipeline(.vhsEffects) }
 
     // ★★★ NEW: Digicam Effects Pipeline ★★★
-    private(set) var digicamEffectsPipeline: MTLRenderPipelineState?
+    var digicamEffectsPipeline: MTLRenderPipelineState? { return deferredPipeline(.digicamEffects) }
 
     // ★★★ NEW: Film Strip Pipeline ★★★
-    private(set) var filmStripPipeline: MTLRenderPipelineState?
+    var filmStripPipeline: MTLRenderPipelineState? { return deferredPipeline(.filmStrip) }
 
     // ★★★ NEW: Skin Tone Protection Pipeline ★★★
-    private(set) var skinToneProtectionPipeline: MTLRenderPipelineState?
+    var skinToneProtectionPipeline: MTLRenderPipelineState? { return deferredPipeline(.skinToneProtection) }
+
+    // ★★★ NEW: Fused Preview Pipeline (uber-shader cho live viewfinder) ★★★
+    private(set) var fusedPreviewPipeline: MTLRenderPipelineState?
+
+    // ★★★ NEW: sRGB boundary passes for linear intermediates ★★★
+    var srgbEncodePipeline: MTLRenderPipelineState? { return deferredPipeline(.srgbEncode) }
+    var srgbDecodePipeline: MTLRenderPipelineState? { return deferredPipeline(.srgbDecode) }
+
+    // ★★★ NEW: Baked color lookups (ColorLUTBaker) ★★★
+    var colorGradingBakedPipeline: MTLRenderPipelineState? { return deferredPipeline(.colorGradingBaked) }
+    var bwBakedPipeline: MTLRenderPipelineState? { return deferredPipeline(.bwBaked) }
+
+    // ★★★ NEW: LUT textures - lazy, prioritized residency with eviction ★★★
+    let lutResidency: LUTResidencyManager
 
-    // LUT textures cache
-    private var lutCache: [String: MTLTexture] = [:]
-    private let lutCacheLock = NSLock()
+    // ★★★ NEW: IOSurface-backed readback targets (zero-copy CGImage) ★★★
+    let readbackSurfaces: ReadbackSurfacePool
+
+    // ★★★ NEW: Color grading / B&W tone baked into lookup textures ★★★
+    let colorLUTBaker: ColorLUTBaker
+
+    // ★★★ NEW: Light leak / dust & scratch static layers baked per seed ★★★
+    let proceduralLayers: ProceduralLayerCache
+
+    // ★★★ NEW: Shared tileable noise (grain, dust, digicam, VHS) ★★★
+    let noiseTextures: NoiseTextureAtlas
+
+    // ★★★ NEW: Compute neighbourhood kernels (threadgroup tile + apron) ★★★
+    let computeKernels: ComputeKernelCache
     
-    // Reusable FilterRenderer for photo processing
-    private var photoFilterRenderer: FilterRenderer?
+    // ★★★ NEW: Per-stream command queues + transient pools (preview, recording, capture) ★★★
+    private var streams: [RenderStream.Role: RenderStream]
+    private let streamsLock = NSLock()
+
+    // Idle FilterRenderers for photo processing (1 renderer / concurrent applyFilter call)
+    private var idlePhotoRenderers: [FilterRenderer] = []
     private let filterRendererLock = NSLock()
     
     // Texture loader for thread-safe texture creation
@@ -128,7 +187,16 @@ class RenderEngine {
     
     // ★★★ NEW: Track initialization status ★★★
     private(set) var isInitialized = false
-    private(set) var initializationErrors: [String] = []
+
+    // Deferred pipelines báo lỗi từ background threads → guarded
+    private var errors: [String] = []
+    private let errorsLock = NSLock()
+
+    var initializationErrors: [String] {
+        errorsLock.lock()
+        defer { errorsLock.unlock() }
+        return errors
+    }
     
     // ★★★ FIX: Failable init to handle errors gracefully ★★★
     private init?() {
@@ -150,13 +218,57 @@ class RenderEngine {
         }
         self.library = library
 
-        self.texturePool = TexturePool(device: device)
+        let texturePool = TexturePool(device: device)
+        texturePool.memoryBudget = RenderStream.Role.preview.memoryBudget
+        self.texturePool = texturePool
+        self.streams = [.preview: RenderStream(role: .preview, commandQueue: commandQueue, texturePool: texturePool)]
         self.textureLoader = MTKTextureLoader(device: device)
+        self.pipelineArchive = PipelineArchive(device: device)
+        self.deferredSlots = Dictionary(uniqueKeysWithValues: DeferredPipeline.allCases.map { ($0, DeferredPipelineSlot()) })
+        self.pipelineVariants = PipelineVariantCache(device: device, library: library, archive: pipelineArchive)
+        self.pipelineFormats = PipelineFormatCache(device: device, library: library, archive: pipelineArchive)
+        self.lutResidency = LUTResidencyManager(device: device)
+        self.readbackSurfaces = ReadbackSurfacePool(device: device)
+        self.colorLUTBaker = ColorLUTBaker(device: device, library: library, commandQueue: commandQueue)
+        self.proceduralLayers = ProceduralLayerCache(device: device, library: library)
+        self.noiseTextures = NoiseTextureAtlas(device: device)
+        self.computeKernels = ComputeKernelCache(device: device, library: library, archive: pipelineArchive)
 
         print("✅ RenderEngine: Core initialization successful")
 
+        let setupStart = CFAbsoluteTimeGetCurrent()
         setupPipelines()
         validatePipelines()
+
+        let archive = pipelineArchive.statistics()
+        print("✅ RenderEngine: Critical pipelines ready in \(String(format: "%.0f", (CFAbsoluteTimeGetCurrent() - setupStart) * 1000))ms (archive: \(archive.hits) hits, \(archive.misses) compiled)")
+        StartupMetrics.shared.mark(.engineReady)
+
+        warmUpDeferredPipelines()
+        setupMemoryWarningObserver()
+    }
+
+    /// Memory warning → every stream drops cached transients + procedural layers (rebuilt on the next frame)
+    private func setupMemoryWarningObserver() {
+        NotificationCenter.default.addObserver(
+            forName: UIApplication.didReceiveMemoryWarningNotification,
+            object: nil,
+            queue: nil
+        ) { [weak self] _ in
+            guard let self = self else { return }
+
+            self.streamsLock.lock()
+            let pools = self.streams.values.reduce(into: [TexturePool]()) { pools, stream in
+                if !pools.contains(where: { $0 === stream.texturePool }) {
+                    pools.append(stream.texturePool)
+                }
+            }
+            self.streamsLock.unlock()
+
+            pools.forEach { $0.purge() }
+            self.proceduralLayers.purge()
+            print("⚠️ RenderEngine: Memory warning - purged \(pools.count) texture pools")
+        }
     }
     
     // MARK: - Pipeline Setup
@@ -169,7 +281,7 @@ class RenderEngine {
         if vertexFunction == nil {
             let error = "Failed to load vertexPassthrough function"
             print("❌ RenderEngine: \(error)")
-            initializationErrors.append(error)
+            recordError(error)
         } else {
             print("✅ RenderEngine: Loaded vertexPassthrough")
         }
@@ -180,111 +292,151 @@ class RenderEngine {
         // Note: Can't enumerate functions directly, but we'll see which ones fail
         #endif
 
-        // Core Pipelines
-        colorGradingPipeline = createPipeline(vertex: vertexFunction, fragmentName: "colorGradingFragment")
-        vignettePipeline = createPipeline(vertex: vertexFunction, fragmentName: "vignetteFragment")
-        grainPipeline = createPipeline(vertex: vertexFunction, fragmentName: "grainFragment")
-        instantFramePipeline = createPipeline(vertex: vertexFunction, fragmentName: "instantFrameFragment")
-        lensDistortionPipeline = createPipeline(vertex: vertexFunction, fragmentName: "lensDistortionFragment")
-        
-        // Legacy single-pass (fallback)
-        bloomPipeline = createPipeline(vertex: vertexFunction, fragmentName: "bloomFragment")
-        halationPipeline = createPipeline(vertex: vertexFunction, fragmentName: "halationFragment")
-        
-        // Separable Bloom Pipeline
-        bloomThresholdPipeline = createPipeline(vertex: vertexFunction, fragmentName: "bloomThresholdFragment")
-        bloomHorizontalPipeline = createPipeline(vertex: vertexFunction, fragmentName: "bloomHorizontalFragment")
-        bloomVerticalPipeline = createPipeline(vertex: vertexFunction, fragmentName: "bloomVerticalFragment")
-        bloomCompositePipeline = createPipelineWithTwoTextures(vertex: vertexFunction, fragmentName: "bloomCompositeFragment")
-        
-        // Separable Halation Pipeline
-        halationThresholdPipeline = createPipeline(vertex: vertexFunction, fragmentName: "halationThresholdFragment")
-        halationHorizontalPipeline = createPipeline(vertex: vertexFunction, fragmentName: "halationHorizontalFragment")
-        halationVerticalPipeline = createPipeline(vertex: vertexFunction, fragmentName: "halationVerticalFragment")
-        halationCompositePipeline = createPipelineWithTwoTextures(vertex: vertexFunction, fragmentName: "halationCompositeFragment")
-        
-        // Tone Mapping
-        toneMappingPipeline = createPipeline(vertex: vertexFunction, fragmentName: "toneMappingFragment")
-
-        // ★★★ NEW: Aspect-Fill Scaling Pipeline ★★★
-        // Uses vertexAspectFill for aspect-correct scaling
-        aspectFillScalePipeline = createAspectFillPipeline(fragmentName: "colorGradingFragment")
-
-        // ★★★ NEW: Flash Effect Pipeline ★★★
-        flashPipeline = createPipeline(vertex: vertexFunction, fragmentName: "flashFragment")
-
-        // ★★★ NEW: Light Leak Effect Pipeline ★★★
-        lightLeakPipeline = createPipeline(vertex: vertexFunction, fragmentName: "lightLeakFragment")
-
-        // ★★★ NEW: Date Stamp Effect Pipeline ★★★
-        dateStampPipeline = createPipeline(vertex: vertexFunction, fragmentName: "dateStampFragment")
-
-        // ★★★ NEW: CCD Bloom Effect Pipeline ★★★
-        ccdBloomPipeline = createPipeline(vertex: vertexFunction, fragmentName: "ccdBloomFragment")
+        passthroughVertex = vertexFunction
+
+        // ★ Chỉ pipeline của frame viewfinder đầu tiên build đồng bộ (song song trên mọi core)
+        // Phần còn lại (DeferredPipeline) build ở background ngay sau init
+        let builders: [() -> MTLRenderPipelineState?] = [
+            // Core Pipelines
+            { self.createPipeline(vertex: vertexFunction, fragmentName: "colorGradingFragment") },
+            { self.createPipeline(vertex: vertexFunction, fragmentName: "vignetteFragment") },
+            { self.createPipeline(vertex: vertexFunction, fragmentName: "grainFragment") },
+            { self.createPipeline(vertex: vertexFunction, fragmentName: "instantFrameFragment") },
+
+            // Legacy single-pass bloom (preview)
+            { self.createPipeline(vertex: vertexFunction, fragmentName: "bloomFragment") },
+
+            // ★★★ NEW: Aspect-Fill Scaling Pipeline ★★★
+            // Uses vertexAspectFill for aspect-correct scaling
+            { self.createAspectFillPipeline(fragmentName: "colorGradingFragment") },
+
+            // ★★★ NEW: YUV Input Pipeline (aspect-fill, replaces Scale for 420f frames) ★★★
+            { self.createAspectFillPipeline(fragmentName: "yuvToRGBFragment") },
+
+            // ★★★ NEW: Fused Preview Pipeline ★★★
+            // Uses vertexAspectFill so the fused pass also replaces the Scale pass
+            { self.createAspectFillPipeline(fragmentName: "fusedPreviewFragment") }
+        ]
+        var critical: [MTLRenderPipelineState?] = Array(repeating: nil, count: builders.count)
+        let criticalLock = NSLock()
+        DispatchQueue.concurrentPerform(iterations: builders.count) { index in
+            let pipeline = builders[index]()
+            criticalLock.lock()
+            critical[index] = pipeline
+            criticalLock.unlock()
+        }
+
+        colorGradingPipeline = critical[0]
+        vignettePipeline = critical[1]
+        grainPipeline = critical[2]
+        instantFramePipeline = critical[3]
+        bloomPipeline = critical[4]
+        aspectFillScalePipeline = critical[5]
+        yuvConvertPipeline = critical[6]
+        fusedPreviewPipeline = critical[7]
+    }
 
-        // ★★★ NEW: Black & White Pipeline ★★★
-        bwPipeline = createPipeline(vertex: vertexFunction, fragmentName: "bwConvertFragment")
+    // MARK: - ★★★ Deferred Pipelines (background warm-up) ★★★
 
-        // ★★★ NEW: Overlays Pipeline (Dust & Scratches) ★★★
-        overlaysPipeline = createPipeline(vertex: vertexFunction, fragmentName: "overlaysFragment")
+    /// Deferred pipeline, built on first access if the warm-up hasn't reached it yet
+    private func deferredPipeline(_ kind: DeferredPipeline) -> MTLRenderPipelineState? {
+        return deferredSlots[kind]?.resolve {
+            createPipeline(vertex: passthroughVertex, fragmentName: kind.fragmentName, pixelFormat: kind.pixelFormat, rendersToTarget: kind.rendersToTarget)
+        }
+    }
 
-        // ★★★ NEW: VHS Effects Pipeline ★★★
-        vhsEffectsPipeline = createPipeline(vertex: vertexFunction, fragmentName: "vhsEffectsFragment")
+    /// Build every deferred pipeline in parallel, then derive linear variants + save the archive
+    private func warmUpDeferredPipelines() {
+        DispatchQueue.global(qos: .utility).async {
+            let startTime = CFAbsoluteTimeGetCurrent()
+            let kinds = DeferredPipeline.allCases
+            DispatchQueue.concurrentPerform(iterations: kinds.count) { index in
+                _ = self.deferredPipeline(kinds[index])
+            }
 
-        // ★★★ NEW: Digicam Effects Pipeline ★★★
-        digicamEffectsPipeline = createPipeline(vertex: vertexFunction, fragmentName: "digicamEffectsFragment")
+            #if DEBUG
+            print("✅ RenderEngine: Built \(kinds.count) deferred pipelines in \(String(format: "%.0f", (CFAbsoluteTimeGetCurrent() - startTime) * 1000))ms")
+            #endif
+            self.printPipelineStatus()
+
+            // ★ Capture mặc định dùng linear rgba16Float intermediates (FilterRenderer.captureIntermediateFormat)
+            // → compile variants nền trước shot đầu tiên; cần mọi base pipeline đã register → sau warm-up
+            self.pipelineFormats.prewarm(mode: ShaderIOMode(linearIntermediates: true), pixelFormat: .rgba16Float) { compiled, elapsed in
+                #if DEBUG
+                print("✅ RenderEngine: Prewarmed \(compiled) linear rgba16Float variants in \(String(format: "%.0f", elapsed * 1000))ms")
+                #endif
+                self.pipelineArchive.serialize()
+            }
+            self.computeKernels.prewarm(mode: ShaderIOMode(linearIntermediates: true)) {
+                self.pipelineArchive.serialize()
+            }
+        }
+    }
 
-        // ★★★ NEW: Film Strip Pipeline ★★★
-        filmStripPipeline = createPipeline(vertex: vertexFunction, fragmentName: "filmStripFragment")
+    /// ★ Deferred pipelines the preset uses → build ngay (userInitiated) thay vì chờ thứ tự warm-up
+    func prewarmPipelines(for preset: FilterPreset) {
+        let kinds = DeferredPipeline.needed(by: preset).filter { deferredSlots[$0]?.isResolved == false }
+        guard !kinds.isEmpty else { return }
 
-        // ★★★ NEW: Skin Tone Protection Pipeline ★★★
-        skinToneProtectionPipeline = createPipeline(vertex: vertexFunction, fragmentName: "skinToneProtectionFragment")
+        DispatchQueue.global(qos: .userInitiated).async {
+            DispatchQueue.concurrentPerform(iterations: kinds.count) { index in
+                _ = self.deferredPipeline(kinds[index])
+            }
+        }
+    }
 
-        printPipelineStatus()
+    private func recordError(_ error: String) {
+        errorsLock.lock()
+        errors.append(error)
+        errorsLock.unlock()
     }
     
-    private func createPipeline(vertex: MTLFunction?, fragmentName: String) -> MTLRenderPipelineState? {
-        guard let fragmentFunction = library.makeFunction(name: fragmentName) else {
+    /// Generic (unspecialized) fragment: không set function constant nào → shader dùng giá trị runtime
+    /// Fragments with function constants must be created via constantValues, even when empty
+    private func makeGenericFragmentFunction(name: String) -> MTLFunction? {
+        return try? library.makeFunction(name: name, constantValues: MTLFunctionConstantValues())
+    }
+
+    /// rendersToTarget: pass ghi thẳng vào target bgra8 (EncodeSRGB) → prewarm không đổi format
+    private func createPipeline(vertex: MTLFunction?, fragmentName: String, pixelFormat: MTLPixelFormat = .bgra8Unorm, rendersToTarget: Bool = false) -> MTLRenderPipelineState? {
+        guard let fragmentFunction = makeGenericFragmentFunction(name: fragmentName) else {
             let error = "\(fragmentName) shader not found in Metal library"
             print("⚠️ RenderEngine: \(error)")
-            initializationErrors.append(error)
+            recordError(error)
             return nil
         }
         
         let descriptor = MTLRenderPipelineDescriptor()
         descriptor.vertexFunction = vertex
         descriptor.fragmentFunction = fragmentFunction
-        descriptor.colorAttachments[0].pixelFormat = .bgra8Unorm
+        descriptor.colorAttachments[0].pixelFormat = pixelFormat
         
         do {
-            let pipeline = try device.makeRenderPipelineState(descriptor: descriptor)
+            let pipeline = try pipelineArchive.makeRenderPipeline(descriptor: descriptor)
+            pipelineFormats.register(pipeline, descriptor: descriptor, fragmentName: fragmentName, rendersToTarget: rendersToTarget)
             print("✅ RenderEngine: \(fragmentName) pipeline created")
             return pipeline
         } catch {
             let errorMsg = "Failed to create \(fragmentName) pipeline: \(error.localizedDescription)"
             print("❌ RenderEngine: \(errorMsg)")
-            initializationErrors.append(errorMsg)
+            recordError(errorMsg)
             return nil
         }
     }
     
-    private func createPipelineWithTwoTextures(vertex: MTLFunction?, fragmentName: String) -> MTLRenderPipelineState? {
-        return createPipeline(vertex: vertex, fragmentName: fragmentName)
-    }
-
     // ★★★ NEW: Create pipeline with aspect-fill vertex shader ★★★
     private func createAspectFillPipeline(fragmentName: String) -> MTLRenderPipelineState? {
         guard let vertexFunction = library.makeFunction(name: "vertexAspectFill") else {
             let error = "vertexAspectFill shader not found in Metal library"
             print("⚠️ RenderEngine: \(error)")
-            initializationErrors.append(error)
+            recordError(error)
             return nil
         }
 
-        guard let fragmentFunction = library.makeFunction(name: fragmentName) else {
+        guard let fragmentFunction = makeGenericFragmentFunction(name: fragmentName) else {
             let error = "\(fragmentName) shader not found for aspect-fill pipeline"
             print("⚠️ RenderEngine: \(error)")
-            initializationErrors.append(error)
+            recordError(error)
             return nil
         }
 
@@ -294,13 +446,14 @@ class RenderEngine {
         descriptor.colorAttachments[0].pixelFormat = .bgra8Unorm
 
         do {
-            let pipeline = try device.makeRenderPipelineState(descriptor: descriptor)
-            print("✅ RenderEngine: aspectFillScale pipeline created")
+            let pipeline = try pipelineArchive.makeRenderPipeline(descriptor: descriptor)
+            pipelineFormats.register(pipeline, descriptor: descriptor, fragmentName: fragmentName)
+            print("✅ RenderEngine: \(fragmentName) (aspect-fill) pipeline created")
             return pipeline
         } catch {
-            let errorMsg = "Failed to create aspectFillScale pipeline: \(error.localizedDescription)"
+            let errorMsg = "Failed to create \(fragmentName) (aspect-fill) pipeline: \(error.localizedDescription)"
             print("❌ RenderEngine: \(errorMsg)")
-            initializationErrors.append(errorMsg)
+            recordError(errorMsg)
             return nil
         }
     }
@@ -341,6 +494,7 @@ class RenderEngine {
         print("═══════════════════════════════════════════════════════════════")
         print("   Core Pipelines:")
         print("      colorGrading:    \(colorGradingPipeline != nil ? "✅" : "❌")")
+        print("      colorGrading (baked): \(colorGradingBakedPipeline != nil ? "✅" : "❌")")
         print("      vignette:        \(vignettePipeline != nil ? "✅" : "❌")")
         print("      grain:           \(grainPipeline != nil ? "✅" : "❌")")
         print("      instantFrame:    \(instantFramePipeline != nil ? "✅" : "❌")")
@@ -360,17 +514,27 @@ class RenderEngine {
         print("      halationVertical:  \(halationVerticalPipeline != nil ? "✅" : "❌")")
         print("      halationComposite: \(halationCompositePipeline != nil ? "✅" : "❌")")
         print("")
+        print("   Blur Pyramid:")
+        print("      bloomThreshold:  \(bloomPyramidThresholdPipeline != nil ? "✅" : "❌")")
+        print("      halationThresh.: \(halationPyramidThresholdPipeline != nil ? "✅" : "❌")")
+        print("      sharedThreshold: \(sharedPyramidThresholdPipeline != nil ? "✅" : "❌")")
+        print("      downsample:      \(pyramidDownsamplePipeline != nil ? "✅" : "❌")")
+        print("      upsample:        \(pyramidUpsamplePipeline != nil ? "✅" : "❌")")
+        print("      halationComp.:   \(halationPyramidCompositePipeline != nil ? "✅" : "❌")")
+        print("")
         print("   Tone Mapping:")
         print("      toneMapping:     \(toneMappingPipeline != nil ? "✅" : "❌")")
         print("")
         print("   Aspect-Fill Scaling:")
         print("      aspectFillScale: \(aspectFillScalePipeline != nil ? "✅" : "❌")")
+        print("      yuvConvert:      \(yuvConvertPipeline != nil ? "✅" : "❌")")
         print("")
         print("   Flash Effect:")
         print("      flash:           \(flashPipeline != nil ? "✅" : "❌")")
         print("")
         print("   Light Leak Effect:")
         print("      lightLeak:       \(lightLeakPipeline != nil ? "✅" : "❌")")
+        print("      lightLeak (layer): \(lightLeakCompositePipeline != nil ? "✅" : "❌")")
         print("")
         print("   Date Stamp Effect:")
         print("      dateStamp:       \(dateStampPipeline != nil ? "✅" : "❌")")
@@ -380,9 +544,11 @@ class RenderEngine {
         print("")
         print("   B&W Pipeline:")
         print("      bw:              \(bwPipeline != nil ? "✅" : "❌")")
+        print("      bw (baked):      \(bwBakedPipeline != nil ? "✅" : "❌")")
         print("")
         print("   Overlays Pipeline:")
         print("      overlays:        \(overlaysPipeline != nil ? "✅" : "❌")")
+        print("      overlays (layer): \(overlaysCompositePipeline != nil ? "✅" : "❌")")
         print("")
         print("   VHS Effects Pipeline:")
         print("      vhsEffects:      \(vhsEffectsPipeline != nil ? "✅" : "❌")")
@@ -392,6 +558,13 @@ class RenderEngine {
         print("")
         print("   Film Strip Pipeline:")
         print("      filmStrip:       \(filmStripPipeline != nil ? "✅" : "❌")")
+        print("")
+        print("   Fused Preview Pipeline:")
+        print("      fusedPreview:    \(fusedPreviewPipeline != nil ? "✅" : "❌")")
+        print("")
+        print("   sRGB Boundary (linear intermediates):")
+        print("      srgbEncode:      \(srgbEncodePipeline != nil ? "✅" : "❌")")
+        print("      srgbDecode:      \(srgbDecodePipeline != nil ? "✅" : "❌")")
         print("═══════════════════════════════════════════════════════════════")
         
         if !initializationErrors.isEmpty {
@@ -425,48 +598,51 @@ class RenderEngine {
 
     /// ★ NEW: Preload all LUTs on background thread to eliminate UI jank
     /// Call this from app startup (e.g., in App.init or ContentView.onAppear)
+    /// ★★★ CHANGED: Background priority - chỉ load khi còn budget, preset active/neighbour luôn đi trước ★★★
     func preloadAllLUTs() {
-        DispatchQueue.global(qos: .utility).async { [weak self] in
-            guard let self = self else { return }
-
-            let startTime = CFAbsoluteTimeGetCurrent()
-            var loadedCount = 0
-
-            print("🔄 RenderEngine: Preloading \(Self.allLUTFiles.count) LUTs...")
-
-            for lutFile in Self.allLUTFiles {
-                if self.loadLUT(named: lutFile) != nil {
-                    loadedCount += 1
-                }
-            }
+        print("🔄 RenderEngine: Preloading up to \(Self.allLUTFiles.count) LUTs (budget \(lutResidency.byteBudget / 1024) KB)...")
 
-            let elapsed = CFAbsoluteTimeGetCurrent() - startTime
+        lutResidency.prefetch(Self.allLUTFiles, priority: .background) { [weak self] elapsed in
+            guard let self = self else { return }
+            let loadedCount = Self.allLUTFiles.filter { self.lutResidency.residentTexture(named: $0) != nil }.count
             print("✅ RenderEngine: Preloaded \(loadedCount)/\(Self.allLUTFiles.count) LUTs in \(String(format: "%.2f", elapsed))s")
+            self.reportLUTPreloadTiming(elapsed: elapsed)
         }
     }
 
-    func loadLUT(named filename: String) -> MTLTexture? {
-        lutCacheLock.lock()
-        defer { lutCacheLock.unlock() }
+    /// ★ Active preset LUT first, then its carousel neighbours
+    func prioritizeLUTs(active: FilterPreset, neighbours: [FilterPreset]) {
+        lutResidency.prioritize(
+            active: active.lutFile,
+            neighbours: neighbours.compactMap { $0.lutFile }.filter { $0 != active.lutFile }
+        )
+    }
 
-        if let cached = lutCache[filename] {
-            return cached
-        }
+    /// ★ Before/after report: lần đầu (.cube parse) lưu làm baseline, các lần sau (binary) so sánh
+    private func reportLUTPreloadTiming(elapsed: CFAbsoluteTime) {
+        let sources = Self.allLUTFiles.compactMap { lutResidency.loadSource(of: $0) }
 
-        guard let texture = LUTLoader.load(filename: filename, device: device) else {
-            print("⚠️ RenderEngine: Failed to load LUT: \(filename)")
-            return nil
+        let parsedCount = sources.filter { $0 == .cubeParse }.count
+        let binaryCount = sources.count - parsedCount
+        print("   Sources: \(binaryCount) binary (.flut), \(parsedCount) parsed (.cube)")
+
+        let baselineKey = "lutPreloadCubeBaseline"
+        let defaults = UserDefaults.standard
+
+        if parsedCount == sources.count && !sources.isEmpty {
+            defaults.set(elapsed, forKey: baselineKey)
+        } else if parsedCount == 0, defaults.object(forKey: baselineKey) != nil {
+            let baseline = defaults.double(forKey: baselineKey)
+            print("   LUT preload: before (.cube) \(String(format: "%.3f", baseline))s → after (binary) \(String(format: "%.3f", elapsed))s")
         }
+    }
 
-        lutCache[filename] = texture
-        print("✅ RenderEngine: LUT loaded and cached: \(filename)")
-        return texture
+    func loadLUT(named filename: String) -> MTLTexture? {
+        return lutResidency.texture(named: filename)
     }
 
     func clearLUTCache() {
-        lutCacheLock.lock()
-        lutCache.removeAll()
-        lutCacheLock.unlock()
+        lutResidency.removeAll()
         print("🧹 RenderEngine: LUT cache cleared")
     }
     
@@ -541,42 +717,21 @@ class RenderEngine {
             return nil
         }
 
-        guard let outputTexture = texturePool.readableTexture(
-            width: inputTexture.width,
-            height: inputTexture.height,
-            pixelFormat: .bgra8Unorm
-        ) else {
-            print("❌ RenderEngine: Failed to create preview output texture")
-            return nil
-        }
-
-        filterRendererLock.lock()
-        if photoFilterRenderer == nil {
-            photoFilterRenderer = FilterRenderer()
-        }
-        let renderer = photoFilterRenderer!
-        filterRendererLock.unlock()
+        let renderer = dequeuePhotoRenderer()
+        defer { enqueuePhotoRenderer(renderer) }
 
         // Use lightweight 2-pass pipeline
-        let success = renderer.renderGalleryPreview(
-            input: inputTexture,
-            output: outputTexture,
-            preset: preset,
-            commandQueue: commandQueue
-        )
-
-        guard success else {
-            texturePool.recycle(outputTexture)
-            return nil
-        }
-
-        guard let filteredCGImage = textureToCGImage(texture: outputTexture) else {
-            texturePool.recycle(outputTexture)
+        guard let filteredCGImage = renderToCGImage(width: inputTexture.width, height: inputTexture.height, render: { outputTexture in
+            renderer.renderGalleryPreview(
+                input: inputTexture,
+                output: outputTexture,
+                preset: preset,
+                commandQueue: renderer.stream.commandQueue
+            )
+        }) else {
             return nil
         }
 
-        texturePool.recycle(outputTexture)
-
         return UIImage(
             cgImage: filteredCGImage,
             scale: image.scale,
@@ -615,63 +770,33 @@ class RenderEngine {
         
         print("✅ Input texture: \(inputTexture.width)x\(inputTexture.height), format: \(inputTexture.pixelFormat.rawValue)")
 
-        // Step 3: Create output texture (CPU-readable)
-        guard let outputTexture = texturePool.readableTexture(
-            width: inputTexture.width,
-            height: inputTexture.height,
-            pixelFormat: .bgra8Unorm
-        ) else {
-            print("❌ RenderEngine: Failed to create output texture")
-            return nil
-        }
-        
-        print("✅ Output texture created")
+        // Step 3: Get or create FilterRenderer (thread-safe, capture stream)
+        let renderer = dequeuePhotoRenderer()
+        defer { enqueuePhotoRenderer(renderer) }
 
-        // Step 4: Get or create FilterRenderer (thread-safe)
-        filterRendererLock.lock()
-        if photoFilterRenderer == nil {
-            photoFilterRenderer = FilterRenderer()
-            print("   Created new FilterRenderer for photo processing")
-        }
-        let renderer = photoFilterRenderer!
-        filterRendererLock.unlock()
-
-        // Step 5: Render with synchronous GPU wait
+        // Step 4: Render with synchronous GPU wait straight into the readback surface
         print("🔄 Starting renderSync...")
-        let success = renderer.renderSync(
-            input: inputTexture,
-            output: outputTexture,
-            preset: preset,
-            commandQueue: commandQueue
-        )
-        
-        guard success else {
-            print("❌ RenderEngine: Filter rendering failed")
-            texturePool.recycle(outputTexture)
+        guard let filteredCGImage = renderToCGImage(width: inputTexture.width, height: inputTexture.height, render: { outputTexture in
+            renderer.renderSync(
+                input: inputTexture,
+                output: outputTexture,
+                preset: preset,
+                commandQueue: renderer.stream.commandQueue
+            )
+        }) else {
+            print("❌ RenderEngine: Filter rendering / readback failed")
             return nil
         }
-        
-        print("✅ GPU rendering completed")
 
-        // Step 6: Convert texture back to CGImage
-        guard let filteredCGImage = textureToCGImage(texture: outputTexture) else {
-            print("❌ RenderEngine: Failed to convert texture to CGImage")
-            texturePool.recycle(outputTexture)
-            return nil
-        }
-        
-        print("✅ Converted to CGImage: \(filteredCGImage.width)x\(filteredCGImage.height)")
+        print("✅ Rendered to CGImage: \(filteredCGImage.width)x\(filteredCGImage.height)")
 
-        // Step 7: Create UIImage with original orientation
+        // Step 5: Create UIImage with original orientation
         let filteredImage = UIImage(
             cgImage: filteredCGImage,
             scale: image.scale,
             orientation: image.imageOrientation
         )
-        
-        // Cleanup
-        texturePool.recycle(outputTexture)
-        
+
         let elapsed = CFAbsoluteTimeGetCurrent() - startTime
         print("✅ RenderEngine.applyFilter: Completed in \(String(format: "%.3f", elapsed))s")
         print("   Result: \(Int(filteredImage.size.width))x\(Int(filteredImage.size.height))")
@@ -679,42 +804,101 @@ class RenderEngine {
         return filteredImage
     }
 
-    /// Convert MTLTexture to CGImage
-    private func textureToCGImage(texture: MTLTexture) -> CGImage? {
+    // MARK: - ★★★ NEW: Render Streams ★★★
+
+    /// Queue + transient pool for role, created on first use
+    /// .preview = commandQueue / texturePool; không tạo được queue mới → dùng chung stream .preview
+    func stream(_ role: RenderStream.Role) -> RenderStream {
+        streamsLock.lock()
+        defer { streamsLock.unlock() }
+
+        if let stream = streams[role] {
+            return stream
+        }
+        let stream = RenderStream.make(role: role, device: device) ?? streams[.preview]!
+        streams[role] = stream
+        #if DEBUG
+        print("✅ RenderEngine: \(role.rawValue) stream ready (\(stream.role == role ? "own queue + pool" : "shared with preview"))")
+        #endif
+        return stream
+    }
+
+    private func dequeuePhotoRenderer() -> FilterRenderer {
+        filterRendererLock.lock()
+        defer { filterRendererLock.unlock() }
+        return idlePhotoRenderers.popLast() ?? FilterRenderer(stream: stream(.capture))
+    }
+
+    private func enqueuePhotoRenderer(_ renderer: FilterRenderer) {
+        filterRendererLock.lock()
+        idlePhotoRenderers.append(renderer)
+        filterRendererLock.unlock()
+    }
+
+    // MARK: - ★★★ NEW: Zero-copy Readback ★★★
+
+    /// Render into a CPU-visible target and return it as a CGImage
+    /// - render: encodes + waits for the GPU (renderSync / renderGalleryPreview), returns success
+    /// - Fast path: IOSurface-backed CVPixelBuffer, CGImage wraps the same memory (0 copy, 0 swap)
+    /// - Fallback: shared texture + getBytes (1 copy, vẫn không swap)
+    func renderToCGImage(width: Int, height: Int, render: (MTLTexture) -> Bool) -> CGImage? {
+        if let surface = readbackSurfaces.makeSurface(width: width, height: height) {
+            guard render(surface.texture) else {
+                return nil
+            }
+            return surface.makeCGImage()
+        }
+
+        guard let outputTexture = texturePool.readableTexture(
+            width: width,
+            height: height,
+            pixelFormat: .bgra8Unorm
+        ) else {
+            print("❌ RenderEngine: Failed to create output texture")
+            return nil
+        }
+        defer { texturePool.recycle(outputTexture) }
+
+        guard render(outputTexture) else {
+            return nil
+        }
+        return textureToCGImage(texture: outputTexture)
+    }
+
+    /// Convert MTLTexture to CGImage (fallback when no readback surface is available)
+    /// ★ BGRA giữ nguyên: CGImage đọc little-endian ARGB → không cần swap trên CPU
+    func textureToCGImage(texture: MTLTexture) -> CGImage? {
         let width = texture.width
         let height = texture.height
         let bytesPerPixel = 4
         let bytesPerRow = bytesPerPixel * width
         let bitsPerComponent = 8
 
-        var pixelData = [UInt8](repeating: 0, count: width * height * bytesPerPixel)
+        var pixelData = Data(count: bytesPerRow * height)
 
         let region = MTLRegion(
             origin: MTLOrigin(x: 0, y: 0, z: 0),
             size: MTLSize(width: width, height: height, depth: 1)
         )
 
-        texture.getBytes(
-            &pixelData,
-            bytesPerRow: bytesPerRow,
-            from: region,
-            mipmapLevel: 0
-        )
-        
-        // BGRA → RGBA conversion (Metal uses BGRA, CGImage expects RGBA)
-        for i in stride(from: 0, to: pixelData.count, by: 4) {
-            let b = pixelData[i]
-            pixelData[i] = pixelData[i + 2]  // R
-            pixelData[i + 2] = b              // B
+        pixelData.withUnsafeMutableBytes { buffer in
+            guard let baseAddress = buffer.baseAddress else { return }
+            texture.getBytes(
+                baseAddress,
+                bytesPerRow: bytesPerRow,
+                from: region,
+                mipmapLevel: 0
+            )
         }
 
-        guard let dataProvider = CGDataProvider(data: Data(pixelData) as CFData) else {
+        guard let dataProvider = CGDataProvider(data: pixelData as CFData) else {
             print("❌ RenderEngine: Failed to create CGDataProvider")
             return nil
         }
 
         let colorSpace = CGColorSpaceCreateDeviceRGB()
-        let bitmapInfo = CGBitmapInfo(rawValue: CGImageAlphaInfo.premultipliedLast.rawValue)
+        let bitmapInfo = CGBitmapInfo(rawValue: CGImageAlphaInfo.noneSkipFirst.rawValue)
+            .union(.byteOrder32Little)
 
         return CGImage(
             width: width,
@@ -735,17 +919,20 @@ class RenderEngine {
     
     #if DEBUG
     func printPoolStatistics() {
-        let stats = texturePool.statistics()
-        print("📊 TexturePool: available=\(stats.available), inUse=\(stats.inUse)")
+        streamsLock.lock()
+        let streams = RenderStream.Role.allCases.compactMap { self.streams[$0] }.filter { $0.role == .preview || $0.texturePool !== texturePool }
+        streamsLock.unlock()
+
+        for stream in streams {
+            let pool = stream.texturePool
+            let stats = pool.statistics()
+            print("📊 TexturePool (\(stream.role.rawValue)): available=\(stats.available), inUse=\(stats.inUse)")
+            print("   resident=\(stats.bytesResident / 1_048_576)MB, aliased=\(stats.bytesAliased / 1_048_576)MB, peak=\(stats.peakBytes / 1_048_576)MB, budget=\(pool.memoryBudget / 1_048_576)MB")
+        }
     }
     
     func printLUTCacheStatus() {
-        lutCacheLock.lock()
-        print("📊 LUT Cache: \(lutCache.count) entries")
-        for (name, texture) in lutCache {
-            print("   - \(name): \(texture.width)x\(texture.height)x\(texture.depth)")
-        }
-        lutCacheLock.unlock()
+        lutResidency.printStatus()
     }
     
     func printStatus() {
@@ -757,6 +944,16 @@ class RenderEngine {
         print("   Device: \(device.name)")
         printPoolStatistics()
         printLUTCacheStatus()
+        let archive = pipelineArchive.statistics()
+        print("📊 PipelineArchive: \(archive.loaded ? "loaded" : "new"), \(archive.hits) hits, \(archive.misses) compiled, \(archive.pending) unsaved, \(archive.bytes / 1024)KB on disk")
+        let formats = pipelineFormats.statistics()
+        print("📊 PipelineFormats: \(formats.registered) registered, \(formats.variants) variants, \(formats.failed) failed")
+        let baked = colorLUTBaker.statistics()
+        print("📊 ColorLUTBaker: \(baked.entries) cached (\(baked.ready) ready), \(baked.bakes) bakes")
+        let layers = proceduralLayers.statistics()
+        print("📊 ProceduralLayers: \(layers.entries) cached (\(layers.ready) ready), \(layers.bakes) bakes, \(layers.bytes / 1024)KB")
+        let kernels = computeKernels.statistics()
+        print("📊 ComputeKernels: \(kernels.pipelines) pipelines, \(kernels.failed) failed, \(kernels.tileMemory / 1024)KB tile memory")
         print("═══════════════════════════════════════════════════════════════")
         print("")
     }
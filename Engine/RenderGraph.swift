@@ -0,0 +1,398 @@
+// RenderGraph.swift
+// Film Camera - Declarative pass scheduling for FilterRenderer
+// ★★★ NEW: Replaces hand-rolled ping-pong buffers ★★★
+
+import Foundation
+import Metal
+
+/// Quality tier — một mô tả pipeline duy nhất, mỗi tier bật/tắt những gì cần
+enum RenderQuality: String {
+    case preview    // Live viewfinder: simplified blur, fused per-pixel passes
+    case video      // Recording: same effects as preview at input resolution
+    case gallery    // Gallery scrolling: Color Grading + Vignette only
+    case capture    // Photo capture: full quality separable blur, exact multi-pass
+
+    /// Separable 4-pass bloom/halation (capture only)
+    var usesSeparableBlur: Bool {
+        return self == .capture
+    }
+
+    /// Collapse adjacent per-pixel passes into fusedPreviewFragment
+    /// Capture giữ multi-pass để output từng bit giống trước
+    var mergesPerPixelPasses: Bool {
+        return self != .capture
+    }
+
+    /// Lens distortion is a capture-only pass (preview never had it)
+    var includesLensDistortion: Bool {
+        return self == .capture
+    }
+
+    /// Gallery scrolling skips everything except the core look
+    var includesSecondaryEffects: Bool {
+        return self != .gallery
+    }
+}
+
+/// Size + format of a transient texture (textures with equal descriptors can alias)
+struct RenderGraphTextureDescriptor: Hashable {
+    let width: Int
+    let height: Int
+    let pixelFormat: MTLPixelFormat
+}
+
+/// Textures handed to a pass at execution time
+struct RenderGraphPassContext {
+    let inputs: [MTLTexture]
+    let output: MTLTexture
+    let commandBuffer: MTLCommandBuffer
+}
+
+/// Builds, compiles and executes a chain of fullscreen passes for one command buffer
+///
+/// - Passes declare inputs/outputs as resource handles, not textures
+/// - compile(): culls dead/identity passes, merges fusable per-pixel runs, counts readers
+/// - execute(): allocates transients from TexturePool lazily; after its last reader each one is
+///   made aliasable (heap mode) or returned to a free list → memory is shared across
+///   non-overlapping lifetimes
+final class RenderGraph {
+
+    typealias Resource = Int
+
+    /// Per-pixel stages a pass contributes when merged into fusedPreviewFragment (nil = not fusable)
+    typealias FusedEncoder = (FusedPreviewStages, RenderGraphPassContext) -> Bool
+
+    private struct Pass {
+        var name: String
+        var inputs: [Resource]
+        var output: Resource
+        var fusedStages: FusedPreviewStages?
+        var isRequired: Bool
+        var encode: (RenderGraphPassContext) -> Bool
+    }
+
+    /// The imported source texture
+    let source: Resource = 0
+
+    private let sourceTexture: MTLTexture
+    /// Extra external textures (vd. CbCr plane của frame 420f) — never pooled
+    private var importedTextures: [Resource: MTLTexture] = [:]
+    private var descriptors: [Resource: RenderGraphTextureDescriptor] = [:]
+    private var passes: [Pass] = []
+    private var finalOutput: Resource = 0
+
+    private var fusedEncoder: FusedEncoder?
+    private var isCompiled = false
+
+    /// ★★★ NEW: Content keys (RenderGraphCache) ★★★
+    /// Hash of the parameters of the passes being declared; nil → their outputs are not cacheable
+    var parameterKey: Int?
+    /// key = hash(pass name, parameterKey, input keys); source key từ caller
+    private var resourceKeys: [Resource: Int] = [:]
+
+    /// Stats từ lần compile gần nhất (debug)
+    private(set) var declaredPassCount = 0
+    private(set) var culledPassCount = 0
+    private(set) var mergedPassCount = 0
+
+    /// Required pass that failed in the last execute() — result không dùng được, caller bỏ frame
+    private(set) var failedRequiredPass: String?
+
+    /// - sourceKey: identity of the source pixels + render settings (nil → graph không cache được)
+    init(source: MTLTexture, sourceKey: Int? = nil) {
+        self.sourceTexture = source
+        resourceKeys[source] = sourceKey
+        descriptors[source] = RenderGraphTextureDescriptor(
+            width: source.width,
+            height: source.height,
+            pixelFormat: source.pixelFormat
+        )
+    }
+
+    // MARK: - Declaration
+
+    /// Import an additional external texture as a pass input
+    func importTexture(_ texture: MTLTexture) -> Resource {
+        let resource = makeTexture(RenderGraphTextureDescriptor(
+            width: texture.width,
+            height: texture.height,
+            pixelFormat: texture.pixelFormat
+        ))
+        importedTextures[resource] = texture
+        return resource
+    }
+
+    /// Declare a transient texture
+    func makeTexture(_ descriptor: RenderGraphTextureDescriptor) -> Resource {
+        let resource = descriptors.count
+        descriptors[resource] = descriptor
+        return resource
+    }
+
+    func descriptor(of resource: Resource) -> RenderGraphTextureDescriptor {
+        return descriptors[resource]!
+    }
+
+    /// Declare a pass writing a new transient texture
+    /// - isIdentity: pass không thay đổi ảnh (vd. intensity = 0) → culled, output alias input
+    /// - fusedStages: non-nil khi pass có thể gộp vào fusedPreviewFragment
+    /// - isRequired: passthrough khi thất bại cho ra ảnh sai (vd. chỉ còn luma, linear vào bgra8)
+    ///   → execute() ghi failedRequiredPass thay vì âm thầm bỏ qua
+    @discardableResult
+    func addPass(
+        _ name: String,
+        inputs: [Resource],
+        output descriptor: RenderGraphTextureDescriptor,
+        isIdentity: Bool = false,
+        fusedStages: FusedPreviewStages? = nil,
+        isRequired: Bool = false,
+        encode: @escaping (RenderGraphPassContext) -> Bool
+    ) -> Resource {
+        declaredPassCount += 1
+
+        guard !isIdentity, !inputs.isEmpty else {
+            culledPassCount += 1
+            return inputs.first ?? source
+        }
+
+        let output = makeTexture(descriptor)
+        passes.append(Pass(name: name, inputs: inputs, output: output, fusedStages: fusedStages, isRequired: isRequired, encode: encode))
+        finalOutput = output
+
+        let inputKeys = inputs.compactMap { resourceKeys[$0] }
+        if let parameterKey = parameterKey, inputKeys.count == inputs.count {
+            var hasher = Hasher()
+            hasher.combine(name)
+            hasher.combine(parameterKey)
+            inputKeys.forEach { hasher.combine($0) }
+            resourceKeys[output] = hasher.finalize()
+        }
+        return output
+    }
+
+    /// Mark the resource that execute() should return (defaults to the last pass output)
+    func setOutput(_ resource: Resource) {
+        finalOutput = resource
+    }
+
+    /// Enable merging of adjacent fusable passes (encoder receives the union of stages)
+    func enableFusion(_ encoder: @escaping FusedEncoder) {
+        fusedEncoder = encoder
+    }
+
+    // MARK: - Compile
+
+    /// Cull passes that don't contribute to the output, then merge fusable runs
+    func compile() {
+        guard !isCompiled else { return }
+        isCompiled = true
+
+        // 1. Cull: walk backwards from the output, keep passes whose output is needed
+        var needed: Set<Resource> = [finalOutput]
+        var live: [Pass] = []
+        for pass in passes.reversed() where needed.contains(pass.output) {
+            needed.formUnion(pass.inputs)
+            live.append(pass)
+        }
+        culledPassCount += passes.count - live.count
+        passes = live.reversed()
+
+        // 2. Merge: A → B where B reads only A and nobody else reads A
+        guard let fusedEncoder = fusedEncoder else { return }
+
+        var readers: [Resource: Int] = [:]
+        for pass in passes {
+            for input in pass.inputs { readers[input, default: 0] += 1 }
+        }
+
+        var merged: [Pass] = []
+        for pass in passes {
+            if let stages = pass.fusedStages,
+               var previous = merged.last,
+               let previousStages = previous.fusedStages,
+               pass.inputs == [previous.output],
+               readers[previous.output] == 1,
+               previous.output != finalOutput {
+                let union = previousStages.union(stages)
+                previous.name += "+" + pass.name
+                previous.output = pass.output
+                previous.fusedStages = union
+                previous.isRequired = previous.isRequired || pass.isRequired
+                previous.encode = { context in fusedEncoder(union, context) }
+                merged[merged.count - 1] = previous
+                mergedPassCount += 1
+            } else {
+                merged.append(pass)
+            }
+        }
+        passes = merged
+    }
+
+    // MARK: - Execute
+
+    /// Encode all live passes into commandBuffer
+    /// - target: optional external texture; final pass renders straight into it (no blit) when compatible
+    /// - instrumentation: encoders của mỗi pass được tính vào pass.name (RenderInstrumentation)
+    /// - cache: resources found there are not recomputed (nor anything only they depend on);
+    ///   the inputs of the first changed pass are handed to it for the next render
+    /// - Returns: texture containing the result, and every pooled texture used (recycle after GPU completes)
+    func execute(
+        commandBuffer: MTLCommandBuffer,
+        texturePool: TexturePool,
+        target: MTLTexture? = nil,
+        instrumentation: FrameRecorder? = nil,
+        cache: RenderGraphCache? = nil
+    ) -> (result: MTLTexture, transients: [MTLTexture]) {
+        compile()
+        failedRequiredPass = nil
+
+        // Walk back from the output; a cached resource cuts off everything above it
+        var schedule = passes
+        var cachedTextures: [Resource: MTLTexture] = [:]
+        if let cache = cache {
+            var needed: Set<Resource> = [finalOutput]
+            var live: [Pass] = []
+            for pass in passes.reversed() where needed.contains(pass.output) {
+                if pass.output != finalOutput, let key = resourceKeys[pass.output], let texture = cache.texture(for: key) {
+                    cachedTextures[pass.output] = texture
+                    continue
+                }
+                needed.formUnion(pass.inputs)
+                live.append(pass)
+            }
+            schedule = live.reversed()
+        }
+
+        // Reader count per logical resource (lifetime = until its last reader runs)
+        var readerCounts: [Resource: Int] = [:]
+        for pass in schedule {
+            for input in pass.inputs { readerCounts[input, default: 0] += 1 }
+        }
+        readerCounts[finalOutput, default: 0] += 1  // Output lives until the caller reads it
+
+        var physical: [Resource: MTLTexture] = [source: sourceTexture]
+        // Reference count per physical texture (aliased resources share one texture)
+        var physicalRefs: [ObjectIdentifier: Int] = [:]
+        var freeList: [RenderGraphTextureDescriptor: [MTLTexture]] = [:]
+        var allocated: [MTLTexture] = []
+        var pooled: Set<ObjectIdentifier> = []
+        // Handed to the cache → never aliased / reused; evicted ones recycle with the transients
+        var retained: Set<ObjectIdentifier> = []
+        var evicted: [MTLTexture] = []
+        var storedEditPoint = false
+
+        func acquire(_ descriptor: RenderGraphTextureDescriptor) -> MTLTexture? {
+            if var free = freeList[descriptor], let texture = free.popLast() {
+                freeList[descriptor] = free
+                return texture
+            }
+            guard let texture = texturePool.transientTexture(
+                width: descriptor.width,
+                height: descriptor.height,
+                pixelFormat: descriptor.pixelFormat
+            ) else { return nil }
+            allocated.append(texture)
+            pooled.insert(ObjectIdentifier(texture))
+            return texture
+        }
+
+        func release(_ resource: Resource) {
+            guard let texture = physical[resource] else { return }
+            let id = ObjectIdentifier(texture)
+            physicalRefs[id, default: 0] -= 1
+            if physicalRefs[id, default: 0] <= 0 && pooled.contains(id) && !retained.contains(id) {
+                // Heap-backed → alias memory cho allocation sau; otherwise reuse texture directly
+                if texturePool.makeAliasable(texture) { return }
+                let descriptor = RenderGraphTextureDescriptor(width: texture.width, height: texture.height, pixelFormat: texture.pixelFormat)
+                freeList[descriptor, default: []].append(texture)
+            }
+        }
+
+        physicalRefs[ObjectIdentifier(sourceTexture)] = readerCounts[source] ?? 0
+        for (resource, texture) in importedTextures {
+            physical[resource] = texture
+            physicalRefs[ObjectIdentifier(texture)] = readerCounts[resource] ?? 0
+        }
+        for (resource, texture) in cachedTextures {
+            physical[resource] = texture
+        }
+
+        for pass in schedule {
+            // Edit point: first pass whose output changed since the last render → keep what it reads
+            if let cache = cache, !storedEditPoint, let key = resourceKeys[pass.output], cache.isNewSinceLastRender(key) {
+                storedEditPoint = true
+                for input in pass.inputs {
+                    guard let texture = physical[input], let inputKey = resourceKeys[input],
+                          pooled.contains(ObjectIdentifier(texture)), !retained.contains(ObjectIdentifier(texture)) else { continue }
+                    retained.insert(ObjectIdentifier(texture))
+                    evicted += cache.store(texture, key: inputKey)
+                }
+            }
+
+            let inputs = pass.inputs.compactMap { physical[$0] }
+            let descriptor = descriptors[pass.output]!
+            let writesTarget = pass.output == finalOutput && target.map { canRender(into: $0, descriptor) } == true
+
+            var output: MTLTexture?
+            if writesTarget {
+                output = target
+            } else {
+                output = acquire(descriptor)
+            }
+
+            let readers = readerCounts[pass.output] ?? 0
+            instrumentation?.beginPass(pass.name)
+
+            if inputs.count == pass.inputs.count, let output = output,
+               pass.encode(RenderGraphPassContext(inputs: inputs, output: output, commandBuffer: commandBuffer)) {
+                physical[pass.output] = output
+                physicalRefs[ObjectIdentifier(output), default: 0] += readers
+            } else {
+                // ★ Pass thất bại → bỏ qua (giống pipeline cũ): output alias primary input
+                #if DEBUG
+                print("⚠️ RenderGraph: Pass \(pass.name) failed, passing input through")
+                #endif
+                if pass.isRequired && failedRequiredPass == nil {
+                    failedRequiredPass = pass.name
+                }
+                if let output = output, !writesTarget, !texturePool.makeAliasable(output) {
+                    let outputDescriptor = RenderGraphTextureDescriptor(width: output.width, height: output.height, pixelFormat: output.pixelFormat)
+                    freeList[outputDescriptor, default: []].append(output)
+                }
+                if let passthrough = physical[pass.inputs[0]] {
+                    physical[pass.output] = passthrough
+                    physicalRefs[ObjectIdentifier(passthrough), default: 0] += readers
+                }
+            }
+
+            for input in pass.inputs {
+                release(input)
+            }
+        }
+
+        let result = physical[finalOutput] ?? sourceTexture
+
+        cache?.finishRender(keys: Set(resourceKeys.values), skipped: passes.count - schedule.count, executed: schedule.count)
+
+        #if DEBUG
+        if RenderGraph.verboseLogging {
+            print("🧩 RenderGraph: \(schedule.map { $0.name }.joined(separator: " → "))")
+            print("   declared: \(declaredPassCount), culled: \(culledPassCount), merged: \(mergedPassCount), cached: \(passes.count - schedule.count), textures: \(allocated.count)")
+        }
+        #endif
+
+        return (result, allocated.filter { !retained.contains(ObjectIdentifier($0)) } + evicted)
+    }
+
+    /// Log compiled pass list on every execute (DEBUG only)
+    static var verboseLogging = false
+
+    // MARK: - Private
+
+    private func canRender(into texture: MTLTexture, _ descriptor: RenderGraphTextureDescriptor) -> Bool {
+        return texture.usage.contains(.renderTarget) &&
+            texture.width == descriptor.width &&
+            texture.height == descriptor.height &&
+            texture.pixelFormat == descriptor.pixelFormat
+    }
+}
@@ -0,0 +1,125 @@
+// RenderGraphCache.swift
+// Film Camera - Intermediate pass outputs kept across renders
+// ★★★ NEW: Incremental re-render cho PhotoEditorView (slider drag chỉ chạy lại phần sau effect đổi) ★★★
+
+import Foundation
+import Metal
+
+/// Pass outputs from earlier renders, keyed by a hash of everything upstream of them
+///
+/// - RenderGraph gán mỗi resource một key = hash(pass name, pass parameters, input keys)
+///   → cùng key = cùng pixels, bất kể preset nào sinh ra
+/// - execute(cache:) dừng lùi tại resource đã có trong cache → không chạy các pass phía trên
+/// - Stored: inputs của pass đầu tiên có key mới so với lần render trước ("edit point")
+///   → kéo vignette: output ngay trước Vignette được giữ, lần sau chỉ Vignette → InstantFrame chạy
+/// - LRU theo bytes; texture bị evict trả về caller như transient (recycle sau khi GPU xong)
+/// - Chỉ dùng cho renders deterministic (fixedFrameSeed) — grain/light leak đổi mỗi frame thì key sai
+final class RenderGraphCache {
+
+    /// Max bytes of cached textures (1200px rgba16Float ≈ 8.6MB mỗi entry)
+    let maxBytes: Int
+
+    private var entries: [Int: MTLTexture] = [:]
+    private var recency: [Int] = []  // Least recent first
+    private var cachedBytes = 0
+    private let texturePool: TexturePool
+    private let lock = NSLock()
+
+    /// Every resource key of the previous render (edit point detection)
+    private var previousKeys: Set<Int> = []
+
+    // Stats
+    private var hitCount = 0
+    private var passesSkipped = 0
+    private var passesExecuted = 0
+
+    init(texturePool: TexturePool, maxBytes: Int = 96 * 1024 * 1024) {
+        self.texturePool = texturePool
+        self.maxBytes = maxBytes
+    }
+
+    deinit {
+        entries.values.forEach { texturePool.recycle($0) }
+    }
+
+    // MARK: - RenderGraph Interface
+
+    func texture(for key: Int) -> MTLTexture? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard let texture = entries[key] else { return nil }
+        touch(key)
+        hitCount += 1
+        return texture
+    }
+
+    /// Take ownership of a pass output; returns evicted textures (still possibly read by in-flight GPU work)
+    func store(_ texture: MTLTexture, key: Int) -> [MTLTexture] {
+        lock.lock()
+        defer { lock.unlock() }
+
+        // Quá lớn so với budget → không giữ (vd. full-res render lúc thả slider)
+        let bytes = texture.allocatedSize
+        guard entries[key] == nil, bytes <= maxBytes / 2 else { return [texture] }
+
+        entries[key] = texture
+        recency.append(key)
+        cachedBytes += bytes
+
+        var evicted: [MTLTexture] = []
+        while cachedBytes > maxBytes, recency.count > 1 {
+            let oldest = recency.removeFirst()
+            if let texture = entries.removeValue(forKey: oldest) {
+                cachedBytes -= texture.allocatedSize
+                evicted.append(texture)
+            }
+        }
+        return evicted
+    }
+
+    func isNewSinceLastRender(_ key: Int) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return !previousKeys.isEmpty && !previousKeys.contains(key)
+    }
+
+    /// Called by RenderGraph.execute after scheduling
+    func finishRender(keys: Set<Int>, skipped: Int, executed: Int) {
+        lock.lock()
+        previousKeys = keys
+        passesSkipped += skipped
+        passesExecuted += executed
+        lock.unlock()
+    }
+
+    // MARK: - Management
+
+    /// Drop everything (new image / memory warning) — call when no render using the cache is in flight
+    func removeAll() {
+        lock.lock()
+        let textures = Array(entries.values)
+        entries.removeAll()
+        recency.removeAll()
+        previousKeys.removeAll()
+        cachedBytes = 0
+        lock.unlock()
+
+        textures.forEach { texturePool.recycle($0) }
+    }
+
+    func statistics() -> (entries: Int, bytes: Int, hits: Int, passesSkipped: Int, passesExecuted: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+        return (entries.count, cachedBytes, hitCount, passesSkipped, passesExecuted)
+    }
+
+    // MARK: - Private
+
+    private func touch(_ key: Int) {
+        if let index = recency.firstIndex(of: key) {
+            recency.remove(at: index)
+        }
+        recency.append(key)
+    }
+}
@@ -0,0 +1,364 @@
+// RenderInstrumentation.swift
+// Film Camera - Per-pass GPU timing, pool allocation + signposts
+// ★★★ NEW: Pass nào tốn GPU trên máy nào — bật/tắt lúc runtime, đọc được ở release build ★★★
+
+import Foundation
+import Metal
+import os
+
+/// GPU time of one render graph pass (mọi encoder của pass cộng lại)
+struct PassTiming {
+    let name: String
+    var gpuMilliseconds: Double
+    var encoders: Int
+}
+
+/// One instrumented command buffer (preview frame, capture, capture tile)
+struct FrameInstrumentation {
+    let label: String
+    /// Theo thứ tự encode; rỗng khi GPU không hỗ trợ stage-boundary counters
+    let passes: [PassTiming]
+    /// Render graph passes encoded (có cả khi không có per-pass timing)
+    let passCount: Int
+    /// Command buffer gpuEndTime - gpuStartTime (luôn có, fallback khi không có per-pass)
+    let gpuMilliseconds: Double
+    /// TexturePool bytes handed out / newly allocated while encoding this frame
+    let bytesRequested: Int
+    let bytesAllocated: Int
+    /// Encoders past the sample buffer capacity (không có timing riêng)
+    let unsampledEncoders: Int
+
+    /// One-line report, e.g. for release logging
+    var summary: String {
+        let passList = passes
+            .map { "\($0.name) \(String(format: "%.2f", $0.gpuMilliseconds))" }
+            .joined(separator: ", ")
+        let memory = "\(bytesRequested / 1024)KB requested, \(bytesAllocated / 1024)KB allocated"
+        if passes.isEmpty {
+            return "\(label): GPU \(String(format: "%.2f", gpuMilliseconds))ms, \(memory)"
+        }
+        return "\(label): GPU \(String(format: "%.2f", gpuMilliseconds))ms [\(passList)], \(memory)"
+    }
+}
+
+/// Runtime-toggleable render instrumentation
+///
+/// - Per-pass: MTLCounterSampleBuffer (timestamp counter set) gắn vào render / compute pass descriptor,
+///   sample đầu vertex + cuối fragment (compute: đầu + cuối encoder) → GPU ticks → ns qua sampleTimestamps
+/// - Không hỗ trợ .atStageBoundary → chỉ command buffer GPU time
+/// - TexturePool: bytes cấp cho frame (reuse + mới) và bytes thật sự allocate mới
+/// - os_signpost (OSSignposter): capture → filter → encode + preview frames, bật bất kể isEnabled
+///   (Instruments chỉ ghi khi đang record → chi phí ~0)
+/// - latest(label:) / averagePasses(label:) / onFrame → log được ở release build
+final class RenderInstrumentation {
+
+    static let shared = RenderInstrumentation()
+
+    /// Signposts for Instruments (Points of Interest-style intervals)
+    static let signposter = OSSignposter(subsystem: "com.filmcamera", category: "Render")
+
+    /// Toggle GPU counters + frame reports at runtime
+    /// Launch argument `-renderInstrumentationEnabled YES` bật từ đầu (cả release / TestFlight build)
+    var isEnabled: Bool = UserDefaults.standard.bool(forKey: "renderInstrumentationEnabled")
+
+    /// Print printReport() every N recorded frames (0 = chỉ khi gọi trực tiếp)
+    var reportInterval: Int = 600
+
+    /// Max timed encoders per command buffer (2 samples mỗi encoder)
+    var encodersPerFrame: Int = 96
+
+    /// Frames kept per label for averages
+    var historyLength: Int = 120
+
+    /// Called on Metal's completion thread for every instrumented frame
+    var onFrame: ((FrameInstrumentation) -> Void)?
+
+    let supportsPassTiming: Bool
+
+    private let device: MTLDevice
+    private let counterSet: MTLCounterSet?
+    private var sampleBuffers: [MTLCounterSampleBuffer] = []
+    private var history: [String: [FrameInstrumentation]] = [:]
+    private var recordedCount = 0
+    private let lock = NSLock()
+
+    private init() {
+        let device = RenderEngine.shared.device
+        self.device = device
+        self.counterSet = device.counterSets?.first { $0.name == MTLCommonCounterSet.timestamp.rawValue }
+        self.supportsPassTiming = counterSet != nil && device.supportsCounterSampling(.atStageBoundary)
+    }
+
+    // MARK: - Frames
+
+    /// Recorder for one command buffer, nil when instrumentation is off
+    /// texturePool: pool của stream encode frame (allocation delta chỉ tính pool đó)
+    func beginFrame(label: String, commandBuffer: MTLCommandBuffer, texturePool: TexturePool) -> FrameRecorder? {
+        guard isEnabled else { return nil }
+        return FrameRecorder(instrumentation: self, label: label, commandBuffer: commandBuffer, texturePool: texturePool, sampleBuffer: supportsPassTiming ? dequeueSampleBuffer() : nil)
+    }
+
+    /// Most recent frame for label ("preview", "capture", …)
+    func latest(label: String) -> FrameInstrumentation? {
+        lock.lock()
+        defer { lock.unlock() }
+        return history[label]?.last
+    }
+
+    /// Mean per-pass GPU time over the recorded history of label
+    func averagePasses(label: String) -> [PassTiming] {
+        lock.lock()
+        let frames = history[label] ?? []
+        lock.unlock()
+
+        var order: [String] = []
+        var totals: [String: PassTiming] = [:]
+        for frame in frames {
+            for pass in frame.passes {
+                if totals[pass.name] == nil {
+                    order.append(pass.name)
+                    totals[pass.name] = PassTiming(name: pass.name, gpuMilliseconds: 0, encoders: 0)
+                }
+                totals[pass.name]!.gpuMilliseconds += pass.gpuMilliseconds
+                totals[pass.name]!.encoders += pass.encoders
+            }
+        }
+        let count = Double(max(frames.count, 1))
+        return order.compactMap { totals[$0] }.map {
+            PassTiming(name: $0.name, gpuMilliseconds: $0.gpuMilliseconds / count, encoders: $0.encoders / max(frames.count, 1))
+        }
+    }
+
+    /// Print averages for every label (hoạt động cả release build)
+    func printReport() {
+        lock.lock()
+        let labels = history.keys.sorted()
+        let counts = history.mapValues { $0.count }
+        lock.unlock()
+
+        print("📊 RenderInstrumentation: \(supportsPassTiming ? "per-pass counters" : "command buffer time only")")
+        for label in labels {
+            guard let latest = latest(label: label) else { continue }
+            print("   \(latest.summary)")
+            let passes = averagePasses(label: label)
+                .sorted { $0.gpuMilliseconds > $1.gpuMilliseconds }
+                .map { "\($0.name) \(String(format: "%.2f", $0.gpuMilliseconds))ms" }
+            if !passes.isEmpty {
+                print("   avg over \(counts[label] ?? 0): \(passes.joined(separator: ", "))")
+            }
+        }
+    }
+
+    func reset() {
+        lock.lock()
+        defer { lock.unlock() }
+        history.removeAll()
+    }
+
+    // MARK: - Internal
+
+    fileprivate func record(_ frame: FrameInstrumentation, sampleBuffer: MTLCounterSampleBuffer?) {
+        lock.lock()
+        var frames = history[frame.label] ?? []
+        frames.append(frame)
+        if frames.count > historyLength {
+            frames.removeFirst(frames.count - historyLength)
+        }
+        history[frame.label] = frames
+        if let sampleBuffer = sampleBuffer {
+            sampleBuffers.append(sampleBuffer)
+        }
+        recordedCount += 1
+        let reportDue = reportInterval > 0 && recordedCount % reportInterval == 0
+        lock.unlock()
+
+        onFrame?(frame)
+        if reportDue {
+            printReport()
+        }
+    }
+
+    /// Reuse resolved sample buffers (tạo mới tốn allocation mỗi frame)
+    private func dequeueSampleBuffer() -> MTLCounterSampleBuffer? {
+        lock.lock()
+        if let buffer = sampleBuffers.popLast(), buffer.sampleCount >= encodersPerFrame * 2 {
+            lock.unlock()
+            return buffer
+        }
+        lock.unlock()
+
+        guard let counterSet = counterSet else { return nil }
+        let descriptor = MTLCounterSampleBufferDescriptor()
+        descriptor.counterSet = counterSet
+        descriptor.storageMode = .shared
+        descriptor.sampleCount = encodersPerFrame * 2
+        descriptor.label = "RenderInstrumentation"
+        do {
+            return try device.makeCounterSampleBuffer(descriptor: descriptor)
+        } catch {
+            print("⚠️ RenderInstrumentation: Counter sample buffer unavailable: \(error.localizedDescription)")
+            return nil
+        }
+    }
+}
+
+/// Collects pass boundaries of one command buffer; resolved when the GPU completes it
+/// Dùng trên thread encode (không thread-safe), completion chạy trên thread của Metal
+final class FrameRecorder {
+
+    private let instrumentation: RenderInstrumentation
+    private let label: String
+    private let sampleBuffer: MTLCounterSampleBuffer?
+    private let device: MTLDevice
+    private let texturePool: TexturePool
+    private let poolStart: (requested: Int, allocated: Int)
+
+    private var currentPass = "Unnamed"
+    private var passCount = 0
+    /// Pass name per sampled encoder (index i → samples 2i, 2i + 1)
+    private var encoderPasses: [String] = []
+    private var unsampled = 0
+    private var cpuStart: MTLTimestamp = 0
+    private var gpuStart: MTLTimestamp = 0
+    private var finished = false
+
+    /// Result of this command buffer (wait(timeout:) → đúng frame của caller, không qua onFrame)
+    private var resolvedFrame: FrameInstrumentation?
+    private let resolvedLock = NSLock()
+    private let completed = DispatchSemaphore(value: 0)
+
+    fileprivate init(instrumentation: RenderInstrumentation, label: String, commandBuffer: MTLCommandBuffer, texturePool: TexturePool, sampleBuffer: MTLCounterSampleBuffer?) {
+        self.instrumentation = instrumentation
+        self.label = label
+        self.sampleBuffer = sampleBuffer
+        self.device = commandBuffer.device
+        self.texturePool = texturePool
+        self.poolStart = texturePool.allocationCounters()
+        device.sampleTimestamps(&cpuStart, gpuTimestamp: &gpuStart)
+    }
+
+    /// Following encoders belong to pass name (RenderGraph gọi trước mỗi pass)
+    func beginPass(_ name: String) {
+        currentPass = name
+        passCount += 1
+    }
+
+    /// Add start/end samples for the next render encoder (descriptor dùng lại → clear sau khi tạo encoder)
+    func attach(to descriptor: MTLRenderPassDescriptor) {
+        guard let index = nextSampleIndex() else { return }
+        let attachment = descriptor.sampleBufferAttachments[0]!
+        attachment.sampleBuffer = sampleBuffer
+        attachment.startOfVertexSampleIndex = index
+        attachment.endOfVertexSampleIndex = MTLCounterDontSample
+        attachment.startOfFragmentSampleIndex = MTLCounterDontSample
+        attachment.endOfFragmentSampleIndex = index + 1
+    }
+
+    /// Compute pass descriptor sampling the next compute encoder (nil → encoder không đo)
+    func computePassDescriptor() -> MTLComputePassDescriptor? {
+        guard let index = nextSampleIndex() else { return nil }
+        let descriptor = MTLComputePassDescriptor()
+        let attachment = descriptor.sampleBufferAttachments[0]!
+        attachment.sampleBuffer = sampleBuffer
+        attachment.startOfEncoderSampleIndex = index
+        attachment.endOfEncoderSampleIndex = index + 1
+        return descriptor
+    }
+
+    /// Resolve timings after the GPU completes commandBuffer (call once, before commit)
+    func finish(_ commandBuffer: MTLCommandBuffer) {
+        guard !finished else { return }
+        finished = true
+
+        let poolEnd = texturePool.allocationCounters()
+        let requested = poolEnd.requested - poolStart.requested
+        let allocated = poolEnd.allocated - poolStart.allocated
+        let passCount = self.passCount
+
+        commandBuffer.addCompletedHandler { [self] buffer in
+            let passes = resolvePasses()
+            let frame = FrameInstrumentation(
+                label: label,
+                passes: passes,
+                passCount: passCount,
+                gpuMilliseconds: max(0, buffer.gpuEndTime - buffer.gpuStartTime) * 1000,
+                bytesRequested: requested,
+                bytesAllocated: allocated,
+                unsampledEncoders: unsampled
+            )
+            resolvedLock.lock()
+            resolvedFrame = frame
+            resolvedLock.unlock()
+            completed.signal()
+
+            instrumentation.record(frame, sampleBuffer: sampleBuffer)
+        }
+    }
+
+    /// Block until the GPU completes this recorder's command buffer (nil on timeout / chưa finish)
+    func wait(timeout: DispatchTime) -> FrameInstrumentation? {
+        guard finished, completed.wait(timeout: timeout) == .success else { return nil }
+        completed.signal()  // Lần wait sau trả về ngay
+
+        resolvedLock.lock()
+        defer { resolvedLock.unlock() }
+        return resolvedFrame
+    }
+
+    // MARK: - Private
+
+    private func nextSampleIndex() -> Int? {
+        guard let sampleBuffer = sampleBuffer, (encoderPasses.count + 1) * 2 <= sampleBuffer.sampleCount else {
+            unsampled += 1
+            return nil
+        }
+        encoderPasses.append(currentPass)
+        return (encoderPasses.count - 1) * 2
+    }
+
+    private func resolvePasses() -> [PassTiming] {
+        guard let sampleBuffer = sampleBuffer, !encoderPasses.isEmpty,
+              let data = sampleBuffer.resolveCounterRange(0..<(encoderPasses.count * 2)) else {
+            return []
+        }
+
+        // GPU ticks → ns (cặp CPU/GPU timestamp lúc bắt đầu + lúc resolve)
+        var cpuEnd: MTLTimestamp = 0
+        var gpuEnd: MTLTimestamp = 0
+        device.sampleTimestamps(&cpuEnd, gpuTimestamp: &gpuEnd)
+        let nanosecondsPerTick = gpuEnd > gpuStart ? Double(cpuEnd - cpuStart) / Double(gpuEnd - gpuStart) : 1
+
+        var passes: [PassTiming] = []
+        data.withUnsafeBytes { raw in
+            let samples = raw.bindMemory(to: MTLCounterResultTimestamp.self)
+            for (index, name) in encoderPasses.enumerated() {
+                let start = samples[index * 2].timestamp
+                let end = samples[index * 2 + 1].timestamp
+                guard start != MTLCounterErrorValue, end != MTLCounterErrorValue, end >= start else { continue }
+
+                let milliseconds = Double(end - start) * nanosecondsPerTick / 1_000_000
+                // Encoder liên tiếp cùng pass (tiles, pyramid levels, smear + bloom) → gộp
+                if let last = passes.last, last.name == name {
+                    passes[passes.count - 1].gpuMilliseconds += milliseconds
+                    passes[passes.count - 1].encoders += 1
+                } else {
+                    passes.append(PassTiming(name: name, gpuMilliseconds: milliseconds, encoders: 1))
+                }
+            }
+        }
+        return passes
+    }
+}
+
+// MARK: - Timing Statistics
+
+extension Array where Element == Double {
+
+    /// Median (0 when empty) — ít nhạy với frame bị preempt / launch lạnh hơn mean
+    var median: Double {
+        let sorted = self.sorted()
+        guard !sorted.isEmpty else { return 0 }
+        let middle = sorted.count / 2
+        return sorted.count % 2 == 0 ? (sorted[middle - 1] + sorted[middle]) / 2 : sorted[middle]
+    }
+}
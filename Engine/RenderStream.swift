@@ -0,0 +1,123 @@
+// RenderStream.swift
+// Film Camera - Independent GPU streams on one shared RenderEngine
+// ★★★ NEW: Viewfinder / recording / capture không còn chung 1 queue + 1 pool ★★★
+
+import Foundation
+import Metal
+
+/// Command queue + transient texture pool of one producer of GPU work
+///
+/// - Mỗi stream 1 MTLCommandQueue → capture 12MP / gallery batch không chặn preview frame xếp sau nó
+///   (command buffers trong 1 queue chạy theo thứ tự commit = head-of-line blocking)
+/// - Mỗi stream 1 TexturePool → heap aliasing chỉ an toàn trong 1 queue, lock của pool không bị
+///   3 producer tranh nhau mỗi pass
+/// - Shared, read-only sau khi build (RenderEngine): pipelines + variants + archive, LUT residency,
+///   ColorLUTBaker, noise atlas, ProceduralLayerCache
+/// - Metal không có API priority cho queue → ưu tiên qua maxCommandBufferCount (preview nông → latency thấp,
+///   capture sâu → throughput) + QoS của thread encode (qos)
+final class RenderStream {
+
+    enum Role: String, CaseIterable {
+        /// Main viewfinder — dùng RenderEngine.commandQueue / texturePool (code cũ không đổi hành vi)
+        case preview
+        /// VideoRecorder frames (VideoToolbox đọc output sau completion)
+        case recording
+        /// Still photos, gallery re-render, editor
+        case capture
+
+        /// Command buffers queued before makeCommandBuffer blocks (PreviewFramePacer: 3 in flight)
+        var maxCommandBufferCount: Int {
+            switch self {
+            case .preview: return PreviewFramePacer.maxFramesInFlight + 1
+            case .recording: return 8
+            case .capture: return 16
+            }
+        }
+
+        /// TexturePool budget — tổng 3 stream = 256 MB, trần của pool chung trước đây
+        /// (1080p bgra8 ≈ 8 MB / transient; 12MP rgba16Float ≈ 96 MB → capture giữ 1 size class lớn)
+        var memoryBudget: Int {
+            switch self {
+            case .preview: return 96 * 1024 * 1024
+            case .recording: return 48 * 1024 * 1024
+            case .capture: return 112 * 1024 * 1024
+            }
+        }
+
+        /// QoS for threads that encode on this stream
+        var qos: DispatchQoS {
+            switch self {
+            case .preview: return .userInteractive
+            case .recording, .capture: return .userInitiated
+            }
+        }
+    }
+
+    let role: Role
+    let commandQueue: MTLCommandQueue
+    let texturePool: TexturePool
+
+    /// Idle time before cached transients of a finished burst / batch are released
+    var idlePurgeDelay: TimeInterval = 2
+
+    private var activeWork = 0
+    private var idleGeneration = 0
+    private let lock = NSLock()
+
+    init(role: Role, commandQueue: MTLCommandQueue, texturePool: TexturePool) {
+        self.role = role
+        self.commandQueue = commandQueue
+        self.texturePool = texturePool
+    }
+
+    // MARK: - Idle Purge
+
+    /// Producer started work on this stream (PhotoProcessingPipeline job, gallery batch)
+    func beginWork() {
+        lock.lock()
+        activeWork += 1
+        idleGeneration += 1
+        lock.unlock()
+    }
+
+    /// Matching endWork: last producer done → purge the pool after idlePurgeDelay
+    /// Burst / batch kế tiếp trong delay giữ lại textures (không allocate lại 12MP mỗi shot)
+    func endWork() {
+        lock.lock()
+        activeWork = max(activeWork - 1, 0)
+        guard activeWork == 0 else {
+            lock.unlock()
+            return
+        }
+        idleGeneration += 1
+        let generation = idleGeneration
+        lock.unlock()
+
+        DispatchQueue.global(qos: .utility).asyncAfter(deadline: .now() + idlePurgeDelay) { [weak self] in
+            guard let self = self else { return }
+
+            self.lock.lock()
+            let stillIdle = self.activeWork == 0 && self.idleGeneration == generation
+            self.lock.unlock()
+            guard stillIdle else { return }
+
+            self.texturePool.purge()
+            #if DEBUG
+            print("♻️ RenderStream: \(self.role.rawValue) idle, texture pool purged")
+            #endif
+        }
+    }
+
+    /// New queue + pool for role, nil when the device can't create another queue
+    static func make(role: Role, device: MTLDevice) -> RenderStream? {
+        guard let commandQueue = device.makeCommandQueue(maxCommandBufferCount: role.maxCommandBufferCount) else {
+            print("⚠️ RenderStream: Could not create command queue for \(role.rawValue)")
+            return nil
+        }
+        commandQueue.label = "FilmCamera.\(role.rawValue)"
+
+        let texturePool = TexturePool(device: device)
+        texturePool.memoryBudget = role.memoryBudget
+        return RenderStream(role: role, commandQueue: commandQueue, texturePool: texturePool)
+    }
+}
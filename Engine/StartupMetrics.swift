@@ -0,0 +1,148 @@
+// StartupMetrics.swift
+// Film Camera - Time-to-first-frame instrumentation
+// ★★★ NEW: Cold launch → first presented viewfinder frame, lưu history theo app version ★★★
+
+import Foundation
+import Darwin
+
+/// Launch timeline from process start to the first viewfinder frame on screen
+///
+/// - processStart: kernel start time của process (sysctl) → tính cả dyld + static init
+/// - Milestones đánh dấu 1 lần / process, frame đầu được present → report + lưu UserDefaults
+/// - History giữ maxHistory launches gần nhất kèm version/build → so sánh median giữa các release
+final class StartupMetrics {
+
+    static let shared = StartupMetrics()
+
+    enum Milestone: String, CaseIterable {
+        case appInit
+        case engineReady
+        case firstCameraFrame
+        case firstFramePresented
+    }
+
+    /// One recorded launch (UserDefaults plist)
+    struct Launch: Codable {
+        let version: String
+        let build: String
+        let timeToFirstFrame: Double
+        let engineReady: Double
+        let archiveLoaded: Bool
+        let date: Date
+    }
+
+    private static let historyKey = "startupMetricsHistory"
+
+    /// Launches kept across releases
+    static let maxHistory = 30
+
+    let processStart: CFAbsoluteTime
+
+    private var marks: [Milestone: CFAbsoluteTime] = [:]
+    private var reported = false
+    private let lock = NSLock()
+
+    private init() {
+        processStart = StartupMetrics.processStartTime() ?? CFAbsoluteTimeGetCurrent()
+    }
+
+    /// Record milestone (first call wins)
+    func mark(_ milestone: Milestone) {
+        let now = CFAbsoluteTimeGetCurrent()
+
+        lock.lock()
+        if marks[milestone] == nil {
+            marks[milestone] = now
+        }
+        let shouldReport = milestone == .firstFramePresented && !reported
+        if shouldReport {
+            reported = true
+        }
+        lock.unlock()
+
+        if shouldReport {
+            report()
+        }
+    }
+
+    /// First frame already on screen → caller không cần theo dõi nữa
+    var hasPresentedFirstFrame: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return marks[.firstFramePresented] != nil
+    }
+
+    /// Milestone offset from process start (seconds)
+    func elapsed(to milestone: Milestone) -> Double? {
+        lock.lock()
+        defer { lock.unlock() }
+        return marks[milestone].map { $0 - processStart }
+    }
+
+    /// Recorded launches, oldest first
+    func history() -> [Launch] {
+        guard let data = UserDefaults.standard.data(forKey: StartupMetrics.historyKey),
+              let launches = try? PropertyListDecoder().decode([Launch].self, from: data) else {
+            return []
+        }
+        return launches
+    }
+
+    // MARK: - Private
+
+    private func report() {
+        guard let timeToFirstFrame = elapsed(to: .firstFramePresented) else { return }
+
+        let info = Bundle.main.infoDictionary
+        let version = info?["CFBundleShortVersionString"] as? String ?? "?"
+        let build = info?["CFBundleVersion"] as? String ?? "?"
+        let archiveLoaded = RenderEngine.isAvailable && RenderEngine.shared.pipelineArchive.loadedFromDisk
+
+        let launch = Launch(
+            version: version,
+            build: build,
+            timeToFirstFrame: timeToFirstFrame,
+            engineReady: elapsed(to: .engineReady) ?? 0,
+            archiveLoaded: archiveLoaded,
+            date: Date()
+        )
+        var launches = history()
+        launches.append(launch)
+        launches = Array(launches.suffix(StartupMetrics.maxHistory))
+        if let data = try? PropertyListEncoder().encode(launches) {
+            UserDefaults.standard.set(data, forKey: StartupMetrics.historyKey)
+        }
+
+        print("📊 StartupMetrics: First frame in \(milliseconds(timeToFirstFrame)) (archive \(archiveLoaded ? "warm" : "cold"), v\(version) (\(build)))")
+        let timeline = Milestone.allCases.compactMap { milestone in
+            elapsed(to: milestone).map { "\(milestone.rawValue) \(milliseconds($0))" }
+        }
+        print("   Timeline: \(timeline.joined(separator: " → "))")
+
+        // Median per release → regressions hiện ra khi so với release trước
+        let current = launches.filter { $0.version == version && $0.build == build }
+        let previous = launches.last { $0.version != version || $0.build != build }
+        var summary = "   This build: median \(milliseconds(current.map { $0.timeToFirstFrame }.median)) over \(current.count) launches"
+        if let previous = previous {
+            let releaseLaunches = launches.filter { $0.version == previous.version && $0.build == previous.build }
+            summary += ", v\(previous.version) (\(previous.build)): median \(milliseconds(releaseLaunches.map { $0.timeToFirstFrame }.median))"
+        }
+        print(summary)
+    }
+
+    private func milliseconds(_ seconds: Double) -> String {
+        return "\(String(format: "%.0f", seconds * 1000))ms"
+    }
+
+    /// Process start from the kernel (nil → fallback lần đầu truy cập StartupMetrics)
+    private static func processStartTime() -> CFAbsoluteTime? {
+        var info = kinfo_proc()
+        var size = MemoryLayout<kinfo_proc>.stride
+        var mib: [Int32] = [CTL_KERN, KERN_PROC, KERN_PROC_PID, getpid()]
+        guard sysctl(&mib, u_int(mib.count), &info, &size, nil, 0) == 0 else { return nil }
+
+        let start = info.kp_proc.p_un.__p_starttime
+        let unixTime = Double(start.tv_sec) + Double(start.tv_usec) / 1_000_000
+        return unixTime - kCFAbsoluteTimeIntervalSince1970
+    }
+}
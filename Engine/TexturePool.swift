@@ -1,89 +1,186 @@
 // TexturePool.swift
 // Film Camera - Metal Texture Memory Management (FIXED VERSION)
 // Fix: Storage mode for iOS (.shared instead of .private)
+// ★★★ NEW: MTLHeap-backed transients + memory budget with LRU eviction ★★★
 
 import Foundation
 import Metal
 
 /// Manages reusable Metal textures to avoid allocation overhead
 class TexturePool {
+
+    /// Cheap hashable key (thay cho String interpolation trên mỗi lần get/recycle)
+    private struct TextureKey: Hashable {
+        let width: Int
+        let height: Int
+        let pixelFormat: UInt
+        let usage: UInt
+        let storageMode: UInt
+
+        init(_ descriptor: MTLTextureDescriptor) {
+            width = descriptor.width
+            height = descriptor.height
+            pixelFormat = descriptor.pixelFormat.rawValue
+            usage = descriptor.usage.rawValue
+            storageMode = descriptor.storageMode.rawValue
+        }
+
+        init(_ texture: MTLTexture) {
+            width = texture.width
+            height = texture.height
+            pixelFormat = texture.pixelFormat.rawValue
+            usage = texture.usage.rawValue
+            storageMode = texture.storageMode.rawValue
+        }
+    }
+
+    /// Reusable textures of one size class, most recently recycled last
+    private struct SizeClass {
+        var textures: [MTLTexture] = []
+        var lastUsed: UInt64 = 0
+    }
+
     private let device: MTLDevice
-    private var availableTextures: [String: [MTLTexture]] = [:]
-    private var inUseTextures: Set<ObjectIdentifier> = []
+    private var availableTextures: [TextureKey: SizeClass] = [:]
+    private var inUseTextures: [ObjectIdentifier: Int] = [:]   // id → allocatedSize
     private let lock = NSLock()
-    
+
+    // Heap-backed transients
+    private var heaps: [MTLHeap] = []
+    private var heapTextures: Set<ObjectIdentifier> = []
+
+    // Byte accounting
+    private var cachedBytes: Int = 0
+    private var inUseBytes: Int = 0
+    private var aliasedBytes: Int = 0
+    private var peakBytes: Int = 0
+    private var useCounter: UInt64 = 0
+
+    // Cumulative counters (RenderInstrumentation lấy delta theo frame)
+    private var requestedBytesTotal: Int = 0
+    private var allocatedBytesTotal: Int = 0
+
+    /// Max bytes kept resident (cached + in use + heaps); LRU size classes are evicted above it
+    var memoryBudget: Int = 256 * 1024 * 1024 {
+        didSet {
+            lock.lock()
+            enforceBudget()
+            lock.unlock()
+        }
+    }
+
+    /// Sub-allocate transient render targets from MTLHeap (false → classic reuse pool)
+    var usesHeapAllocation: Bool = true
+
+    /// Minimum heap size; larger requests get a heap of their own size
+    var heapChunkSize: Int = 64 * 1024 * 1024
+
     init(device: MTLDevice) {
         self.device = device
     }
-    
+
     /// Get or create a texture with the specified descriptor
     func texture(matching descriptor: MTLTextureDescriptor) -> MTLTexture? {
         lock.lock()
         defer { lock.unlock() }
-        
-        let key = textureKey(for: descriptor)
-        
+
+        let key = TextureKey(descriptor)
+        useCounter += 1
+
         // Try to reuse an existing texture
-        if var textures = availableTextures[key], !textures.isEmpty {
-            let texture = textures.removeLast()
-            availableTextures[key] = textures
-            inUseTextures.insert(ObjectIdentifier(texture))
+        if var sizeClass = availableTextures[key], let texture = sizeClass.textures.popLast() {
+            sizeClass.lastUsed = useCounter
+            availableTextures[key] = sizeClass.textures.isEmpty ? nil : sizeClass
+
+            let bytes = texture.allocatedSize
+            cachedBytes -= bytes
+            markInUse(texture, bytes: bytes)
             return texture
         }
-        
-        // Create a new texture
+
+        // Create a new texture (evict first so the budget holds after allocation)
+        enforceBudget(reserving: estimatedSize(of: descriptor))
+
         guard let texture = device.makeTexture(descriptor: descriptor) else {
             return nil
         }
-        
-        inUseTextures.insert(ObjectIdentifier(texture))
+
+        allocatedBytesTotal += texture.allocatedSize
+        markInUse(texture, bytes: texture.allocatedSize)
         return texture
     }
-    
+
     /// Return a texture to the pool for reuse
     func recycle(_ texture: MTLTexture) {
         lock.lock()
         defer { lock.unlock() }
-        
+
         let id = ObjectIdentifier(texture)
-        guard inUseTextures.contains(id) else { return }
-        
-        inUseTextures.remove(id)
-        
-        let key = textureKey(for: texture)
-        if availableTextures[key] == nil {
-            availableTextures[key] = []
+        guard let bytes = inUseTextures.removeValue(forKey: id) else { return }
+        inUseBytes -= bytes
+
+        // Heap textures are never cached: their memory returns to the heap when released
+        if heapTextures.remove(id) != nil {
+            return
         }
-        availableTextures[key]?.append(texture)
+
+        useCounter += 1
+        let key = TextureKey(texture)
+        var sizeClass = availableTextures[key] ?? SizeClass()
+        sizeClass.textures.append(texture)
+        sizeClass.lastUsed = useCounter
+        availableTextures[key] = sizeClass
+        cachedBytes += bytes
+
+        enforceBudget()
     }
-    
+
     /// Create a texture for render target use (GPU-only intermediate textures)
     /// ★ FIX: Dùng .private cho intermediate textures để tránh GPU timeout
     /// - .private: Chỉ GPU access, nhanh nhất, không cần memory barriers
     /// - .shared: CPU+GPU access, chậm hơn, cần sync barriers
     /// Với 13-pass pipeline + ảnh 12MP, .shared gây nghẽn bandwidth → timeout
     func renderTargetTexture(width: Int, height: Int, pixelFormat: MTLPixelFormat = .bgra8Unorm) -> MTLTexture? {
-        let descriptor = MTLTextureDescriptor.texture2DDescriptor(
-            pixelFormat: pixelFormat,
-            width: width,
-            height: height,
-            mipmapped: false
-        )
-        descriptor.usage = [.shaderRead, .shaderWrite, .renderTarget]
+        return texture(matching: renderTargetDescriptor(width: width, height: height, pixelFormat: pixelFormat))
+    }
 
-        // ★ FIX: Use .private for GPU-only intermediate textures
-        // This eliminates memory barriers between render passes
-        #if os(iOS) || os(tvOS)
-        descriptor.storageMode = .private  // ★ CHANGED from .shared
-        #elseif os(macOS)
-        descriptor.storageMode = .private
-        #else
-        descriptor.storageMode = .private
-        #endif
+    /// Transient render target valid for ONE command buffer
+    /// Heap mode: sub-allocated from an MTLHeap; gọi makeAliasable() sau pass đọc cuối cùng
+    /// để các texture cấp sau có thể dùng lại cùng vùng nhớ. Luôn recycle() sau khi GPU xong.
+    func transientTexture(width: Int, height: Int, pixelFormat: MTLPixelFormat = .bgra8Unorm) -> MTLTexture? {
+        let descriptor = renderTargetDescriptor(width: width, height: height, pixelFormat: pixelFormat)
 
-        return texture(matching: descriptor)
+        guard usesHeapAllocation else {
+            return texture(matching: descriptor)
+        }
+
+        lock.lock()
+        let heapTexture = makeHeapTexture(descriptor: descriptor)
+        if let heapTexture = heapTexture {
+            heapTextures.insert(ObjectIdentifier(heapTexture))
+            markInUse(heapTexture, bytes: heapTexture.allocatedSize)
+        }
+        lock.unlock()
+
+        // Heap unavailable → classic pool
+        return heapTexture ?? texture(matching: descriptor)
+    }
+
+    /// Mark a transient's memory reusable by later heap allocations (contents become undefined)
+    /// - Returns: false if the texture is not heap-backed (caller may reuse it directly)
+    @discardableResult
+    func makeAliasable(_ texture: MTLTexture) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+
+        let id = ObjectIdentifier(texture)
+        guard heapTextures.contains(id) else { return false }
+
+        texture.makeAliasable()
+        aliasedBytes += texture.allocatedSize
+        return true
     }
-    
+
     /// Create a texture optimized for CPU read (for photo capture)
     func readableTexture(width: Int, height: Int, pixelFormat: MTLPixelFormat = .bgra8Unorm) -> MTLTexture? {
         let descriptor = MTLTextureDescriptor.texture2DDescriptor(
@@ -93,37 +190,148 @@ class TexturePool {
             mipmapped: false
         )
         descriptor.usage = [.shaderRead, .shaderWrite, .renderTarget]
-        
+
         // ★ Always use .shared for CPU-readable textures
         descriptor.storageMode = .shared
-        
+
         return texture(matching: descriptor)
     }
-    
-    /// Clear all cached textures
+
+    /// Clear all cached textures and heaps no longer backing live textures
     func purge() {
         lock.lock()
         defer { lock.unlock() }
-        
+
         availableTextures.removeAll()
+        cachedBytes = 0
+        heaps.removeAll { $0.usedSize == 0 }
     }
-    
+
     /// Get pool statistics for debugging
-    func statistics() -> (available: Int, inUse: Int) {
+    /// - bytesResident: cached + in-use textures + heap capacity
+    /// - bytesAliased: total bytes handed back to heaps via makeAliasable()
+    /// - peakBytes: highest bytesResident seen
+    func statistics() -> (available: Int, inUse: Int, bytesResident: Int, bytesAliased: Int, peakBytes: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        let availableCount = availableTextures.values.reduce(0) { $0 + $1.textures.count }
+        return (availableCount, inUseTextures.count, residentBytes(), aliasedBytes, peakBytes)
+    }
+
+    /// Restart peak tracking from the current resident size (PipelineBenchmark: peak per run)
+    func resetPeakBytes() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        peakBytes = residentBytes()
+    }
+
+    /// Cumulative bytes since launch (delta quanh 1 frame → bytes/frame)
+    /// - requested: every texture handed out (reused, heap sub-allocated or new)
+    /// - allocated: new device memory (makeTexture + new heaps)
+    /// Pool dùng chung → frame chạy song song (preview + capture) cộng vào delta của nhau
+    func allocationCounters() -> (requested: Int, allocated: Int) {
         lock.lock()
         defer { lock.unlock() }
-        
-        let availableCount = availableTextures.values.reduce(0) { $0 + $1.count }
-        return (availableCount, inUseTextures.count)
+
+        return (requestedBytesTotal, allocatedBytesTotal)
     }
-    
+
     // MARK: - Private
-    
-    private func textureKey(for descriptor: MTLTextureDescriptor) -> String {
-        return "\(descriptor.width)x\(descriptor.height)_\(descriptor.pixelFormat.rawValue)_\(descriptor.usage.rawValue)_\(descriptor.storageMode.rawValue)"
+
+    private func renderTargetDescriptor(width: Int, height: Int, pixelFormat: MTLPixelFormat) -> MTLTextureDescriptor {
+        let descriptor = MTLTextureDescriptor.texture2DDescriptor(
+            pixelFormat: pixelFormat,
+            width: width,
+            height: height,
+            mipmapped: false
+        )
+        descriptor.usage = [.shaderRead, .shaderWrite, .renderTarget]
+
+        // ★ FIX: Use .private for GPU-only intermediate textures
+        // This eliminates memory barriers between render passes
+        descriptor.storageMode = .private
+
+        return descriptor
+    }
+
+    /// Must be called with lock held
+    private func markInUse(_ texture: MTLTexture, bytes: Int) {
+        inUseTextures[ObjectIdentifier(texture)] = bytes
+        inUseBytes += bytes
+        requestedBytesTotal += bytes
+        peakBytes = max(peakBytes, residentBytes())
+    }
+
+    /// Must be called with lock held
+    private func residentBytes() -> Int {
+        // Heap textures are counted in heap capacity, không tính 2 lần
+        let heapTextureBytes = inUseTextures.reduce(0) { total, entry in
+            heapTextures.contains(entry.key) ? total + entry.value : total
+        }
+        let heapBytes = heaps.reduce(0) { $0 + $1.size }
+        return cachedBytes + (inUseBytes - heapTextureBytes) + heapBytes
+    }
+
+    private func estimatedSize(of descriptor: MTLTextureDescriptor) -> Int {
+        return device.heapTextureSizeAndAlign(descriptor: descriptor).size
+    }
+
+    /// Evict least-recently-used size classes until resident bytes fit the budget
+    /// Must be called with lock held
+    private func enforceBudget(reserving extraBytes: Int = 0) {
+        while residentBytes() + extraBytes > memoryBudget,
+              let oldest = availableTextures.min(by: { $0.value.lastUsed < $1.value.lastUsed }) {
+            let key = oldest.key
+            let sizeClass = oldest.value
+            for texture in sizeClass.textures {
+                cachedBytes -= texture.allocatedSize
+            }
+            availableTextures.removeValue(forKey: key)
+
+            #if DEBUG
+            print("♻️ TexturePool: Evicted \(sizeClass.textures.count)x \(key.width)x\(key.height) (budget \(memoryBudget / 1_048_576)MB)")
+            #endif
+        }
+
+        // Empty heaps are cheap to recreate → drop them first when over budget
+        if residentBytes() + extraBytes > memoryBudget {
+            heaps.removeAll { $0.usedSize == 0 }
+        }
     }
-    
-    private func textureKey(for texture: MTLTexture) -> String {
-        return "\(texture.width)x\(texture.height)_\(texture.pixelFormat.rawValue)_\(texture.usage.rawValue)_\(texture.storageMode.rawValue)"
+
+    /// Must be called with lock held
+    private func makeHeapTexture(descriptor: MTLTextureDescriptor) -> MTLTexture? {
+        let sizeAndAlign = device.heapTextureSizeAndAlign(descriptor: descriptor)
+
+        for heap in heaps where heap.maxAvailableSize(alignment: sizeAndAlign.align) >= sizeAndAlign.size {
+            if let texture = heap.makeTexture(descriptor: descriptor) {
+                return texture
+            }
+        }
+
+        // No room → grow with a new heap
+        let heapDescriptor = MTLHeapDescriptor()
+        heapDescriptor.storageMode = .private
+        heapDescriptor.size = max(heapChunkSize, sizeAndAlign.size)
+        // ★ Tracked: Metal tự xử lý hazard giữa các texture alias cùng vùng nhớ
+        heapDescriptor.hazardTrackingMode = .tracked
+
+        enforceBudget(reserving: heapDescriptor.size)
+
+        guard let heap = device.makeHeap(descriptor: heapDescriptor) else {
+            print("⚠️ TexturePool: Failed to create \(heapDescriptor.size / 1_048_576)MB heap")
+            return nil
+        }
+        heap.label = "TexturePool.heap\(heaps.count)"
+        heaps.append(heap)
+        allocatedBytesTotal += heap.size
+
+        #if DEBUG
+        print("✅ TexturePool: Created \(heap.size / 1_048_576)MB heap (\(heaps.count) total)")
+        #endif
+
+        return heap.makeTexture(descriptor: descriptor)
     }
 }
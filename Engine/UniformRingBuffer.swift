@@ -0,0 +1,187 @@
+// UniformRingBuffer.swift
+// Film Camera - Per-frame uniform storage for pass params
+// ★★★ NEW: Params của cả command buffer nằm trong 1 MTLBuffer, pass chỉ bind offset ★★★
+
+import Foundation
+import Metal
+
+/// Ring of shared-memory regions, one per command buffer in flight
+///
+/// - FilterRenderer.beginFrame lấy 1 region rảnh, mỗi pass ghi params vào region (256-byte aligned),
+///   finishFrame trả region khi GPU xong command buffer → CPU không ghi đè params GPU đang đọc
+/// - regionCount mặc định = PreviewFramePacer.maxFramesInFlight (triple buffering)
+/// - Hết region rảnh (capture song song preview) → thêm region, tối đa maxRegionCount
+/// - Không bao giờ block render thread: hết chỗ → allocate trả nil, caller fallback setBytes
+final class UniformRingBuffer {
+
+    struct Allocation {
+        let buffer: MTLBuffer
+        let offset: Int
+    }
+
+    /// Buffer offset alignment cho constant address space (256 đủ cho mọi GPU family)
+    static let alignment = 256
+
+    /// Bytes per region (full capture chain ≈ 30 passes × ≤ 2KB params)
+    static let regionSize = 64 * 1024
+
+    static let maxRegionCount = 8
+
+    private final class Region {
+        let buffer: MTLBuffer
+        var cursor = 0
+        var isBusy = false
+
+        init(buffer: MTLBuffer) {
+            self.buffer = buffer
+        }
+    }
+
+    private let device: MTLDevice
+    private var regions: [Region] = []
+    private let lock = NSLock()
+
+    /// Region của frame đang encode (chỉ thread encode đụng tới)
+    private var current: Region?
+
+    // Stats
+    private var frameCount = 0
+    private var allocationCount = 0
+    private var fallbackCount = 0
+    private var peakBytes = 0
+
+    init(device: MTLDevice, regionCount: Int = PreviewFramePacer.maxFramesInFlight) {
+        self.device = device
+
+        lock.lock()
+        for _ in 0..<regionCount {
+            guard let region = makeRegion() else { break }
+            regions.append(region)
+        }
+        lock.unlock()
+    }
+
+    // MARK: - Frame
+
+    /// Open a region for the command buffer about to be encoded; false → passes dùng setBytes
+    @discardableResult
+    func beginFrame() -> Bool {
+        // Frame trước bỏ dở (encode lỗi, không commit) → region chưa từng lên GPU, dùng lại
+        if let region = current {
+            region.cursor = 0
+            return true
+        }
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        frameCount += 1
+        if let region = regions.first(where: { !$0.isBusy }) ?? appendRegion() {
+            region.isBusy = true
+            region.cursor = 0
+            current = region
+            return true
+        }
+
+        #if DEBUG
+        print("⚠️ UniformRingBuffer: All \(regions.count) regions in flight - falling back to setBytes")
+        #endif
+        return false
+    }
+
+    /// Copy value into the current region; nil when no frame is open or the region is full
+    func allocate<T>(_ value: inout T) -> Allocation? {
+        guard let region = current else {
+            record(fallback: true)
+            return nil
+        }
+
+        let length = MemoryLayout<T>.stride
+        let offset = (region.cursor + Self.alignment - 1) & ~(Self.alignment - 1)
+        guard offset + length <= region.buffer.length else {
+            record(fallback: true)
+            return nil
+        }
+
+        withUnsafeBytes(of: &value) { bytes in
+            region.buffer.contents().advanced(by: offset).copyMemory(from: bytes.baseAddress!, byteCount: length)
+        }
+        region.cursor = offset + length
+        record(fallback: false)
+        return Allocation(buffer: region.buffer, offset: offset)
+    }
+
+    /// Release the current region once commandBuffer completes (gọi trước commit)
+    func endFrame(_ commandBuffer: MTLCommandBuffer) {
+        guard let region = current else { return }
+        current = nil
+
+        lock.lock()
+        peakBytes = max(peakBytes, region.cursor)
+        lock.unlock()
+
+        commandBuffer.addCompletedHandler { [weak self] _ in
+            guard let self = self else { return }
+            self.lock.lock()
+            region.isBusy = false
+            self.lock.unlock()
+        }
+    }
+
+    func statistics() -> (regions: Int, frames: Int, allocations: Int, fallbacks: Int, peakBytes: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+        return (regions.count, frameCount, allocationCount, fallbackCount, peakBytes)
+    }
+
+    // MARK: - Private
+
+    private func record(fallback: Bool) {
+        lock.lock()
+        if fallback {
+            fallbackCount += 1
+        } else {
+            allocationCount += 1
+        }
+        lock.unlock()
+    }
+
+    /// Caller holds lock
+    private func appendRegion() -> Region? {
+        guard regions.count < Self.maxRegionCount, let region = makeRegion() else { return nil }
+        regions.append(region)
+        #if DEBUG
+        print("📊 UniformRingBuffer: Grew to \(regions.count) regions")
+        #endif
+        return region
+    }
+
+    private func makeRegion() -> Region? {
+        guard let buffer = device.makeBuffer(length: Self.regionSize, options: [.storageModeShared, .cpuCacheModeWriteCombined]) else {
+            print("❌ UniformRingBuffer: Failed to allocate \(Self.regionSize) byte region")
+            return nil
+        }
+        buffer.label = "UniformRing"
+        return Region(buffer: buffer)
+    }
+}
+
+// MARK: - Packed Params
+
+/// Last packed Swift → ShaderTypes.h struct, rebuilt only when its config changes
+/// Preview gọi prepare*Params mỗi frame với cùng preset → so sánh config thay vì pack lại
+final class PackedParams<Config: Equatable, Params> {
+
+    private var config: Config?
+    private var params: Params?
+
+    func params(for config: Config, pack: (Config) -> Params) -> Params {
+        if let params = params, self.config == config {
+            return params
+        }
+        let packed = pack(config)
+        self.config = config
+        self.params = packed
+        return packed
+    }
+}
@@ -11,10 +11,15 @@ import SwiftUI
 struct Film_cameraApp: App {
 
     init() {
+        StartupMetrics.shared.mark(.appInit)
+
         // ★★★ FIX: Only preload LUTs if RenderEngine initializes successfully ★★★
         if RenderEngine.isAvailable {
             RenderEngine.shared.preloadAllLUTs()
             print("✅ Film_cameraApp: RenderEngine ready, preloading LUTs")
+
+            // ★ Launch argument `-runPipelineBenchmark YES` → PipelineBenchmark JSON trong Documents/Benchmarks
+            PipelineBenchmark.runFromLaunchArguments()
         } else {
             print("⚠️ Film_cameraApp: RenderEngine unavailable - check Metal shaders")
         }
@@ -40,13 +40,22 @@ struct UserAdjustments: Codable, Equatable {
     static let `default` = UserAdjustments()
 }
 
+// MARK: - Deferred Render
+/// Parameters that reproduce the filtered image from the original (original-only storage)
+struct DeferredRender: Codable, Equatable {
+    /// FilterRenderer.fixedFrameSeed used at capture → same grain / light leaks on every render
+    let seed: UInt32
+    /// Preset parameters when they differ from the built-in preset (nil → FilmPresets.preset(byId:))
+    var preset: FilterPreset?
+}
+
 // MARK: - Captured Photo
 /// Represents a photo captured and stored in the app's local gallery
 struct CapturedPhoto: Codable, Identifiable, Equatable {
     let id: UUID
     let createdAt: Date
-    let presetId: String
-    let presetLabel: String
+    var presetId: String
+    var presetLabel: String
 
     /// Relative path from Documents directory
     let originalFileName: String
@@ -56,6 +65,10 @@ struct CapturedPhoto: Codable, Identifiable, Equatable {
     var userAdjustments: UserAdjustments
     var isFavorite: Bool
 
+    /// Set when only the original is stored: filteredFileName is not written, the filtered
+    /// image is rendered on demand (nil in metadata written before original-only storage)
+    var deferredRender: DeferredRender?
+
     // MARK: - Computed Paths
 
     var originalPath: URL {
@@ -81,7 +94,8 @@ struct CapturedPhoto: Codable, Identifiable, Equatable {
         filteredFileName: String,
         thumbnailFileName: String,
         userAdjustments: UserAdjustments = .default,
-        isFavorite: Bool = false
+        isFavorite: Bool = false,
+        deferredRender: DeferredRender? = nil
     ) {
         self.id = id
         self.createdAt = createdAt
@@ -92,10 +106,16 @@ struct CapturedPhoto: Codable, Identifiable, Equatable {
         self.thumbnailFileName = thumbnailFileName
         self.userAdjustments = userAdjustments
         self.isFavorite = isFavorite
+        self.deferredRender = deferredRender
     }
 
     // MARK: - Convenience Methods
 
+    /// Filtered image has no file of its own (original-only storage)
+    var isFilterDeferred: Bool {
+        deferredRender != nil
+    }
+
     /// Format creation date for display
     var formattedDate: String {
         let formatter = DateFormatter()
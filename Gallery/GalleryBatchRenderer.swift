@@ -0,0 +1,423 @@
+//
+//  GalleryBatchRenderer.swift
+//  Film Camera
+//
+//  Background re-render of saved photos with a new preset
+//  (ImageIO decode → async GPU filter → bounded ImageIO encode)
+//
+
+import Foundation
+import UIKit
+import Metal
+import ImageIO
+import UniformTypeIdentifiers
+
+// MARK: - Batch Job
+
+/// Handle for one batch re-render: progress, cancellation, throughput
+final class GalleryBatchJob {
+
+    struct Progress {
+        let completed: Int
+        let failed: Int
+        let total: Int
+        let elapsed: CFAbsoluteTime
+        let isCancelled: Bool
+
+        var finished: Int { completed + failed }
+
+        var fractionCompleted: Double {
+            total > 0 ? Double(finished) / Double(total) : 1
+        }
+
+        /// Headline metric: successfully re-rendered photos per second
+        var photosPerSecond: Double {
+            elapsed > 0 ? Double(completed) / elapsed : 0
+        }
+    }
+
+    let preset: FilterPreset
+    let total: Int
+
+    /// Called on the main queue after every finished photo
+    var onProgress: ((Progress) -> Void)?
+
+    /// Called once on the main queue when every photo finished or the job was cancelled
+    var onComplete: ((Progress) -> Void)?
+
+    private var completed = 0
+    private var failed = 0
+    private var cancelled = false
+    private let startTime = CFAbsoluteTimeGetCurrent()
+    private let lock = NSLock()
+
+    init(preset: FilterPreset, total: Int) {
+        self.preset = preset
+        self.total = total
+    }
+
+    /// Stop after the photos already in flight (finished photos keep the new preset)
+    func cancel() {
+        lock.lock()
+        cancelled = true
+        lock.unlock()
+    }
+
+    var isCancelled: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return cancelled
+    }
+
+    var progress: Progress {
+        lock.lock()
+        defer { lock.unlock() }
+        return Progress(
+            completed: completed,
+            failed: failed,
+            total: total,
+            elapsed: CFAbsoluteTimeGetCurrent() - startTime,
+            isCancelled: cancelled
+        )
+    }
+
+    fileprivate func record(success: Bool) -> Progress {
+        lock.lock()
+        if success {
+            completed += 1
+        } else {
+            failed += 1
+        }
+        lock.unlock()
+        return progress
+    }
+}
+
+// MARK: - Batch Renderer
+
+/// Pipelines gallery photos through decode → GPU → encode with a fixed memory ceiling
+///
+/// - Decode: ImageIO on a serial queue, sensor orientation (như capture), downsampled to maxPixelSize when given
+///   (no UIImage, no full-size decode for reduced outputs); EXIF orientation đi theo output làm metadata
+/// - GPU: FilterRenderer.renderAsync (full capture chain) into a ReadbackSurface,
+///   completion-driven — no thread waits on the GPU
+/// - Encode: ImageIO (file's own container, HEIC for new photos) on an OperationQueue limited to maxConcurrentEncodes
+/// - maxPhotosInFlight bounds decoded-but-not-written photos → memory stays flat for any library size
+final class GalleryBatchRenderer {
+
+    struct Output {
+        let filteredQuality: CGFloat
+        let thumbnailQuality: CGFloat
+    }
+
+    /// Photos between decode start and encode finish (each 12MP ≈ 48MB input + 48MB output)
+    let maxPhotosInFlight: Int
+
+    private let output: Output
+    private let window: DispatchSemaphore
+    private let decodeQueue = DispatchQueue(label: "com.filmcamera.gallery.batch.decode", qos: .utility)
+    private let encodeQueue: OperationQueue
+    private var idleRenderers: [FilterRenderer] = []
+    private let lock = NSLock()
+
+    init(output: Output, maxPhotosInFlight: Int = 3, maxConcurrentEncodes: Int = 2) {
+        self.output = output
+        self.maxPhotosInFlight = maxPhotosInFlight
+        self.window = DispatchSemaphore(value: maxPhotosInFlight)
+
+        encodeQueue = OperationQueue()
+        encodeQueue.name = "com.filmcamera.gallery.batch.encode"
+        encodeQueue.qualityOfService = .utility
+        encodeQueue.maxConcurrentOperationCount = maxConcurrentEncodes
+    }
+
+    /// Start re-rendering photos with job.preset
+    /// - photoFinished: main queue, for each photo whose files were replaced
+    /// - jobFinished: main queue, once, before job.onComplete
+    func start(
+        _ job: GalleryBatchJob,
+        photos: [CapturedPhoto],
+        maxPixelSize: Int?,
+        photoFinished: @escaping (CapturedPhoto) -> Void,
+        jobFinished: @escaping () -> Void
+    ) {
+        let group = DispatchGroup()
+        let stream = RenderEngine.isAvailable ? RenderEngine.shared.stream(.capture) : nil
+        stream?.beginWork()
+
+        decodeQueue.async { [self] in
+            for photo in photos {
+                guard !job.isCancelled else { break }
+
+                // Back-pressure: wait for a slot before decoding the next original
+                window.wait()
+                guard !job.isCancelled else {
+                    window.signal()
+                    break
+                }
+
+                group.enter()
+                process(photo, job: job, maxPixelSize: maxPixelSize) { success in
+                    self.window.signal()
+                    let progress = job.record(success: success)
+                    DispatchQueue.main.async {
+                        if success {
+                            photoFinished(photo)
+                        }
+                        job.onProgress?(progress)
+                    }
+                    group.leave()
+                }
+            }
+
+            group.notify(queue: .main) {
+                let progress = job.progress
+                let texturePool = stream?.texturePool.statistics()
+                print("📊 [GalleryBatch] \(progress.completed)/\(progress.total) photos in \(String(format: "%.1f", progress.elapsed))s - \(String(format: "%.2f", progress.photosPerSecond)) photos/s\(progress.failed > 0 ? ", \(progress.failed) failed" : "")\(progress.isCancelled ? " (cancelled)" : "")")
+                if let texturePool = texturePool {
+                    print("   TexturePool peak \(texturePool.peakBytes / 1_048_576)MB, \(self.maxPhotosInFlight) photos in flight")
+                }
+                // Batch xong → capture pool purge sau idlePurgeDelay (peak của batch không ở lại)
+                stream?.endWork()
+                jobFinished()
+                job.onComplete?(progress)
+            }
+        }
+    }
+
+    // MARK: - Stages
+
+    /// Decode on decodeQueue, filter on the GPU, encode on encodeQueue; done(success) exactly once
+    private func process(_ photo: CapturedPhoto, job: GalleryBatchJob, maxPixelSize: Int?, done: @escaping (Bool) -> Void) {
+        // Original-only photos keep no filtered file → only the thumbnails need pixels, but rendered at
+        // full capture size: grain / dust are per-pixel → thumbnails giống hệt render on-demand sau này
+        let decodeSize = photo.isFilterDeferred ? nil : maxPixelSize
+
+        render(photo, preset: job.preset, seed: photo.deferredRender?.seed, maxPixelSize: decodeSize) { [weak self] filtered, orientation in
+            guard let self = self, let filtered = filtered else {
+                done(false)
+                return
+            }
+
+            // 3. Encode (bounded) — the CGImage wraps the readback memory until written
+            self.encodeQueue.addOperation {
+                let written: Bool = autoreleasepool {
+                    self.write(filtered, orientation: orientation, for: photo)
+                }
+                done(written)
+            }
+        }
+    }
+
+    /// Decode the original and run the full capture chain; completion(filtered, orientation) on a Metal completion thread
+    /// Also used for lazy renders of original-only photos: seed = capture seed + maxPixelSize nil
+    /// → same input pixels as PhotoProcessingPipeline → identical output
+    /// The CGImage is in sensor orientation (orientation = EXIF of the original, apply as metadata)
+    /// and wraps a ReadbackSurface (or a copy) — release it promptly
+    func render(
+        _ photo: CapturedPhoto,
+        preset: FilterPreset,
+        seed: UInt32?,
+        maxPixelSize: Int?,
+        completion: @escaping (CGImage?, UIImage.Orientation) -> Void
+    ) {
+        guard RenderEngine.isAvailable else {
+            completion(nil, .up)
+            return
+        }
+        let engine = RenderEngine.shared
+
+        // 1. Decode
+        let decoded = autoreleasepool {
+            Self.decodeImage(at: photo.originalPath, maxPixelSize: maxPixelSize)
+        }
+        guard let decoded = decoded, let inputTexture = engine.makeTexture(from: decoded.image) else {
+            print("[GalleryBatch] Failed to decode \(photo.originalFileName)")
+            completion(nil, .up)
+            return
+        }
+        let cgImage = decoded.image
+        let orientation = decoded.orientation
+
+        // 2. GPU → readback target (IOSurface zero-copy, fallback shared texture)
+        let outputTexture: MTLTexture
+        let readback: () -> CGImage?
+        if let surface = engine.readbackSurfaces.makeSurface(width: cgImage.width, height: cgImage.height) {
+            outputTexture = surface.texture
+            readback = { surface.makeCGImage() }
+        } else if let texture = engine.stream(.capture).texturePool.readableTexture(width: cgImage.width, height: cgImage.height) {
+            outputTexture = texture
+            readback = {
+                defer { engine.stream(.capture).texturePool.recycle(texture) }
+                return engine.textureToCGImage(texture: texture)
+            }
+        } else {
+            print("[GalleryBatch] Failed to create output texture")
+            completion(nil, orientation)
+            return
+        }
+
+        let renderer = dequeueRenderer()
+        renderer.fixedFrameSeed = seed
+        renderer.stampDate = photo.createdAt
+        renderer.renderAsync(
+            input: inputTexture,
+            output: outputTexture,
+            preset: preset,
+            commandQueue: renderer.stream.commandQueue
+        ) { [weak self] success in
+            self?.enqueueRenderer(renderer)
+
+            guard success else {
+                print("[GalleryBatch] Filter failed for \(photo.filteredFileName)")
+                completion(nil, orientation)
+                return
+            }
+            completion(readback(), orientation)
+        }
+    }
+
+    /// Replace filtered file atomically (original-only photos: none), then its thumbnail pyramid
+    /// Pixels stay in sensor orientation, orientation goes to metadata (same layout as a capture's files)
+    private func write(_ image: CGImage, orientation: UIImage.Orientation, for photo: CapturedPhoto) -> Bool {
+        guard photo.isFilterDeferred || Self.writeImage(image, to: photo.filteredPath, orientation: orientation, quality: output.filteredQuality) else {
+            print("[GalleryBatch] Failed to write \(photo.filteredFileName)")
+            return false
+        }
+        if let pyramid = ThumbnailPyramid.make(from: image, orientation: orientation) {
+            _ = pyramid.write(id: photo.id, to: photo.thumbnailPath.deletingLastPathComponent(), quality: output.thumbnailQuality)
+        }
+        return true
+    }
+
+    // MARK: - Renderers
+
+    /// One FilterRenderer per photo on the GPU (renderer state is per command buffer)
+    private func dequeueRenderer() -> FilterRenderer {
+        lock.lock()
+        defer { lock.unlock() }
+        return idleRenderers.popLast() ?? FilterRenderer(stream: RenderEngine.shared.stream(.capture))
+    }
+
+    private func enqueueRenderer(_ renderer: FilterRenderer) {
+        lock.lock()
+        idleRenderers.append(renderer)
+        lock.unlock()
+    }
+
+    // MARK: - ImageIO
+
+    /// Decode with ImageIO in sensor orientation; maxPixelSize → downsampled at decode time (nil = full size)
+    /// EXIF orientation is returned, not applied: camera HEIC originals are stored unrotated and the capture
+    /// (UIImage(data:).cgImage) filters those pixels — full-size decode here = the exact same input
+    static func decodeImage(at url: URL, maxPixelSize: Int?) -> (image: CGImage, orientation: UIImage.Orientation)? {
+        let sourceOptions = [kCGImageSourceShouldCache: false] as CFDictionary
+        guard let source = CGImageSourceCreateWithURL(url as CFURL, sourceOptions) else { return nil }
+
+        let properties = CGImageSourceCopyPropertiesAtIndex(source, 0, nil) as? [CFString: Any]
+        let orientation = (properties?[kCGImagePropertyOrientation] as? UInt32)
+            .flatMap(CGImagePropertyOrientation.init(rawValue:))
+            .map(UIImage.Orientation.init) ?? .up
+
+        let image: CGImage?
+        if let maxPixelSize = maxPixelSize, let fullSize = fullPixelSize(of: source), maxPixelSize < fullSize {
+            let options = [
+                kCGImageSourceCreateThumbnailFromImageAlways: true,
+                kCGImageSourceCreateThumbnailWithTransform: false,
+                kCGImageSourceShouldCacheImmediately: true,
+                kCGImageSourceThumbnailMaxPixelSize: maxPixelSize
+            ] as CFDictionary
+            image = CGImageSourceCreateThumbnailAtIndex(source, 0, options)
+        } else {
+            image = CGImageSourceCreateImageAtIndex(source, 0, [kCGImageSourceShouldCacheImmediately: true] as CFDictionary)
+        }
+        return image.map { ($0, orientation) }
+    }
+
+    private static func fullPixelSize(of source: CGImageSource) -> Int? {
+        guard let properties = CGImageSourceCopyPropertiesAtIndex(source, 0, nil) as? [CFString: Any],
+              let width = properties[kCGImagePropertyPixelWidth] as? Int,
+              let height = properties[kCGImagePropertyPixelHeight] as? Int else {
+            return nil
+        }
+        return max(width, height)
+    }
+
+    /// Encode into a temp file, then swap it in (readers never see a partial file)
+    /// Container follows the file extension: .heic/.jpg written before HEIC keep their format
+    static func writeImage(_ image: CGImage, to url: URL, orientation: UIImage.Orientation, quality: CGFloat) -> Bool {
+        let tempURL = url.deletingLastPathComponent().appendingPathComponent(".\(UUID().uuidString).tmp")
+        let type = UTType(filenameExtension: url.pathExtension) ?? PhotoEncoder.fileType
+        guard let destination = CGImageDestinationCreateWithURL(tempURL as CFURL, type.identifier as CFString, 1, nil) else {
+            return false
+        }
+
+        let properties = [
+            kCGImageDestinationLossyCompressionQuality: quality,
+            kCGImagePropertyOrientation: CGImagePropertyOrientation(orientation).rawValue
+        ] as CFDictionary
+        CGImageDestinationAddImage(destination, image, properties)
+        guard CGImageDestinationFinalize(destination) else {
+            try? FileManager.default.removeItem(at: tempURL)
+            return false
+        }
+
+        do {
+            _ = try FileManager.default.replaceItemAt(url, withItemAt: tempURL)
+            return true
+        } catch {
+            try? FileManager.default.removeItem(at: tempURL)
+            return false
+        }
+    }
+
+    /// Aspect-fit downscale so the long side ≤ maxPixelSize (already small enough → image itself)
+    static func downsample(_ image: CGImage, maxPixelSize: Int) -> CGImage? {
+        let longSide = max(image.width, image.height)
+        guard longSide > maxPixelSize else { return image }
+
+        let scale = CGFloat(maxPixelSize) / CGFloat(longSide)
+        let width = max(1, Int((CGFloat(image.width) * scale).rounded()))
+        let height = max(1, Int((CGFloat(image.height) * scale).rounded()))
+
+        guard let context = CGContext(
+            data: nil,
+            width: width,
+            height: height,
+            bitsPerComponent: 8,
+            bytesPerRow: 0,
+            space: CGColorSpaceCreateDeviceRGB(),
+            bitmapInfo: CGImageAlphaInfo.noneSkipLast.rawValue
+        ) else { return nil }
+
+        context.interpolationQuality = .high
+        context.draw(image, in: CGRect(x: 0, y: 0, width: width, height: height))
+        return context.makeImage()
+    }
+
+    /// Aspect-fill + center crop to size × size pixels
+    static func squareThumbnail(of image: CGImage, size: Int) -> CGImage? {
+        let scale = CGFloat(size) / CGFloat(min(image.width, image.height))
+        let width = CGFloat(image.width) * scale
+        let height = CGFloat(image.height) * scale
+
+        guard let context = CGContext(
+            data: nil,
+            width: size,
+            height: size,
+            bitsPerComponent: 8,
+            bytesPerRow: 0,
+            space: CGColorSpaceCreateDeviceRGB(),
+            bitmapInfo: CGImageAlphaInfo.noneSkipLast.rawValue
+        ) else { return nil }
+
+        context.interpolationQuality = .high
+        context.draw(image, in: CGRect(
+            x: (CGFloat(size) - width) / 2,
+            y: (CGFloat(size) - height) / 2,
+            width: width,
+            height: height
+        ))
+        return context.makeImage()
+    }
+}
@@ -9,6 +9,8 @@ import Foundation
 import UIKit
 import Photos
 import Combine
+import os
+import ImageIO
 
 final class GalleryManager: ObservableObject {
 
@@ -39,20 +41,79 @@ final class GalleryManager: ObservableObject {
         documentsDirectory.appendingPathComponent("photos_metadata.json")
     }
 
+    /// Full-size renders of original-only photos handed to the share sheet (removed after sharing / at launch)
+    static var sharedRendersDirectory: URL {
+        FileManager.default.temporaryDirectory.appendingPathComponent("SharedRenders", isDirectory: true)
+    }
+
     // MARK: - Configuration
 
-    private let thumbnailSize: CGFloat = 450 // For @3x Retina displays
+    private let jpegQualityOriginal: CGFloat = 0.95  // Only when camera bytes are unavailable
     private let jpegQualityFiltered: CGFloat = 0.88
     private let jpegQualityThumbnail: CGFloat = 0.75
 
+    private static let storageModeKey = "galleryStorageMode"
+
+    /// Original + filtered files, or original only with the filtered image rendered on demand (GalleryView menu)
+    /// Applies to new captures — saved photos keep their storage (CapturedPhoto.deferredRender), both kinds load the same way
+    @Published var storageMode: PhotoStorageMode = GalleryManager.savedStorageMode {
+        didSet { UserDefaults.standard.set(storageMode.rawValue, forKey: Self.storageModeKey) }
+    }
+
+    private static var savedStorageMode: PhotoStorageMode {
+        UserDefaults.standard.string(forKey: storageModeKey).flatMap(PhotoStorageMode.init) ?? .originalAndFiltered
+    }
+
+    /// Decoded thumbnails kept in memory (cost = decoded bytes)
+    private static let thumbnailCacheBytes = 48 * 1024 * 1024
+
+    /// Grid cells ahead of the last visible one decoded in the background
+    let thumbnailPrefetchDistance = 18
+
     // MARK: - Thumbnail Cache
 
-    private var thumbnailCache = NSCache<NSString, UIImage>()
+    // Not lazy: read from the thumbnail/prefetch queues concurrently
+    private let thumbnailCache: NSCache<NSString, UIImage> = {
+        let cache = NSCache<NSString, UIImage>()
+        cache.totalCostLimit = GalleryManager.thumbnailCacheBytes
+        return cache
+    }()
 
     // MARK: - Private Queue
 
     private let fileQueue = DispatchQueue(label: "com.filmcamera.gallery.file", qos: .userInitiated)
 
+    /// Visible-cell thumbnail decodes, off the serial file queue (writes không chặn grid)
+    /// Bounded → fling nhanh không spawn 1 thread / cell; cell rời màn hình huỷ decode của nó (loadThumbnailAsync)
+    private let thumbnailQueue: OperationQueue = {
+        let queue = OperationQueue()
+        queue.name = "com.filmcamera.gallery.thumbnail"
+        queue.qualityOfService = .userInitiated
+        queue.maxConcurrentOperationCount = 3
+        return queue
+    }()
+
+    /// Photos with no thumbnail file at all and no decodable source → không thử lại mỗi lần cell hiện
+    private var missingThumbnails: Set<UUID> = []
+    private let missingThumbnailsLock = NSLock()
+
+    private let prefetchQueue: OperationQueue = {
+        let queue = OperationQueue()
+        queue.name = "com.filmcamera.gallery.prefetch"
+        queue.qualityOfService = .utility
+        queue.maxConcurrentOperationCount = 2
+        return queue
+    }()
+    private var prefetchOperations: [NSString: Operation] = [:]
+    private let prefetchLock = NSLock()
+
+    // MARK: - Batch Re-render
+
+    private lazy var batchRenderer = GalleryBatchRenderer(output: .init(
+        filteredQuality: jpegQualityFiltered,
+        thumbnailQuality: jpegQualityThumbnail
+    ))
+
     // MARK: - Initialization
 
     private init() {
@@ -71,6 +132,9 @@ final class GalleryManager: ObservableObject {
         } catch {
             print("[GalleryManager] Failed to create directories: \(error)")
         }
+
+        // Share sheet bị kill giữa chừng → file render tạm của lần chạy trước
+        try? fm.removeItem(at: Self.sharedRendersDirectory)
     }
 
     private func setupMemoryWarningObserver() {
@@ -86,6 +150,9 @@ final class GalleryManager: ObservableObject {
     // MARK: - CRUD Operations
 
     /// Save a captured photo with its preset to the gallery
+    /// - Original: camera file stored as-is when PhotoProcessingPipeline attached it (HEIC, no re-encode)
+    /// - Filtered: ImageIO HEIC/JPEG straight from the rendered CGImage (orientation in metadata,
+    ///   no UIKit redraw); skipped in .originalOnly storage
     /// - Parameters:
     ///   - originalImage: The unfiltered image from camera
     ///   - filteredImage: The image with filter applied
@@ -97,22 +164,23 @@ final class GalleryManager: ObservableObject {
         preset: FilterPreset
     ) async -> CapturedPhoto? {
         let id = UUID()
-        let originalFileName = "\(id.uuidString)_original.jpg"
-        let filteredFileName = "\(id.uuidString)_filtered.jpg"
-        let thumbnailFileName = "\(id.uuidString)_thumb.jpg"
+        let source = CaptureSource.attached(to: originalImage)
+        let sourceType = source.flatMap { PhotoEncoder.fileType(of: $0.data) }
+        let originalExtension = sourceType?.preferredFilenameExtension ?? PhotoEncoder.fileExtension
+        let originalFileName = "\(id.uuidString)_original.\(originalExtension)"
+        let filteredFileName = "\(id.uuidString)_filtered.\(PhotoEncoder.fileExtension)"
+        let thumbnailFileName = ThumbnailPyramid.fileName(for: id, level: .medium)
 
-        // Normalize image orientation
-        let normalizedOriginal = originalImage.normalizedOrientation()
-        let normalizedFiltered = filteredImage.normalizedOrientation()
+        // Original-only needs the capture seed to reproduce the render later
+        let deferredRender: DeferredRender? = storageMode == .originalOnly ? source.map {
+            DeferredRender(seed: $0.renderSeed, preset: preset == FilmPresets.preset(byId: preset.id) ? nil : preset)
+        } : nil
 
-        // Generate thumbnail from filtered image
-        guard let thumbnail = generateThumbnail(from: normalizedFiltered) else {
-            print("[GalleryManager] Failed to generate thumbnail")
-            return nil
-        }
+        // Thumbnail pyramid rendered on the GPU with the capture (nil → ImageIO from the encoded filtered image)
+        let capturedThumbnails = ThumbnailPyramid.attached(to: filteredImage)
 
         // Write files on background queue
-        let success = await withCheckedContinuation { continuation in
+        let pyramid: ThumbnailPyramid? = await withCheckedContinuation { continuation in
             fileQueue.async {
                 let fm = FileManager.default
 
@@ -121,66 +189,79 @@ final class GalleryManager: ObservableObject {
                    let freeSpace = attrs[.systemFreeSize] as? Int64,
                    freeSpace < 10_000_000 {
                     print("[GalleryManager] Insufficient disk space")
-                    continuation.resume(returning: false)
+                    continuation.resume(returning: nil)
                     return
                 }
 
-                // Write original (high quality)
+                // Encode (signpost "Encode" nối tiếp Capture/Filter của PhotoProcessingPipeline)
+                let signposter = RenderInstrumentation.signposter
+                let encodeInterval = signposter.beginInterval("Encode", id: signposter.makeSignpostID())
+                let encodedOriginal = sourceType != nil ? source?.data : PhotoEncoder.encode(originalImage, quality: self.jpegQualityOriginal)
+                let encodedFiltered = deferredRender != nil ? nil : PhotoEncoder.encode(filteredImage, quality: self.jpegQualityFiltered)
+                let encodedPyramid = capturedThumbnails ?? encodedFiltered.flatMap { ThumbnailPyramid.make(fromEncoded: $0) }
+                signposter.endInterval("Encode", encodeInterval)
+
+                // Write original (camera file or high quality encode)
                 let originalPath = Self.photosDirectory.appendingPathComponent(originalFileName)
-                guard let originalData = normalizedOriginal.jpegData(compressionQuality: 0.95) else {
-                    continuation.resume(returning: false)
+                guard let originalData = encodedOriginal else {
+                    continuation.resume(returning: nil)
                     return
                 }
 
-                // Write filtered
+                // Write filtered (nil only when deferred)
                 let filteredPath = Self.photosDirectory.appendingPathComponent(filteredFileName)
-                guard let filteredData = normalizedFiltered.jpegData(compressionQuality: self.jpegQualityFiltered) else {
-                    continuation.resume(returning: false)
+                guard encodedFiltered != nil || deferredRender != nil else {
+                    continuation.resume(returning: nil)
                     return
                 }
 
-                // Write thumbnail
-                let thumbnailPath = Self.thumbnailsDirectory.appendingPathComponent(thumbnailFileName)
-                guard let thumbnailData = thumbnail.jpegData(compressionQuality: self.jpegQualityThumbnail) else {
-                    continuation.resume(returning: false)
+                // Thumbnails (150 / 450 / 1200 px) — the only filtered pixels stored for deferred photos
+                guard let pyramid = encodedPyramid else {
+                    print("[GalleryManager] Failed to generate thumbnails")
+                    continuation.resume(returning: nil)
                     return
                 }
 
                 do {
                     try originalData.write(to: originalPath, options: .atomic)
-                    try filteredData.write(to: filteredPath, options: .atomic)
-                    try thumbnailData.write(to: thumbnailPath, options: .atomic)
-                    continuation.resume(returning: true)
+                    try encodedFiltered?.write(to: filteredPath, options: .atomic)
+                    guard pyramid.write(id: id, to: Self.thumbnailsDirectory, quality: self.jpegQualityThumbnail) else {
+                        throw CocoaError(.fileWriteUnknown)
+                    }
+                    continuation.resume(returning: pyramid)
                 } catch {
                     print("[GalleryManager] Failed to write files: \(error)")
                     // Cleanup partial writes
                     try? fm.removeItem(at: originalPath)
                     try? fm.removeItem(at: filteredPath)
-                    try? fm.removeItem(at: thumbnailPath)
-                    continuation.resume(returning: false)
+                    Self.removeThumbnails(for: id)
+                    continuation.resume(returning: nil)
                 }
             }
         }
 
-        guard success else { return nil }
+        guard let pyramid = pyramid else { return nil }
 
         // Create photo model
         let photo = CapturedPhoto(
             id: id,
-            createdAt: Date(),
+            createdAt: source?.capturedAt ?? Date(),
             presetId: preset.id,
             presetLabel: preset.label,
             originalFileName: originalFileName,
             filteredFileName: filteredFileName,
-            thumbnailFileName: thumbnailFileName
+            thumbnailFileName: thumbnailFileName,
+            deferredRender: deferredRender
         )
 
         // Add to collection and save metadata
         photos.insert(photo, at: 0) // Most recent first
         await saveMetadata()
 
-        // Cache thumbnail
-        thumbnailCache.setObject(thumbnail, forKey: id.uuidString as NSString)
+        // Cache thumbnails (grid + camera button hiện ngay, không decode lại từ đĩa)
+        for (level, image) in pyramid.images {
+            cacheThumbnail(UIImage(cgImage: image, scale: 1, orientation: pyramid.orientation), id: id, level: level)
+        }
 
         return photo
     }
@@ -232,13 +313,14 @@ final class GalleryManager: ObservableObject {
                 try? fm.removeItem(at: photo.originalPath)
                 try? fm.removeItem(at: photo.filteredPath)
                 try? fm.removeItem(at: photo.thumbnailPath)
+                Self.removeThumbnails(for: photo.id)
                 continuation.resume()
             }
         }
 
         // Remove from collection
         photos.remove(at: index)
-        thumbnailCache.removeObject(forKey: id.uuidString as NSString)
+        removeCachedThumbnails(id: id)
         await saveMetadata()
 
         return true
@@ -251,131 +333,279 @@ final class GalleryManager: ObservableObject {
         }
     }
 
-    // MARK: - Thumbnail Operations
+    /// Re-apply a preset to many photos in the background
+    /// - Decode, GPU filter and JPEG encode run pipelined on their own queues; memory is bounded
+    ///   by GalleryBatchRenderer.maxPhotosInFlight regardless of how many photos are passed
+    /// - maxPixelSize: downsample originals at decode time (nil = full resolution)
+    /// - Each finished photo is updated in `photos` immediately; metadata is saved once at the end
+    ///   (also after cancel(), for the photos that finished)
+    /// - Returns: job for progress / cancellation; set its callbacks right away (main queue)
+    @discardableResult
+    func reRender(_ photos: [CapturedPhoto], with preset: FilterPreset, maxPixelSize: Int? = nil) -> GalleryBatchJob {
+        let job = GalleryBatchJob(preset: preset, total: photos.count)
+
+        batchRenderer.start(job, photos: photos, maxPixelSize: maxPixelSize, photoFinished: { [weak self] photo in
+            guard let self = self, let index = self.photos.firstIndex(where: { $0.id == photo.id }) else { return }
+            self.photos[index].presetId = preset.id
+            self.photos[index].presetLabel = preset.label
+            self.photos[index].deferredRender?.preset = preset == FilmPresets.preset(byId: preset.id) ? nil : preset
+            self.removeCachedThumbnails(id: photo.id)
+        }, jobFinished: { [weak self] in
+            Task {
+                await self?.saveMetadata()
+            }
+        })
 
-    /// Generate thumbnail from image
-    private func generateThumbnail(from image: UIImage) -> UIImage? {
-        let size = CGSize(width: thumbnailSize, height: thumbnailSize)
-        let aspectRatio = image.size.width / image.size.height
+        return job
+    }
 
-        var targetSize: CGSize
-        if aspectRatio > 1 {
-            // Landscape - fit height
-            targetSize = CGSize(width: size.height * aspectRatio, height: size.height)
-        } else {
-            // Portrait - fit width
-            targetSize = CGSize(width: size.width, height: size.width / aspectRatio)
-        }
+    // MARK: - Thumbnail Operations
 
-        let renderer = UIGraphicsImageRenderer(size: targetSize)
-        let resized = renderer.image { _ in
-            image.draw(in: CGRect(origin: .zero, size: targetSize))
-        }
+    /// Thumbnail from the memory cache only (no I/O, safe on the main thread during scrolling)
+    func cachedThumbnail(id: UUID, level: ThumbnailLevel = .medium) -> UIImage? {
+        thumbnailCache.object(forKey: Self.thumbnailKey(id, level))
+    }
 
-        // Center crop to square
-        let cropRect = CGRect(
-            x: (targetSize.width - size.width) / 2,
-            y: (targetSize.height - size.height) / 2,
-            width: size.width,
-            height: size.height
-        )
+    /// Load thumbnail with caching (synchronous ImageIO decode — prefer loadThumbnailAsync on the main thread)
+    func loadThumbnail(id: UUID, level: ThumbnailLevel = .medium) -> UIImage? {
+        if let cached = cachedThumbnail(id: id, level: level) {
+            return cached
+        }
 
-        guard let cgImage = resized.cgImage?.cropping(to: cropRect) else {
+        guard let photo = photos.first(where: { $0.id == id }) else {
             return nil
         }
 
-        return UIImage(cgImage: cgImage)
+        return decodeThumbnail(for: photo, level: level)
     }
 
-    /// Load thumbnail with caching
-    func loadThumbnail(id: UUID) -> UIImage? {
-        let cacheKey = id.uuidString as NSString
-
-        // Check cache first
-        if let cached = thumbnailCache.object(forKey: cacheKey) {
+    /// Load thumbnail asynchronously (decoded off the main thread, ready to draw)
+    /// Task cancelled (SwiftUI .task của cell scroll khỏi màn hình) → decode còn trong hàng đợi bị huỷ, trả nil
+    func loadThumbnailAsync(id: UUID, level: ThumbnailLevel = .medium) async -> UIImage? {
+        if let cached = cachedThumbnail(id: id, level: level) {
             return cached
         }
 
-        // Find photo
         guard let photo = photos.first(where: { $0.id == id }) else {
             return nil
         }
 
-        // Load from disk
-        guard let image = UIImage(contentsOfFile: photo.thumbnailPath.path) else {
-            return nil
+        let operation = BlockOperation()
+        var image: UIImage?
+        operation.addExecutionBlock { [weak self, unowned operation] in
+            guard let self = self, !operation.isCancelled else { return }
+            image = self.decodeThumbnail(for: photo, level: level)
         }
 
-        // Cache and return
-        thumbnailCache.setObject(image, forKey: cacheKey)
-        return image
+        return await withTaskCancellationHandler {
+            await withCheckedContinuation { continuation in
+                // Cancelled trước khi chạy → execution block bỏ qua, completionBlock vẫn được gọi
+                operation.completionBlock = {
+                    continuation.resume(returning: image)
+                }
+                thumbnailQueue.addOperation(operation)
+            }
+        } onCancel: {
+            operation.cancel()
+        }
     }
 
-    /// Load thumbnail asynchronously
-    func loadThumbnailAsync(id: UUID) async -> UIImage? {
-        let cacheKey = id.uuidString as NSString
+    /// Decode thumbnails for cells about to scroll into view
+    /// Replaces the previous prefetch window: queued decodes for photos no longer in it are cancelled
+    func prefetchThumbnails(for photos: [CapturedPhoto], level: ThumbnailLevel = .medium) {
+        let wanted = Dictionary(photos.map { (Self.thumbnailKey($0.id, level), $0) }, uniquingKeysWith: { first, _ in first })
 
-        // Check cache first
-        if let cached = thumbnailCache.object(forKey: cacheKey) {
-            return cached
+        prefetchLock.lock()
+        for (key, operation) in prefetchOperations where wanted[key] == nil {
+            operation.cancel()
+            prefetchOperations.removeValue(forKey: key)
         }
 
-        // Find photo
-        guard let photo = photos.first(where: { $0.id == id }) else {
-            return nil
+        for (key, photo) in wanted where prefetchOperations[key] == nil && thumbnailCache.object(forKey: key) == nil {
+            let operation = BlockOperation()
+            operation.addExecutionBlock { [weak self, weak operation] in
+                guard let self = self, operation?.isCancelled == false else { return }
+                _ = self.decodeThumbnail(for: photo, level: level)
+                self.prefetchLock.lock()
+                self.prefetchOperations.removeValue(forKey: key)
+                self.prefetchLock.unlock()
+            }
+            prefetchOperations[key] = operation
+            prefetchQueue.addOperation(operation)
+        }
+        prefetchLock.unlock()
+    }
+
+    /// Clear thumbnail cache
+    func clearThumbnailCache() {
+        thumbnailCache.removeAllObjects()
+        print("[GalleryManager] Thumbnail cache cleared")
+    }
+
+    // MARK: - Thumbnail Helpers
+
+    private static func thumbnailKey(_ id: UUID, _ level: ThumbnailLevel) -> NSString {
+        "\(id.uuidString)_\(level.pixelSize)" as NSString
+    }
+
+    private func cacheThumbnail(_ image: UIImage, id: UUID, level: ThumbnailLevel) {
+        let cost = image.cgImage.map { $0.bytesPerRow * $0.height } ?? 0
+        thumbnailCache.setObject(image, forKey: Self.thumbnailKey(id, level), cost: cost)
+    }
+
+    private func removeCachedThumbnails(id: UUID) {
+        for level in ThumbnailLevel.allCases {
+            thumbnailCache.removeObject(forKey: Self.thumbnailKey(id, level))
+        }
+        missingThumbnailsLock.lock()
+        missingThumbnails.remove(id)
+        missingThumbnailsLock.unlock()
+    }
+
+    private static func removeThumbnails(for id: UUID) {
+        for level in ThumbnailLevel.allCases {
+            try? FileManager.default.removeItem(at: thumbnailsDirectory.appendingPathComponent(ThumbnailPyramid.fileName(for: id, level: level)))
         }
+    }
 
-        // Load from disk on background
-        let image = await withCheckedContinuation { continuation in
+    /// Pyramid level → largest level on disk (level lớn hơn ảnh không bao giờ được ghi) →
+    /// levels written from the filtered image (photos saved before the pyramid, migrated on first load)
+    /// → legacy 450 px JPEG. Any thread; result is cached under the requested level
+    private func decodeThumbnail(for photo: CapturedPhoto, level: ThumbnailLevel) -> UIImage? {
+        missingThumbnailsLock.lock()
+        let knownMissing = missingThumbnails.contains(photo.id)
+        missingThumbnailsLock.unlock()
+        guard !knownMissing else { return nil }
+
+        let levelURLs = ([level] + ThumbnailLevel.allCases.sorted(by: >).filter { $0 != level }).map {
+            Self.thumbnailsDirectory.appendingPathComponent(ThumbnailPyramid.fileName(for: photo.id, level: $0))
+        }
+        var image = levelURLs.lazy.compactMap { ThumbnailPyramid.decodeImage(at: $0, maxPixelSize: level.pixelSize) }.first
+
+        if image == nil, let source = CGImageSourceCreateWithURL(photo.filteredPath as CFURL, nil),
+           let pyramid = ThumbnailPyramid.make(from: source) {
+            image = (pyramid.images[level] ?? pyramid.images.max { $0.key < $1.key }?.value).map { UIImage(cgImage: $0) }
+
+            // Trên fileQueue: delete() xoá file cùng queue → không ghi pyramid cho ảnh vừa bị xoá
+            let quality = jpegQualityThumbnail
             fileQueue.async {
-                let img = UIImage(contentsOfFile: photo.thumbnailPath.path)
-                continuation.resume(returning: img)
+                guard FileManager.default.fileExists(atPath: photo.filteredPath.path) else { return }
+                _ = pyramid.write(id: photo.id, to: Self.thumbnailsDirectory, quality: quality)
             }
         }
+        if image == nil {
+            image = ThumbnailPyramid.decodeImage(at: photo.thumbnailPath, maxPixelSize: level.pixelSize)
+        }
 
-        // Cache and return
         if let image = image {
-            thumbnailCache.setObject(image, forKey: cacheKey)
+            cacheThumbnail(image, id: photo.id, level: level)
+        } else {
+            missingThumbnailsLock.lock()
+            missingThumbnails.insert(photo.id)
+            missingThumbnailsLock.unlock()
         }
         return image
     }
 
-    /// Clear thumbnail cache
-    func clearThumbnailCache() {
-        thumbnailCache.removeAllObjects()
-        print("[GalleryManager] Thumbnail cache cleared")
-    }
-
     // MARK: - Full Image Loading
 
     /// Load filtered image for a photo
-    func loadFilteredImage(id: UUID) async -> UIImage? {
+    /// - maxPixelSize: downsample at decode time (e.g. screen size for display); nil = full resolution
+    /// Decoded on the file queue → drawing it never decodes JPEG on the main thread
+    /// Original-only photos are rendered from the full-size original (same pixels + seed as the capture),
+    /// then downsampled to maxPixelSize
+    func loadFilteredImage(id: UUID, maxPixelSize: Int? = nil) async -> UIImage? {
         guard let photo = photos.first(where: { $0.id == id }) else {
             return nil
         }
 
+        if photo.isFilterDeferred {
+            return await renderDeferred(photo, maxPixelSize: maxPixelSize)
+        }
+
         return await withCheckedContinuation { continuation in
             fileQueue.async {
-                let image = UIImage(contentsOfFile: photo.filteredPath.path)
+                let image = ThumbnailPyramid.decodeImage(at: photo.filteredPath, maxPixelSize: maxPixelSize)
                 continuation.resume(returning: image)
             }
         }
     }
 
     /// Load original image for a photo
-    func loadOriginalImage(id: UUID) async -> UIImage? {
+    /// - maxPixelSize: downsample at decode time; nil = full resolution
+    func loadOriginalImage(id: UUID, maxPixelSize: Int? = nil) async -> UIImage? {
         guard let photo = photos.first(where: { $0.id == id }) else {
             return nil
         }
 
         return await withCheckedContinuation { continuation in
             fileQueue.async {
-                let image = UIImage(contentsOfFile: photo.originalPath.path)
+                let image = ThumbnailPyramid.decodeImage(at: photo.originalPath, maxPixelSize: maxPixelSize)
                 continuation.resume(returning: image)
             }
         }
     }
 
+    /// File to share for a photo's filtered version
+    /// Original-only photos: rendered at full resolution into sharedRendersDirectory → finishSharing(_:) after the sheet
+    func filteredFileURL(id: UUID) async -> URL? {
+        guard let photo = photos.first(where: { $0.id == id }) else {
+            return nil
+        }
+        guard photo.isFilterDeferred else {
+            return photo.filteredPath
+        }
+
+        guard let rendered = await renderDeferred(photo, maxPixelSize: nil) else { return nil }
+        let directory = Self.sharedRendersDirectory
+        let url = directory.appendingPathComponent(photo.filteredFileName)
+        return await withCheckedContinuation { continuation in
+            DispatchQueue.global(qos: .userInitiated).async {
+                try? FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+                let encoded = PhotoEncoder.encode(rendered, quality: self.jpegQualityFiltered)
+                let written = (try? encoded?.write(to: url, options: .atomic)) != nil
+                continuation.resume(returning: written ? url : nil)
+            }
+        }
+    }
+
+    /// Share sheet closed: drop a temporary render from filteredFileURL (gallery files are left alone)
+    func finishSharing(_ url: URL) {
+        guard url.deletingLastPathComponent().standardizedFileURL == Self.sharedRendersDirectory.standardizedFileURL else { return }
+        DispatchQueue.global(qos: .utility).async {
+            try? FileManager.default.removeItem(at: url)
+        }
+    }
+
+    /// Render an original-only photo with its stored preset + seed exactly like the capture did:
+    /// full-size original in sensor orientation → filter → EXIF orientation as UIImage metadata,
+    /// maxPixelSize → downsampled after the render (grain / dust stay at capture scale)
+    /// Decode + render on a global queue: 12MP decode không chặn fileQueue (thumbnails, metadata, saves)
+    private func renderDeferred(_ photo: CapturedPhoto, maxPixelSize: Int?) async -> UIImage? {
+        guard let deferred = photo.deferredRender,
+              let preset = deferred.preset ?? FilmPresets.preset(byId: photo.presetId) else {
+            print("[GalleryManager] No preset to render \(photo.presetId)")
+            return nil
+        }
+
+        let renderer = batchRenderer
+        return await withCheckedContinuation { continuation in
+            DispatchQueue.global(qos: .userInitiated).async {
+                renderer.render(photo, preset: preset, seed: deferred.seed, maxPixelSize: nil) { image, orientation in
+                    guard let image = image else {
+                        continuation.resume(returning: nil)
+                        return
+                    }
+                    // Downsample off the Metal completion thread
+                    DispatchQueue.global(qos: .userInitiated).async {
+                        let output = maxPixelSize.flatMap { GalleryBatchRenderer.downsample(image, maxPixelSize: $0) } ?? image
+                        continuation.resume(returning: UIImage(cgImage: output, scale: 1, orientation: orientation))
+                    }
+                }
+            }
+        }
+    }
+
     // MARK: - Export
 
     /// Export photo to system Photo Library
@@ -450,9 +680,9 @@ final class GalleryManager: ObservableObject {
             decoder.dateDecodingStrategy = .iso8601
             let metadata = try decoder.decode(GalleryMetadata.self, from: data)
 
-            // Validate files exist
+            // Validate files exist (original-only photos have no filtered file — their original is the source)
             photos = metadata.photos.filter { photo in
-                FileManager.default.fileExists(atPath: photo.filteredPath.path)
+                FileManager.default.fileExists(atPath: (photo.isFilterDeferred ? photo.originalPath : photo.filteredPath).path)
             }
 
             // Remove orphaned photos from metadata if any were filtered
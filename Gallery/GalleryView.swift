@@ -54,6 +54,19 @@ struct GalleryView: View {
 
                 ToolbarItem(placement: .navigationBarTrailing) {
                     HStack(spacing: 16) {
+                        // Storage mode for new captures (Original Only = render filter on demand, ~½ disk)
+                        Menu {
+                            Picker("Storage", selection: $galleryManager.storageMode) {
+                                ForEach(PhotoStorageMode.allCases, id: \.self) { mode in
+                                    Label(mode.title, systemImage: mode.systemImage)
+                                        .tag(mode)
+                                }
+                            }
+                        } label: {
+                            Image(systemName: galleryManager.storageMode.systemImage)
+                                .foregroundColor(.white)
+                        }
+
                         // Favorites filter
                         Button {
                             withAnimation {
@@ -135,7 +148,7 @@ struct GalleryView: View {
     private var photoGrid: some View {
         ScrollView {
             LazyVGrid(columns: columns, spacing: 2) {
-                ForEach(displayedPhotos) { photo in
+                ForEach(Array(displayedPhotos.enumerated()), id: \.element.id) { index, photo in
                     PhotoThumbnailCell(
                         photo: photo,
                         isSelected: selectedIds.contains(photo.id),
@@ -154,12 +167,24 @@ struct GalleryView: View {
                             selectedIds.insert(photo.id)
                         }
                     }
+                    .onAppear {
+                        prefetchThumbnails(after: index)
+                    }
                 }
             }
             .padding(.bottom, isSelectionMode && !selectedIds.isEmpty ? 80 : 0)
         }
     }
 
+    /// Decode the cells just below the one appearing (LazyVGrid has no prefetch hook)
+    private func prefetchThumbnails(after index: Int) {
+        let photos = displayedPhotos
+        let start = index + 1
+        guard start < photos.count else { return }
+        let end = min(start + galleryManager.thumbnailPrefetchDistance, photos.count)
+        galleryManager.prefetchThumbnails(for: Array(photos[start..<end]))
+    }
+
     // MARK: - Selection Toolbar
 
     private var selectionToolbar: some View {
@@ -308,7 +333,10 @@ struct PhotoThumbnailCell: View {
         }
         .aspectRatio(1, contentMode: .fit)
         .task {
-            thumbnail = await galleryManager.loadThumbnailAsync(id: photo.id)
+            thumbnail = galleryManager.cachedThumbnail(id: photo.id)
+            if thumbnail == nil {
+                thumbnail = await galleryManager.loadThumbnailAsync(id: photo.id)
+            }
         }
     }
 }
@@ -16,6 +16,7 @@ struct PhotoDetailView: View {
     @State private var displayImage: UIImage?
     @State private var isLoading = true
     @State private var showShareSheet = false
+    @State private var shareURL: URL?
     @State private var showDeleteConfirmation = false
     @State private var showExportSuccess = false
     @State private var showOriginal = false
@@ -114,7 +115,10 @@ struct PhotoDetailView: View {
                         }
 
                         Button {
-                            showShareSheet = true
+                            Task {
+                                shareURL = await galleryManager.filteredFileURL(id: photo.id)
+                                showShareSheet = shareURL != nil
+                            }
                         } label: {
                             Label("Share", systemImage: "square.and.arrow.up")
                         }
@@ -168,9 +172,15 @@ struct PhotoDetailView: View {
             } message: {
                 Text("This photo will be permanently deleted from your gallery.")
             }
-            .sheet(isPresented: $showShareSheet) {
-                if let image = displayImage {
-                    ShareSheet(items: [image])
+            .sheet(isPresented: $showShareSheet, onDismiss: {
+                if let url = shareURL {
+                    galleryManager.finishSharing(url)
+                }
+                shareURL = nil
+            }) {
+                // Share the full-resolution file, not the screen-sized display image
+                if let url = shareURL {
+                    ShareSheet(items: [url])
                 }
             }
             .alert("Saved to Photos", isPresented: $showExportSuccess) {
@@ -240,11 +250,15 @@ struct PhotoDetailView: View {
     private func loadImages() async {
         isLoading = true
 
+        // Decode at screen resolution (12MP → ~3MP, no main-thread JPEG decode when drawn)
+        let screen = UIScreen.main
+        let maxPixelSize = Int(max(screen.bounds.width, screen.bounds.height) * screen.scale)
+
         // Load filtered image first (primary display)
-        displayImage = await galleryManager.loadFilteredImage(id: photo.id)
+        displayImage = await galleryManager.loadFilteredImage(id: photo.id, maxPixelSize: maxPixelSize)
 
         // Load original for comparison
-        originalImage = await galleryManager.loadOriginalImage(id: photo.id)
+        originalImage = await galleryManager.loadOriginalImage(id: photo.id, maxPixelSize: maxPixelSize)
 
         isLoading = false
     }
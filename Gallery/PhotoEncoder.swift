@@ -0,0 +1,113 @@
+//
+//  PhotoEncoder.swift
+//  Film Camera
+//
+//  ImageIO encode stage for saved photos: HEIC (hardware encoder) with JPEG
+//  fallback, camera-original passthrough and the original-only storage mode
+//
+
+import Foundation
+import UIKit
+import ImageIO
+import UniformTypeIdentifiers
+
+// MARK: - Storage Mode
+
+/// What GalleryManager writes for each capture
+enum PhotoStorageMode: String, CaseIterable {
+    /// Original + rendered filtered file
+    case originalAndFiltered
+    /// Original only; the filtered image is rendered on demand from CapturedPhoto.deferredRender
+    case originalOnly
+
+    var title: String {
+        switch self {
+        case .originalAndFiltered: return "Original + Filtered"
+        case .originalOnly: return "Original Only"
+        }
+    }
+
+    var systemImage: String {
+        switch self {
+        case .originalAndFiltered: return "photo.stack"
+        case .originalOnly: return "externaldrive"
+        }
+    }
+}
+
+// MARK: - Capture Source
+
+/// Camera bytes and render parameters of one capture
+/// Attached to the original UIImage by PhotoProcessingPipeline so GalleryManager.save can
+/// store the camera file as-is and reproduce the filtered render later
+struct CaptureSource {
+    let data: Data
+    let renderSeed: UInt32
+    let capturedAt: Date
+
+    private static var attachmentKey: UInt8 = 0
+
+    func attach(to image: UIImage) {
+        objc_setAssociatedObject(image, &Self.attachmentKey, Box(self), .OBJC_ASSOCIATION_RETAIN_NONATOMIC)
+    }
+
+    static func attached(to image: UIImage) -> CaptureSource? {
+        (objc_getAssociatedObject(image, &attachmentKey) as? Box)?.source
+    }
+
+    private final class Box {
+        let source: CaptureSource
+        init(_ source: CaptureSource) { self.source = source }
+    }
+}
+
+// MARK: - Photo Encoder
+
+/// Encodes straight from the CGImage the renderer produced (ReadbackSurface wraps the
+/// CVPixelBuffer, no copy) — orientation goes into metadata instead of redrawing the pixels
+enum PhotoEncoder {
+
+    /// HEIC when the device has a hardware encoder (A10+), JPEG otherwise
+    static let fileType: UTType = {
+        let supported = CGImageDestinationCopyTypeIdentifiers() as? [String] ?? []
+        return supported.contains(UTType.heic.identifier) ? .heic : .jpeg
+    }()
+
+    static var fileExtension: String {
+        fileType.preferredFilenameExtension ?? "jpg"
+    }
+
+    /// Container of already-encoded camera data (nil → not an image ImageIO can read)
+    static func fileType(of data: Data) -> UTType? {
+        guard let source = CGImageSourceCreateWithData(data as CFData, [kCGImageSourceShouldCache: false] as CFDictionary),
+              let identifier = CGImageSourceGetType(source) else {
+            return nil
+        }
+        return UTType(identifier as String)
+    }
+
+    /// Encode with fileType; nil on failure
+    static func encode(_ image: CGImage, orientation: UIImage.Orientation, quality: CGFloat) -> Data? {
+        let data = NSMutableData()
+        guard let destination = CGImageDestinationCreateWithData(data, fileType.identifier as CFString, 1, nil) else {
+            return nil
+        }
+
+        let properties = [
+            kCGImageDestinationLossyCompressionQuality: quality,
+            kCGImagePropertyOrientation: CGImagePropertyOrientation(orientation).rawValue
+        ] as CFDictionary
+        CGImageDestinationAddImage(destination, image, properties)
+        guard CGImageDestinationFinalize(destination) else { return nil }
+        return data as Data
+    }
+
+    /// UIImage variant: CGImage-backed images encode directly, others are redrawn once
+    static func encode(_ image: UIImage, quality: CGFloat) -> Data? {
+        if let cgImage = image.cgImage {
+            return encode(cgImage, orientation: image.imageOrientation, quality: quality)
+        }
+        guard let cgImage = image.normalizedOrientation().cgImage else { return nil }
+        return encode(cgImage, orientation: .up, quality: quality)
+    }
+}
@@ -0,0 +1,195 @@
+//
+//  ThumbnailPyramid.swift
+//  Film Camera
+//
+//  Multi-resolution square thumbnails (150 / 450 / 1200 px, HEIC)
+//  and ImageIO downsampled decoding for the gallery
+//
+
+import Foundation
+import UIKit
+import ImageIO
+import UniformTypeIdentifiers
+
+// MARK: - Thumbnail Level
+
+/// Square center-cropped thumbnail sizes stored per photo
+enum ThumbnailLevel: Int, CaseIterable, Comparable {
+    case small = 150    // Dense grids, camera "last photo" button
+    case medium = 450   // 3-column gallery grid (@3x)
+    case large = 1200   // Large cells (iPad, 1–2 column layouts)
+
+    var pixelSize: Int { rawValue }
+
+    static func < (lhs: ThumbnailLevel, rhs: ThumbnailLevel) -> Bool {
+        lhs.rawValue < rhs.rawValue
+    }
+
+    /// Smallest level covering a cell of the given size in pixels
+    static func fitting(pixels: CGFloat) -> ThumbnailLevel {
+        allCases.first { CGFloat($0.pixelSize) >= pixels } ?? .large
+    }
+}
+
+// MARK: - Thumbnail Pyramid
+
+/// One photo's thumbnails, largest first
+/// Capture path: rendered on the GPU in the same command buffer as the filter
+/// (FilterRenderer.renderAsync thumbnails:) and handed to GalleryManager.save attached to the filtered UIImage
+struct ThumbnailPyramid {
+
+    let images: [ThumbnailLevel: CGImage]
+
+    /// Orientation of the full image the thumbnails were cut from (GPU thumbnails are unrotated)
+    let orientation: UIImage.Orientation
+
+    private static var attachmentKey: UInt8 = 0
+
+    // MARK: - Capture Handoff
+
+    /// Attach to the filtered image so it travels with it to GalleryManager.save
+    func attach(to image: UIImage) {
+        objc_setAssociatedObject(image, &Self.attachmentKey, Box(self), .OBJC_ASSOCIATION_RETAIN_NONATOMIC)
+    }
+
+    /// Pyramid attached by the capture pipeline, if any
+    static func attached(to image: UIImage) -> ThumbnailPyramid? {
+        (objc_getAssociatedObject(image, &attachmentKey) as? Box)?.pyramid
+    }
+
+    private final class Box {
+        let pyramid: ThumbnailPyramid
+        init(_ pyramid: ThumbnailPyramid) { self.pyramid = pyramid }
+    }
+
+    // MARK: - CPU Fallback
+
+    /// Build from encoded image data with ImageIO (no full-size UIKit decode)
+    /// Used for re-rendered photos and photos saved without a GPU pyramid
+    static func make(fromEncoded data: Data) -> ThumbnailPyramid? {
+        guard let source = CGImageSourceCreateWithData(data as CFData, [kCGImageSourceShouldCache: false] as CFDictionary) else {
+            return nil
+        }
+        return make(from: source)
+    }
+
+    static func make(from source: CGImageSource) -> ThumbnailPyramid? {
+        guard let properties = CGImageSourceCopyPropertiesAtIndex(source, 0, nil) as? [CFString: Any],
+              let width = properties[kCGImagePropertyPixelWidth] as? Int,
+              let height = properties[kCGImagePropertyPixelHeight] as? Int,
+              width > 0, height > 0 else {
+            return nil
+        }
+
+        // Decode once at the size the largest level needs (short side = 1200), cut every level from it
+        let aspect = CGFloat(max(width, height)) / CGFloat(min(width, height))
+        let largest = ThumbnailLevel.allCases.max()!.pixelSize
+        let options = [
+            kCGImageSourceCreateThumbnailFromImageAlways: true,
+            kCGImageSourceCreateThumbnailWithTransform: true,
+            kCGImageSourceShouldCacheImmediately: true,
+            kCGImageSourceThumbnailMaxPixelSize: Int((CGFloat(min(largest, min(width, height))) * aspect).rounded(.up))
+        ] as CFDictionary
+        guard let decoded = CGImageSourceCreateThumbnailAtIndex(source, 0, options) else { return nil }
+        return make(from: decoded)
+    }
+
+    /// Cut every level from an already-decoded image (batch re-render output: sensor orientation + orientation)
+    /// Center square crop commutes with rotation → orientation stays metadata
+    static func make(from decoded: CGImage, orientation: UIImage.Orientation = .up) -> ThumbnailPyramid? {
+        var images: [ThumbnailLevel: CGImage] = [:]
+        var previous = decoded
+        for level in ThumbnailLevel.allCases.sorted(by: >) {
+            guard let image = GalleryBatchRenderer.squareThumbnail(of: previous, size: level.pixelSize) else { continue }
+            images[level] = image
+            previous = image
+        }
+        return images.isEmpty ? nil : ThumbnailPyramid(images: images, orientation: orientation)
+    }
+
+    // MARK: - Files
+
+    /// Same container as the photos (HEIC when the device has an encoder, JPEG otherwise)
+    static var fileType: UTType { PhotoEncoder.fileType }
+
+    static func fileName(for id: UUID, level: ThumbnailLevel) -> String {
+        "\(id.uuidString)_thumb_\(level.pixelSize).\(PhotoEncoder.fileExtension)"
+    }
+
+    /// Write every level; returns false if any level failed
+    func write(id: UUID, to directory: URL, quality: CGFloat) -> Bool {
+        var success = true
+        for (level, image) in images {
+            let url = directory.appendingPathComponent(Self.fileName(for: id, level: level))
+            success = Self.write(image, orientation: orientation, to: url, quality: quality) && success
+        }
+        return success
+    }
+
+    static func write(_ image: CGImage, orientation: UIImage.Orientation, to url: URL, quality: CGFloat) -> Bool {
+        guard let destination = CGImageDestinationCreateWithURL(url as CFURL, fileType.identifier as CFString, 1, nil) else {
+            return false
+        }
+        let properties = [
+            kCGImageDestinationLossyCompressionQuality: quality,
+            kCGImagePropertyOrientation: CGImagePropertyOrientation(orientation).rawValue
+        ] as CFDictionary
+        CGImageDestinationAddImage(destination, image, properties)
+        return CGImageDestinationFinalize(destination)
+    }
+
+    // MARK: - Decoding
+
+    /// Decoded (not lazily backed) image, downsampled so the long side ≤ maxPixelSize (nil = full size)
+    /// EXIF orientation applied → result is always .up; call off the main thread
+    static func decodeImage(at url: URL, maxPixelSize: Int?) -> UIImage? {
+        guard let source = CGImageSourceCreateWithURL(url as CFURL, [kCGImageSourceShouldCache: false] as CFDictionary) else {
+            return nil
+        }
+
+        var options: [CFString: Any] = [
+            kCGImageSourceCreateThumbnailFromImageAlways: true,
+            kCGImageSourceCreateThumbnailWithTransform: true,
+            kCGImageSourceShouldCacheImmediately: true
+        ]
+        if let maxPixelSize = maxPixelSize {
+            options[kCGImageSourceThumbnailMaxPixelSize] = maxPixelSize
+        }
+        guard let image = CGImageSourceCreateThumbnailAtIndex(source, 0, options as CFDictionary) else { return nil }
+        return UIImage(cgImage: image)
+    }
+}
+
+// MARK: - Orientation
+
+extension CGImagePropertyOrientation {
+    init(_ orientation: UIImage.Orientation) {
+        switch orientation {
+        case .up: self = .up
+        case .down: self = .down
+        case .left: self = .left
+        case .right: self = .right
+        case .upMirrored: self = .upMirrored
+        case .downMirrored: self = .downMirrored
+        case .leftMirrored: self = .leftMirrored
+        case .rightMirrored: self = .rightMirrored
+        @unknown default: self = .up
+        }
+    }
+}
+
+extension UIImage.Orientation {
+    init(_ orientation: CGImagePropertyOrientation) {
+        switch orientation {
+        case .up: self = .up
+        case .down: self = .down
+        case .left: self = .left
+        case .right: self = .right
+        case .upMirrored: self = .upMirrored
+        case .downMirrored: self = .downMirrored
+        case .leftMirrored: self = .leftMirrored
+        case .rightMirrored: self = .rightMirrored
+        @unknown default: self = .up
+        }
+    }
+}
@@ -4,12 +4,37 @@
 //
 //  Created by mac on 17/12/25.
 //  ★★★ UPDATED: Added RGB Curves support ★★★
+//  ★★★ UPDATED: Packed param layout v2 (flag bitfields, packed float3, curves → texture) ★★★
 
 #ifndef ShaderTypes_h
 #define ShaderTypes_h
 
 #include <simd/simd.h>
 
+// ★★★ NEW: Param layout version ★★★
+// Tăng mỗi khi đổi layout struct bên dưới (cập nhật SHADER_TYPES_ASSERT_SIZE cuối file)
+// → key của PipelineArchive, binary archive cũ không dùng với layout mới
+#define SHADER_PARAMS_LAYOUT_VERSION 2
+
+// Size check dùng chung Swift (Clang C) và Metal (C++) — layout lệch giữa 2 bên = lỗi compile
+#ifdef __METAL_VERSION__
+#define SHADER_TYPES_ASSERT_SIZE(type, size) static_assert(sizeof(type) == size, #type " layout changed")
+#else
+#define SHADER_TYPES_ASSERT_SIZE(type, size) _Static_assert(sizeof(type) == size, #type " layout changed")
+#endif
+
+// ★★★ NEW: 3 floats, 4-byte aligned (vector_float3 = 16 byte, align 16 → padding giữa các scalar) ★★★
+// Metal: packed_float3 (đọc qua float3(...)), Swift: PackedFloat3(x:y:z:)
+#ifdef __METAL_VERSION__
+typedef packed_float3 PackedFloat3;
+#else
+typedef struct {
+    float x;
+    float y;
+    float z;
+} PackedFloat3;
+#endif
+
 // Vertex data
 typedef struct {
     vector_float2 position;
@@ -19,16 +44,39 @@ typedef struct {
 // Buffer indices
 typedef enum {
     BufferIndexVertices = 0,
-    BufferIndexUniforms = 1
+    BufferIndexUniforms = 1,
+    BufferIndexKernelTile = 6,     // ★ KernelTileParams (compute neighbourhood kernels)
+    BufferIndexTileRegion = 7      // ★ TileRegion (fragment) cho pass phụ thuộc vị trí
 } BufferIndex;
 
 // Texture indices
 typedef enum {
     TextureIndexInput = 0,
     TextureIndexLUT = 1,
-    TextureIndexOutput = 2
+    TextureIndexOutput = 2,
+    TextureIndexCurves = 5,        // ★ Baked RGB curves (1D, ColorLUTBaker.curvesTexture)
+    TextureIndexNoise = 6,         // ★ NoiseTextureAtlas grain / white noise (rgba8, tileable)
+    TextureIndexBlueNoise = 7      // ★ NoiseTextureAtlas blue noise (r8, tileable)
 } TextureIndex;
 
+// ★★★ NEW: Function constant indices (pipeline specialization per preset) ★★★
+// Dùng chung cho [[function_constant(...)]] trong Shaders.metal và MTLFunctionConstantValues ở Swift
+typedef enum {
+    FunctionConstantFlashFalloffType = 0,
+    FunctionConstantFlashHotSpot = 1,
+    FunctionConstantFlashFresnel = 2,
+    FunctionConstantFlashFresnelRings = 3,
+    FunctionConstantFlashSpecular = 4,
+    FunctionConstantLeakType = 5,
+    FunctionConstantLeakFalloffType = 6,
+    FunctionConstantLeakBlendMode = 7,
+    FunctionConstantLeakTemporal = 8,
+    FunctionConstantLeakDepthLayers = 9,
+    FunctionConstantBWToningMode = 10,
+    FunctionConstantLinearIntermediates = 11,   // ★ Intermediates chứa giá trị linear (rgba16Float/rg11b10Float)
+    FunctionConstantHalfPrecision = 12          // ★ Per-pixel math dùng half
+} FunctionConstantIndex;
+
 // --- CORE ENGINE STRUCTS (Ported from WebGL) ---
 
 // 1. SELECTIVE COLOR: Chỉnh HSL cho từng dải màu cụ thể
@@ -57,6 +105,7 @@ typedef struct {
 
 // ★★★ NEW: RGB CURVES DATA ★★★
 // Maximum 8 control points per channel (including endpoints)
+// CPU-side only: ColorLUTBaker bake thành 1D texture (TextureIndexCurves), shader không đọc struct này
 #define MAX_CURVE_POINTS 8
 
 typedef struct {
@@ -70,6 +119,12 @@ typedef struct {
 } RGBCurvesParams;
 
 // 3. COLOR GRADING: Tổng hợp các tham số chỉnh màu
+#define COLOR_GRADING_FLAG_LUT      1     // .cube LUT bound at texture(1)
+#define COLOR_GRADING_FLAG_CURVE_R  2     // Curves texture kênh R/G/B hợp lệ (kênh không có điểm → giữ nguyên)
+#define COLOR_GRADING_FLAG_CURVE_G  4
+#define COLOR_GRADING_FLAG_CURVE_B  8
+#define COLOR_GRADING_FLAG_CURVES   14    // CURVE_R | CURVE_G | CURVE_B
+
 typedef struct {
     float exposure;
     float contrast;
@@ -98,10 +153,8 @@ typedef struct {
 
     // LUT
     float lutIntensity;
-    int useLUT;
-    
-    // ★★★ NEW: RGB Curves ★★★
-    RGBCurvesParams rgbCurves;
+
+    unsigned int flags;     // COLOR_GRADING_FLAG_* (LUT + curves texture)
 } ColorGradingParams;
 
 // 4. GRAIN: Hạt nhiễu giả lập film
@@ -109,7 +162,7 @@ typedef struct {
     float globalIntensity;
     float size;             // Kích thước hạt
     float softness;         // Độ mềm
-    vector_float3 channelIntensity; // Cường độ hạt cho R, G, B
+    PackedFloat3 channelIntensity;  // Cường độ hạt cho R, G, B
     int enabled;
 } GrainParams;
 
@@ -119,7 +172,7 @@ typedef struct {
     float threshold;
     float radius;
     float softness;
-    vector_float3 colorTint;
+    PackedFloat3 colorTint;
     int enabled;
 } BloomParams;
 
@@ -129,10 +182,19 @@ typedef struct {
     float threshold;
     float radius;
     float softness;
-    vector_float3 color;
+    PackedFloat3 color;
     int enabled;
 } HalationParams;
 
+// ★★★ NEW: Dual-filter blur pyramid (bloom + halation, capture) ★★★
+#define PYRAMID_CHANNEL_RGB    0      // Nguồn halation = .rgb (pyramid riêng)
+#define PYRAMID_CHANNEL_ALPHA  1      // Nguồn halation = .a (pyramid chung với bloom)
+
+typedef struct {
+    float scatter;                // Upsample: mix(level hiện tại, level thấp hơn) — 0..1, lớn = lan rộng
+    int channelMode;              // PYRAMID_CHANNEL_* (halation composite)
+} PyramidParams;
+
 // 7. VIGNETTE: Tối góc
 typedef struct {
     float intensity;
@@ -145,7 +207,7 @@ typedef struct {
 // 8. INSTANT FRAME: Khung ảnh Polaroid
 typedef struct {
     vector_float4 borderWidths; // top, left, right, bottom
-    vector_float3 borderColor;
+    PackedFloat3 borderColor;
     float edgeFade;
     float cornerDarkening;
     float inputAspect;      // Input texture aspect ratio (width/height)
@@ -180,8 +242,13 @@ typedef struct {
 
 // ★★★ FLASH EFFECT (Disposable Camera) - PHYSICS ENHANCED ★★★
 // Simulates on-camera flash with physics-based falloff, hot spots, and Fresnel rings
+#define FLASH_FEATURE_HOT_SPOT  1     // Bright center spot
+#define FLASH_FEATURE_FRESNEL   2     // Fresnel ring artifacts
+#define FLASH_FEATURE_SPECULAR  4     // Specular catch lights
+
 typedef struct {
     int enabled;
+    unsigned int features;  // FLASH_FEATURE_*
     float intensity;        // Overall flash strength (0.0-1.0)
     float falloff;          // Radial falloff exponent (1.5-3.0)
     float warmth;           // Warm tint amount (0.0-0.3)
@@ -194,19 +261,16 @@ typedef struct {
     int falloffType;        // 0=power, 1=inverseSquare, 2=exponential, 3=gaussian
     float distanceScale;    // Distance scale for inverse square (0.5-3.0)
 
-    // Hot spot simulation
-    int hotSpotEnabled;     // Enable bright center spot
+    // Hot spot simulation (FLASH_FEATURE_HOT_SPOT)
     float hotSpotSize;      // Hot spot radius (0.05-0.3)
     float hotSpotIntensity; // Hot spot brightness boost (0.0-1.0)
 
-    // Fresnel ring effects
-    int fresnelEnabled;     // Enable Fresnel ring artifacts
+    // Fresnel ring effects (FLASH_FEATURE_FRESNEL)
     int fresnelRings;       // Number of rings (1-5)
     float fresnelIntensity; // Ring visibility (0.0-0.5)
     float fresnelSpacing;   // Ring spacing (0.1-0.5)
 
-    // Specular highlights
-    int specularEnabled;    // Enable specular catch lights
+    // Specular highlights (FLASH_FEATURE_SPECULAR)
     float specularThreshold;// Brightness threshold (0.7-1.0)
     float specularBoost;    // Specular intensity (0.0-1.0)
 } FlashParams;
@@ -248,7 +312,7 @@ typedef struct {
     int digits[10];         // Up to 10 digits/chars (-1 = space, 0-9, 10=quote, 11=slash, 12=dot)
     int digitCount;         // Number of active digits
     int position;           // 0=bottomRight, 1=bottomLeft, 2=topRight, 3=topLeft
-    vector_float3 color;    // Text color RGB
+    PackedFloat3 color;     // Text color RGB
     float opacity;          // Overall opacity
     float scale;            // Size multiplier
     float marginX;          // Horizontal margin (normalized)
@@ -302,7 +366,7 @@ typedef struct {
     // Toning
     int toningMode;           // 0=none, 1=sepia, 2=selenium, 3=cyanotype, 4=splitTone, 5=custom
     float toningIntensity;    // Toning strength (0.0-1.0)
-    vector_float3 customColor;// Custom toning color RGB
+    PackedFloat3 customColor; // Custom toning color RGB
 
     // Split Tone (when toningMode = 4)
     float shadowHue;          // Shadow color hue (0-1)
@@ -348,25 +412,27 @@ typedef struct {
 
 // ★★★ NEW: VHS EFFECTS ★★★
 // Simulates VHS tape playback artifacts
+#define VHS_FEATURE_SCANLINES    1
+#define VHS_FEATURE_COLOR_BLEED  2
+#define VHS_FEATURE_TRACKING     4
+
 typedef struct {
     int enabled;
+    unsigned int features;        // VHS_FEATURE_*
 
     // Scanlines
-    int scanlinesEnabled;
     float scanlinesIntensity;     // Line visibility (0.0-1.0)
     float scanlinesDensity;       // Lines per screen (0.5-2.0)
     float scanlinesFlickerSpeed;  // Flicker rate (0.0-1.0)
     float scanlinesFlickerIntensity; // Flicker amount (0.0-1.0)
 
     // Color Bleed
-    int colorBleedEnabled;
     float colorBleedIntensity;    // Overall bleed amount (0.0-1.0)
     float colorBleedRedShift;     // Red channel offset (0.0-0.02)
     float colorBleedBlueShift;    // Blue channel offset (0.0-0.02)
     float colorBleedVertical;     // Vertical smearing (0.0-1.0)
 
     // Tracking
-    int trackingEnabled;
     float trackingIntensity;      // Distortion strength (0.0-1.0)
     float trackingSpeed;          // Roll speed (0.0-2.0)
     float trackingNoise;          // Random jitter (0.0-1.0)
@@ -413,7 +479,7 @@ typedef struct {
     int perforationStyle;         // 0=none, 1=35mm, 2=cinema, 3=super8
 
     // Border
-    vector_float3 borderColor;    // Border color RGB
+    PackedFloat3 borderColor;     // Border color RGB
     float borderOpacity;          // Border visibility (0.0-1.0)
 
     // Frame lines
@@ -426,4 +492,89 @@ typedef struct {
     int kodakStyle;               // Orange Kodak rebate style
 } FilmStripParams;
 
+// ★★★ NEW: FUSED PREVIEW (Uber-shader cho live preview) ★★★
+// Gộp các stage per-pixel vào 1 fragment để tránh round-trip qua ping-pong textures.
+// Bit flags phải khớp với FusedPreviewStages trong FilterRenderer.swift
+#define FUSED_STAGE_COLOR_GRADING   1
+#define FUSED_STAGE_SKIN_TONE       2
+#define FUSED_STAGE_TONE_MAPPING    4
+#define FUSED_STAGE_BW              8
+#define FUSED_STAGE_FLASH           16
+#define FUSED_STAGE_VIGNETTE        32
+#define FUSED_STAGE_GRAIN           64
+#define FUSED_STAGE_YUV_INPUT       128   // texture(0) = Y, texture(2) = CbCr
+#define FUSED_STAGE_BAKED_GRADING   256   // texture(3) = baked color grading 3D LUT
+#define FUSED_STAGE_BAKED_BW        512   // texture(4) = baked B&W tone 1D
+
+typedef struct {
+    int stageMask;                // Tổ hợp FUSED_STAGE_*
+    int yuvMatrix;                // YUVMatrix (chỉ đọc khi FUSED_STAGE_YUV_INPUT)
+    vector_float2 outputSize;     // Kích thước render target (thay cho get_width() của input)
+} FusedPreviewParams;
+
+// ★★★ NEW: YUV CAMERA INPUT (420f bi-planar) ★★★
+// Full-range Y'CbCr → R'G'B' (vẫn gamma-encoded, giống BGRA từ ISP)
+typedef enum {
+    YUVMatrixBT601 = 0,
+    YUVMatrixBT709 = 1
+} YUVMatrix;
+
+typedef struct {
+    int matrix;                   // YUVMatrix
+} YUVConvertParams;
+
+// ★★★ NEW: TILED CAPTURE (48MP) ★★★
+// Tile → full image mapping cho pass phụ thuộc toạ độ (vignette, grain, light leak, ...)
+// Identity (origin 0, extent 1, imageSize 0) khi render cả ảnh → shader dùng kích thước texture
+typedef struct {
+    vector_float2 origin;         // Góc trên-trái của tile trong UV ảnh đầy đủ
+    vector_float2 extent;         // Kích thước tile / kích thước ảnh
+    vector_float2 imageSize;      // Ảnh đầy đủ (pixels), 0 = không tile
+} TileRegion;
+
+// ★★★ NEW: COMPUTE NEIGHBOURHOOD KERNELS (threadgroup tile + apron) ★★★
+// Threadgroup KERNEL_TILE_SIZE × KERNEL_TILE_SIZE, tile + apron load vào threadgroup memory (half4/texel)
+#define KERNEL_TILE_SIZE 16
+
+typedef struct {
+    vector_int2 apron;            // Tap xa nhất luôn cần (pixels quanh tile)
+    vector_int2 reach;            // Thêm vào apron khi còn chỗ (vd. VHS vertical bleed), không thì đọc texture
+    int capacity;                 // Threadgroup memory tính theo texel half4
+} KernelTileParams;
+
+// CCD vertical smear theo cột: cửa sổ trượt (prefix difference) thay cho 4..30 taps / pixel
+typedef struct {
+    int length;                   // Cửa sổ dưới (taps, stride 3 px), trọng số tam giác
+    int above;                    // Cửa sổ trên (taps)
+    int segmentRows;              // Rows mỗi thread xử lý trong 1 cột
+} CCDSmearParams;
+
+// ★★★ NEW: Layout checks (SHADER_PARAMS_LAYOUT_VERSION) ★★★
+// Swift MemoryLayout<T>.stride và Metal [[buffer]] phải cùng size → đổi struct thì cập nhật ở đây
+SHADER_TYPES_ASSERT_SIZE(LensDistortionParams, 20);
+SHADER_TYPES_ASSERT_SIZE(ColorGradingParams, 244);
+SHADER_TYPES_ASSERT_SIZE(GrainParams, 28);
+SHADER_TYPES_ASSERT_SIZE(BloomParams, 32);
+SHADER_TYPES_ASSERT_SIZE(HalationParams, 32);
+SHADER_TYPES_ASSERT_SIZE(PyramidParams, 8);
+SHADER_TYPES_ASSERT_SIZE(VignetteParams, 20);
+SHADER_TYPES_ASSERT_SIZE(InstantFrameParams, 48);
+SHADER_TYPES_ASSERT_SIZE(SkinToneParams, 20);
+SHADER_TYPES_ASSERT_SIZE(ToneMappingParams, 20);
+SHADER_TYPES_ASSERT_SIZE(AspectScaleParams, 8);
+SHADER_TYPES_ASSERT_SIZE(FlashParams, 80);
+SHADER_TYPES_ASSERT_SIZE(LightLeakParams, 72);
+SHADER_TYPES_ASSERT_SIZE(DateStampParams, 88);
+SHADER_TYPES_ASSERT_SIZE(CCDBloomParams, 56);
+SHADER_TYPES_ASSERT_SIZE(BWParams, 80);
+SHADER_TYPES_ASSERT_SIZE(OverlaysParams, 72);
+SHADER_TYPES_ASSERT_SIZE(VHSEffectsParams, 72);
+SHADER_TYPES_ASSERT_SIZE(DigicamEffectsParams, 48);
+SHADER_TYPES_ASSERT_SIZE(FilmStripParams, 44);
+SHADER_TYPES_ASSERT_SIZE(FusedPreviewParams, 16);
+SHADER_TYPES_ASSERT_SIZE(YUVConvertParams, 4);
+SHADER_TYPES_ASSERT_SIZE(TileRegion, 24);
+SHADER_TYPES_ASSERT_SIZE(KernelTileParams, 24);
+SHADER_TYPES_ASSERT_SIZE(CCDSmearParams, 12);
+
 #endif /* ShaderTypes_h */
@@ -25,6 +25,88 @@ float3 linearToSrgb3(float3 c) {
     return float3(linearToSrgb(c.r), linearToSrgb(c.g), linearToSrgb(c.b));
 }
 
+// ★★★ NEW: Half-precision variants (ALU rẻ hơn, register pressure thấp hơn trên Apple GPU) ★★★
+half srgbToLinearHalf(half c) {
+    return (c <= 0.04045h) ? (c / 12.92h) : pow((c + 0.055h) / 1.055h, 2.4h);
+}
+
+half3 srgbToLinear3h(half3 c) {
+    return half3(srgbToLinearHalf(c.r), srgbToLinearHalf(c.g), srgbToLinearHalf(c.b));
+}
+
+half linearToSrgbHalf(half c) {
+    return (c <= 0.0031308h) ? (c * 12.92h) : (1.055h * pow(c, 1.0h/2.4h) - 0.055h);
+}
+
+half3 linearToSrgb3h(half3 c) {
+    return half3(linearToSrgbHalf(c.r), linearToSrgbHalf(c.g), linearToSrgbHalf(c.b));
+}
+
+// ═══════════════════════════════════════════════════════════════
+// ★★★ NEW: FUNCTION CONSTANTS (Pipeline specialization per preset) ★★★
+// Pipeline specialized (MTLFunctionConstantValues) → branch/loop bị compile out.
+// Pipeline generic (không set constant) → dùng giá trị runtime trong param struct.
+// ═══════════════════════════════════════════════════════════════
+
+constant int  fcFlashFalloffType  [[function_constant(FunctionConstantFlashFalloffType)]];
+constant bool fcFlashHotSpot      [[function_constant(FunctionConstantFlashHotSpot)]];
+constant bool fcFlashFresnel      [[function_constant(FunctionConstantFlashFresnel)]];
+constant int  fcFlashFresnelRings [[function_constant(FunctionConstantFlashFresnelRings)]];
+constant bool fcFlashSpecular     [[function_constant(FunctionConstantFlashSpecular)]];
+constant int  fcLeakType          [[function_constant(FunctionConstantLeakType)]];
+constant int  fcLeakFalloffType   [[function_constant(FunctionConstantLeakFalloffType)]];
+constant int  fcLeakBlendMode     [[function_constant(FunctionConstantLeakBlendMode)]];
+constant bool fcLeakTemporal      [[function_constant(FunctionConstantLeakTemporal)]];
+constant int  fcLeakDepthLayers   [[function_constant(FunctionConstantLeakDepthLayers)]];
+constant int  fcBWToningMode      [[function_constant(FunctionConstantBWToningMode)]];
+
+constant bool hasFcFlashFalloffType  = is_function_constant_defined(fcFlashFalloffType);
+constant bool hasFcFlashHotSpot      = is_function_constant_defined(fcFlashHotSpot);
+constant bool hasFcFlashFresnel      = is_function_constant_defined(fcFlashFresnel);
+constant bool hasFcFlashFresnelRings = is_function_constant_defined(fcFlashFresnelRings);
+constant bool hasFcFlashSpecular     = is_function_constant_defined(fcFlashSpecular);
+constant bool hasFcLeakType          = is_function_constant_defined(fcLeakType);
+constant bool hasFcLeakFalloffType   = is_function_constant_defined(fcLeakFalloffType);
+constant bool hasFcLeakBlendMode     = is_function_constant_defined(fcLeakBlendMode);
+constant bool hasFcLeakTemporal      = is_function_constant_defined(fcLeakTemporal);
+constant bool hasFcLeakDepthLayers   = is_function_constant_defined(fcLeakDepthLayers);
+constant bool hasFcBWToningMode      = is_function_constant_defined(fcBWToningMode);
+
+// ═══════════════════════════════════════════════════════════════
+// ★★★ NEW: INTERMEDIATE FORMAT I/O (linear half-float intermediates) ★★★
+// linearIO: intermediates là rgba16Float/rg11b10Float chứa giá trị LINEAR → sRGB decode chỉ ở source
+//           (texture view _srgb) và encode ở pass EncodeSRGB cuối. Generic: bgra8Unorm sRGB-encoded như cũ.
+// halfMath: conversion + per-pixel math dùng half (A/B với float qua FilterRenderer.benchmarkIntermediateFormats)
+// ═══════════════════════════════════════════════════════════════
+
+constant bool fcLinearIntermediates [[function_constant(FunctionConstantLinearIntermediates)]];
+constant bool fcHalfPrecision       [[function_constant(FunctionConstantHalfPrecision)]];
+
+constant bool linearIO = is_function_constant_defined(fcLinearIntermediates) ? fcLinearIntermediates : false;
+constant bool halfMath = is_function_constant_defined(fcHalfPrecision) ? fcHalfPrecision : false;
+
+inline float3 toLinear(float3 srgb) {
+    return halfMath ? float3(srgbToLinear3h(half3(srgb))) : srgbToLinear3(srgb);
+}
+
+inline float3 toSrgb(float3 rgb) {
+    return halfMath ? float3(linearToSrgb3h(half3(rgb))) : linearToSrgb3(rgb);
+}
+
+// Pass tính trong linear (grading, tone mapping, vignette, flash, bloom/halation): intermediate ↔ linear
+inline float3 decodeIntermediate(float3 c) { return linearIO ? c : toLinear(c); }
+inline float3 encodeIntermediate(float3 c) { return linearIO ? c : toSrgb(c); }
+
+// Pass định nghĩa trong sRGB (grain, leak, B&W, overlays, digicam...): intermediate ↔ sRGB
+inline float3 loadSrgb(float3 c) { return linearIO ? toSrgb(c) : c; }
+inline float3 storeSrgb(float3 c) { return linearIO ? toLinear(c) : c; }
+inline float4 loadSrgb(float4 c) { return float4(loadSrgb(c.rgb), c.a); }
+inline float4 storeSrgb(float4 c) { return float4(storeSrgb(c.rgb), c.a); }
+
+inline float4 sampleSrgb(texture2d<float> texture, sampler s, float2 uv) {
+    return loadSrgb(texture.sample(s, uv));
+}
+
 // ═══════════════════════════════════════════════════════════════
 // COMMON VERTEX SHADER
 // ═══════════════════════════════════════════════════════════════
@@ -82,6 +164,162 @@ vertex VertexOut vertexAspectFill(uint vertexID [[vertex_id]],
     return out;
 }
 
+// ═══════════════════════════════════════════════════════════════
+// ★★★ NEW: TILED CAPTURE HELPERS ★★★
+// Pass phụ thuộc vị trí tính hiệu ứng theo toạ độ ảnh đầy đủ, sample theo toạ độ tile.
+// TileRegion identity → tileImageUV == texCoord, tileImageSize == kích thước texture
+// ═══════════════════════════════════════════════════════════════
+
+inline float2 tileImageUV(float2 texCoord, constant TileRegion &tile) {
+    return tile.origin + texCoord * tile.extent;
+}
+
+inline float2 tileLocalUV(float2 imageUV, constant TileRegion &tile) {
+    return (imageUV - tile.origin) / tile.extent;
+}
+
+inline float2 tileImageSize(constant TileRegion &tile, texture2d<float> texture) {
+    return tile.imageSize.x > 0.0 ? tile.imageSize : float2(texture.get_width(), texture.get_height());
+}
+
+// ═══════════════════════════════════════════════════════════════
+// ★★★ NEW: COMPUTE NEIGHBOURHOOD KERNELS (threadgroup tile + apron) ★★★
+// Threadgroup load 1 lần vùng input (tile + apron) vào threadgroup memory, mọi tap đọc từ đó
+// thay vì texture sample lặp lại. Texel lưu theo toạ độ đã clamp → giống address::clamp_to_edge.
+// Tap nằm ngoài footprint (vd. tracking glitch, footprint bị thu nhỏ) đọc thẳng texture.
+// ═══════════════════════════════════════════════════════════════
+
+struct TileFootprint {
+    int2 origin;    // Texel (có thể ngoài ảnh) của tile[0]
+    int2 size;      // 0 = không dùng threadgroup memory
+};
+
+// Tile + apron + reach nếu vừa capacity, không thì tile + apron, không nữa thì rỗng
+inline TileFootprint groupFootprint(uint2 group, uint2 groupSize, constant KernelTileParams &tp) {
+    int2 lo = int2(group * groupSize);
+    int2 hi = lo + int2(groupSize) - 1;
+
+    TileFootprint fp;
+    fp.origin = lo - tp.apron - tp.reach;
+    fp.size = hi - lo + 1 + 2 * (tp.apron + tp.reach);
+    if (fp.size.x * fp.size.y <= tp.capacity) return fp;
+
+    fp.origin = lo - tp.apron;
+    fp.size = hi - lo + 1 + 2 * tp.apron;
+    if (fp.size.x * fp.size.y <= tp.capacity) return fp;
+
+    fp.size = int2(0);
+    return fp;
+}
+
+// Bounding box → footprint (rỗng nếu vượt capacity)
+inline TileFootprint boundsFootprint(int2 lo, int2 hi, int capacity) {
+    TileFootprint fp;
+    fp.origin = lo;
+    fp.size = max(hi - lo + 1, int2(0));
+    if (fp.size.x * fp.size.y > capacity) fp.size = int2(0);
+    return fp;
+}
+
+inline bool footprintContains(TileFootprint fp, int2 lo, int2 hi) {
+    return all(lo >= fp.origin) && all(hi < fp.origin + fp.size);
+}
+
+// Cooperative load: mỗi thread load texel index, index + threads, ... (srgb: loadSrgb như sampleSrgb)
+inline void loadTile(threadgroup half4 *tile, texture2d<float> texture, TileFootprint fp,
+                     uint index, uint threads, bool srgb) {
+    int2 maxTexel = int2(texture.get_width(), texture.get_height()) - 1;
+    int count = fp.size.x * fp.size.y;
+    for (int i = int(index); i < count; i += int(threads)) {
+        int2 texel = clamp(fp.origin + int2(i % fp.size.x, i / fp.size.x), int2(0), maxTexel);
+        float4 c = texture.read(uint2(texel));
+        tile[i] = half4(srgb ? loadSrgb(c) : c);
+    }
+}
+
+// 1 kênh (lens CA: R/G/B mỗi kênh 1 footprint riêng)
+inline void loadTileChannel(threadgroup half *tile, texture2d<float> texture, TileFootprint fp,
+                            int channel, uint index, uint threads) {
+    int2 maxTexel = int2(texture.get_width(), texture.get_height()) - 1;
+    int count = fp.size.x * fp.size.y;
+    for (int i = int(index); i < count; i += int(threads)) {
+        int2 texel = clamp(fp.origin + int2(i % fp.size.x, i / fp.size.x), int2(0), maxTexel);
+        tile[i] = half(texture.read(uint2(texel))[channel]);
+    }
+}
+
+inline float4 readTexel(texture2d<float> texture, int2 texel, bool srgb) {
+    int2 maxTexel = int2(texture.get_width(), texture.get_height()) - 1;
+    float4 c = texture.read(uint2(clamp(texel, int2(0), maxTexel)));
+    return srgb ? loadSrgb(c) : c;
+}
+
+inline float4 tileTexel(threadgroup const half4 *tile, TileFootprint fp, texture2d<float> texture, int2 texel, bool srgb) {
+    if (!footprintContains(fp, texel, texel)) return readTexel(texture, texel, srgb);
+    int2 local = texel - fp.origin;
+    return float4(tile[local.y * fp.size.x + local.x]);
+}
+
+// Bilinear như sampler(filter::linear, clamp_to_edge); position theo texel (tâm pixel = i + 0.5)
+inline float4 tileSample(threadgroup const half4 *tile, TileFootprint fp, texture2d<float> texture, float2 position, bool srgb) {
+    float2 p = position - 0.5;
+    int2 i0 = int2(floor(p));
+    if (!footprintContains(fp, i0, i0 + 1)) {
+        constexpr sampler s(filter::linear, address::clamp_to_edge);
+        float4 c = texture.sample(s, position / float2(texture.get_width(), texture.get_height()));
+        return srgb ? loadSrgb(c) : c;
+    }
+
+    float2 f = p - float2(i0);
+    int2 local = i0 - fp.origin;
+    int row = local.y * fp.size.x + local.x;
+    float4 a = float4(tile[row]);
+    float4 b = float4(tile[row + 1]);
+    float4 c = float4(tile[row + fp.size.x]);
+    float4 d = float4(tile[row + fp.size.x + 1]);
+    return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
+}
+
+inline float tileSampleChannel(threadgroup const half *tile, TileFootprint fp, texture2d<float> texture, float2 position, int channel) {
+    float2 p = position - 0.5;
+    int2 i0 = int2(floor(p));
+    if (!footprintContains(fp, i0, i0 + 1)) {
+        constexpr sampler s(filter::linear, address::clamp_to_edge);
+        return texture.sample(s, position / float2(texture.get_width(), texture.get_height()))[channel];
+    }
+
+    float2 f = p - float2(i0);
+    int2 local = i0 - fp.origin;
+    int row = local.y * fp.size.x + local.x;
+    float top = mix(float(tile[row]), float(tile[row + 1]), f.x);
+    float bottom = mix(float(tile[row + fp.size.x]), float(tile[row + fp.size.x + 1]), f.x);
+    return mix(top, bottom, f.y);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// ★★★ NEW: sRGB BOUNDARY PASSES (linear intermediates) ★★★
+// ═══════════════════════════════════════════════════════════════
+
+// Linear → sRGB encode cho pass cuối (linear intermediates → bgra8Unorm target)
+fragment float4 srgbEncodeFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]]
+) {
+    constexpr sampler s(filter::nearest, address::clamp_to_edge);
+    float4 color = inputTexture.sample(s, in.texCoord);
+    return float4(toSrgb(saturate(color.rgb)), 1.0);
+}
+
+// sRGB → linear decode khi source không có view _srgb (fallback)
+fragment float4 srgbDecodeFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]]
+) {
+    constexpr sampler s(filter::nearest, address::clamp_to_edge);
+    float4 color = inputTexture.sample(s, in.texCoord);
+    return float4(toLinear(color.rgb), color.a);
+}
+
 // ═══════════════════════════════════════════════════════════════
 // UTILITY FUNCTIONS
 // ═══════════════════════════════════════════════════════════════
@@ -127,6 +365,30 @@ float noise2D(float2 st, uint seed) {
     return mix(a, b, u.x) + (c - a) * u.y * (1.0 - u.x) + (d - b) * u.x * u.y;
 }
 
+// ★★★ NEW: NOISE TEXTURES (NoiseTextureAtlas) ★★★
+// Tileable noise tạo 1 lần lúc khởi động thay cho hash per-pixel.
+// Seed → texel offset: cùng seed = cùng vùng texture = cùng pattern
+inline float2 noiseSeedOffset(uint seed) {
+    uint h = seed * 747796405u + 2891336453u;
+    h = ((h >> ((h >> 28u) + 4u)) ^ h) * 277803737u;
+    h = (h >> 22u) ^ h;
+    return float2(float(h & 0xFFu), float((h >> 8u) & 0xFFu));
+}
+
+// 1 texel (nearest, wrap) → tối đa 4 giá trị [0,1] độc lập
+inline float4 noiseTexel(texture2d<float> noise, float2 texel, uint seed) {
+    constexpr sampler s(filter::nearest, address::repeat);
+    float2 size = float2(noise.get_width(), noise.get_height());
+    return noise.sample(s, (floor(texel) + noiseSeedOffset(seed) + 0.5) / size);
+}
+
+// Bilinear (wrap) → value noise mượt; texel center = toạ độ nguyên + 0.5
+inline float4 noiseSmooth(texture2d<float> noise, float2 texel, uint seed) {
+    constexpr sampler s(filter::linear, address::repeat);
+    float2 size = float2(noise.get_width(), noise.get_height());
+    return noise.sample(s, (texel + noiseSeedOffset(seed)) / size);
+}
+
 // Gaussian weight
 float gaussianWeight(float x, float sigma) {
     return exp(-(x * x) / (2.0 * sigma * sigma));
@@ -136,69 +398,20 @@ float gaussianWeight(float x, float sigma) {
 // ★★★ NEW: RGB CURVES FUNCTIONS ★★★
 // ═══════════════════════════════════════════════════════════════
 
-// Evaluate a single curve at input value using linear interpolation
-// between control points. Uses Catmull-Rom spline for smoothness.
-float evaluateCurve(float input, constant CurvePoint* curve, int pointCount) {
-    if (pointCount <= 0) return input;
-    if (pointCount == 1) return curve[0].output;
-    
-    // Clamp input to valid range
-    input = saturate(input);
-    
-    // Find the two points to interpolate between
-    int idx = 0;
-    for (int i = 0; i < pointCount - 1; i++) {
-        if (input >= curve[i].input && input <= curve[i + 1].input) {
-            idx = i;
-            break;
-        }
-        if (i == pointCount - 2) {
-            idx = i; // Fallback to last segment
-        }
-    }
-    
-    // Get the four control points for Catmull-Rom (or use endpoints)
-    float2 p0 = float2(curve[max(0, idx - 1)].input, curve[max(0, idx - 1)].output);
-    float2 p1 = float2(curve[idx].input, curve[idx].output);
-    float2 p2 = float2(curve[min(idx + 1, pointCount - 1)].input, curve[min(idx + 1, pointCount - 1)].output);
-    float2 p3 = float2(curve[min(idx + 2, pointCount - 1)].input, curve[min(idx + 2, pointCount - 1)].output);
-    
-    // Calculate t parameter (0-1 within this segment)
-    float segmentWidth = p2.x - p1.x;
-    float t = (segmentWidth > 0.0001) ? (input - p1.x) / segmentWidth : 0.0;
-    t = saturate(t);
-    
-    // Catmull-Rom spline interpolation
-    float t2 = t * t;
-    float t3 = t2 * t;
-    
-    float output = 0.5 * (
-        (2.0 * p1.y) +
-        (-p0.y + p2.y) * t +
-        (2.0 * p0.y - 5.0 * p1.y + 4.0 * p2.y - p3.y) * t2 +
-        (-p0.y + 3.0 * p1.y - 3.0 * p2.y + p3.y) * t3
-    );
-    
-    return saturate(output);
-}
+// Curves baked thành 1D texture (ColorLUTBaker.curvesTexture, Catmull-Rom trên CPU)
+// → không còn 3 × 8 control points trong ColorGradingParams; r/g/b = output của từng kênh
+// Kênh không có control point → giữ nguyên (không clamp), giống evaluateCurve cũ
+float3 applyRGBCurves(float3 color, uint flags, texture1d<float> curves) {
+    if ((flags & COLOR_GRADING_FLAG_CURVES) == 0) return color;
+
+    constexpr sampler curveSampler(filter::linear, address::clamp_to_edge);
+    float size = float(curves.get_width());
+    float3 coord = saturate(color) * ((size - 1.0) / size) + 0.5 / size;
 
-// Apply RGB curves to a color
-float3 applyRGBCurves(float3 color, constant RGBCurvesParams& curves) {
-    if (curves.enabled == 0) return color;
-    
     float3 result = color;
-    
-    // Apply each channel curve
-    if (curves.redPointCount > 0) {
-        result.r = evaluateCurve(color.r, curves.redCurve, curves.redPointCount);
-    }
-    if (curves.greenPointCount > 0) {
-        result.g = evaluateCurve(color.g, curves.greenCurve, curves.greenPointCount);
-    }
-    if (curves.bluePointCount > 0) {
-        result.b = evaluateCurve(color.b, curves.blueCurve, curves.bluePointCount);
-    }
-    
+    if (flags & COLOR_GRADING_FLAG_CURVE_R) result.r = curves.sample(curveSampler, coord.r).r;
+    if (flags & COLOR_GRADING_FLAG_CURVE_G) result.g = curves.sample(curveSampler, coord.g).g;
+    if (flags & COLOR_GRADING_FLAG_CURVE_B) result.b = curves.sample(curveSampler, coord.b).b;
     return result;
 }
 
@@ -206,51 +419,102 @@ float3 applyRGBCurves(float3 color, constant RGBCurvesParams& curves) {
 // 1. LENS DISTORTION SHADER (Disposable Camera Effect)
 // ═══════════════════════════════════════════════════════════════
 
+// Radial distortion quanh tâm ảnh; caScale = 1 ∓ caStrength cho kênh R/B
+inline float2 lensChannelUV(float2 uv, constant LensDistortionParams &p, float caScale) {
+    float2 center = float2(0.5, 0.5);
+    float2 dc = uv - center;
+    float r2 = dot(dc, dc);
+
+    float distortion = 1.0 + p.k1 * r2 + p.k2 * r2 * r2;
+    return center + dc * distortion * caScale * p.scale;
+}
+
 fragment float4 lensDistortionFragment(VertexOut in [[stage_in]],
                                        texture2d<float> inputTexture [[texture(0)]],
-                                       constant LensDistortionParams &p [[buffer(0)]]) {
+                                       constant LensDistortionParams &p [[buffer(0)]],
+                                       constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]) {
     constexpr sampler s(filter::linear, address::clamp_to_edge);
 
     if (p.enabled == 0) {
         return inputTexture.sample(s, in.texCoord);
     }
 
-    float2 uv = in.texCoord;
-    float2 center = float2(0.5, 0.5);
-    float2 dc = uv - center;
-    float r2 = dot(dc, dc);
+    float2 uv = tileImageUV(in.texCoord, tile);
 
-    float distortion = 1.0 + p.k1 * r2 + p.k2 * r2 * r2;
+    float r = inputTexture.sample(s, tileLocalUV(lensChannelUV(uv, p, 1.0 - p.caStrength), tile)).r;
+    float g = inputTexture.sample(s, tileLocalUV(lensChannelUV(uv, p, 1.0), tile)).g;
+    float b = inputTexture.sample(s, tileLocalUV(lensChannelUV(uv, p, 1.0 + p.caStrength), tile)).b;
+
+    return float4(r, g, b, 1.0);
+}
 
-    float2 uvR = center + dc * distortion * (1.0 - p.caStrength) * p.scale;
-    float2 uvG = center + dc * distortion * p.scale;
-    float2 uvB = center + dc * distortion * (1.0 + p.caStrength) * p.scale;
+// ★ Compute: mỗi kênh 1 footprint (CA kéo R/B về 2 phía) = bbox của lưới 3×3 điểm tile đã map
+kernel void lensDistortionKernel(
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float, access::write> outputTexture [[texture(1)]],
+    constant LensDistortionParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]],
+    constant KernelTileParams &tp [[buffer(BufferIndexKernelTile)]],
+    threadgroup half4 *tileMemory [[threadgroup(0)]],
+    uint2 gid [[thread_position_in_grid]],
+    uint2 group [[threadgroup_position_in_grid]],
+    uint2 groupSize [[threads_per_threadgroup]],
+    uint lid [[thread_index_in_threadgroup]]
+) {
+    float2 texSize = float2(inputTexture.get_width(), inputTexture.get_height());
+    bool inside = gid.x < outputTexture.get_width() && gid.y < outputTexture.get_height();
 
-    float r = inputTexture.sample(s, uvR).r;
-    float g = inputTexture.sample(s, uvG).g;
-    float b = inputTexture.sample(s, uvB).b;
+    if (p.enabled == 0) {
+        if (inside) outputTexture.write(inputTexture.read(gid), gid);
+        return;
+    }
+
+    float scales[3] = { 1.0 - p.caStrength, 1.0, 1.0 + p.caStrength };
+    int channelCapacity = tp.capacity * 4 / 3;
+    threadgroup half *channels = (threadgroup half *)tileMemory;
+
+    // Footprint giống nhau cho cả threadgroup (chỉ phụ thuộc group) → không cần barrier trước load
+    float2 groupLo = float2(group * groupSize);
+    float2 groupHi = groupLo + float2(groupSize);
+    TileFootprint fps[3];
+    for (int c = 0; c < 3; c++) {
+        float2 lo = float2(INFINITY);
+        float2 hi = float2(-INFINITY);
+        for (int j = 0; j < 9; j++) {
+            float2 corner = mix(groupLo, groupHi, float2(j % 3, j / 3) * 0.5);
+            float2 mapped = tileLocalUV(lensChannelUV(tileImageUV(corner / texSize, tile), p, scales[c]), tile) * texSize;
+            lo = min(lo, mapped);
+            hi = max(hi, mapped);
+        }
+        fps[c] = boundsFootprint(int2(floor(lo - 0.5)) - 1, int2(floor(hi - 0.5)) + 2, channelCapacity);
+    }
 
-    return float4(r, g, b, 1.0);
+    uint threads = groupSize.x * groupSize.y;
+    for (int c = 0; c < 3; c++) {
+        loadTileChannel(channels + c * channelCapacity, inputTexture, fps[c], c, lid, threads);
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    if (!inside) return;
+
+    float2 uv = tileImageUV((float2(gid) + 0.5) / texSize, tile);
+    float rgb[3];
+    for (int c = 0; c < 3; c++) {
+        float2 position = tileLocalUV(lensChannelUV(uv, p, scales[c]), tile) * texSize;
+        rgb[c] = tileSampleChannel(channels + c * channelCapacity, fps[c], inputTexture, position, c);
+    }
+
+    outputTexture.write(float4(rgb[0], rgb[1], rgb[2], 1.0), gid);
 }
 
 // ═══════════════════════════════════════════════════════════════
 // 2. COLOR GRADING SHADER (Core Engine) ★★★ WITH RGB CURVES ★★★
 // ═══════════════════════════════════════════════════════════════
 
-fragment float4 colorGradingFragment(
-    VertexOut in [[stage_in]],
-    texture2d<float> inputTexture [[texture(0)]],
-    texture3d<float> lutTexture [[texture(1)]],
-    constant ColorGradingParams &p [[buffer(0)]]
-) {
-    constexpr sampler s(filter::linear, address::clamp_to_edge);
+// ★ Linear core: input/output linear (float giữ nguyên để LUT/HSL chính xác)
+inline float3 colorGradingLinear(float3 rgb, constant ColorGradingParams &p, texture3d<float> lutTexture, texture1d<float> curvesTexture) {
     constexpr sampler lutSampler(filter::linear, address::clamp_to_edge);
 
-    float4 color = inputTexture.sample(s, in.texCoord);
-    
-    // ★ Convert to LINEAR space for accurate processing
-    float3 rgb = srgbToLinear3(color.rgb);
-
     // === 1. BASIC CORRECTIONS ===
     rgb *= pow(2.0, p.exposure);
     rgb = (rgb - 0.5) * (1.0 + p.contrast) + 0.5;
@@ -269,7 +533,7 @@ fragment float4 colorGradingFragment(
     rgb.g += p.tint * 0.05;
 
     // === 2. ★★★ RGB CURVES (NEW) ★★★ ===
-    rgb = applyRGBCurves(rgb, p.rgbCurves);
+    rgb = applyRGBCurves(rgb, p.flags, curvesTexture);
 
     // === 3. SELECTIVE COLOR (Fixed hue normalization) ===
     if (p.selectiveColorCount > 0) {
@@ -312,7 +576,7 @@ fragment float4 colorGradingFragment(
     rgb = mix(float3(luma), rgb, 1.0 + p.vibrance * (1.0 - colorfulness));
 
     // === 5. LUT LOOKUP ===
-    if (p.useLUT > 0 && p.lutIntensity > 0) {
+    if ((p.flags & COLOR_GRADING_FLAG_LUT) && p.lutIntensity > 0) {
         float3 lutCoord = saturate(rgb);
         float3 lutColor = lutTexture.sample(lutSampler, lutCoord).rgb;
         rgb = mix(rgb, lutColor, p.lutIntensity);
@@ -338,56 +602,89 @@ fragment float4 colorGradingFragment(
         rgb = mix(rgb, rgb * highlightTint, hStr * p.highlightsSat * 0.3);
     }
 
-    // ★ Convert back to sRGB
-    rgb = linearToSrgb3(saturate(rgb));
-    
-    return float4(rgb, color.a);
+    return saturate(rgb);
+}
+
+// ★ Core dùng chung cho colorGradingFragment và fusedPreviewFragment
+// Input/output: sRGB-encoded
+inline float3 colorGradingCore(float3 srgb, constant ColorGradingParams &p, texture3d<float> lutTexture, texture1d<float> curvesTexture) {
+    // ★ Convert to LINEAR space for accurate processing, back to sRGB after
+    return linearToSrgb3(colorGradingLinear(srgbToLinear3(srgb), p, lutTexture, curvesTexture));
+}
+
+fragment float4 colorGradingFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    texture3d<float> lutTexture [[texture(1)]],
+    texture1d<float> curvesTexture [[texture(TextureIndexCurves)]],
+    constant ColorGradingParams &p [[buffer(0)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+
+    float4 color = inputTexture.sample(s, in.texCoord);
+    return float4(encodeIntermediate(colorGradingLinear(decodeIntermediate(color.rgb), p, lutTexture, curvesTexture)), color.a);
 }
 
 // ═══════════════════════════════════════════════════════════════
-// 3. GRAIN SHADER (Film-accurate)
+// ★★★ NEW: BAKED COLOR GRADING (ColorLUTBaker) ★★★
+// colorGradingLinear không phụ thuộc vị trí (curves, selective color, .cube LUT, split tone)
+// → bake 1 lần thành 3D LUT (index sRGB, giá trị linear) khi params đổi; per-pixel = 1 trilinear fetch
 // ═══════════════════════════════════════════════════════════════
 
-// High-frequency film grain noise (sharper than Perlin)
-float filmGrainNoise(float2 coord, uint seed) {
-    // Use golden ratio for better distribution
-    float2 p = coord + float2(seed * 0.1031, seed * 0.1030);
-    float3 p3 = fract(float3(p.xyx) * float3(443.8975, 397.2973, 491.1871));
-    p3 += dot(p3, p3.yzx + 19.19);
-    return fract((p3.x + p3.y) * p3.z) * 2.0 - 1.0;
+// Baked LUT lookup: index = sRGB-encoded input (đều theo cảm nhận, shadow không bị thưa), output linear
+inline float3 sampleBakedGrading(texture3d<float> bakedLUT, float3 srgb) {
+    constexpr sampler lutSampler(filter::linear, address::clamp_to_edge);
+    float size = float(bakedLUT.get_width());
+    float3 coord = saturate(srgb) * ((size - 1.0) / size) + 0.5 / size;
+    return bakedLUT.sample(lutSampler, coord).rgb;
 }
 
-fragment float4 grainFragment(
+kernel void bakeColorGradingLUTKernel(
+    texture3d<float, access::write> bakedLUT [[texture(0)]],
+    texture3d<float> lutTexture [[texture(1)]],
+    texture1d<float> curvesTexture [[texture(TextureIndexCurves)]],
+    constant ColorGradingParams &p [[buffer(0)]],
+    uint3 gid [[thread_position_in_grid]]
+) {
+    uint size = bakedLUT.get_width();
+    if (gid.x >= size || gid.y >= size || gid.z >= size) return;
+
+    float3 srgb = float3(gid) / float(size - 1);
+    bakedLUT.write(float4(colorGradingLinear(srgbToLinear3(srgb), p, lutTexture, curvesTexture), 1.0), gid);
+}
+
+fragment float4 colorGradingBakedFragment(
     VertexOut in [[stage_in]],
     texture2d<float> inputTexture [[texture(0)]],
-    constant GrainParams &p [[buffer(0)]]
+    texture3d<float> bakedLUT [[texture(1)]]
 ) {
-    constexpr sampler s(filter::linear);
-    float4 color = inputTexture.sample(s, in.texCoord);
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
 
-    if (p.enabled == 0) return color;
+    float4 color = inputTexture.sample(s, in.texCoord);
+    float3 srgb = linearIO ? linearToSrgb3(color.rgb) : color.rgb;
+    return float4(encodeIntermediate(sampleBakedGrading(bakedLUT, srgb)), color.a);
+}
 
-    float3 rgb = color.rgb;
+// ═══════════════════════════════════════════════════════════════
+// 3. GRAIN SHADER (Film-accurate)
+// ═══════════════════════════════════════════════════════════════
 
-    float2 texSize = float2(inputTexture.get_width(), inputTexture.get_height());
+// ★ Core dùng chung cho grainFragment và fusedPreviewFragment
+// grainNoise = NoiseTextureAtlas.grain: r/g/b độc lập (chromatic grain), 1 fetch thay cho 3-6 hash
+inline float3 grainCore(float3 rgb, float2 uv, float2 texSize, constant GrainParams &p, texture2d<float> grainNoise) {
+    if (p.enabled == 0) return rgb;
 
-    // Grain coordinate - size controls grain fineness
+    // Grain coordinate - size controls grain fineness (1 texel = grainScale pixels)
     float grainScale = max(0.5, p.size);
-    float2 grainCoord = in.texCoord * texSize / grainScale;
+    float2 grainCoord = uv * texSize / grainScale;
 
-    // Generate independent noise per channel (chromatic grain)
-    float3 noise;
-    noise.r = filmGrainNoise(grainCoord, 1u);
-    noise.g = filmGrainNoise(grainCoord * 1.01, 2u);  // Slight offset for channel separation
-    noise.b = filmGrainNoise(grainCoord * 0.99, 3u);
+    // Independent noise per channel (chromatic grain)
+    float3 noise = noiseSmooth(grainNoise, grainCoord, 0u).rgb * 2.0 - 1.0;
 
     // Softness controls noise sharpness (0 = sharp, 1 = soft/blended)
+    // Nửa texel chéo → bilinear = trung bình 4 hạt lân cận
     if (p.softness > 0.01) {
-        float2 offset = 1.0 / texSize * grainScale;
-        float3 noise2;
-        noise2.r = filmGrainNoise(grainCoord + offset, 1u);
-        noise2.g = filmGrainNoise((grainCoord + offset) * 1.01, 2u);
-        noise2.b = filmGrainNoise((grainCoord + offset) * 0.99, 3u);
+        float3 noise2 = noiseSmooth(grainNoise, grainCoord + 0.5, 0u).rgb * 2.0 - 1.0;
         noise = mix(noise, (noise + noise2) * 0.5, p.softness);
     }
 
@@ -400,12 +697,28 @@ fragment float4 grainFragment(
     float density = shadowRolloff * highlightRolloff * max(0.3, midtonePeak);
 
     // Apply grain with channel-specific intensity
-    float3 grainAmount = noise * p.channelIntensity * p.globalIntensity * density;
+    float3 grainAmount = noise * float3(p.channelIntensity) * p.globalIntensity * density;
 
     // Additive grain (film-like)
     rgb += grainAmount * 0.15;
 
-    return float4(saturate(rgb), color.a);
+    return saturate(rgb);
+}
+
+fragment float4 grainFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float> grainNoise [[texture(TextureIndexNoise)]],
+    constant GrainParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
+) {
+    constexpr sampler s(filter::linear);
+    float4 color = inputTexture.sample(s, in.texCoord);
+
+    if (p.enabled == 0) return color;
+
+    float2 texSize = tileImageSize(tile, inputTexture);
+    return float4(storeSrgb(grainCore(loadSrgb(color.rgb), tileImageUV(in.texCoord, tile), texSize, p, grainNoise)), color.a);
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -423,7 +736,7 @@ fragment float4 bloomThresholdFragment(
     
     if (p.enabled == 0) return float4(0.0);
     
-    float3 rgb = srgbToLinear3(color.rgb);
+    float3 rgb = decodeIntermediate(color.rgb);
     float luma = luminance(rgb);
     
     // Soft threshold extraction
@@ -432,7 +745,7 @@ fragment float4 bloomThresholdFragment(
         float t = max(0.0, (luma - softThreshold) / (1.0 - softThreshold));
         float bloomStrength = pow(t, 1.5);
         
-        float3 bloom = rgb * bloomStrength * p.colorTint;
+        float3 bloom = rgb * bloomStrength * float3(p.colorTint);
         return float4(bloom, 1.0);
     }
     
@@ -508,17 +821,130 @@ fragment float4 bloomCompositeFragment(
     float3 bloom = bloomTexture.sample(s, in.texCoord).rgb;
     
     // Convert to linear for additive blend
-    float3 rgb = srgbToLinear3(original.rgb);
+    float3 rgb = decodeIntermediate(original.rgb);
     
     // ★ Additive blend in linear space (physically correct)
     rgb = rgb + bloom * p.intensity * p.softness;
     
     // Convert back to sRGB
-    rgb = linearToSrgb3(saturate(rgb));
+    rgb = encodeIntermediate(saturate(rgb));
     
     return float4(rgb, original.a);
 }
 
+// ═══════════════════════════════════════════════════════════════
+// ★★★ NEW: DUAL-FILTER BLUR PYRAMID (bloom + halation for capture) ★★★
+// Threshold ở 1/2 res → 13-tap downsample mỗi mip → 9-tap tent upsample ngược lên.
+// Radius lớn = nhiều mip hơn, không phải nhiều tap hơn → chi phí ~ hằng số (≤ 1.33× pass 1/2 res)
+// và không còn cap radius 20/25 texel. Intermediates là rgba16Float (giá trị linear).
+// ═══════════════════════════════════════════════════════════════
+
+// 13-tap downsample (4 box 2×2 chồng nhau + center box) — chống flicker/aliasing khi xuống mip
+fragment float4 pyramidDownsampleFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> sourceTexture [[texture(0)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float2 t = 1.0 / float2(sourceTexture.get_width(), sourceTexture.get_height());
+    float2 uv = in.texCoord;
+
+    float4 a = sourceTexture.sample(s, uv + t * float2(-2.0, -2.0));
+    float4 b = sourceTexture.sample(s, uv + t * float2( 0.0, -2.0));
+    float4 c = sourceTexture.sample(s, uv + t * float2( 2.0, -2.0));
+    float4 d = sourceTexture.sample(s, uv + t * float2(-1.0, -1.0));
+    float4 e = sourceTexture.sample(s, uv + t * float2( 1.0, -1.0));
+    float4 f = sourceTexture.sample(s, uv + t * float2(-2.0,  0.0));
+    float4 g = sourceTexture.sample(s, uv);
+    float4 h = sourceTexture.sample(s, uv + t * float2( 2.0,  0.0));
+    float4 i = sourceTexture.sample(s, uv + t * float2(-1.0,  1.0));
+    float4 j = sourceTexture.sample(s, uv + t * float2( 1.0,  1.0));
+    float4 k = sourceTexture.sample(s, uv + t * float2(-2.0,  2.0));
+    float4 l = sourceTexture.sample(s, uv + t * float2( 0.0,  2.0));
+    float4 m = sourceTexture.sample(s, uv + t * float2( 2.0,  2.0));
+
+    float4 result = (d + e + i + j) * 0.125;
+    result += (a + b + f + g) * 0.03125;
+    result += (b + c + g + h) * 0.03125;
+    result += (f + g + k + l) * 0.03125;
+    result += (g + h + l + m) * 0.03125;
+    return result;
+}
+
+// 9-tap tent upsample của mip thấp hơn, blend với mip cùng cấp (energy-preserving)
+fragment float4 pyramidUpsampleFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> currentTexture [[texture(0)]],
+    texture2d<float> lowerTexture [[texture(1)]],
+    constant PyramidParams &p [[buffer(0)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float2 t = 1.0 / float2(lowerTexture.get_width(), lowerTexture.get_height());
+    float2 uv = in.texCoord;
+
+    float4 up = lowerTexture.sample(s, uv) * 4.0;
+    up += lowerTexture.sample(s, uv + t * float2(-1.0,  0.0)) * 2.0;
+    up += lowerTexture.sample(s, uv + t * float2( 1.0,  0.0)) * 2.0;
+    up += lowerTexture.sample(s, uv + t * float2( 0.0, -1.0)) * 2.0;
+    up += lowerTexture.sample(s, uv + t * float2( 0.0,  1.0)) * 2.0;
+    up += lowerTexture.sample(s, uv + t * float2(-1.0, -1.0));
+    up += lowerTexture.sample(s, uv + t * float2( 1.0, -1.0));
+    up += lowerTexture.sample(s, uv + t * float2(-1.0,  1.0));
+    up += lowerTexture.sample(s, uv + t * float2( 1.0,  1.0));
+    up /= 16.0;
+
+    return mix(currentTexture.sample(s, uv), up, p.scatter);
+}
+
+// Shared threshold khi bloom + halation cùng bật: .rgb = bloom, .a = halation (luma × excess)
+// → 1 pyramid cho cả 2 effect; halation tint áp dụng lúc composite
+fragment float4 bloomHalationThresholdFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    constant BloomParams &bloom [[buffer(0)]],
+    constant HalationParams &halation [[buffer(1)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float3 rgb = decodeIntermediate(inputTexture.sample(s, in.texCoord).rgb);
+    float luma = luminance(rgb);
+
+    float3 bloomRGB = float3(0.0);
+    float softThreshold = bloom.threshold * 0.7;
+    if (bloom.enabled != 0 && luma > softThreshold) {
+        float t = max(0.0, (luma - softThreshold) / (1.0 - softThreshold));
+        bloomRGB = rgb * pow(t, 1.5) * float3(bloom.colorTint);
+    }
+
+    float halo = 0.0;
+    if (halation.enabled != 0 && luma > halation.threshold) {
+        float excess = pow((luma - halation.threshold) / (1.0 - halation.threshold), 1.5);
+        halo = luma * excess;
+    }
+
+    return float4(bloomRGB, halo);
+}
+
+// Halation composite cho pyramid (softness áp dụng ở đây thay vì trong vertical blur)
+fragment float4 halationPyramidCompositeFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> originalTexture [[texture(0)]],
+    texture2d<float> halationTexture [[texture(1)]],
+    constant HalationParams &p [[buffer(0)]],
+    constant PyramidParams &pyramid [[buffer(1)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+
+    float4 original = originalTexture.sample(s, in.texCoord);
+    float4 blurred = halationTexture.sample(s, in.texCoord);
+
+    float3 halation = pyramid.channelMode == PYRAMID_CHANNEL_ALPHA ? blurred.a * float3(p.color) : blurred.rgb;
+    halation = pow(max(halation, 0.0), float3(p.softness));
+
+    float3 rgb = decodeIntermediate(original.rgb);
+    rgb = min(float3(1.0), rgb + halation * p.intensity);
+
+    return float4(encodeIntermediate(rgb), original.a);
+}
+
 // Legacy single-pass bloom (for backwards compatibility, but slow)
 fragment float4 bloomFragment(
     VertexOut in [[stage_in]],
@@ -526,9 +952,9 @@ fragment float4 bloomFragment(
     constant BloomParams &p [[buffer(0)]]
 ) {
     constexpr sampler s(filter::linear, address::clamp_to_edge);
-    float4 color = inputTexture.sample(s, in.texCoord);
+    float4 color = sampleSrgb(inputTexture, s, in.texCoord);
 
-    if (p.enabled == 0) return color;
+    if (p.enabled == 0) return storeSrgb(color);
 
     // ⚠️ Legacy nested loop - use separable pipeline instead!
     float3 bloom = float3(0.0);
@@ -539,7 +965,7 @@ fragment float4 bloomFragment(
     for (int x = -radius; x <= radius; x+=2) {
         for (int y = -radius; y <= radius; y+=2) {
             float2 offset = float2(x, y) * texelSize;
-            float3 sample = inputTexture.sample(s, in.texCoord + offset).rgb;
+            float3 sample = sampleSrgb(inputTexture, s, in.texCoord + offset).rgb;
             float bLuma = luminance(sample);
 
             if (bLuma > p.threshold) {
@@ -552,10 +978,10 @@ fragment float4 bloomFragment(
 
     if (totalWeight > 0.0) {
         bloom /= totalWeight;
-        color.rgb += bloom * p.intensity * p.colorTint;
+        color.rgb += bloom * p.intensity * float3(p.colorTint);
     }
 
-    return saturate(color);
+    return storeSrgb(saturate(color));
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -573,7 +999,7 @@ fragment float4 halationThresholdFragment(
     
     if (p.enabled == 0) return float4(0.0);
     
-    float3 rgb = srgbToLinear3(color.rgb);
+    float3 rgb = decodeIntermediate(color.rgb);
     float luma = luminance(rgb);
     
     if (luma > p.threshold) {
@@ -582,7 +1008,7 @@ fragment float4 halationThresholdFragment(
         excess = pow(excess, 1.5);  // Sharper falloff
         
         // ★ Apply halation color tint (red-orange for Cinestill)
-        float3 halation = rgb * excess * p.color;
+        float3 halation = rgb * excess * float3(p.color);
         return float4(halation, 1.0);
     }
     
@@ -659,13 +1085,13 @@ fragment float4 halationCompositeFragment(
     float3 halation = halationTexture.sample(s, in.texCoord).rgb;
     
     // Convert to linear for physically correct additive blend
-    float3 rgb = srgbToLinear3(original.rgb);
+    float3 rgb = decodeIntermediate(original.rgb);
     
     // ★ ADDITIVE blend (physically correct light addition)
     rgb = min(float3(1.0), rgb + halation * p.intensity);
     
     // Convert back to sRGB
-    rgb = linearToSrgb3(rgb);
+    rgb = encodeIntermediate(rgb);
     
     return float4(rgb, original.a);
 }
@@ -677,9 +1103,9 @@ fragment float4 halationFragment(
     constant HalationParams &p [[buffer(0)]]
 ) {
     constexpr sampler s(filter::linear, address::clamp_to_edge);
-    float4 color = inputTexture.sample(s, in.texCoord);
+    float4 color = sampleSrgb(inputTexture, s, in.texCoord);
 
-    if (p.enabled == 0) return color;
+    if (p.enabled == 0) return storeSrgb(color);
 
     // ⚠️ Legacy nested loop - use separable pipeline instead!
     float3 halo = float3(0.0);
@@ -690,7 +1116,7 @@ fragment float4 halationFragment(
     for (int x = -radius; x <= radius; x+=3) {
         for (int y = -radius; y <= radius; y+=3) {
             float2 offset = float2(x, y) * texelSize;
-            float3 sample = inputTexture.sample(s, in.texCoord + offset).rgb;
+            float3 sample = sampleSrgb(inputTexture, s, in.texCoord + offset).rgb;
             float bLuma = luminance(sample);
 
             if (bLuma > p.threshold) {
@@ -705,32 +1131,25 @@ fragment float4 halationFragment(
         halo /= totalWeight;
         // ★ FIX: Additive blend in linear space
         float3 rgb = srgbToLinear3(color.rgb);
-        float3 haloLinear = halo * p.color * p.intensity * p.softness;
+        float3 haloLinear = halo * float3(p.color) * p.intensity * p.softness;
         rgb = min(float3(1.0), rgb + haloLinear);
         color.rgb = linearToSrgb3(rgb);
     }
 
-    return saturate(color);
+    return storeSrgb(saturate(color));
 }
 
 // ═══════════════════════════════════════════════════════════════
 // 6. VIGNETTE SHADER (Fixed aspect ratio)
 // ═══════════════════════════════════════════════════════════════
 
-fragment float4 vignetteFragment(
-    VertexOut in [[stage_in]],
-    texture2d<float> inputTexture [[texture(0)]],
-    constant VignetteParams &p [[buffer(0)]]
-) {
-    constexpr sampler s(filter::linear);
-    float4 color = inputTexture.sample(s, in.texCoord);
-
-    if (p.enabled == 0) return color;
+// ★ Core dùng chung cho vignetteFragment và fusedPreviewFragment
+// ★ Linear core: falloff ở half khi halfMath (mask mượt, không cần độ chính xác float)
+inline float3 vignetteLinear(float3 rgb, float2 texCoord, float aspect, constant VignetteParams &p) {
 
-    float2 uv = in.texCoord - 0.5;
+    float2 uv = texCoord - 0.5;
     
     // ★ FIX: Correct aspect ratio handling for circular vignette
-    float aspect = float(inputTexture.get_width()) / float(inputTexture.get_height());
     if (aspect > 1.0) {
         uv.x *= aspect;  // Landscape: stretch X
     } else {
@@ -740,24 +1159,48 @@ fragment float4 vignetteFragment(
     // Apply roundness (1.0 = circle, 0.5 = oval)
     uv.x *= mix(1.0, 1.0, p.roundness);
 
+    if (halfMath) {
+        half dist = length(half2(uv));
+        half v = 1.0h - smoothstep(half(p.midpoint - p.feather), half(p.midpoint + p.feather), dist);
+        return float3(half3(rgb) * mix(1.0h, v, half(p.intensity)));
+    }
+
     float dist = length(uv);
     float v = 1.0 - smoothstep(p.midpoint - p.feather, p.midpoint + p.feather, dist);
 
     // Apply in linear space
-    float3 rgb = srgbToLinear3(color.rgb);
-    rgb *= mix(1.0, v, p.intensity);
-    rgb = linearToSrgb3(rgb);
-    
-    return float4(rgb, color.a);
+    return rgb * mix(1.0, v, p.intensity);
 }
 
-// ═══════════════════════════════════════════════════════════════
-// 7. INSTANT FRAME SHADER
-// ═══════════════════════════════════════════════════════════════
+// ★ Core dùng chung cho vignetteFragment và fusedPreviewFragment
+inline float3 vignetteCore(float3 srgb, float2 texCoord, float aspect, constant VignetteParams &p) {
+    if (p.enabled == 0) return srgb;
+    return linearToSrgb3(vignetteLinear(srgbToLinear3(srgb), texCoord, aspect, p));
+}
 
-fragment float4 instantFrameFragment(
+fragment float4 vignetteFragment(
     VertexOut in [[stage_in]],
-    texture2d<float> photoTexture [[texture(0)]],
+    texture2d<float> inputTexture [[texture(0)]],
+    constant VignetteParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
+) {
+    constexpr sampler s(filter::linear);
+    float4 color = inputTexture.sample(s, in.texCoord);
+
+    if (p.enabled == 0) return color;
+
+    float2 size = tileImageSize(tile, inputTexture);
+    float3 rgb = vignetteLinear(decodeIntermediate(color.rgb), tileImageUV(in.texCoord, tile), size.x / size.y, p);
+    return float4(encodeIntermediate(rgb), color.a);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// 7. INSTANT FRAME SHADER
+// ═══════════════════════════════════════════════════════════════
+
+fragment float4 instantFrameFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> photoTexture [[texture(0)]],
     constant InstantFrameParams &p [[buffer(0)]]
 ) {
     constexpr sampler s(filter::linear, address::clamp_to_edge);
@@ -793,7 +1236,7 @@ fragment float4 instantFrameFragment(
             }
         }
 
-        float4 color = photoTexture.sample(s, photoUV);
+        float4 color = sampleSrgb(photoTexture, s, photoUV);
 
         // Edge fade
         float dX = min(contentUV.x, 1.0 - contentUV.x);
@@ -806,9 +1249,9 @@ fragment float4 instantFrameFragment(
         float distCenter = length(contentUV - 0.5);
         color.rgb *= (1.0 - smoothstep(0.4, 0.8, distCenter) * p.cornerDarkening);
 
-        return color;
+        return storeSrgb(color);
     } else {
-        return float4(p.borderColor, 1.0);
+        return storeSrgb(float4(float3(p.borderColor), 1.0));
     }
 }
 
@@ -821,18 +1264,20 @@ float3 filmicToneMap(float3 x, float A, float B, float C, float D, float E, floa
     return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
 }
 
-fragment float4 toneMappingFragment(
-    VertexOut in [[stage_in]],
-    texture2d<float> inputTexture [[texture(0)]],
-    constant ToneMappingParams &params [[buffer(0)]]
-) {
-    constexpr sampler s(filter::linear, address::clamp_to_edge);
-    float4 color = inputTexture.sample(s, in.texCoord);
-    
-    if (params.enabled == 0) return color;
-    
-    float3 rgb = srgbToLinear3(color.rgb);
-    
+half3 filmicToneMapHalf(half3 x, half A, half B, half C, half D, half E, half F) {
+    return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
+}
+
+// ★ Linear core: input/output linear
+inline float3 toneMappingLinear(float3 rgb, constant ToneMappingParams &params) {
+    if (halfMath) {
+        half A = half(params.shoulderStrength);
+        half B = half(params.linearStrength);
+        half D = half(params.toeStrength);
+        half3 whiteScale = 1.0h / filmicToneMapHalf(half3(half(params.whitePoint)), A, B, 0.10h, D, 0.01h, 0.30h);
+        return float3(saturate(filmicToneMapHalf(half3(rgb), A, B, 0.10h, D, 0.01h, 0.30h) * whiteScale));
+    }
+
     // Filmic parameters
     float A = params.shoulderStrength;
     float B = params.linearStrength;
@@ -845,33 +1290,38 @@ fragment float4 toneMappingFragment(
     float3 whiteScale = 1.0 / filmicToneMap(float3(W), A, B, C, D, E, F);
     rgb = filmicToneMap(rgb, A, B, C, D, E, F) * whiteScale;
     
-    rgb = linearToSrgb3(saturate(rgb));
-    
-    return float4(rgb, color.a);
+    return saturate(rgb);
 }
 
-// ═══════════════════════════════════════════════════════════════
-// ★★★ FLASH EFFECT SHADER (Disposable Camera) - PHYSICS ENHANCED ★★★
-// Simulates on-camera flash with physics-based falloff, hot spots,
-// Fresnel rings, and specular highlights
-// ═══════════════════════════════════════════════════════════════
+// ★ Core dùng chung cho toneMappingFragment và fusedPreviewFragment
+inline float3 toneMappingCore(float3 srgb, constant ToneMappingParams &params) {
+    if (params.enabled == 0) return srgb;
+    return linearToSrgb3(toneMappingLinear(srgbToLinear3(srgb), params));
+}
 
-fragment float4 flashFragment(
+fragment float4 toneMappingFragment(
     VertexOut in [[stage_in]],
     texture2d<float> inputTexture [[texture(0)]],
-    constant FlashParams &p [[buffer(0)]]
+    constant ToneMappingParams &params [[buffer(0)]]
 ) {
     constexpr sampler s(filter::linear, address::clamp_to_edge);
     float4 color = inputTexture.sample(s, in.texCoord);
+    
+    if (params.enabled == 0) return color;
+    
+    return float4(encodeIntermediate(toneMappingLinear(decodeIntermediate(color.rgb), params)), color.a);
+}
 
-    if (p.enabled == 0) return color;
+// ═══════════════════════════════════════════════════════════════
+// ★★★ FLASH EFFECT SHADER (Disposable Camera) - PHYSICS ENHANCED ★★★
+// Simulates on-camera flash with physics-based falloff, hot spots,
+// Fresnel rings, and specular highlights
+// ═══════════════════════════════════════════════════════════════
 
-    // Convert to linear space for physically accurate light addition
-    float3 rgb = srgbToLinear3(color.rgb);
+// ★ Linear core: input/output linear (physically accurate light addition)
+inline float3 flashLinear(float3 rgb, float2 uv, float aspect, constant FlashParams &p) {
 
     // Calculate distance from flash position (aspect-ratio corrected)
-    float aspect = float(inputTexture.get_width()) / float(inputTexture.get_height());
-    float2 uv = in.texCoord;
     float2 flashPos = p.position;
 
     // Correct for aspect ratio to make circular falloff
@@ -888,7 +1338,8 @@ fragment float4 flashFragment(
     float falloffFactor = 0.0;
     float scaledDist = normalizedDist * p.distanceScale;
 
-    switch (p.falloffType) {
+    int falloffType = hasFcFlashFalloffType ? fcFlashFalloffType : p.falloffType;
+    switch (falloffType) {
         case 0: // Power falloff (traditional)
             falloffFactor = 1.0 / pow(1.0 + normalizedDist * normalizedDist, p.falloff * 0.5);
             break;
@@ -918,7 +1369,8 @@ fragment float4 flashFragment(
     // Hot spot simulation - bright center of flash
     // ═══════════════════════════════════════════════════════════
     float hotSpotContrib = 0.0;
-    if (p.hotSpotEnabled != 0) {
+    bool hotSpotEnabled = hasFcFlashHotSpot ? fcFlashHotSpot : ((p.features & FLASH_FEATURE_HOT_SPOT) != 0);
+    if (hotSpotEnabled) {
         // Tight gaussian for hot spot
         float hotSpotNorm = dist / p.hotSpotSize;
         hotSpotContrib = exp(-hotSpotNorm * hotSpotNorm * 2.0) * p.hotSpotIntensity;
@@ -928,8 +1380,10 @@ fragment float4 flashFragment(
     // Fresnel ring artifacts - lens reflection rings
     // ═══════════════════════════════════════════════════════════
     float fresnelContrib = 0.0;
-    if (p.fresnelEnabled != 0) {
-        for (int ring = 1; ring <= p.fresnelRings; ring++) {
+    bool fresnelEnabled = hasFcFlashFresnel ? fcFlashFresnel : ((p.features & FLASH_FEATURE_FRESNEL) != 0);
+    int fresnelRings = hasFcFlashFresnelRings ? fcFlashFresnelRings : p.fresnelRings;
+    if (fresnelEnabled) {
+        for (int ring = 1; ring <= fresnelRings; ring++) {
             // Ring position based on spacing
             float ringRadius = float(ring) * p.fresnelSpacing;
             float ringDist = abs(normalizedDist - ringRadius);
@@ -965,7 +1419,8 @@ fragment float4 flashFragment(
     // ═══════════════════════════════════════════════════════════
     // Specular highlights on bright surfaces
     // ═══════════════════════════════════════════════════════════
-    if (p.specularEnabled != 0) {
+    bool specularEnabled = hasFcFlashSpecular ? fcFlashSpecular : ((p.features & FLASH_FEATURE_SPECULAR) != 0);
+    if (specularEnabled) {
         // Find bright areas that would reflect flash
         float specMask = smoothstep(p.specularThreshold, 1.0, luma);
         // Specular is strongest near flash center
@@ -978,27 +1433,39 @@ fragment float4 flashFragment(
     rgb = rgb / (rgb + 0.5);  // Simple Reinhard-style compression
     rgb = rgb * 1.5;           // Compensate for compression
 
-    // Convert back to sRGB
-    rgb = linearToSrgb3(saturate(rgb));
-
-    return float4(rgb, color.a);
+    return saturate(rgb);
 }
 
-// ═══════════════════════════════════════════════════════════════
-// ★★★ NEW: SKIN TONE PROTECTION SHADER ★★★
-// ═══════════════════════════════════════════════════════════════
+// ★ Core dùng chung cho flashFragment và fusedPreviewFragment
+inline float3 flashCore(float3 srgb, float2 uv, float aspect, constant FlashParams &p) {
+    if (p.enabled == 0) return srgb;
+    return linearToSrgb3(flashLinear(srgbToLinear3(srgb), uv, aspect, p));
+}
 
-fragment float4 skinToneProtectionFragment(
+fragment float4 flashFragment(
     VertexOut in [[stage_in]],
     texture2d<float> inputTexture [[texture(0)]],
-    constant SkinToneParams &p [[buffer(0)]]
+    constant FlashParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
 ) {
     constexpr sampler s(filter::linear, address::clamp_to_edge);
     float4 color = inputTexture.sample(s, in.texCoord);
-    
+
     if (p.enabled == 0) return color;
+
+    float2 size = tileImageSize(tile, inputTexture);
+    float3 rgb = flashLinear(decodeIntermediate(color.rgb), tileImageUV(in.texCoord, tile), size.x / size.y, p);
+    return float4(encodeIntermediate(rgb), color.a);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// ★★★ NEW: SKIN TONE PROTECTION SHADER ★★★
+// ═══════════════════════════════════════════════════════════════
+
+// ★ Core dùng chung cho skinToneProtectionFragment và fusedPreviewFragment
+inline float3 skinToneCore(float3 rgb, constant SkinToneParams &p) {
+    if (p.enabled == 0) return rgb;
     
-    float3 rgb = color.rgb;
     float3 hsl = rgb2hsl(rgb);
     
     // Calculate distance from skin tone center
@@ -1027,7 +1494,20 @@ fragment float4 skinToneProtectionFragment(
         rgb = hsl2rgb(hsl);
     }
 
-    return float4(rgb, color.a);
+    return rgb;
+}
+
+fragment float4 skinToneProtectionFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    constant SkinToneParams &p [[buffer(0)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float4 color = sampleSrgb(inputTexture, s, in.texCoord);
+    
+    if (p.enabled == 0) return storeSrgb(color);
+    
+    return storeSrgb(float4(skinToneCore(color.rgb, p), color.a));
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -1089,34 +1569,28 @@ inline float noise(float2 uv, uint seed) {
     return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
 }
 
-fragment float4 lightLeakFragment(
-    VertexOut in [[stage_in]],
-    texture2d<float> inputTexture [[texture(0)]],
-    constant LightLeakParams &p [[buffer(0)]]
-) {
-    constexpr sampler s(filter::linear, address::clamp_to_edge);
-    float4 color = inputTexture.sample(s, in.texCoord);
-
-    if (p.enabled == 0) return color;
-
-    float2 uv = in.texCoord;
-    float aspect = float(inputTexture.get_width()) / float(inputTexture.get_height());
+// Seed của random type với seed = 0 lấy theo pixel (hành vi cũ)
+inline uint lightLeakSeed(float2 uv, int leakType, constant LightLeakParams &p) {
+    return (leakType == 9 && p.seed == 0) ? uint(uv.x * 1000.0 + uv.y * 1000.0) : p.seed;
+}
 
+// ★ Static leak layer (shape, falloff, depth layers, organic noise) — chỉ phụ thuộc uv + params
+// rgb = leak color, a = intensity × opacity (chưa flicker) → bakeLightLeakLayerKernel cache theo seed
+inline float4 lightLeakLayer(float2 uv, float aspect, int leakType, constant LightLeakParams &p) {
     // Determine leak center based on type
     // Types: 0-3 corners, 4-7 edges, 8 streak, 9 random
     float2 leakCenter;
     float leakAngle = 0.0;
-    uint effectiveSeed = p.seed;
+    uint effectiveSeed = lightLeakSeed(uv, leakType, p);
 
     // For random type, use seed to pick random position
-    if (p.leakType == 9) { // random
-        effectiveSeed = (p.seed == 0) ? uint(uv.x * 1000.0 + uv.y * 1000.0) : p.seed;
+    if (leakType == 9) { // random
         float randX = hash(float2(float(effectiveSeed), 0.0), effectiveSeed);
         float randY = hash(float2(0.0, float(effectiveSeed)), effectiveSeed);
         leakCenter = float2(randX, randY);
         leakAngle = hash(float2(float(effectiveSeed), float(effectiveSeed)), effectiveSeed) * 6.28318;
     } else {
-        switch (p.leakType) {
+        switch (leakType) {
             case 0: leakCenter = float2(0.0, 0.0); leakAngle = 0.785; break;  // cornerTopLeft
             case 1: leakCenter = float2(1.0, 0.0); leakAngle = 2.356; break;  // cornerTopRight
             case 2: leakCenter = float2(0.0, 1.0); leakAngle = -0.785; break; // cornerBottomLeft
@@ -1136,7 +1610,7 @@ fragment float4 lightLeakFragment(
 
     // For streak type, use distance to line instead of point
     float dist;
-    if (p.leakType == 8) { // streak
+    if (leakType == 8) { // streak
         // Distance to diagonal line
         float2 dir = float2(cos(leakAngle), sin(leakAngle));
         dist = abs(dot(delta, float2(-dir.y, dir.x)));
@@ -1151,7 +1625,8 @@ fragment float4 lightLeakFragment(
     // ═══ PHYSICS-BASED FALLOFF ═══
     // Apply falloff based on type: 0=gaussian, 1=exponential(Beer-Lambert), 2=linear, 3=cosine
     float baseFalloff;
-    switch (p.falloffType) {
+    int leakFalloffType = hasFcLeakFalloffType ? fcLeakFalloffType : p.falloffType;
+    switch (leakFalloffType) {
         case 0: // Gaussian: e^(-x²/2σ²)
             {
                 float sigma = 1.0 / (p.softness + 0.001);
@@ -1177,7 +1652,7 @@ fragment float4 lightLeakFragment(
     float3 accumulatedColor = float3(0.0);
     float accumulatedIntensity = 0.0;
 
-    int layers = clamp(p.depthLayers, 1, 4);
+    int layers = clamp(hasFcLeakDepthLayers ? fcLeakDepthLayers : p.depthLayers, 1, 4);
     for (int layer = 0; layer < layers; layer++) {
         float layerDepth = float(layer) / float(max(1, layers - 1));
         float layerIntensity = baseFalloff * pow(1.0 - layerDepth * p.depthFalloff, 1.5);
@@ -1203,15 +1678,6 @@ fragment float4 lightLeakFragment(
     float3 leakColor = layers > 0 ? accumulatedColor / float(layers) : float3(0.0);
     float leakIntensity = layers > 0 ? accumulatedIntensity / float(layers) : 0.0;
 
-    // ═══ TEMPORAL ANIMATION (Flicker) ═══
-    if (p.temporalEnabled != 0) {
-        // Compound flicker: sine wave + noise for organic movement
-        float sineFlicker = sin(p.time * p.flickerSpeed * 6.28318) * 0.5;
-        float noiseFlicker = noise(float2(p.time * 0.5, float(effectiveSeed % 100)), effectiveSeed) * 0.35;
-        float compound = sineFlicker + noiseFlicker;
-        leakIntensity *= 1.0 + compound * p.flickerIntensity;
-    }
-
     // Add organic noise variation
     float noiseVal = noise(uv * 8.0 + float2(leakAngle), effectiveSeed);
     leakIntensity *= mix(0.7, 1.0, noiseVal);
@@ -1219,15 +1685,34 @@ fragment float4 lightLeakFragment(
     // Apply opacity
     leakIntensity *= p.opacity;
 
-    if (leakIntensity <= 0.0) return color;
-
     // Add variation to leak color
     float colorNoise = noise(uv * 4.0, effectiveSeed + 1);
     leakColor = mix(leakColor, leakColor * 1.3, colorNoise * 0.3);
 
+    return float4(leakColor, leakIntensity);
+}
+
+// ═══ TEMPORAL ANIMATION (Flicker) ═══
+// Intensity multiplier — chỉ time + seed đổi theo frame, không đụng tới layer
+inline float lightLeakFlicker(float2 uv, int leakType, constant LightLeakParams &p) {
+    bool temporalEnabled = hasFcLeakTemporal ? fcLeakTemporal : (p.temporalEnabled != 0);
+    if (!temporalEnabled) return 1.0;
+
+    // Compound flicker: sine wave + noise for organic movement
+    uint effectiveSeed = lightLeakSeed(uv, leakType, p);
+    float sineFlicker = sin(p.time * p.flickerSpeed * 6.28318) * 0.5;
+    float noiseFlicker = noise(float2(p.time * 0.5, float(effectiveSeed % 100)), effectiveSeed) * 0.35;
+    float compound = sineFlicker + noiseFlicker;
+    return 1.0 + compound * p.flickerIntensity;
+}
+
+inline float4 lightLeakBlend(float4 color, float3 leakColor, float leakIntensity, constant LightLeakParams &p) {
+    if (leakIntensity <= 0.0) return color;
+
     // Apply blend mode
     float3 blended;
-    switch (p.blendMode) {
+    int blendMode = hasFcLeakBlendMode ? fcLeakBlendMode : p.blendMode;
+    switch (blendMode) {
         case 0: blended = blendScreen(color.rgb, leakColor); break;
         case 1: blended = blendAdd(color.rgb, leakColor); break;
         case 2: blended = blendOverlay(color.rgb, leakColor); break;
@@ -1241,6 +1726,57 @@ fragment float4 lightLeakFragment(
     return float4(saturate(result), color.a);
 }
 
+fragment float4 lightLeakFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    constant LightLeakParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float4 color = sampleSrgb(inputTexture, s, in.texCoord);
+
+    if (p.enabled == 0) return storeSrgb(color);
+
+    float2 uv = tileImageUV(in.texCoord, tile);
+    float2 size = tileImageSize(tile, inputTexture);
+    int leakType = hasFcLeakType ? fcLeakType : p.leakType;
+
+    float4 layer = lightLeakLayer(uv, size.x / size.y, leakType, p);
+    return storeSrgb(lightLeakBlend(color, layer.rgb, layer.a * lightLeakFlicker(uv, leakType, p), p));
+}
+
+// ★★★ NEW: Cached leak layer (ProceduralLayerCache) ★★★
+// Bake 1 lần / seed ở độ phân giải thấp (field mượt) — layer texture phủ toàn ảnh, uv = texel center
+kernel void bakeLightLeakLayerKernel(
+    texture2d<float, access::write> layer [[texture(0)]],
+    constant LightLeakParams &p [[buffer(0)]],
+    uint2 gid [[thread_position_in_grid]]
+) {
+    float2 size = float2(layer.get_width(), layer.get_height());
+    if (gid.x >= uint(size.x) || gid.y >= uint(size.y)) return;
+
+    float2 uv = (float2(gid) + 0.5) / size;
+    layer.write(lightLeakLayer(uv, size.x / size.y, p.leakType, p), gid);
+}
+
+// Per-frame pass khi có layer: 1 fetch + flicker + blend
+fragment float4 lightLeakCompositeFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float> leakLayer [[texture(1)]],
+    constant LightLeakParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float4 color = sampleSrgb(inputTexture, s, in.texCoord);
+
+    if (p.enabled == 0) return storeSrgb(color);
+
+    float2 uv = tileImageUV(in.texCoord, tile);
+    float4 layer = leakLayer.sample(s, uv);
+    return storeSrgb(lightLeakBlend(color, layer.rgb, layer.a * lightLeakFlicker(uv, p.leakType, p), p));
+}
+
 // ═══════════════════════════════════════════════════════════════
 // ★★★ NEW: DATE STAMP EFFECT SHADER (Procedural 7-Segment) ★★★
 // Renders date stamp directly without textures using 7-segment display
@@ -1356,15 +1892,17 @@ inline float renderDigit(float2 uv, int digit) {
 fragment float4 dateStampFragment(
     VertexOut in [[stage_in]],
     texture2d<float> inputTexture [[texture(0)]],
-    constant DateStampParams &p [[buffer(0)]]
+    constant DateStampParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
 ) {
     constexpr sampler s(filter::linear, address::clamp_to_edge);
-    float4 color = inputTexture.sample(s, in.texCoord);
+    float4 color = sampleSrgb(inputTexture, s, in.texCoord);
 
-    if (p.enabled == 0 || p.digitCount == 0) return color;
+    if (p.enabled == 0 || p.digitCount == 0) return storeSrgb(color);
 
-    float2 uv = in.texCoord;
-    float aspect = float(inputTexture.get_width()) / float(inputTexture.get_height());
+    float2 uv = tileImageUV(in.texCoord, tile);
+    float2 size = tileImageSize(tile, inputTexture);
+    float aspect = size.x / size.y;
 
     // Calculate stamp dimensions
     float digitHeight = 0.05 * p.scale;
@@ -1394,7 +1932,7 @@ fragment float4 dateStampFragment(
     float2 stampUV = (uv - stampOrigin);
     if (stampUV.x < 0.0 || stampUV.y < 0.0 ||
         stampUV.x > totalWidth || stampUV.y > digitHeight) {
-        return color;
+        return storeSrgb(color);
     }
 
     // Determine which digit we're in
@@ -1416,7 +1954,7 @@ fragment float4 dateStampFragment(
         }
     }
 
-    if (stampAlpha <= 0.0) return color;
+    if (stampAlpha <= 0.0) return storeSrgb(color);
 
     // Apply glow effect
     float glowAlpha = stampAlpha;
@@ -1426,7 +1964,7 @@ fragment float4 dateStampFragment(
 
     // Blend stamp with image
     float finalAlpha = glowAlpha * p.opacity;
-    float3 stampColor = p.color;
+    float3 stampColor = float3(p.color);
 
     // Add subtle glow (additive blend for LED effect)
     if (p.glowEnabled != 0 && stampAlpha > 0.5) {
@@ -1436,7 +1974,7 @@ fragment float4 dateStampFragment(
     // Main stamp (alpha blend)
     color.rgb = mix(color.rgb, stampColor, finalAlpha);
 
-    return float4(saturate(color.rgb), color.a);
+    return storeSrgb(float4(saturate(color.rgb), color.a));
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -1445,6 +1983,53 @@ fragment float4 dateStampFragment(
 // early 2000s digital cameras with CCD sensors (Sony Cybershot, etc.)
 // ═══════════════════════════════════════════════════════════════
 
+// Horizontal bloom tap (chỉ pixel sáng hơn threshold, quadratic falloff)
+inline void ccdAccumulateHorizontal(float3 sampleColor, int i, int hSamples, float threshold,
+                                    thread float3 &hBloom, thread float &hWeight) {
+    if (luminance(sampleColor) > threshold) {
+        float dist = abs(float(i)) / float(hSamples);
+        float weight = 1.0 - dist * dist; // Quadratic falloff
+
+        hBloom += sampleColor * weight;
+        hWeight += weight;
+    }
+}
+
+// Purple fringe appears at high-contrast bright edges (edge detection using luminance gradient)
+inline float ccdFringeMask(float luma, float lumaL, float lumaR, float lumaU, float lumaD) {
+    float edgeH = abs(lumaL - lumaR);
+    float edgeV = abs(lumaU - lumaD);
+    float edge = sqrt(edgeH * edgeH + edgeV * edgeV);
+
+    return smoothstep(0.1, 0.3, edge) * smoothstep(0.5, 0.8, luma);
+}
+
+inline float3 ccdApplyFringe(float3 result, float fringeMask, float rShift, float bShift, constant CCDBloomParams &p) {
+    // Purple/magenta fringe color
+    float3 fringeColor = float3(0.6, 0.2, 0.8);
+
+    // Add fringe color
+    result += fringeColor * fringeMask * p.purpleFringing * 0.3;
+
+    // Apply chromatic aberration
+    result.r = mix(result.r, rShift, fringeMask * p.purpleFringing * 0.2);
+    result.b = mix(result.b, bShift, fringeMask * p.purpleFringing * 0.2);
+    return result;
+}
+
+inline float3 ccdBloomFinish(float3 result, float3 original, constant CCDBloomParams &p) {
+    // === WARM SHIFT IN BLOOM AREAS ===
+    if (p.warmShift > 0.0) {
+        float bloomAmount = max(0.0, luminance(result) - luminance(original));
+        result.r += bloomAmount * p.warmShift * 0.15;
+        result.b -= bloomAmount * p.warmShift * 0.08;
+    }
+
+    // Soft highlight compression to prevent harsh clipping
+    result = result / (result + 0.8);
+    return result * 1.8;
+}
+
 fragment float4 ccdBloomFragment(
     VertexOut in [[stage_in]],
     texture2d<float> inputTexture [[texture(0)]],
@@ -1453,9 +2038,9 @@ fragment float4 ccdBloomFragment(
     constexpr sampler s(filter::linear, address::clamp_to_edge);
     float2 uv = in.texCoord;
 
-    float4 color = inputTexture.sample(s, uv);
+    float4 color = sampleSrgb(inputTexture, s, uv);
 
-    if (p.enabled == 0) return color;
+    if (p.enabled == 0) return storeSrgb(color);
 
     float2 pixelSize = 1.0 / p.imageSize;
     float3 result = color.rgb;
@@ -1481,7 +2066,7 @@ fragment float4 ccdBloomFragment(
             // Clamp to valid range
             sampleUV = clamp(sampleUV, 0.0, 1.0);
 
-            float4 sampleColor = inputTexture.sample(s, sampleUV);
+            float4 sampleColor = sampleSrgb(inputTexture, s, sampleUV);
             float sampleLuma = luminance(sampleColor.rgb);
 
             // Only include bright pixels in smear
@@ -1518,16 +2103,7 @@ fragment float4 ccdBloomFragment(
             float2 sampleUV = uv + float2(offset, 0.0);
             sampleUV = clamp(sampleUV, 0.0, 1.0);
 
-            float4 sampleColor = inputTexture.sample(s, sampleUV);
-            float sampleLuma = luminance(sampleColor.rgb);
-
-            if (sampleLuma > p.threshold) {
-                float dist = abs(float(i)) / float(hSamples);
-                float weight = 1.0 - dist * dist; // Quadratic falloff
-
-                hBloom += sampleColor.rgb * weight;
-                hWeight += weight;
-            }
+            ccdAccumulateHorizontal(sampleSrgb(inputTexture, s, sampleUV).rgb, i, hSamples, p.threshold, hBloom, hWeight);
         }
 
         if (hWeight > 0.0) {
@@ -1540,48 +2116,181 @@ fragment float4 ccdBloomFragment(
     // High contrast edges get purple/magenta fringing
     if (p.purpleFringing > 0.0) {
         // Edge detection using luminance gradient
-        float lumaL = luminance(inputTexture.sample(s, uv - float2(pixelSize.x, 0)).rgb);
-        float lumaR = luminance(inputTexture.sample(s, uv + float2(pixelSize.x, 0)).rgb);
-        float lumaU = luminance(inputTexture.sample(s, uv - float2(0, pixelSize.y)).rgb);
-        float lumaD = luminance(inputTexture.sample(s, uv + float2(0, pixelSize.y)).rgb);
-
-        float edgeH = abs(lumaL - lumaR);
-        float edgeV = abs(lumaU - lumaD);
-        float edge = sqrt(edgeH * edgeH + edgeV * edgeV);
-
-        // Purple fringe appears at high-contrast bright edges
-        float fringeMask = smoothstep(0.1, 0.3, edge) * smoothstep(0.5, 0.8, luma);
+        float fringeMask = ccdFringeMask(
+            luma,
+            luminance(sampleSrgb(inputTexture, s, uv - float2(pixelSize.x, 0)).rgb),
+            luminance(sampleSrgb(inputTexture, s, uv + float2(pixelSize.x, 0)).rgb),
+            luminance(sampleSrgb(inputTexture, s, uv - float2(0, pixelSize.y)).rgb),
+            luminance(sampleSrgb(inputTexture, s, uv + float2(0, pixelSize.y)).rgb)
+        );
 
         if (fringeMask > 0.0) {
-            // Purple/magenta fringe color
-            float3 fringeColor = float3(0.6, 0.2, 0.8);
-
             // Chromatic aberration - shift red/blue channels
             float caOffset = p.fringeWidth * 5.0;
-            float rShift = inputTexture.sample(s, uv + float2(caOffset * pixelSize.x, 0)).r;
-            float bShift = inputTexture.sample(s, uv - float2(caOffset * pixelSize.x, 0)).b;
+            float rShift = sampleSrgb(inputTexture, s, uv + float2(caOffset * pixelSize.x, 0)).r;
+            float bShift = sampleSrgb(inputTexture, s, uv - float2(caOffset * pixelSize.x, 0)).b;
+
+            result = ccdApplyFringe(result, fringeMask, rShift, bShift, p);
+        }
+    }
+
+    result = ccdBloomFinish(result, color.rgb, p);
+
+    return storeSrgb(float4(saturate(result), color.a));
+}
 
-            // Add fringe color
-            result += fringeColor * fringeMask * p.purpleFringing * 0.3;
+// ★★★ NEW: CCD bloom compute path ★★★
+// 1. ccdSmearKernel: vertical smear theo cột - mỗi thread 1 đoạn cột, cửa sổ trượt với trọng số tam giác
+//    (Σ m·c và Σ |i|·m·c cập nhật O(1) mỗi row) thay cho 4..30 taps / pixel
+// 2. ccdBloomKernel: horizontal bloom + fringing đọc từ threadgroup tile (apron = hSamples × 3 px)
+
+// Màu đã mask (luma > threshold) của row y (clamp như sampleUV) → (rgb·m, m)
+inline float4 ccdSmearTap(texture2d<float> texture, int x, int y, int maxY, float threshold) {
+    float3 c = loadSrgb(texture.read(uint2(x, clamp(y, 0, maxY)))).rgb;
+    float m = luminance(c) > threshold ? 1.0 : 0.0;
+    return float4(c * m, m);
+}
+
+kernel void ccdSmearKernel(
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float, access::write> smearTexture [[texture(1)]],
+    constant CCDBloomParams &p [[buffer(0)]],
+    constant CCDSmearParams &sp [[buffer(1)]],
+    uint2 gid [[thread_position_in_grid]]
+) {
+    int width = int(inputTexture.get_width());
+    int height = int(inputTexture.get_height());
+    int x = int(gid.x);
+    int y0 = int(gid.y) * sp.segmentRows;
+    if (x >= width || y0 >= height) return;
+
+    int y1 = min(y0 + sp.segmentRows, height);
+    int maxY = height - 1;
+    int n = sp.length;
+    int a = sp.above;
+    float invN = 1.0 / float(n);
+
+    // Taps cách nhau 3 rows → 3 chuỗi độc lập theo y mod 3
+    for (int phase = 0; phase < 3; phase++) {
+        int y = y0 + phase;
+        if (y >= y1) break;
+
+        // below: i ∈ [1, n] weight 1.2·(1 - i/n); above: i ∈ [-a, 0] weight 1 - |i|/n
+        // .rgb = Σ màu, .a = Σ mask; *1 = cùng tổng nhân |i|
+        float4 below0 = float4(0.0), below1 = float4(0.0);
+        float4 above0 = float4(0.0), above1 = float4(0.0);
+        for (int i = 1; i <= n; i++) {
+            float4 t = ccdSmearTap(inputTexture, x, y + i * 3, maxY, p.threshold);
+            below0 += t;
+            below1 += float(i) * t;
+        }
+        for (int i = 0; i <= a; i++) {
+            float4 t = ccdSmearTap(inputTexture, x, y - i * 3, maxY, p.threshold);
+            above0 += t;
+            above1 += float(i) * t;
+        }
 
-            // Apply chromatic aberration
-            result.r = mix(result.r, rShift, fringeMask * p.purpleFringing * 0.2);
-            result.b = mix(result.b, bShift, fringeMask * p.purpleFringing * 0.2);
+        for (; y < y1; y += 3) {
+            float4 weighted = 1.2 * (below0 - below1 * invN) + (above0 - above1 * invN);
+            bool hasSmear = weighted.a > 1e-4;
+            smearTexture.write(float4(hasSmear ? weighted.rgb / weighted.a : float3(0.0), hasSmear ? 1.0 : 0.0), uint2(x, y));
+
+            // Trượt 3 rows: tap i = 1 chuyển từ below sang above (i = 0), tap i = -a rời above
+            float4 shifted = ccdSmearTap(inputTexture, x, y + 3, maxY, p.threshold);
+            float4 leaving = ccdSmearTap(inputTexture, x, y - a * 3, maxY, p.threshold);
+            float4 entering = ccdSmearTap(inputTexture, x, y + (n + 1) * 3, maxY, p.threshold);
+
+            below0 -= shifted;
+            below1 -= shifted;
+            below1 -= below0;
+            below0 += entering;
+            below1 += float(n) * entering;
+
+            above1 += above0;
+            above0 -= leaving;
+            above1 -= float(a + 1) * leaving;
+            above0 += shifted;
         }
     }
+}
 
-    // === WARM SHIFT IN BLOOM AREAS ===
-    if (p.warmShift > 0.0) {
-        float bloomAmount = max(0.0, luminance(result) - luminance(color.rgb));
-        result.r += bloomAmount * p.warmShift * 0.15;
-        result.b -= bloomAmount * p.warmShift * 0.08;
+kernel void ccdBloomKernel(
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float> smearTexture [[texture(1)]],
+    texture2d<float, access::write> outputTexture [[texture(2)]],
+    constant CCDBloomParams &p [[buffer(0)]],
+    constant KernelTileParams &tp [[buffer(BufferIndexKernelTile)]],
+    threadgroup half4 *tile [[threadgroup(0)]],
+    uint2 gid [[thread_position_in_grid]],
+    uint2 group [[threadgroup_position_in_grid]],
+    uint2 groupSize [[threads_per_threadgroup]],
+    uint lid [[thread_index_in_threadgroup]]
+) {
+    TileFootprint fp = groupFootprint(group, groupSize, tp);
+    loadTile(tile, inputTexture, fp, lid, groupSize.x * groupSize.y, true);
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    if (gid.x >= outputTexture.get_width() || gid.y >= outputTexture.get_height()) return;
+
+    int2 texel = int2(gid);
+    float4 color = tileTexel(tile, fp, inputTexture, texel, true);
+
+    if (p.enabled == 0) {
+        outputTexture.write(storeSrgb(color), gid);
+        return;
     }
 
-    // Soft highlight compression to prevent harsh clipping
-    result = result / (result + 0.8);
-    result = result * 1.8;
+    float3 result = color.rgb;
+    float luma = luminance(color.rgb);
+    float bloomMask = smoothstep(p.threshold, p.threshold + 0.1, luma);
 
-    return float4(saturate(result), color.a);
+    // === VERTICAL SMEAR (ccdSmearKernel) ===
+    if (p.verticalSmear > 0.0 && bloomMask > 0.0) {
+        float4 smear = smearTexture.read(gid);
+        if (smear.a > 0.0) {
+            result += smear.rgb * p.verticalSmear * p.intensity * 0.5;
+        }
+    }
+
+    // === HORIZONTAL BLOOM ===
+    if (p.horizontalBloom > 0.0 && bloomMask > 0.0) {
+        float3 hBloom = float3(0.0);
+        float hWeight = 0.0;
+
+        int hSamples = clamp(int(p.horizontalRadius * 30.0), 2, 15);
+        for (int i = -hSamples; i <= hSamples; i++) {
+            ccdAccumulateHorizontal(tileTexel(tile, fp, inputTexture, texel + int2(i * 3, 0), true).rgb, i, hSamples, p.threshold, hBloom, hWeight);
+        }
+
+        if (hWeight > 0.0) {
+            hBloom /= hWeight;
+            result += hBloom * p.horizontalBloom * p.intensity * 0.3;
+        }
+    }
+
+    // === PURPLE FRINGING ===
+    if (p.purpleFringing > 0.0) {
+        float fringeMask = ccdFringeMask(
+            luma,
+            luminance(tileTexel(tile, fp, inputTexture, texel - int2(1, 0), true).rgb),
+            luminance(tileTexel(tile, fp, inputTexture, texel + int2(1, 0), true).rgb),
+            luminance(tileTexel(tile, fp, inputTexture, texel - int2(0, 1), true).rgb),
+            luminance(tileTexel(tile, fp, inputTexture, texel + int2(0, 1), true).rgb)
+        );
+
+        if (fringeMask > 0.0) {
+            float caOffset = p.fringeWidth * 5.0;
+            float2 position = float2(texel) + 0.5;
+            float rShift = tileSample(tile, fp, inputTexture, position + float2(caOffset, 0.0), true).r;
+            float bShift = tileSample(tile, fp, inputTexture, position - float2(caOffset, 0.0), true).b;
+
+            result = ccdApplyFringe(result, fringeMask, rShift, bShift, p);
+        }
+    }
+
+    result = ccdBloomFinish(result, color.rgb, p);
+
+    outputTexture.write(storeSrgb(float4(saturate(result), color.a)), gid);
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -1607,25 +2316,13 @@ float3 hsvToRgbBW(float h, float s, float v) {
 }
 
 // B&W Film grain generator
-float bwGrain(float2 uv, uint seed, float size) {
+float bwGrain(float2 uv, uint seed, float size, texture2d<float> grainNoise) {
     float2 scaled = uv * size * 500.0;
-    float n1 = fract(sin(dot(scaled + float(seed) * 0.1, float2(12.9898, 78.233))) * 43758.5453);
-    float n2 = fract(sin(dot(scaled + float(seed) * 0.2, float2(93.9898, 67.345))) * 24634.6345);
-    return (n1 + n2) * 0.5 - 0.5; // Centered around 0
+    return noiseSmooth(grainNoise, scaled, seed).a - 0.5; // Centered around 0
 }
 
-fragment float4 bwConvertFragment(
-    VertexOut in [[stage_in]],
-    texture2d<float> inputTexture [[texture(0)]],
-    constant BWParams &p [[buffer(0)]]
-) {
-    constexpr sampler s(filter::linear, address::clamp_to_edge);
-    float2 uv = in.texCoord;
-
-    float4 color = inputTexture.sample(s, uv);
-
-    if (p.enabled == 0) return color;
-
+// ★ Channel mix → luma (normalized khi weights không cộng lại = 1)
+inline float bwMixLuma(float3 color, constant BWParams &p) {
     // === CHANNEL MIXING ===
     // Convert to grayscale with custom RGB weights
     float luma = color.r * p.redWeight +
@@ -1637,7 +2334,12 @@ fragment float4 bwConvertFragment(
     if (weightSum > 0.0) {
         luma /= weightSum;
     }
+    return luma;
+}
 
+// ★ Brightness/contrast/gamma + toning của luma đã mix
+// Trả về (toned rgb, luma sau gamma cho grain) - không phụ thuộc vị trí → bakeBWToneKernel bake thành 1D
+inline float4 bwToneCore(float luma, constant BWParams &p) {
     // === CONTRAST & BRIGHTNESS ===
     // Apply brightness (shift)
     luma += p.brightness;
@@ -1652,10 +2354,11 @@ fragment float4 bwConvertFragment(
     // === TONING ===
     float3 result = float3(luma);
 
-    if (p.toningMode > 0 && p.toningIntensity > 0.0) {
+    int toningMode = hasFcBWToningMode ? fcBWToningMode : p.toningMode;
+    if (toningMode > 0 && p.toningIntensity > 0.0) {
         float3 toneColor = float3(1.0);
 
-        switch (p.toningMode) {
+        switch (toningMode) {
             case 1: // Sepia - warm brown
                 toneColor = float3(1.0, 0.89, 0.71);
                 break;
@@ -1681,12 +2384,12 @@ fragment float4 bwConvertFragment(
                 break;
             }
             case 5: // Custom color
-                toneColor = p.customColor;
+                toneColor = float3(p.customColor);
                 break;
         }
 
         // Apply toning
-        if (p.toningMode == 4) {
+        if (toningMode == 4) {
             // Split tone: colorize based on luminance zones
             result = luma * toneColor;
         } else {
@@ -1695,9 +2398,14 @@ fragment float4 bwConvertFragment(
         }
     }
 
+    return float4(result, luma);
+}
+
+// ★ Grain phụ thuộc UV → luôn tính per-pixel (kể cả khi tone đã bake)
+inline float3 bwGrainCore(float3 result, float luma, float2 uv, constant BWParams &p, texture2d<float> grainNoise) {
     // === B&W FILM GRAIN ===
     if (p.grainIntensity > 0.0) {
-        float grain = bwGrain(uv, p.grainSeed, p.grainSize);
+        float grain = bwGrain(uv, p.grainSeed, p.grainSize, grainNoise);
 
         // Grain is more visible in midtones
         float midtoneMask = 1.0 - abs(luma - 0.5) * 2.0;
@@ -1707,50 +2415,96 @@ fragment float4 bwConvertFragment(
         result += grain * p.grainIntensity * 0.15 * midtoneMask;
     }
 
-    return float4(saturate(result), color.a);
+    return saturate(result);
 }
 
-// ═══════════════════════════════════════════════════════════════
-// OVERLAYS (Dust & Scratches)
-// Procedural dust particles and film scratches for vintage look
-// ═══════════════════════════════════════════════════════════════
+// ★ Core dùng chung cho bwConvertFragment và fusedPreviewFragment
+inline float3 bwConvertCore(float3 color, float2 uv, constant BWParams &p, texture2d<float> grainNoise) {
+    if (p.enabled == 0) return color;
 
-// Hash function for random distribution
-inline float overlayHash(float2 p, uint seed) {
-    float3 p3 = fract(float3(p.xyx) * 0.1031 + float(seed) * 0.001);
-    p3 += dot(p3, p3.yzx + 33.33);
-    return fract((p3.x + p3.y) * p3.z);
+    float4 toned = bwToneCore(bwMixLuma(color, p), p);
+    return bwGrainCore(toned.rgb, toned.a, uv, p, grainNoise);
 }
 
-// 2D noise for organic patterns
-inline float overlayNoise(float2 uv, uint seed) {
-    float2 i = floor(uv);
-    float2 f = fract(uv);
-    f = f * f * (3.0 - 2.0 * f);
-
-    float a = overlayHash(i, seed);
-    float b = overlayHash(i + float2(1.0, 0.0), seed);
-    float c = overlayHash(i + float2(0.0, 1.0), seed);
-    float d = overlayHash(i + float2(1.0, 1.0), seed);
+// ★★★ NEW: Baked B&W - tone curve + toning = 1 fetch từ texture 1D (ColorLUTBaker) ★★★
+inline float3 bwConvertBaked(float3 color, float2 uv, constant BWParams &p, texture1d<float> toneTexture, texture2d<float> grainNoise) {
+    constexpr sampler toneSampler(filter::linear, address::clamp_to_edge);
+    if (p.enabled == 0) return color;
 
-    return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
+    float width = float(toneTexture.get_width());
+    float coord = saturate(bwMixLuma(color, p)) * ((width - 1.0) / width) + 0.5 / width;
+    float4 toned = toneTexture.sample(toneSampler, coord);
+    return bwGrainCore(toned.rgb, toned.a, uv, p, grainNoise);
 }
 
-// Fractal noise for clumping
-inline float overlayFbm(float2 uv, uint seed) {
-    float value = 0.0;
-    float amplitude = 0.5;
-    for (int i = 0; i < 3; i++) {
-        value += amplitude * overlayNoise(uv, seed + uint(i));
-        uv *= 2.0;
+fragment float4 bwConvertFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float> grainNoise [[texture(TextureIndexNoise)]],
+    constant BWParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float2 uv = in.texCoord;
+
+    float4 color = sampleSrgb(inputTexture, s, uv);
+
+    if (p.enabled == 0) return storeSrgb(color);
+
+    return storeSrgb(float4(bwConvertCore(color.rgb, tileImageUV(uv, tile), p, grainNoise), color.a));
+}
+
+// ★★★ NEW: Baked B&W tone (ColorLUTBaker) ★★★
+// Texture 1D: x = luma sau channel mix, rgba = (toned rgb, luma sau gamma)
+kernel void bakeBWToneKernel(
+    texture1d<float, access::write> toneTexture [[texture(0)]],
+    constant BWParams &p [[buffer(0)]],
+    uint gid [[thread_position_in_grid]]
+) {
+    uint width = toneTexture.get_width();
+    if (gid >= width) return;
+
+    toneTexture.write(bwToneCore(float(gid) / float(width - 1), p), gid);
+}
+
+fragment float4 bwConvertBakedFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    texture1d<float> toneTexture [[texture(1)]],
+    texture2d<float> grainNoise [[texture(TextureIndexNoise)]],
+    constant BWParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float2 uv = in.texCoord;
+
+    float4 color = sampleSrgb(inputTexture, s, uv);
+
+    if (p.enabled == 0) return storeSrgb(color);
+
+    return storeSrgb(float4(bwConvertBaked(color.rgb, tileImageUV(uv, tile), p, toneTexture, grainNoise), color.a));
+}
+
+// ═══════════════════════════════════════════════════════════════
+// OVERLAYS (Dust & Scratches)
+// Procedural dust particles and film scratches for vintage look
+// ═══════════════════════════════════════════════════════════════
+
+// Fractal noise for clumping (3 bilinear fetches thay cho 12 hash)
+inline float overlayFbm(texture2d<float> noise, float2 uv, uint seed) {
+    float value = 0.0;
+    float amplitude = 0.5;
+    for (int i = 0; i < 3; i++) {
+        value += amplitude * noiseSmooth(noise, uv, seed + uint(i)).r;
+        uv *= 2.0;
         amplitude *= 0.5;
     }
     return value;
 }
 
-// Generate dust particle at position
-inline float dustParticle(float2 uv, float2 center, float size, float variation, uint seed) {
-    float sizeVar = 1.0 + (overlayHash(center, seed + 100u) - 0.5) * variation;
+// Generate dust particle at position (sizeRand/wobbleRand: random [0,1] của cell)
+inline float dustParticle(float2 uv, float2 center, float size, float variation, float sizeRand, float wobbleRand) {
+    float sizeVar = 1.0 + (sizeRand - 0.5) * variation;
     float actualSize = size * sizeVar * 0.005;
 
     float dist = length(uv - center);
@@ -1758,7 +2512,7 @@ inline float dustParticle(float2 uv, float2 center, float size, float variation,
 
     // Add slight irregularity to particle shape
     float angle = atan2(uv.y - center.y, uv.x - center.x);
-    float wobble = 1.0 + 0.2 * sin(angle * 5.0 + overlayHash(center, seed + 200u) * 6.28);
+    float wobble = 1.0 + 0.2 * sin(angle * 5.0 + wobbleRand * 6.28);
     particle *= wobble;
 
     return saturate(particle);
@@ -1821,18 +2575,10 @@ inline float3 applyOverlayBlend(float3 base, float3 overlay, int blendMode, floa
     return mix(base, result, intensity);
 }
 
-fragment float4 overlaysFragment(
-    VertexOut in [[stage_in]],
-    texture2d<float> inputTexture [[texture(0)]],
-    constant OverlaysParams &p [[buffer(0)]]
-) {
-    constexpr sampler s(filter::linear, address::clamp_to_edge);
-    float4 color = inputTexture.sample(s, in.texCoord);
-
-    if (p.enabled == 0) return color;
-
-    float2 uv = in.texCoord;
-    float3 result = color.rgb;
+// ★ Dust + scratch coverage — chỉ phụ thuộc uv, seed + params (không đọc ảnh)
+// x = dust mask, y = scratch mask → bakeOverlaysLayerKernel cache theo seed
+inline float2 overlaysMasks(float2 uv, constant OverlaysParams &p, texture2d<float> whiteNoise) {
+    float2 masks = float2(0.0);
 
     // === DUST PARTICLES ===
     if (p.dustEnabled != 0 && p.dustDensity > 0.0) {
@@ -1842,36 +2588,30 @@ fragment float4 overlaysFragment(
         float cellSize = 0.03 / (p.dustDensity + 0.1);
         float2 cell = floor(uv / cellSize);
 
+        // Clumping chỉ phụ thuộc uv → tính 1 lần thay vì mỗi cell
+        bool clumped = p.dustClumping > 0.0 && overlayFbm(whiteNoise, uv * 10.0, p.seed) < p.dustClumping * 0.5;
+
         // Check neighboring cells for particles
-        for (int dx = -1; dx <= 1; dx++) {
+        for (int dx = -1; dx <= 1 && !clumped; dx++) {
             for (int dy = -1; dy <= 1; dy++) {
                 float2 checkCell = cell + float2(dx, dy);
-                uint cellSeed = p.seed + uint(checkCell.x * 1000.0 + checkCell.y);
+
+                // 1 texel / cell: r = probability, gb = position, a = size variation
+                float4 cellRand = noiseTexel(whiteNoise, checkCell, p.seed);
 
                 // Probability of particle in this cell
-                if (overlayHash(checkCell, cellSeed) < p.dustDensity * 0.8) {
+                if (cellRand.r < p.dustDensity * 0.8) {
                     // Particle position within cell
                     float2 particlePos = (checkCell + 0.5) * cellSize;
-                    particlePos += (float2(overlayHash(checkCell, cellSeed + 1u),
-                                          overlayHash(checkCell, cellSeed + 2u)) - 0.5) * cellSize * 0.8;
-
-                    // Apply clumping
-                    if (p.dustClumping > 0.0) {
-                        float clumpNoise = overlayFbm(uv * 10.0, p.seed);
-                        if (clumpNoise < p.dustClumping * 0.5) continue;
-                    }
+                    particlePos += (cellRand.gb - 0.5) * cellSize * 0.8;
 
-                    dustMask += dustParticle(uv, particlePos, p.dustSize, p.dustVariation, cellSeed);
+                    float wobbleRand = noiseTexel(whiteNoise, checkCell, p.seed + 1u).r;
+                    dustMask += dustParticle(uv, particlePos, p.dustSize, p.dustVariation, cellRand.a, wobbleRand);
                 }
             }
         }
 
-        dustMask = saturate(dustMask);
-
-        if (dustMask > 0.0) {
-            float3 dustColor = float3(0.1); // Dark dust
-            result = applyOverlayBlend(result, dustColor, p.dustBlendMode, dustMask * p.dustOpacity);
-        }
+        masks.x = saturate(dustMask);
     }
 
     // === SCRATCHES ===
@@ -1882,21 +2622,19 @@ fragment float4 overlaysFragment(
         int numScratches = int(p.scratchDensity * 15.0) + 1;
 
         for (int i = 0; i < numScratches && i < 20; i++) {
-            uint scratchSeed = p.seed + uint(i) * 7919u;
+            // 2 texel / scratch: rg = start, b = angle, a = angle variation; r (row 1) = length
+            float4 scratchRand = noiseTexel(whiteNoise, float2(float(i), 0.0), p.seed + 7919u);
 
             // Random scratch position
-            float startX = overlayHash(float2(float(i), 0.0), scratchSeed);
-            float startY = overlayHash(float2(0.0, float(i)), scratchSeed + 1u);
-
-            float2 start = float2(startX, startY);
+            float2 start = scratchRand.rg;
 
             // Scratch direction (mostly vertical if preferred)
-            float baseAngle = p.scratchVertical != 0 ? 1.5708 : overlayHash(float2(float(i), float(i)), scratchSeed + 2u) * 3.14159;
-            float angleVar = p.scratchAngle * (overlayHash(float2(float(i * 2), 0.0), scratchSeed + 3u) - 0.5) * 0.5;
+            float baseAngle = p.scratchVertical != 0 ? 1.5708 : scratchRand.b * 3.14159;
+            float angleVar = p.scratchAngle * (scratchRand.a - 0.5) * 0.5;
             float angle = baseAngle + angleVar;
 
             // Scratch length
-            float len = p.scratchLength * (0.5 + overlayHash(float2(float(i), float(i) * 2.0), scratchSeed + 4u) * 0.5);
+            float len = p.scratchLength * (0.5 + noiseTexel(whiteNoise, float2(float(i), 1.0), p.seed + 7919u).r * 0.5);
 
             float2 dir = float2(cos(angle), sin(angle));
             float2 end = start + dir * len;
@@ -1909,15 +2647,71 @@ fragment float4 overlaysFragment(
             scratchMask += scratchLine(uvCorrected, start, end, p.scratchWidth);
         }
 
-        scratchMask = saturate(scratchMask);
+        masks.y = saturate(scratchMask);
+    }
 
-        if (scratchMask > 0.0) {
-            float3 scratchColor = float3(0.9); // Light scratches
-            result = applyOverlayBlend(result, scratchColor, p.scratchBlendMode, scratchMask * p.scratchOpacity);
-        }
+    return masks;
+}
+
+inline float3 overlaysComposite(float3 result, float2 masks, constant OverlaysParams &p) {
+    if (masks.x > 0.0) {
+        float3 dustColor = float3(0.1); // Dark dust
+        result = applyOverlayBlend(result, dustColor, p.dustBlendMode, masks.x * p.dustOpacity);
     }
 
-    return float4(saturate(result), color.a);
+    if (masks.y > 0.0) {
+        float3 scratchColor = float3(0.9); // Light scratches
+        result = applyOverlayBlend(result, scratchColor, p.scratchBlendMode, masks.y * p.scratchOpacity);
+    }
+
+    return saturate(result);
+}
+
+fragment float4 overlaysFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float> whiteNoise [[texture(TextureIndexNoise)]],
+    constant OverlaysParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float4 color = sampleSrgb(inputTexture, s, in.texCoord);
+
+    if (p.enabled == 0) return storeSrgb(color);
+
+    float2 masks = overlaysMasks(tileImageUV(in.texCoord, tile), p, whiteNoise);
+    return storeSrgb(float4(overlaysComposite(color.rgb, masks, p), color.a));
+}
+
+// ★★★ NEW: Cached dust & scratch layer (ProceduralLayerCache) ★★★
+// rg = (dust, scratch) mask toàn ảnh — scratch rộng ~1px nên layer gần full res
+kernel void bakeOverlaysLayerKernel(
+    texture2d<float, access::write> layer [[texture(0)]],
+    texture2d<float> whiteNoise [[texture(TextureIndexNoise)]],
+    constant OverlaysParams &p [[buffer(0)]],
+    uint2 gid [[thread_position_in_grid]]
+) {
+    float2 size = float2(layer.get_width(), layer.get_height());
+    if (gid.x >= uint(size.x) || gid.y >= uint(size.y)) return;
+
+    float2 uv = (float2(gid) + 0.5) / size;
+    layer.write(float4(overlaysMasks(uv, p, whiteNoise), 0.0, 1.0), gid);
+}
+
+fragment float4 overlaysCompositeFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float> overlaysLayer [[texture(1)]],
+    constant OverlaysParams &p [[buffer(0)]],
+    constant TileRegion &tile [[buffer(BufferIndexTileRegion)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float4 color = sampleSrgb(inputTexture, s, in.texCoord);
+
+    if (p.enabled == 0) return storeSrgb(color);
+
+    float2 masks = overlaysLayer.sample(s, tileImageUV(in.texCoord, tile)).rg;
+    return storeSrgb(float4(overlaysComposite(color.rgb, masks, p), color.a));
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -1926,12 +2720,10 @@ fragment float4 overlaysFragment(
 // color bleeding, tracking distortion, and analog noise
 // ═══════════════════════════════════════════════════════════════
 
-// VHS noise pattern
-inline float vhsNoise(float2 uv, float time, uint seed) {
-    float2 p = uv * 100.0 + float2(time * 50.0, 0.0);
-    float3 p3 = fract(float3(p.xyx) * 0.1031 + float(seed) * 0.01);
-    p3 += dot(p3, p3.yzx + 33.33);
-    return fract((p3.x + p3.y) * p3.z) * 2.0 - 1.0;
+// VHS noise pattern: blue noise, mỗi frame (30 Hz) 1 offset mới → nhiễu chạy theo thời gian
+inline float vhsNoise(texture2d<float> blueNoise, float2 texel, float time, uint seed) {
+    uint frame = uint(max(time, 0.0) * 30.0);
+    return noiseTexel(blueNoise, texel, seed + frame * 16u).r * 2.0 - 1.0;
 }
 
 // Scanline pattern
@@ -1940,9 +2732,78 @@ inline float scanlinePattern(float y, float density, float intensity) {
     return 1.0 - (0.5 - line * 0.5) * intensity;
 }
 
+// Tracking distortion: horizontal wave + glitch lines theo row → UV đã clamp
+inline float2 vhsTrackingUV(float2 uv, constant VHSEffectsParams &p, texture2d<float> blueNoise) {
+    float2 distortedUV = uv;
+    if ((p.features & VHS_FEATURE_TRACKING) != 0 && p.trackingIntensity > 0.0) {
+        // Horizontal wave distortion
+        float wave = sin(uv.y * 20.0 + p.time * p.trackingSpeed * 5.0) * p.trackingWaveHeight;
+        wave += vhsNoise(blueNoise, float2(uv.y * 240.0, 0.0), p.time, 1u) * p.trackingNoise * 0.02;
+
+        // Apply tracking distortion
+        distortedUV.x += wave * p.trackingIntensity;
+
+        // Occasional glitch lines
+        float glitchLine = step(0.98, vhsNoise(blueNoise, float2(0.0, uv.y * 48.0), p.time, 2u));
+        distortedUV.x += glitchLine * 0.05 * p.trackingIntensity;
+    }
+
+    // Clamp UV
+    return clamp(distortedUV, 0.0, 1.0);
+}
+
+// Color bleed offsets: (red px, blue px, vertical UV)
+inline float3 vhsBleedOffsets(constant VHSEffectsParams &p) {
+    // Sample channels with horizontal offset (simulates analog bandwidth limitations)
+    float redOffset = p.colorBleedRedShift * p.colorBleedIntensity * 10.0;
+    float blueOffset = p.colorBleedBlueShift * p.colorBleedIntensity * 10.0;
+
+    // Also add vertical bleed
+    float verticalOffset = p.colorBleedVertical * p.colorBleedIntensity * 0.01;
+    return float3(redOffset, blueOffset, verticalOffset);
+}
+
+inline float3 vhsSaturationLoss(float3 result, constant VHSEffectsParams &p) {
+    if (p.saturationLoss > 0.0) {
+        float luma = dot(result, float3(0.299, 0.587, 0.114));
+        result = mix(result, float3(luma), p.saturationLoss);
+    }
+    return result;
+}
+
+// Scanlines + static noise (chỉ phụ thuộc toạ độ pixel)
+inline float3 vhsScanlinesAndNoise(float3 result, float2 uv, float2 texSize, constant VHSEffectsParams &p, texture2d<float> blueNoise) {
+    // === SCANLINES ===
+    if ((p.features & VHS_FEATURE_SCANLINES) != 0 && p.scanlinesIntensity > 0.0) {
+        float scanline = scanlinePattern(uv.y, p.scanlinesDensity, p.scanlinesIntensity);
+
+        // Add flicker
+        float flicker = 1.0 + sin(p.time * p.scanlinesFlickerSpeed * 30.0) * p.scanlinesFlickerIntensity * 0.1;
+        scanline *= flicker;
+
+        result *= scanline;
+    }
+
+    // === NOISE ===
+    if (p.noiseIntensity > 0.0) {
+        float2 texel = uv * texSize;
+        float noise = vhsNoise(blueNoise, texel, p.time, 3u);
+
+        // Add some color to the noise (VHS noise is slightly colored)
+        float3 coloredNoise = float3(noise);
+        coloredNoise.r += vhsNoise(blueNoise, texel, p.time, 4u) * 0.1;
+        coloredNoise.b += vhsNoise(blueNoise, texel, p.time, 5u) * 0.1;
+
+        result += coloredNoise * p.noiseIntensity * 0.1;
+    }
+
+    return result;
+}
+
 fragment float4 vhsEffectsFragment(
     VertexOut in [[stage_in]],
     texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float> blueNoise [[texture(TextureIndexBlueNoise)]],
     constant VHSEffectsParams &p [[buffer(0)]]
 ) {
     constexpr sampler s(filter::linear, address::clamp_to_edge);
@@ -1956,47 +2817,24 @@ fragment float4 vhsEffectsFragment(
     float2 pixelSize = 1.0 / texSize;
 
     // === TRACKING DISTORTION ===
-    float2 distortedUV = uv;
-    if (p.trackingEnabled != 0 && p.trackingIntensity > 0.0) {
-        // Horizontal wave distortion
-        float wave = sin(uv.y * 20.0 + p.time * p.trackingSpeed * 5.0) * p.trackingWaveHeight;
-        wave += vhsNoise(float2(uv.y * 10.0, p.time), p.time, 1u) * p.trackingNoise * 0.02;
-
-        // Apply tracking distortion
-        distortedUV.x += wave * p.trackingIntensity;
-
-        // Occasional glitch lines
-        float glitchLine = step(0.98, vhsNoise(float2(p.time * 10.0, uv.y * 5.0), p.time, 2u));
-        distortedUV.x += glitchLine * 0.05 * p.trackingIntensity;
-    }
-
-    // Clamp UV
-    distortedUV = clamp(distortedUV, 0.0, 1.0);
+    float2 distortedUV = vhsTrackingUV(uv, p, blueNoise);
 
     // === COLOR BLEED / CHROMATIC SEPARATION ===
     float3 result;
-    if (p.colorBleedEnabled != 0 && p.colorBleedIntensity > 0.0) {
-        // Sample channels with horizontal offset (simulates analog bandwidth limitations)
-        float redOffset = p.colorBleedRedShift * p.colorBleedIntensity * 10.0;
-        float blueOffset = p.colorBleedBlueShift * p.colorBleedIntensity * 10.0;
+    if ((p.features & VHS_FEATURE_COLOR_BLEED) != 0 && p.colorBleedIntensity > 0.0) {
+        float3 bleed = vhsBleedOffsets(p);
 
-        // Also add vertical bleed
-        float verticalOffset = p.colorBleedVertical * p.colorBleedIntensity * 0.01;
-
-        float r = inputTexture.sample(s, distortedUV + float2(redOffset * pixelSize.x, 0.0)).r;
-        float g = inputTexture.sample(s, distortedUV).g;
-        float b = inputTexture.sample(s, distortedUV - float2(blueOffset * pixelSize.x, verticalOffset)).b;
+        float r = sampleSrgb(inputTexture, s, distortedUV + float2(bleed.x * pixelSize.x, 0.0)).r;
+        float g = sampleSrgb(inputTexture, s, distortedUV).g;
+        float b = sampleSrgb(inputTexture, s, distortedUV - float2(bleed.y * pixelSize.x, bleed.z)).b;
 
         result = float3(r, g, b);
     } else {
-        result = inputTexture.sample(s, distortedUV).rgb;
+        result = sampleSrgb(inputTexture, s, distortedUV).rgb;
     }
 
     // === SATURATION LOSS ===
-    if (p.saturationLoss > 0.0) {
-        float luma = dot(result, float3(0.299, 0.587, 0.114));
-        result = mix(result, float3(luma), p.saturationLoss);
-    }
+    result = vhsSaturationLoss(result, p);
 
     // === SHARPNESS LOSS (BLUR) ===
     if (p.sharpnessLoss > 0.0) {
@@ -2004,39 +2842,89 @@ fragment float4 vhsEffectsFragment(
         float blur = p.sharpnessLoss * 2.0;
 
         // Simple box blur
-        blurred += inputTexture.sample(s, distortedUV + float2(blur, 0.0) * pixelSize).rgb;
-        blurred += inputTexture.sample(s, distortedUV - float2(blur, 0.0) * pixelSize).rgb;
-        blurred += inputTexture.sample(s, distortedUV + float2(0.0, blur) * pixelSize).rgb;
-        blurred += inputTexture.sample(s, distortedUV - float2(0.0, blur) * pixelSize).rgb;
+        blurred += sampleSrgb(inputTexture, s, distortedUV + float2(blur, 0.0) * pixelSize).rgb;
+        blurred += sampleSrgb(inputTexture, s, distortedUV - float2(blur, 0.0) * pixelSize).rgb;
+        blurred += sampleSrgb(inputTexture, s, distortedUV + float2(0.0, blur) * pixelSize).rgb;
+        blurred += sampleSrgb(inputTexture, s, distortedUV - float2(0.0, blur) * pixelSize).rgb;
         blurred /= 5.0;
 
         result = mix(result, blurred, p.sharpnessLoss * 0.5);
     }
 
-    // === SCANLINES ===
-    if (p.scanlinesEnabled != 0 && p.scanlinesIntensity > 0.0) {
-        float scanline = scanlinePattern(uv.y, p.scanlinesDensity, p.scanlinesIntensity);
+    result = vhsScanlinesAndNoise(result, uv, texSize, p, blueNoise);
 
-        // Add flicker
-        float flicker = 1.0 + sin(p.time * p.scanlinesFlickerSpeed * 30.0) * p.scanlinesFlickerIntensity * 0.1;
-        scanline *= flicker;
+    return storeSrgb(float4(saturate(result), 1.0));
+}
 
-        result *= scanline;
+// ★ Compute: footprint dịch theo tracking shift của row giữa tile (wave thay đổi chậm theo y);
+// apron = bleed ngang + blur, reach = vertical bleed. Glitch line / row lệch nhiều → tap đọc texture
+kernel void vhsEffectsKernel(
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float, access::write> outputTexture [[texture(1)]],
+    texture2d<float> blueNoise [[texture(TextureIndexBlueNoise)]],
+    constant VHSEffectsParams &p [[buffer(0)]],
+    constant KernelTileParams &tp [[buffer(BufferIndexKernelTile)]],
+    threadgroup half4 *tile [[threadgroup(0)]],
+    uint2 gid [[thread_position_in_grid]],
+    uint2 group [[threadgroup_position_in_grid]],
+    uint2 groupSize [[threads_per_threadgroup]],
+    uint lid [[thread_index_in_threadgroup]]
+) {
+    float2 texSize = float2(inputTexture.get_width(), inputTexture.get_height());
+    bool inside = gid.x < outputTexture.get_width() && gid.y < outputTexture.get_height();
+
+    if (p.enabled == 0) {
+        if (inside) outputTexture.write(inputTexture.read(gid), gid);
+        return;
     }
 
-    // === NOISE ===
-    if (p.noiseIntensity > 0.0) {
-        float noise = vhsNoise(uv, p.time, 3u);
+    float2 groupCenter = float2(group * groupSize) + float2(groupSize) * 0.5;
+    float2 centerUV = groupCenter / texSize;
+    int shift = int(round((vhsTrackingUV(centerUV, p, blueNoise).x - centerUV.x) * texSize.x));
 
-        // Add some color to the noise (VHS noise is slightly colored)
-        float3 coloredNoise = float3(noise);
-        coloredNoise.r += vhsNoise(uv + 0.1, p.time, 4u) * 0.1;
-        coloredNoise.b += vhsNoise(uv + 0.2, p.time, 5u) * 0.1;
+    TileFootprint fp = groupFootprint(group, groupSize, tp);
+    fp.origin.x += shift;
+    loadTile(tile, inputTexture, fp, lid, groupSize.x * groupSize.y, true);
+    threadgroup_barrier(mem_flags::mem_threadgroup);
 
-        result += coloredNoise * p.noiseIntensity * 0.1;
+    if (!inside) return;
+
+    float2 uv = (float2(gid) + 0.5) / texSize;
+    float2 position = vhsTrackingUV(uv, p, blueNoise) * texSize;
+
+    // === COLOR BLEED / CHROMATIC SEPARATION ===
+    float3 result;
+    if ((p.features & VHS_FEATURE_COLOR_BLEED) != 0 && p.colorBleedIntensity > 0.0) {
+        float3 bleed = vhsBleedOffsets(p);
+
+        float r = tileSample(tile, fp, inputTexture, position + float2(bleed.x, 0.0), true).r;
+        float g = tileSample(tile, fp, inputTexture, position, true).g;
+        float b = tileSample(tile, fp, inputTexture, position - float2(bleed.y, bleed.z * texSize.y), true).b;
+
+        result = float3(r, g, b);
+    } else {
+        result = tileSample(tile, fp, inputTexture, position, true).rgb;
     }
 
-    return float4(saturate(result), 1.0);
+    result = vhsSaturationLoss(result, p);
+
+    // === SHARPNESS LOSS (BLUR) ===
+    if (p.sharpnessLoss > 0.0) {
+        float3 blurred = result;
+        float blur = p.sharpnessLoss * 2.0;
+
+        blurred += tileSample(tile, fp, inputTexture, position + float2(blur, 0.0), true).rgb;
+        blurred += tileSample(tile, fp, inputTexture, position - float2(blur, 0.0), true).rgb;
+        blurred += tileSample(tile, fp, inputTexture, position + float2(0.0, blur), true).rgb;
+        blurred += tileSample(tile, fp, inputTexture, position - float2(0.0, blur), true).rgb;
+        blurred /= 5.0;
+
+        result = mix(result, blurred, p.sharpnessLoss * 0.5);
+    }
+
+    result = vhsScanlinesAndNoise(result, uv, texSize, p, blueNoise);
+
+    outputTexture.write(storeSrgb(float4(saturate(result), 1.0)), gid);
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -2045,11 +2933,9 @@ fragment float4 vhsEffectsFragment(
 // JPEG compression, sharpening, and banding
 // ═══════════════════════════════════════════════════════════════
 
-// Digital noise pattern (more structured than film grain)
-inline float digitalNoise(float2 uv, uint seed) {
-    float2 grid = floor(uv * 500.0);
-    float n = fract(sin(dot(grid + float(seed) * 0.1, float2(12.9898, 78.233))) * 43758.5453);
-    return n * 2.0 - 1.0;
+// Digital noise pattern (more structured than film grain) - blue noise trên lưới 500×500
+inline float digitalNoise(texture2d<float> blueNoise, float2 uv, uint seed) {
+    return noiseTexel(blueNoise, uv * 500.0, seed).r * 2.0 - 1.0;
 }
 
 // JPEG block pattern
@@ -2060,23 +2946,8 @@ inline float jpegBlockPattern(float2 uv, float blockSize) {
     return edge;
 }
 
-fragment float4 digicamEffectsFragment(
-    VertexOut in [[stage_in]],
-    texture2d<float> inputTexture [[texture(0)]],
-    constant DigicamEffectsParams &p [[buffer(0)]]
-) {
-    constexpr sampler s(filter::linear, address::clamp_to_edge);
-    float2 uv = in.texCoord;
-
-    if (p.enabled == 0) {
-        return inputTexture.sample(s, uv);
-    }
-
-    float2 texSize = float2(inputTexture.get_width(), inputTexture.get_height());
-    float2 pixelSize = 1.0 / texSize;
-
-    float3 result = inputTexture.sample(s, uv).rgb;
-
+// White balance, auto exposure, digital noise (chỉ phụ thuộc toạ độ pixel)
+inline float3 digicamSensor(float3 result, float2 uv, float2 texSize, constant DigicamEffectsParams &p, texture2d<float> blueNoise) {
     // === WHITE BALANCE SHIFT ===
     if (abs(p.whiteBalance) > 0.001) {
         // Positive = warmer, Negative = cooler
@@ -2092,12 +2963,12 @@ fragment float4 digicamEffectsFragment(
     // === DIGITAL NOISE ===
     if (p.digitalNoiseEnabled != 0 && p.digitalNoiseIntensity > 0.0) {
         // Luminance noise
-        float lNoise = digitalNoise(uv, p.seed);
+        float lNoise = digitalNoise(blueNoise, uv, p.seed);
         result += lNoise * p.luminanceNoise * 0.05;
 
         // Chrominance noise (colored)
-        float cNoiseR = digitalNoise(uv + 0.1, p.seed + 1u);
-        float cNoiseB = digitalNoise(uv + 0.2, p.seed + 2u);
+        float cNoiseR = digitalNoise(blueNoise, uv, p.seed + 1u);
+        float cNoiseB = digitalNoise(blueNoise, uv, p.seed + 2u);
         result.r += cNoiseR * p.chrominanceNoise * 0.03;
         result.b += cNoiseB * p.chrominanceNoise * 0.03;
 
@@ -2109,47 +2980,138 @@ fragment float4 digicamEffectsFragment(
 
         // Hot pixels
         if (p.hotPixels > 0.0) {
-            float hotPixel = step(0.999 - p.hotPixels * 0.01, digitalNoise(uv * 50.0, p.seed + 10u));
+            float hotPixel = step(0.999 - p.hotPixels * 0.01, digitalNoise(blueNoise, uv * 50.0, p.seed + 10u));
             result = mix(result, float3(1.0, 0.8, 0.8), hotPixel * 0.8);
         }
     }
 
+    return result;
+}
+
+// 8x8 block quantization simulation: block size theo UV
+inline float digicamBlockSize(float2 texSize) {
+    return 8.0 / min(texSize.x, texSize.y) * 100.0;
+}
+
+inline float3 digicamJPEG(float3 result, float2 uv, float blockSize, float3 blockColor, constant DigicamEffectsParams &p) {
+    // Blend toward block color (quantization)
+    result = mix(result, blockColor, p.jpegArtifacts * 0.3);
+
+    // Add block edge ringing
+    float edge = jpegBlockPattern(uv, 1.0 / blockSize);
+    return result - edge * p.jpegArtifacts * 0.05;
+}
+
+// Unsharp mask (blurred = trung bình 4 tap chéo ±1.5 px)
+inline float3 digicamSharpen(float3 result, float3 blurred, constant DigicamEffectsParams &p) {
+    float3 sharpened = result + (result - blurred) * p.sharpening;
+    result = sharpened;
+
+    // Add slight halos on edges (over-sharpening artifact)
+    float3 diff = abs(result - blurred);
+    float edgeMask = dot(diff, float3(0.33));
+    return result + edgeMask * p.sharpening * 0.2;
+}
+
+fragment float4 digicamEffectsFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float> blueNoise [[texture(TextureIndexBlueNoise)]],
+    constant DigicamEffectsParams &p [[buffer(0)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float2 uv = in.texCoord;
+
+    if (p.enabled == 0) {
+        return inputTexture.sample(s, uv);
+    }
+
+    float2 texSize = float2(inputTexture.get_width(), inputTexture.get_height());
+    float2 pixelSize = 1.0 / texSize;
+
+    float3 result = sampleSrgb(inputTexture, s, uv).rgb;
+    result = digicamSensor(result, uv, texSize, p, blueNoise);
+
     // === JPEG COMPRESSION ARTIFACTS ===
     if (p.jpegArtifacts > 0.0) {
-        // 8x8 block quantization simulation
-        float blockSize = 8.0 / min(texSize.x, texSize.y) * 100.0;
+        float blockSize = digicamBlockSize(texSize);
         float2 blockUV = floor(uv / blockSize) * blockSize;
 
         // Sample block average
-        float3 blockColor = inputTexture.sample(s, blockUV + blockSize * 0.5).rgb;
+        float3 blockColor = sampleSrgb(inputTexture, s, blockUV + blockSize * 0.5).rgb;
+        result = digicamJPEG(result, uv, blockSize, blockColor, p);
+    }
 
-        // Blend toward block color (quantization)
-        result = mix(result, blockColor, p.jpegArtifacts * 0.3);
+    // === DIGITAL SHARPENING ===
+    if (p.sharpening > 0.0) {
+        float3 blurred = sampleSrgb(inputTexture, s, uv + pixelSize * 1.5).rgb;
+        blurred += sampleSrgb(inputTexture, s, uv - pixelSize * 1.5).rgb;
+        blurred += sampleSrgb(inputTexture, s, uv + float2(1.5, -1.5) * pixelSize).rgb;
+        blurred += sampleSrgb(inputTexture, s, uv + float2(-1.5, 1.5) * pixelSize).rgb;
+        blurred *= 0.25;
 
-        // Add block edge ringing
-        float edge = jpegBlockPattern(uv, 1.0 / blockSize);
-        result -= edge * p.jpegArtifacts * 0.05;
+        result = digicamSharpen(result, blurred, p);
+    }
+
+    return storeSrgb(float4(saturate(result), 1.0));
+}
+
+// ★ Compute: unsharp mask đọc từ threadgroup tile (apron 3 px, 4 tap bilinear / pixel);
+// JPEG block color nằm xa pixel (block ~ 8% cạnh ngắn) → vẫn sample texture
+kernel void digicamEffectsKernel(
+    texture2d<float> inputTexture [[texture(0)]],
+    texture2d<float, access::write> outputTexture [[texture(1)]],
+    texture2d<float> blueNoise [[texture(TextureIndexBlueNoise)]],
+    constant DigicamEffectsParams &p [[buffer(0)]],
+    constant KernelTileParams &tp [[buffer(BufferIndexKernelTile)]],
+    threadgroup half4 *tile [[threadgroup(0)]],
+    uint2 gid [[thread_position_in_grid]],
+    uint2 group [[threadgroup_position_in_grid]],
+    uint2 groupSize [[threads_per_threadgroup]],
+    uint lid [[thread_index_in_threadgroup]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    bool inside = gid.x < outputTexture.get_width() && gid.y < outputTexture.get_height();
+
+    if (p.enabled == 0) {
+        if (inside) outputTexture.write(inputTexture.read(gid), gid);
+        return;
+    }
+
+    TileFootprint fp = groupFootprint(group, groupSize, tp);
+    loadTile(tile, inputTexture, fp, lid, groupSize.x * groupSize.y, true);
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    if (!inside) return;
+
+    float2 texSize = float2(inputTexture.get_width(), inputTexture.get_height());
+    float2 position = float2(gid) + 0.5;
+    float2 uv = position / texSize;
+
+    float3 result = tileTexel(tile, fp, inputTexture, int2(gid), true).rgb;
+    result = digicamSensor(result, uv, texSize, p, blueNoise);
+
+    // === JPEG COMPRESSION ARTIFACTS ===
+    if (p.jpegArtifacts > 0.0) {
+        float blockSize = digicamBlockSize(texSize);
+        float2 blockUV = floor(uv / blockSize) * blockSize;
+
+        float3 blockColor = sampleSrgb(inputTexture, s, blockUV + blockSize * 0.5).rgb;
+        result = digicamJPEG(result, uv, blockSize, blockColor, p);
     }
 
     // === DIGITAL SHARPENING ===
     if (p.sharpening > 0.0) {
-        // Unsharp mask
-        float3 blurred = inputTexture.sample(s, uv + pixelSize * 1.5).rgb;
-        blurred += inputTexture.sample(s, uv - pixelSize * 1.5).rgb;
-        blurred += inputTexture.sample(s, uv + float2(1.5, -1.5) * pixelSize).rgb;
-        blurred += inputTexture.sample(s, uv + float2(-1.5, 1.5) * pixelSize).rgb;
+        float3 blurred = tileSample(tile, fp, inputTexture, position + 1.5, true).rgb;
+        blurred += tileSample(tile, fp, inputTexture, position - 1.5, true).rgb;
+        blurred += tileSample(tile, fp, inputTexture, position + float2(1.5, -1.5), true).rgb;
+        blurred += tileSample(tile, fp, inputTexture, position + float2(-1.5, 1.5), true).rgb;
         blurred *= 0.25;
 
-        float3 sharpened = result + (result - blurred) * p.sharpening;
-        result = sharpened;
-
-        // Add slight halos on edges (over-sharpening artifact)
-        float3 diff = abs(result - blurred);
-        float edgeMask = dot(diff, float3(0.33));
-        result += edgeMask * p.sharpening * 0.2;
+        result = digicamSharpen(result, blurred, p);
     }
 
-    return float4(saturate(result), 1.0);
+    outputTexture.write(storeSrgb(float4(saturate(result), 1.0)), gid);
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -2181,7 +3143,7 @@ fragment float4 filmStripFragment(
         return inputTexture.sample(s, uv);
     }
 
-    float4 photo = inputTexture.sample(s, uv);
+    float4 photo = sampleSrgb(inputTexture, s, uv);
     float3 result = photo.rgb;
 
     float aspect = float(inputTexture.get_width()) / float(inputTexture.get_height());
@@ -2203,7 +3165,7 @@ fragment float4 filmStripFragment(
 
         // Clamp to valid range
         photoUV = clamp(photoUV, 0.0, 1.0);
-        result = inputTexture.sample(s, photoUV).rgb;
+        result = sampleSrgb(inputTexture, s, photoUV).rgb;
 
         // Add frame lines
         if (p.frameLineOpacity > 0.0) {
@@ -2223,7 +3185,7 @@ fragment float4 filmStripFragment(
         }
     } else {
         // Outside photo area - show film border/rebate
-        float3 borderColor = p.borderColor;
+        float3 borderColor = float3(p.borderColor);
 
         // Kodak orange rebate style
         if (p.kodakStyle != 0) {
@@ -2277,5 +3239,102 @@ fragment float4 filmStripFragment(
         }
     }
 
-    return float4(result, 1.0);
+    return storeSrgb(float4(result, 1.0));
+}
+
+// ═══════════════════════════════════════════════════════════════
+// ★★★ NEW: YUV → RGB (420f camera input) ★★★
+// Y plane r8Unorm (full res) + CbCr plane rg8Unorm (half res), full range.
+// Chạy với vertexAspectFill → thay luôn bước Scale như fused pass.
+// ═══════════════════════════════════════════════════════════════
+
+inline float3 yuvToRgbCore(float y, float2 cbcr, int matrix) {
+    float cb = cbcr.x - 0.5;
+    float cr = cbcr.y - 0.5;
+
+    float3 rgb;
+    if (matrix == YUVMatrixBT601) {
+        rgb = float3(y + 1.402 * cr,
+                     y - 0.344136 * cb - 0.714136 * cr,
+                     y + 1.772 * cb);
+    } else {
+        rgb = float3(y + 1.5748 * cr,
+                     y - 0.187324 * cb - 0.468124 * cr,
+                     y + 1.8556 * cb);
+    }
+    return saturate(rgb);
+}
+
+fragment float4 yuvToRGBFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> lumaTexture [[texture(0)]],
+    texture2d<float> chromaTexture [[texture(1)]],
+    constant YUVConvertParams &params [[buffer(0)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float y = lumaTexture.sample(s, in.texCoord).r;
+    float2 cbcr = chromaTexture.sample(s, in.texCoord).rg;
+    return storeSrgb(float4(yuvToRgbCore(y, cbcr, params.matrix), 1.0));
+}
+
+// ═══════════════════════════════════════════════════════════════
+// ★★★ NEW: FUSED PREVIEW SHADER (Uber-shader cho live viewfinder) ★★★
+// Chạy ColorGrading → SkinTone → ToneMapping → B&W → Flash → Vignette → Grain
+// trong 1 fragment invocation. Blur (CCD bloom, bloom, halation) vẫn là pass riêng,
+// FilterRenderer tách chuỗi stage tại các blur đó để giữ đúng thứ tự.
+//
+// Dùng vertexAspectFill nên pass này cũng thay luôn bước Scale.
+// Sai khác so với multi-pass: multi-pass lượng tử hóa về 8-bit sau mỗi stage,
+// fused giữ float32 trong register → chênh lệch ≤ 2/255 mỗi kênh.
+// ═══════════════════════════════════════════════════════════════
+
+fragment float4 fusedPreviewFragment(
+    VertexOut in [[stage_in]],
+    texture2d<float> inputTexture [[texture(0)]],
+    texture3d<float> lutTexture [[texture(1)]],
+    texture2d<float> chromaTexture [[texture(2)]],
+    constant FusedPreviewParams &f [[buffer(0)]],
+    constant ColorGradingParams &colorGrading [[buffer(1)]],
+    constant SkinToneParams &skinTone [[buffer(2)]],
+    constant ToneMappingParams &toneMapping [[buffer(3)]],
+    constant BWParams &bw [[buffer(4)]],
+    constant FlashParams &flash [[buffer(5)]],
+    constant VignetteParams &vignette [[buffer(6)]],
+    constant GrainParams &grain [[buffer(7)]],
+    texture3d<float> bakedGrading [[texture(3)]],
+    texture1d<float> bakedBWTone [[texture(4)]],
+    texture1d<float> curvesTexture [[texture(TextureIndexCurves)]],
+    texture2d<float> grainNoise [[texture(TextureIndexNoise)]]
+) {
+    constexpr sampler s(filter::linear, address::clamp_to_edge);
+    float4 color = inputTexture.sample(s, in.texCoord);
+    if (f.stageMask & FUSED_STAGE_YUV_INPUT) {
+        // inputTexture là Y plane → convert ngay trong register, không có pass YUV riêng
+        color = float4(yuvToRgbCore(color.r, chromaTexture.sample(s, in.texCoord).rg, f.yuvMatrix), 1.0);
+    } else {
+        color = loadSrgb(color);
+    }
+    float3 rgb = color.rgb;
+
+    // Các effect phụ thuộc vị trí dùng UV của render target (không phải UV đã aspect-fill)
+    float2 uv = in.position.xy / f.outputSize;
+    float aspect = f.outputSize.x / f.outputSize.y;
+
+    if (f.stageMask & FUSED_STAGE_COLOR_GRADING) {
+        rgb = (f.stageMask & FUSED_STAGE_BAKED_GRADING)
+            ? linearToSrgb3(sampleBakedGrading(bakedGrading, rgb))
+            : colorGradingCore(rgb, colorGrading, lutTexture, curvesTexture);
+    }
+    if (f.stageMask & FUSED_STAGE_SKIN_TONE)     rgb = skinToneCore(rgb, skinTone);
+    if (f.stageMask & FUSED_STAGE_TONE_MAPPING)  rgb = toneMappingCore(rgb, toneMapping);
+    if (f.stageMask & FUSED_STAGE_BW) {
+        rgb = (f.stageMask & FUSED_STAGE_BAKED_BW)
+            ? bwConvertBaked(rgb, uv, bw, bakedBWTone, grainNoise)
+            : bwConvertCore(rgb, uv, bw, grainNoise);
+    }
+    if (f.stageMask & FUSED_STAGE_FLASH)         rgb = flashCore(rgb, uv, aspect, flash);
+    if (f.stageMask & FUSED_STAGE_VIGNETTE)      rgb = vignetteCore(rgb, uv, aspect, vignette);
+    if (f.stageMask & FUSED_STAGE_GRAIN)         rgb = grainCore(rgb, uv, f.outputSize, grain, grainNoise);
+
+    return float4(storeSrgb(rgb), color.a);
 }
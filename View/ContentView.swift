@@ -70,7 +70,7 @@ struct ContentView: View {
             // Load last photo thumbnail from gallery
             if let lastPhoto = galleryManager.mostRecentPhoto {
                 Task {
-                    lastCapturedImage = await galleryManager.loadThumbnailAsync(id: lastPhoto.id)
+                    lastCapturedImage = await galleryManager.loadThumbnailAsync(id: lastPhoto.id, level: .small)
                 }
             }
         }
@@ -176,9 +176,11 @@ struct ContentView: View {
         }
         .onChange(of: selectedPreset) { _, newPreset in
             effectManager.loadPreset(newPreset)
+            prioritizeLUTResidency(for: newPreset)
         }
         .onAppear {
             effectManager.loadPreset(selectedPreset)
+            prioritizeLUTResidency(for: selectedPreset)
         }
         .sheet(isPresented: $showPresetPicker) {
             PresetPickerView(
@@ -539,6 +541,26 @@ struct ContentView: View {
         }
     }
     
+    // MARK: - LUT Residency
+
+    /// ★ Load active preset LUT first, then ±2 neighbours in the carousel
+    private func prioritizeLUTResidency(for preset: FilterPreset) {
+        guard RenderEngine.isAvailable else { return }
+
+        let carousel = FilmPresets.presets(for: preset.category)
+        var neighbours: [FilterPreset] = []
+        if let index = carousel.firstIndex(where: { $0.id == preset.id }) {
+            for offset in [1, -1, 2, -2] {
+                let neighbourIndex = index + offset
+                if carousel.indices.contains(neighbourIndex) {
+                    neighbours.append(carousel[neighbourIndex])
+                }
+            }
+        }
+
+        RenderEngine.shared.prioritizeLUTs(active: preset, neighbours: neighbours)
+    }
+
     // MARK: - Actions
 
     private func capturePhoto() {
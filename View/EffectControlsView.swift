@@ -11,6 +11,8 @@ import SwiftUI
 
 struct EffectControlsView: View {
     @ObservedObject var effectManager: EffectStateManager
+    /// Slider drag began (true) / ended (false) — PhotoEditorView renders a proxy while dragging
+    var onEditingChanged: (Bool) -> Void = { _ in }
     @State private var selectedGroup: EffectGroup = .film
     @State private var expandedEffect: EffectType?
 
@@ -33,6 +35,7 @@ struct EffectControlsView: View {
                             onToggle: { effectManager.toggleEffect(effect) },
                             onIntensityChange: { effectManager.setEffectIntensity(effect, intensity: $0) },
                             onSliderChange: { effectManager.setSliderValue(effect, value: $0) },
+                            onEditingChanged: onEditingChanged,
                             onTap: {
                                 withAnimation(.easeInOut(duration: 0.2)) {
                                     expandedEffect = expandedEffect == effect ? nil : effect
@@ -121,6 +124,7 @@ struct EffectControlRow: View {
     let onToggle: () -> Void
     let onIntensityChange: (Float) -> Void
     let onSliderChange: (Float) -> Void
+    let onEditingChanged: (Bool) -> Void
     let onTap: () -> Void
 
     private var isEnabled: Bool { value.isEnabled }
@@ -237,7 +241,8 @@ struct EffectControlRow: View {
                             get: { intensity },
                             set: { onIntensityChange($0) }
                         ),
-                        in: 0...1
+                        in: 0...1,
+                        onEditingChanged: onEditingChanged
                     )
                     .tint(.blue)
                     Text(String(format: "%.0f%%", intensity * 100))
@@ -261,7 +266,8 @@ struct EffectControlRow: View {
                             get: { val },
                             set: { onSliderChange($0) }
                         ),
-                        in: minVal...maxVal
+                        in: minVal...maxVal,
+                        onEditingChanged: onEditingChanged
                     )
                     .tint(val >= 0 ? .blue : .orange)
 
@@ -56,6 +56,17 @@ struct PhotoEditorView: View {
     // Processing state with ID to track which filter is active
     @State private var processingPresetId: String?
 
+    // ★★★ NEW: Effect adjustments + incremental re-render ★★★
+    @StateObject private var effectManager = EffectStateManager()
+    @State private var editorSession: EditorRenderSession?
+    @State private var showAdjustments = false
+    @State private var isDraggingSlider = false
+
+    /// Selected preset with the user's effect overrides applied
+    private var effectivePreset: FilterPreset {
+        effectManager.applyToPreset() ?? selectedPreset
+    }
+
     var body: some View {
         ZStack {
             Color.black.ignoresSafeArea()
@@ -82,10 +93,23 @@ struct PhotoEditorView: View {
             loadImage(from: newItem)
         }
         .onChange(of: selectedPreset) { _, newPreset in
+            effectManager.loadPreset(newPreset)
+            if originalImage != nil {
+                applyFilterDebounced(preset: effectivePreset)
+            }
+        }
+        .onChange(of: effectManager.effectOverrides) { _, _ in
+            // Proxy, only the passes after the changed effect re-run (RenderGraphCache); .full once settled
             if originalImage != nil {
-                applyFilterDebounced(preset: newPreset)
+                applyFilterDebounced(preset: effectivePreset)
             }
         }
+        .onAppear {
+            effectManager.loadPreset(selectedPreset)
+        }
+        .onReceive(NotificationCenter.default.publisher(for: UIApplication.didReceiveMemoryWarningNotification)) { _ in
+            editorSession?.purge()
+        }
         .alert("Photo Saved", isPresented: $showSavedAlert) {
             Button("OK") { dismiss() }
         } message: {
@@ -220,6 +244,16 @@ struct PhotoEditorView: View {
 
                 Spacer()
 
+                Button(action: { withAnimation(.easeInOut(duration: 0.2)) { showAdjustments.toggle() } }) {
+                    Image(systemName: "slider.horizontal.3")
+                        .font(.system(size: 13, weight: .medium))
+                        .foregroundColor(showAdjustments ? .black : .white)
+                        .padding(.horizontal, 12)
+                        .padding(.vertical, 8)
+                        .background(showAdjustments ? .white : .white.opacity(0.2))
+                        .cornerRadius(18)
+                }
+
                 Button(action: { showBeforeAfter.toggle() }) {
                     HStack(spacing: 6) {
                         Image(systemName: showBeforeAfter ? "square.split.2x1.fill" : "square.split.2x1")
@@ -236,9 +270,21 @@ struct PhotoEditorView: View {
             .padding(.horizontal, 16)
             .padding(.top, 12)
 
-            categoryScrollView
-            presetScrollView
-                .padding(.bottom, 20)
+            if showAdjustments {
+                EffectControlsView(effectManager: effectManager) { editing in
+                    isDraggingSlider = editing
+                    if !editing {
+                        // Release → full resolution render of the final value
+                        applyFilterDebounced(preset: effectivePreset, resolution: .full)
+                    }
+                }
+                .frame(height: 300)
+                .transition(.move(edge: .bottom))
+            } else {
+                categoryScrollView
+                presetScrollView
+                    .padding(.bottom, 20)
+            }
         }
         .background(
             LinearGradient(
@@ -340,12 +386,16 @@ struct PhotoEditorView: View {
                 let preview = uiImage.resizedIfNeeded(maxDimension: maxPreviewDimension)
                 let fullRes = uiImage.resizedIfNeeded(maxDimension: maxFullResDimension)
 
+                // Upload once; proxy + full renders reuse these textures and cached passes
+                let session = EditorRenderSession(image: fullRes)
+
                 await MainActor.run {
                     self.previewImage = preview
                     self.fullResImage = fullRes
                     self.originalImage = preview
+                    self.editorSession = session
                     self.isProcessing = false
-                    applyFilterDebounced(preset: selectedPreset)
+                    applyFilterDebounced(preset: effectivePreset)
                 }
             } catch {
                 await MainActor.run {
@@ -359,40 +409,28 @@ struct PhotoEditorView: View {
 
     // MARK: - Filter Application
 
-    private func applyFilterDebounced(preset: FilterPreset) {
+    /// - resolution: .proxy for interactive changes (preset tap, slider, toggle) → .full follows once the
+    ///   value settled for settleDelay; .full directly on slider release
+    ///   EditorRenderSession unavailable → lightweight gallery preview of the preview image
+    private func applyFilterDebounced(preset: FilterPreset, resolution: EditorRenderSession.Resolution = .proxy) {
         currentFilterTask?.cancel()
 
         guard let original = previewImage ?? originalImage else { return }
 
         processingPresetId = preset.id
+        let session = editorSession
 
         currentFilterTask = Task { @MainActor in
-            try? await Task.sleep(nanoseconds: 100_000_000)
-
-            guard !Task.isCancelled, preset.id == selectedPreset.id else { return }
-
-            let filtered: UIImage? = await withCheckedContinuation { continuation in
-                DispatchQueue.global(qos: .userInitiated).async {
-                    guard !Task.isCancelled else {
-                        continuation.resume(returning: nil)
-                        return
-                    }
-
-                    if RenderEngine.isAvailable {
-                        let result = RenderEngine.shared.applyFilterPreview(to: original, preset: preset)
-                        continuation.resume(returning: result)
-                    } else {
-                        continuation.resume(returning: nil)
-                    }
-                }
-            }
+            try? await Task.sleep(nanoseconds: resolution == .proxy ? 16_000_000 : 100_000_000)
 
             guard !Task.isCancelled, preset.id == selectedPreset.id else { return }
+            guard await showFiltered(preset: preset, resolution: resolution, session: session, fallback: original) else { return }
 
-            if let filtered = filtered {
-                self.filteredImage = filtered
-            } else {
-                self.filteredImage = original
+            // Settled → full resolution of the same value (không chạy khi ngón tay còn giữ slider)
+            if resolution == .proxy, session != nil {
+                try? await Task.sleep(nanoseconds: Self.settleDelay)
+                guard !Task.isCancelled, !isDraggingSlider, preset.id == selectedPreset.id else { return }
+                guard await showFiltered(preset: preset, resolution: .full, session: session, fallback: original) else { return }
             }
 
             if processingPresetId == preset.id {
@@ -401,21 +439,53 @@ struct PhotoEditorView: View {
         }
     }
 
+    /// Idle time after the last interactive change before the .full render
+    private static let settleDelay: UInt64 = 250_000_000
+
+    /// Render off the main thread and display; false when superseded by a newer change
+    @MainActor
+    private func showFiltered(preset: FilterPreset, resolution: EditorRenderSession.Resolution, session: EditorRenderSession?, fallback: UIImage) async -> Bool {
+        let filtered: UIImage? = await withCheckedContinuation { continuation in
+            DispatchQueue.global(qos: .userInitiated).async {
+                if let session = session {
+                    continuation.resume(returning: session.render(preset: preset, resolution: resolution))
+                } else if RenderEngine.isAvailable {
+                    let result = RenderEngine.shared.applyFilterPreview(to: fallback, preset: preset)
+                    continuation.resume(returning: result)
+                } else {
+                    continuation.resume(returning: nil)
+                }
+            }
+        }
+
+        guard !Task.isCancelled, preset.id == selectedPreset.id else { return false }
+
+        filteredImage = filtered ?? fallback
+        return true
+    }
+
     // MARK: - Save Photo
 
     private func savePhoto() {
         guard let fullRes = fullResImage ?? originalImage else { return }
 
         isProcessing = true
+        let preset = effectivePreset
+        let session = editorSession
 
         Task {
             let imageToSave: UIImage = await withCheckedContinuation { continuation in
                 DispatchQueue.global(qos: .userInitiated).async {
+                    // Same renderer as the screen: session seed + stamp date → the saved photo is what was shown
+                    if let filtered = session?.render(preset: preset, resolution: .full) {
+                        continuation.resume(returning: filtered)
+                        return
+                    }
                     guard RenderEngine.isAvailable else {
                         continuation.resume(returning: fullRes)
                         return
                     }
-                    if let filtered = RenderEngine.shared.applyFilter(to: fullRes, preset: selectedPreset) {
+                    if let filtered = RenderEngine.shared.applyFilter(to: fullRes, preset: preset) {
                         continuation.resume(returning: filtered)
                     } else {
                         continuation.resume(returning: fullRes)